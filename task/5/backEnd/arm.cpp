@@ -1,5 +1,7 @@
 #include "arm.h"
 #include "Module.h"
+#include "PassStats.h"
+#include "vectorLoop.h"
 #include <cmath>
 using namespace std;
 
@@ -15,6 +17,7 @@ static map<ValuePtr, int> stack_val_map;
 static map<pair<ValuePtr, ValuePtr>, MOperand> vv_div_map;
 static map<pair<int, ValuePtr>, MOperand> cv_div_map;
 static map<pair<ValuePtr, int>, MOperand> vc_div_map;
+static map<ValuePtr, MOperand> phi_incoming_map;
 ValuePtr cur_arr_base;
 
 MOperand make_imm(int32 constant) { return MOperand(IMM, constant); } // 创建立即数操作数
@@ -210,6 +213,7 @@ void clear_function_related_variables() {
     vv_div_map.clear();     // 清除变量对变量除法结果缓存
     cv_div_map.clear();     // 清除常量对变量除法结果缓存
     vc_div_map.clear();     // 清除变量对常量除法结果缓存
+    phi_incoming_map.clear(); // 清除phi在前驱中赋值的虚拟寄存器
 }
 
 // 获取分支条件对应的汇编后缀字符串
@@ -325,11 +329,11 @@ void get_init_sequence(VariablePtr globalarr,
 void build_globals(String_Builder *s, vector<VariablePtr> &globals) {
     if (globals.size() == 0)
         return;
-    s->append(".data\n.align 2\n");
+    s->put(".data\n.align 2\n");
     for (int i = 0; i < globals.size(); i++) {
         if (globals[i]->type->isInt()) {
             s->append("%s:\n", globals[i]->name.c_str());
-            s->append("    ");
+            s->put("    ");
             int32 val = dynamic_cast<Int *>(globals[i].get())->intVal;
             s->append(".word %d\n", val);
         } else if (globals[i]->type->isArr()) {
@@ -341,7 +345,7 @@ void build_globals(String_Builder *s, vector<VariablePtr> &globals) {
                 get_init_sequence(globals[i], init_inst);
                 s->append("%s:\n", globals[i]->name.c_str());
                 for (int j = 0; j < init_inst.size(); j++) {
-                    s->append("    ");
+                    s->put("    ");
                     s->append("%s  %d\n", init_inst[j].first.c_str(),
                               init_inst[j].second);
                 }
@@ -350,8 +354,8 @@ void build_globals(String_Builder *s, vector<VariablePtr> &globals) {
             printf("globals error type\n");
         }
     }
-    s->append(".bss\n");
-    s->append(".align 2\n");
+    s->put(".bss\n");
+    s->put(".align 2\n");
     for (int i = 0; i < globals.size(); i++) {
         if (globals[i]->type->isArr()) {
             auto globalarr = dynamic_cast<Arr *>(globals[i].get());
@@ -572,14 +576,150 @@ MI_Move* emit_move(MOperand dst, MOperand src, Machine_Block* mb) {
     return mv;
 }
 
+// 把常量放到新的虚拟寄存器里，能编码成立即数时用mov/mvn，否则从字面量池加载
+static MOperand emit_constant_reg(int32 constant, Machine_Block *mb) {
+    auto vreg = make_vreg(vreg_count++);
+    if (can_be_imm_ror(constant) || (constant < 0 && can_be_imm_ror(~constant)))
+        emit_move(vreg, make_imm(constant), mb);
+    else
+        emit_load_of_constant(vreg, constant, mb);
+    return vreg;
+}
+
+// 有符号除以常量d的魔数（Hacker's Delight 10-1），|d| >= 2且不是2的幂
+// x / d = t + (t < 0)，其中t = (smmul(x, magic) [+ x 或 - x]) >> shift
+static void signed_div_magic(int32 d, int32 &magic, int32 &shift) {
+    const uint32 two31 = 0x80000000u;
+    uint32 ad = d < 0 ? 0u - (uint32)d : (uint32)d;
+    uint32 t = two31 + ((uint32)d >> 31);
+    uint32 anc = t - 1 - t % ad;
+    uint32 q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32 q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32 delta;
+    int p = 31;
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    magic = (int32)(q2 + 1);
+    if (d < 0)
+        magic = -magic;
+    shift = p - 32;
+}
+
+// dst = x / d，d是常量且|d| >= 2，不是INT_MIN
+static void emit_div_by_constant(MOperand dst, MOperand x, int32 d, Machine_Block *mb) {
+    uint32 ad = d < 0 ? 0u - (uint32)d : (uint32)d;
+    if ((ad & (ad - 1)) == 0) {
+        // 2的幂：负数先加上2^k - 1再算术右移，使结果向零取整
+        int k = __builtin_ctz(ad);
+        auto sign = x;
+        if (k > 1) {
+            sign = make_vreg(vreg_count++);
+            mb->push((MI *)new MI_Binary(BINARY_ASR, sign, x, make_imm(31)));
+        }
+        auto bias = sign;
+        bias.s_tag = LSR;
+        bias.s_value = 32 - k;
+        auto t = make_vreg(vreg_count++);
+        mb->push((MI *)new MI_Binary(BINARY_ADD, t, x, bias));
+        if (d > 0) {
+            mb->push((MI *)new MI_Binary(BINARY_ASR, dst, t, make_imm(k)));
+        } else {
+            auto q = make_vreg(vreg_count++);
+            mb->push((MI *)new MI_Binary(BINARY_ASR, q, t, make_imm(k)));
+            mb->push((MI *)new MI_Binary(BINARY_RSB, dst, q, make_imm(0)));
+        }
+        return;
+    }
+
+    int32 magic, shift;
+    signed_div_magic(d, magic, shift);
+    auto t = make_vreg(vreg_count++);
+    mb->push((MI *)new MI_Binary(BINARY_SMMUL, t, x, emit_constant_reg(magic, mb)));
+    // 魔数的符号与d相反时说明它溢出了32位，补上或减去x
+    if (d > 0 && magic < 0) {
+        auto t2 = make_vreg(vreg_count++);
+        mb->push((MI *)new MI_Binary(BINARY_ADD, t2, t, x));
+        t = t2;
+    } else if (d < 0 && magic > 0) {
+        auto t2 = make_vreg(vreg_count++);
+        mb->push((MI *)new MI_Binary(BINARY_SUBTRACT, t2, t, x));
+        t = t2;
+    }
+    if (shift > 0) {
+        auto t2 = make_vreg(vreg_count++);
+        mb->push((MI *)new MI_Binary(BINARY_ASR, t2, t, make_imm(shift)));
+        t = t2;
+    }
+    // 商为负时加1，向零取整
+    auto sign = t;
+    sign.s_tag = LSR;
+    sign.s_value = 31;
+    mb->push((MI *)new MI_Binary(BINARY_ADD, dst, t, sign));
+}
+
+// 除数是常量时不用sdiv：2的幂用移位，其余用smmul乘魔数；取模为x - (x / |d|) * |d|
+static void emit_div_mod_by_constant(Binary_Op_Type op_type, MOperand dst, MOperand x, int32 d, Machine_Block *mb) {
+    uint32 ad = d < 0 ? 0u - (uint32)d : (uint32)d;
+    if (op_type == BINARY_DIVIDE) {
+        if (d == 1)
+            emit_move(dst, x, mb);
+        else if (d == -1)
+            mb->push((MI *)new MI_Binary(BINARY_RSB, dst, x, make_imm(0)));
+        else
+            emit_div_by_constant(dst, x, d, mb);
+        return;
+    }
+
+    // 余数的符号只跟被除数有关
+    if (ad == 1) {
+        emit_move(dst, make_imm(0), mb);
+        return;
+    }
+    auto q = make_vreg(vreg_count++);
+    emit_div_by_constant(q, x, (int32)ad, mb);
+    if ((ad & (ad - 1)) == 0) {
+        auto scaled = q;
+        scaled.s_tag = LSL;
+        scaled.s_value = __builtin_ctz(ad);
+        mb->push((MI *)new MI_Binary(BINARY_SUBTRACT, dst, x, scaled));
+    } else {
+        mb->push((MI *)new MI_ComplexMul(COMPLEX_MLS, dst, q, emit_constant_reg((int32)ad, mb), x));
+    }
+}
+
 // 生成二元运算指令
 void emit_Binary(InstructionPtr I, Machine_Block* mb) {
     auto bi_I = dynamic_cast<BinaryInstruction*>(I.get());
     string myop;
     myop += bi_I->op;
     auto op_type = Binary_ir2asm[myop];
-    
+
     auto lhs = make_operand(bi_I->getOperand(0), mb, true);
+
+    // 除以非零常量（INT_MIN除外）
+    auto divisor = bi_I->getOperand(1);
+    if ((op_type == BINARY_DIVIDE || op_type == BINARY_MOD) && divisor->isConst) {
+        int32 d = dynamic_cast<Const *>(divisor.get())->intVal;
+        if (d != 0 && d != INT32_MIN) {
+            emit_div_mod_by_constant(op_type, make_operand(bi_I->reg, mb, true), lhs, d, mb);
+            return;
+        }
+    }
+
     auto rhs = make_operand(bi_I->getOperand(1), mb, true);
     auto dst = make_operand(bi_I->reg, mb, true);
 
@@ -876,10 +1016,7 @@ void emit_Gep(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<Va
                 if (ptr_I->from->type->ID == PtrID) {
                     auto tmp = dynamic_cast<PtrType *>(
                         ptr_I->from->type.get());
-                    if (tmp->inner->isArr())
-                        const_size = dynamic_cast<ArrType *>(
-                                        tmp->inner.get())
-                                        ->getSize();
+                    const_size = tmp->inner->getNumElements();
                 } else if (ptr_I->from->type->ID == IntID ||
                         ptr_I->from->type->ID == FLoatID) {
                     const_size = 1;  // 基本类型大小为1个元素
@@ -892,19 +1029,13 @@ void emit_Gep(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<Va
                 assert(ptr_I->from->type->ID == ArrID);
                 auto tmp = dynamic_cast<ArrType *>(
                     ptr_I->from->type.get());
-                if (tmp->inner->isArr())
-                    const_size =
-                        dynamic_cast<ArrType *>(tmp->inner.get())
-                            ->getSize();
+                const_size = tmp->getStride();
                 cur_arr = tmp->inner;  // 更新当前处理的数组类型
             } else if (i > 1) {
                 // 更高维度 - 继续深入数组类型
                 assert(cur_arr->ID == ArrID);
                 auto nc = dynamic_cast<ArrType *>(cur_arr.get());
-                if (nc->inner->isArr())
-                    const_size =
-                        dynamic_cast<ArrType *>(nc->inner.get())
-                            ->getSize();
+                const_size = nc->getStride();
                 cur_arr = nc->inner;  // 更新当前处理的数组类型
             }
             
@@ -915,8 +1046,7 @@ void emit_Gep(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<Va
                 // 需要动态计算偏移量
                 if (x != ptr_I->index.back() || const_size != 1) {
                     // 创建表示维度大小的整数常量
-                    ValuePtr imptr = ValuePtr(
-                        new Int("asdf", false, false, const_size));
+                    ValuePtr imptr = newIR<Int>("asdf", false, false, const_size);
                     // 创建乘法指令：索引 * 维度大小
                     auto bi_mul = new MI_Binary;
                     bi_mul->op = BINARY_MULTIPLY;
@@ -954,18 +1084,12 @@ void emit_Gep(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<Va
                 // 第二维 - 获取第一维的内部类型
                 auto tmp = dynamic_cast<ArrType *>(
                     ptr_I->from->type.get());
-                if (tmp->inner->isArr())
-                    const_size =
-                        dynamic_cast<ArrType *>(tmp->inner.get())
-                            ->getSize();
+                const_size = tmp->getStride();
                 cur_arr = tmp->inner;  // 更新当前处理的数组类型
             } else {
                 // 更高维度 - 继续深入数组类型
                 auto nc = dynamic_cast<ArrType *>(cur_arr.get());
-                if (nc->inner->isArr())
-                    const_size =
-                        dynamic_cast<ArrType *>(nc->inner.get())
-                            ->getSize();
+                const_size = nc->getStride();
                 cur_arr = nc->inner;  // 更新当前处理的数组类型
             }
             
@@ -976,8 +1100,7 @@ void emit_Gep(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<Va
                 // 需要动态计算偏移量
                 if (x != ptr_I->index.back()) {
                     // 创建表示维度大小的整数常量
-                    ValuePtr imptr = ValuePtr(
-                        new Int("asdf", false, false, const_size));
+                    ValuePtr imptr = newIR<Int>("asdf", false, false, const_size);
                     // 创建乘法指令：索引 * 维度大小
                     auto bi_mul = new MI_Binary;
                     bi_mul->op = BINARY_MULTIPLY;
@@ -1430,8 +1553,196 @@ void emit_Store(Func_Asm *func_asm, InstructionPtr I, Machine_Block *mb, vector<
     mb->push((MI *)str);  // 将存储指令添加到基本块
 }
 
+// ---------------------------------------------------------------------------
+// NEON向量化
+// 能向量化的循环形式及q寄存器的分配由opt/vectorLoop.h的analyzeVectorLoop判断（loopUnroll也用它避开这些循环），
+// 这里在原循环前插入每次处理4个int的向量循环，剩下不足4次的迭代仍由原循环完成
+
+static Machine_Block *new_vector_block(Machine_Block *header, const char *suffix, uint32 loop_depth) {
+    auto mb = new Machine_Block();
+    mb->label = LabelPtr(new Label(header->label->name + suffix));
+    mb->func = header->func;
+    mb->loop_depth = loop_depth;
+    return mb;
+}
+
+static void link_blocks(Machine_Block *from, Machine_Block *to) {
+    from->succs.push(to);
+    to->preds.push(from);
+}
+
+static MI_Branch *emit_block_branch(Machine_Block *mb, Branch_Condition cond, Machine_Block *true_target,
+                                    Machine_Block *false_target = NULL) {
+    auto br = new MI_Branch(cond, true_target, false_target);
+    mb->push((MI *)br);
+    mb->control_transfer_inst = (MI *)br;
+    link_blocks(mb, true_target);
+    if (false_target)
+        link_blocks(mb, false_target);
+    return br;
+}
+
+static Binary_Op_Type neon_op(char op) {
+    return op == '+' ? BINARY_ADD : op == '-' ? BINARY_SUBTRACT : BINARY_MULTIPLY;
+}
+
+// 在循环头之前插入：
+//   guard:  cmp i, n; 不满足循环条件时跳到header
+//   check:  t = n - i; 地址、广播和累加器初始化; t < threshold时跳到header
+//   body:   每次处理4个元素，i += 4，t -= 4，t >= threshold时继续
+//   reduce: 累加器求和后加到归约的phi上
+// 向量循环直接更新phi在前驱中赋值的虚拟寄存器，原循环从i继续执行剩余的迭代
+static void emit_vector_loop(Func_Asm *func_asm, VectorLoop &vl) {
+    auto loop = vl.loop;
+    auto pre = func_asm->mbs[func_asm->bb2idx[loop->getPreheader()]];
+    auto head = func_asm->mbs[func_asm->bb2idx[loop->getHeader()]];
+    auto guard = new_vector_block(head, ".vec.guard", head->loop_depth - 1);
+    auto check = new_vector_block(head, ".vec.check", head->loop_depth - 1);
+    auto body = new_vector_block(head, ".vec.body", head->loop_depth);
+    auto reduce = vl.reduction.empty() ? nullptr : new_vector_block(head, ".vec.reduce", head->loop_depth - 1);
+    auto q = [&](Value *v) { return MOperand(QREG, vl.qreg[v]); };
+    auto i = phi_incoming_map[vl.ind->reg];
+
+    // 前置块改为跳到guard
+    auto pre_br = (MI_Branch *)pre->control_transfer_inst;
+    assert(pre_br && pre_br->tag == MI_BRANCH && pre->succs.find(head) != -1);
+    if (pre_br->true_target == head)
+        pre_br->true_target = guard;
+    if (pre_br->false_target == head)
+        pre_br->false_target = guard;
+    pre->succs[pre->succs.find(head)] = guard;
+    head->preds.remove(pre);
+    guard->preds.push(pre);
+
+    auto n = make_operand(loop->indEnd, guard, true);
+    guard->push(new MI_Compare(i, n));
+    emit_block_branch(guard, vl.threshold == 4 ? GREATER_THAN_OR_EQUAL : GREATER_THAN, head, check);
+
+    auto t = make_vreg(vreg_count++);
+    check->push(new MI_Binary(BINARY_SUBTRACT, t, n, i));
+    map<pair<ValuePtr, int>, MOperand> bases;
+    for (auto &a : vl.access) {
+        if (bases.count(a.second))
+            continue;
+        auto array = a.second.first;
+        MOperand base;
+        if (array->type->isArr() && !dynamic_cast<AllocaInstruction *>(array->I)) {
+            base = make_vreg(vreg_count++);
+            emit_load_of_global_ref(func_asm, array, base, check);
+        } else {
+            base = value_map[array];
+        }
+        if (a.second.second) {
+            auto moved = make_vreg(vreg_count++);
+            auto offset = make_ror_imm(a.second.second * 4, check);
+            check->push(new MI_Binary(BINARY_ADD, moved, base, offset));
+            base = moved;
+        }
+        bases[a.second] = base;
+    }
+    for (auto v : vl.broadcast)
+        check->push(new MI_Neon_Dup(q(v.get()), make_operand(v, check, true)));
+    for (auto &r : vl.reduction)
+        check->push(new MI_Neon_Dup(q(r.second->reg.get()), make_imm(0)));
+    check->push(new MI_Compare(t, make_imm(vl.threshold)));
+    emit_block_branch(check, LESS_THAN, head, body);
+
+    // 每个数组本次迭代的地址
+    map<pair<ValuePtr, int>, MOperand> addrs;
+    auto scaled_i = i;
+    scaled_i.s_tag = LSL;
+    scaled_i.s_value = 2;
+    for (auto &b : bases) {
+        auto addr = make_vreg(vreg_count++);
+        body->push(new MI_Binary(BINARY_ADD, addr, b.second, scaled_i));
+        addrs[b.first] = addr;
+    }
+    for (auto I : vl.body) {
+        switch (I->type) {
+            case Load: {
+                auto ld = dynamic_cast<LoadInstruction *>(I);
+                body->push(new MI_Neon_Mem(MI_VLD1, q(ld->to.get()), addrs[vl.access[ld->from.get()]]));
+            } break;
+            case Store: {
+                auto st = dynamic_cast<StoreInstruction *>(I);
+                body->push(new MI_Neon_Mem(MI_VST1, q(st->value.get()), addrs[vl.access[st->des.get()]]));
+            } break;
+            case Binary: {
+                auto bi = dynamic_cast<BinaryInstruction *>(I);
+                if (bi == vl.inc || vl.fused.count(bi))
+                    break;
+                // 累加器（归约或合并乘法时的另一个加数）与加到它上面的值
+                MOperand dst;
+                ValuePtr addend;
+                if (vl.reduction.count(bi)) {
+                    dst = q(vl.reduction[bi]->reg.get());
+                    addend = bi->a == vl.reduction[bi]->reg ? bi->b : bi->a;
+                } else if ((bi->a->I && vl.fused.count(bi->a->I)) || (bi->b->I && vl.fused.count(bi->b->I))) {
+                    dst = q(bi->reg.get());
+                    addend = (bi->a->I && vl.fused.count(bi->a->I)) ? bi->a : bi->b;
+                } else {
+                    body->push(new MI_Neon_Binary(neon_op(bi->op), q(bi->reg.get()), q(bi->a.get()), q(bi->b.get())));
+                    break;
+                }
+                if (addend->I && vl.fused.count(addend->I)) {
+                    auto mul = dynamic_cast<BinaryInstruction *>(addend->I);
+                    body->push(new MI_Neon_Binary(neon_op(bi->op), dst, q(mul->a.get()), q(mul->b.get()), true));
+                } else {
+                    body->push(new MI_Neon_Binary(neon_op(bi->op), dst, dst, q(addend.get())));
+                }
+            } break;
+            default:
+                break;
+        }
+    }
+    body->push(new MI_Binary(BINARY_ADD, i, i, make_imm(4)));
+    body->push(new MI_Binary(BINARY_SUBTRACT, t, t, make_imm(4)));
+    body->push(new MI_Compare(t, make_imm(vl.threshold)));
+    emit_block_branch(body, GREATER_THAN_OR_EQUAL, body, reduce ? reduce : head);
+
+    if (reduce) {
+        for (auto &r : vl.reduction) {
+            auto sum = make_vreg(vreg_count++);
+            auto s = phi_incoming_map[r.second->reg];
+            reduce->push(new MI_Neon_Reduce(sum, q(r.second->reg.get())));
+            reduce->push(new MI_Binary(BINARY_ADD, s, s, sum));
+        }
+        emit_block_branch(reduce, NO_CONDITION, head);
+    }
+
+    // 放在循环头之前，前置块和reduce块可以直接落入
+    int at = head->i;
+    func_asm->mbs.insert(at, guard);
+    func_asm->mbs.insert(at + 1, check);
+    func_asm->mbs.insert(at + 2, body);
+    if (reduce)
+        func_asm->mbs.insert(at + 3, reduce);
+    for (int k = 0; k < func_asm->mbs.len; k++)
+        func_asm->mbs[k]->i = k;
+    passStats.add("vectorize", "loops vectorized");
+}
+
+static void vectorize_loops(FunctionPtr func, Func_Asm *func_asm) {
+    vector<pair<BasicBlockPtr, Machine_Block *>> blocks;
+    for (auto bb : func->basicBlocks)
+        blocks.push_back({bb, func_asm->mbs[func_asm->bb2idx[bb]]});
+    for (auto loop : func->getAllLoops()) {
+        VectorLoop vl;
+        if (!analyzeVectorLoop(func, loop, vl))
+            continue;
+        emit_vector_loop(func_asm, vl);
+        // 插入的块没有对应的IR基本块，其余块的下标后移
+        func_asm->bb2idx.clear();
+        func_asm->idx2bb.clear();
+        for (auto &b : blocks) {
+            func_asm->bb2idx[b.first] = b.second->i;
+            func_asm->idx2bb[b.second->i] = b.first;
+        }
+    }
+}
+
 // 为函数生成ARM汇编代码
-Func_Asm *emit_function_asm(FunctionPtr func, int idx, Module program_module,
+Func_Asm *emit_function_asm(FunctionPtr func, int idx, Module &program_module,
                             vector<VariablePtr> &globalValues) {
     // 重置虚拟寄存器计数器
     vreg_count = 0;
@@ -1493,8 +1804,7 @@ Func_Asm *emit_function_asm(FunctionPtr func, int idx, Module program_module,
 
     for (auto bb : func->basicBlocks) {
         Machine_Block *mb = func_asm->mbs[func_asm->bb2idx[bb]];
-        for (int i = 0; i < bb->instructions.size(); i++) {
-            auto I = bb->instructions[i];
+        for (auto I : bb->instructions) {
             switch (I->type) {
                 case Br: {
                     emit_Branch(func_asm, I, mb);
@@ -1553,14 +1863,15 @@ Func_Asm *emit_function_asm(FunctionPtr func, int idx, Module program_module,
     // 处理Phi指令 - 在SSA形式中用于合并来自不同路径的值
     for (auto bb : func->basicBlocks) {
         auto mb = func_asm->mbs[func_asm->bb2idx[bb]];
-        for (int i = 0; i < bb->instructions.size(); i++) {
+        for (auto &I : bb->instructions) {
             // 只处理Phi类型的指令
-            if (bb->instructions[i]->type == Phi) {
+            if (I->type == Phi) {
                 // 获取Phi指令
                 auto phi =
-                    dynamic_cast<PhiInstruction *>(bb->instructions[i].get());
+                    dynamic_cast<PhiInstruction *>(I.get());
                 // 创建一个中间虚拟寄存器，用来接收各个前驱基本块的值
                 auto incoming = make_vreg(vreg_count++);
+                phi_incoming_map[phi->reg] = incoming;
 
                 // 获取Phi指令的结果寄存器
                 auto phi_as_operand = make_operand(phi->reg, mb);
@@ -1592,13 +1903,15 @@ Func_Asm *emit_function_asm(FunctionPtr func, int idx, Module program_module,
         }
     }
     
+    vectorize_loops(func, func_asm);
+
     // 更新函数的虚拟寄存器计数
     func_asm->vreg_count = vreg_count;
     return func_asm;  // 返回完成的函数汇编
 }
 
 // 生成整个程序的ARM汇编表示
-Program_Asm *emit_asm(Module program_module) {
+Program_Asm *emit_asm(Module &program_module) {
     auto program_asm = new Program_Asm;
 
     Binary_ir2asm["+"] = BINARY_ADD;
@@ -1625,8 +1938,6 @@ Program_Asm *emit_asm(Module program_module) {
                                           program_module.globalVariables);
         program_asm->functions.push(func_asm);
     }
-    print_program_asm(program_asm, program_module.globalVariables);
-
     return program_asm;
 }
 
@@ -1636,28 +1947,39 @@ void build_operand(String_Builder *s, MOperand op) {
     // 物理寄存器
     case REG: {
         if (op.value == sp)
-            s->append("sp");      // 栈指针
+            s->put("sp");      // 栈指针
         else if (op.value == lr)
-            s->append("lr");      // 链接寄存器
+            s->put("lr");      // 链接寄存器
         else if (op.value == pc)
-            s->append("pc");      // 程序计数器
+            s->put("pc");      // 程序计数器
         else
-            s->append("r%d", op.value); // 普通寄存器
+        {
+            s->put('r');
+            s->put_int(op.value); // 普通寄存器
+        }
     } break;
 
     // 虚拟寄存器
     case VREG: {
-        s->append("vr%d", op.value);
+        s->put("vr");
+        s->put_int(op.value);
     } break;
 
     // 整数立即数
     case IMM: {
-        s->append("#%d", op.value);
+        s->put('#');
+        s->put_int(op.value);
     } break;
 
     // 全局变量地址
     case ADR_GLOBAL: {
-        s->append("%s", op.adr);
+        s->put(op.adr);
+    } break;
+
+    // NEON四字寄存器
+    case QREG: {
+        s->put('q');
+        s->put_int(op.value);
     } break;
 
     case ERRORTYPE: {
@@ -1669,32 +1991,62 @@ void build_operand(String_Builder *s, MOperand op) {
     case Nothing:
         break;
     case LSL: {
-        s->append(", lsl #%d", op.s_value); // 逻辑左移
+        s->put(", lsl #"); // 逻辑左移
+        s->put_int(op.s_value);
     } break;
     case LSR: {
-        s->append(", lsr #%d", op.s_value); // 逻辑右移
+        s->put(", lsr #"); // 逻辑右移
+        s->put_int(op.s_value);
     } break;
     case ASL: {
-        s->append(", asl #%d", op.s_value); // 算术左移
+        s->put(", asl #"); // 算术左移
+        s->put_int(op.s_value);
     } break;
     case ASR: {
-        s->append(", asr #%d", op.s_value); // 算术右移
+        s->put(", asr #"); // 算术右移
+        s->put_int(op.s_value);
     } break;
     }
 }
 
+// 生成块标签.L<函数序号>_<块序号>
+static void build_label(String_Builder *s, Func_Asm *func, Machine_Block *mb) {
+    s->put(".L");
+    s->put_int(func->index);
+    s->put('_');
+    s->put_int(mb->i);
+}
+
+// 生成跳转指令b<cond> <label>
+static void build_branch(String_Builder *s, Func_Asm *func, Branch_Condition cond, Machine_Block *target) {
+    s->put('b');
+    s->put(get_branch_suffix(cond));
+    s->put(' ');
+    build_label(s, func, target);
+}
+
+// 生成助记符后的s和条件后缀
+static void build_suffix(String_Builder *s, const char *set_flags, const char *cond) {
+    s->put(set_flags);
+    s->put(cond);
+    s->put(' ');
+}
+
 // 生成单个函数的ARM汇编文本
 void build_function_asm(String_Builder *s, Func_Asm *func) {
     auto ss = func->mbs.len;
-    s->append("%s:\n", func->name.c_str());
+    s->put(func->name.c_str());
+    s->put(":\n");
     for (int i = 0; i < func->mbs.len; i++) {
         Machine_Block *next_bb = NULL;
         if (i != func->mbs.len - 1)
             next_bb = func->mbs[i + 1];
-        s->append(".L%d_%d:\t# %s\n", func->index, func->mbs[i]->i,
-                  func->idx2bb[i]->label->name.c_str());
+        build_label(s, func, func->mbs[i]);
+        s->put(":\t# ");
+        s->put(func->mbs[i]->label->name.c_str());
+        s->put('\n');
         for (auto I = func->mbs[i]->inst; I; I = I->next) {
-            s->append("    ");
+            s->put("    ");
             const char *cond = get_branch_suffix(I->cond);
             const char *set_flags = I->update_flags ? "s" : "";
             switch (I->tag) {
@@ -1702,21 +2054,23 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
             case MI_MOVE: {
                 auto mv = (MI_Move *)I;
                 if (mv->neg) {
-                    s->append("mvn%s%s ", set_flags, cond);
+                    s->put("mvn");
                 } else {
-                    s->append("mov%s%s ", set_flags, cond);
+                    s->put("mov");
                 }
+                build_suffix(s, set_flags, cond);
                 build_operand(s, mv->dst);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, mv->src);
             } break;
 
             // 生成clz（计数前导零）指令的汇编文本
             case MI_CLZ: {
                 auto clz = (MI_Clz *)I;
-                s->append("clz%s%s ", set_flags, cond);
+                s->put("clz");
+                build_suffix(s, set_flags, cond);
                 build_operand(s, clz->dst);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, clz->operand);
             } break;
 
@@ -1727,67 +2081,66 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                 switch (bi->op) {
                 case BINARY_ADD: {
                     // 生成add（加法）指令的汇编文本
-                    s->append("add");
+                    s->put("add");
                 } break;
                 case BINARY_SUBTRACT: {
                     // 生成sub（减法）指令的汇编文本
-                    s->append("sub");
+                    s->put("sub");
                 } break;
                 case BINARY_MULTIPLY: {
                     // 生成mul（乘法）指令的汇编文本
-                    s->append("mul");
+                    s->put("mul");
                 } break;
                 case BINARY_DIVIDE: {
                     // 生成sdiv（有符号数除法）指令的汇编文本
-                    s->append("sdiv");
+                    s->put("sdiv");
                 } break;
                 case BINARY_LSL: {
                     // 生成lsl（逻辑左移）指令的汇编文本
-                    s->append("lsl");
+                    s->put("lsl");
                 } break;
                 case BINARY_LSR: {
                     // 生成lsr（逻辑右移）指令的汇编文本
-                    s->append("lsr");
+                    s->put("lsr");
                 } break;
                 case BINARY_ASL: {
                     // 生成asl（算术左移）指令的汇编文本
-                    s->append("asl");
+                    s->put("asl");
                 } break;
                 case BINARY_ASR: {
                     // 生成asr（算术右移）指令的汇编文本
-                    s->append("asr");
+                    s->put("asr");
                 } break;
                 case BINARY_RSB: {
                     // 生成rsb（反向减法）指令的汇编文本
-                    s->append("rsb");
+                    s->put("rsb");
                 } break;
                 case BINARY_BITWISE_AND: {
                     // 生成and（按位与）指令的汇编文本
-                    s->append("and");
+                    s->put("and");
                 } break;
                 case BINARY_BITWISE_OR: {
                     // 生成orr（按位或）指令的汇编文本
-                    s->append("orr");
+                    s->put("orr");
                 } break;
                 case BINARY_BIC: {
                     // 生成bic（按位清零）指令的汇编文本
-                    s->append("bic");
+                    s->put("bic");
                 } break;
                 case BINARY_SMMUL: {
                     // 生成smmul（高位乘法）指令的汇编文本
-                    s->append("smmul");
+                    s->put("smmul");
                 } break;
                 default: {
                     exit(53);
                     assert(false && "unknown binary asm instruction.");
                 }
                 }
-                s->append("%s%s", set_flags, cond);
-                s->append(" ");
+                build_suffix(s, set_flags, cond);
                 build_operand(s, bi->dst);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, bi->lhs);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, bi->rhs);
             } break;
 
@@ -1797,22 +2150,21 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                 switch (complex->op) {
                 // 生成mla（乘加）指令的汇编文本
                 case COMPLEX_MLA: {
-                    s->append("mla");
+                    s->put("mla");
                 } break;
 
                 // 生成mls（乘减）指令的汇编文本
                 case COMPLEX_MLS: {
-                    s->append("mls");
+                    s->put("mls");
                 } break;
                 }
-                s->append("%s%s", set_flags, cond);
-                s->append(" ");
+                build_suffix(s, set_flags, cond);
                 build_operand(s, complex->dst);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, complex->lhs);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, complex->rhs);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, complex->extra);
             } break;
         
@@ -1821,12 +2173,12 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                 auto cmp = (MI_Compare *)I;
 
                 if (cmp->neg) {
-                    s->append("cmn ");
+                    s->put("cmn ");
                 } else {
-                    s->append("cmp ");
+                    s->put("cmp ");
                 }
                 build_operand(s, cmp->lhs);
-                s->append(", ");
+                s->put(", ");
                 build_operand(s, cmp->rhs);
             } break;
 
@@ -1839,26 +2191,25 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                 // 无条件跳转，且目标不是下一个基本块
                 if (br->cond == NO_CONDITION) {
                     if (br->true_target->i != i + 1) {
-                        s->append("b .L%d_%d", func->index, br->true_target->i);
+                        s->put("b ");
+                        build_label(s, func, br->true_target);
                     }
                 }
                 // 条件跳转，true分支为下一个基本块，生成反条件跳转到false分支
                 else if (br->true_target->i == i + 1) {
-                    s->append("b%s .L%d_%d\n",
-                              get_branch_suffix(invert_branch_cond(br->cond)),
-                              func->index, br->false_target->i);
+                    build_branch(s, func, invert_branch_cond(br->cond), br->false_target);
+                    s->put('\n');
                 } 
                 // 条件跳转，false分支为下一个基本块，生成条件跳转到true分支
                 else if (br->false_target->i == i + 1) {
-                    s->append("b%s .L%d_%d\n", get_branch_suffix(br->cond),
-                              func->index, br->true_target->i);
+                    build_branch(s, func, br->cond, br->true_target);
+                    s->put('\n');
                 } 
                 // 其他情况，先跳转到true分支，再无条件跳转到false分支
                 else {
-                    s->append("b%s .L%d_%d\n", get_branch_suffix(br->cond),
-                              func->index, br->true_target->i);
-                    s->append("    ");
-                    s->append("b .L%d_%d", func->index, br->false_target->i);
+                    build_branch(s, func, br->cond, br->true_target);
+                    s->put("\n    ");
+                    build_branch(s, func, NO_CONDITION, br->false_target);
                 }
             } break;
 
@@ -1867,19 +2218,22 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
             case MI_POP: {
                 auto push_or_pop = (MI_Push *)I;
 
-                s->append((I->tag == MI_PUSH) ? "push {" : "pop {");
+                s->put((I->tag == MI_PUSH) ? "push {" : "pop {");
                 for (int i = 0; i < push_or_pop->operands.len; i++) {
                     build_operand(s, push_or_pop->operands[i]);
                     if (i != push_or_pop->operands.len - 1)
-                        s->append(", ");
+                        s->put(", ");
                 }
-                s->append("}");
+                s->put("}");
             } break;
 
             // 生成函数调用指令的汇编文本
             case MI_FUNC_CALL: {
                 auto call = (MI_Func_Call *)I;
-                s->append("bl%s %s", cond, call->func_name);
+                s->put("bl");
+                s->put(cond);
+                s->put(' ');
+                s->put(call->func_name);
             } break;
 
             // 生成load/store指令的汇编文本
@@ -1888,15 +2242,19 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                 auto load_or_store = (MI_Load *)I;
                 // 基址为全局变量，使用movw/movt加载地址
                 if (load_or_store->base.tag == ADR_GLOBAL) {
-                    s->append("movw%s ", cond);
+                    s->put("movw");
+                    s->put(cond);
+                    s->put(' ');
                     build_operand(s, load_or_store->reg);
-                    s->append(", ");
-                    s->append(":lower16:");
+                    s->put(", ");
+                    s->put(":lower16:");
                     build_operand(s, load_or_store->base);
-                    s->append("\n    movt%s ", cond);
+                    s->put("\n    movt");
+                    s->put(cond);
+                    s->put(' ');
                     build_operand(s, load_or_store->reg);
-                    s->append(", ");
-                    s->append(":upper16:");
+                    s->put(", ");
+                    s->put(":upper16:");
                     build_operand(s, load_or_store->base);
                 } 
                 // 基址为立即数，根据不同情况选择mov/movw/mvn/movt指令
@@ -1904,23 +2262,29 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                     auto val = load_or_store->base.value;
                     // 可以用mov指令直接加载
                     if (can_be_imm_ror(val)) {
-                        s->append("mov%s ", cond);
+                        s->put("mov");
+                        s->put(cond);
+                        s->put(' ');
                         build_operand(s, load_or_store->reg);
-                        s->append(", ");
+                        s->put(", ");
                         build_operand(s, load_or_store->base);
                     }
                     // 16位无符号立即数，使用movw
                     else if ((val & 0xFFFF) == val) {
-                        s->append("movw%s ", cond);
+                        s->put("movw");
+                        s->put(cond);
+                        s->put(' ');
                         build_operand(s, load_or_store->reg);
-                        s->append(", ");
+                        s->put(", ");
                         build_operand(s, load_or_store->base);
                     }
                     // -1 ~ -257 范围，使用mvn取反加载
                     else if (val < 0 && val > -258) {
-                        s->append("mvn%s ", cond);
+                        s->put("mvn");
+                        s->put(cond);
+                        s->put(' ');
                         build_operand(s, load_or_store->reg);
-                        s->append(", ");
+                        s->put(", ");
                         auto valn = -val - 1;
                         MOperand valn_imm(IMM, valn);
                         build_operand(s, valn_imm);
@@ -1931,38 +2295,95 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
                         auto valh = (val >> 16) & 0xFFFF;
                         MOperand vall_imm(IMM, vall);
                         MOperand valh_imm(IMM, valh);
-                        s->append("movw%s ", cond);
+                        s->put("movw");
+                        s->put(cond);
+                        s->put(' ');
                         build_operand(s, load_or_store->reg);
-                        s->append(", ");
+                        s->put(", ");
                         build_operand(s, vall_imm);
-                        s->append("\n    movt%s ", cond);
+                        s->put("\n    movt");
+                        s->put(cond);
+                        s->put(' ');
                         build_operand(s, load_or_store->reg);
-                        s->append(", ");
+                        s->put(", ");
                         build_operand(s, valh_imm);
                     }
                 }
                 // 其他情况，生成标准的ldr/str指令
                 else {
-                    s->append(I->tag == MI_LOAD ? "ldr" : "str");
-                    s->append(cond);
-                    s->append(" ");
+                    s->put(I->tag == MI_LOAD ? "ldr" : "str");
+                    s->put(cond);
+                    s->put(" ");
                     build_operand(s, load_or_store->reg);
-                    s->append(", [");
+                    s->put(", [");
                     build_operand(s, load_or_store->base);
                     if (load_or_store->offset.tag != ERRORTYPE) {
-                        s->append(", ");
+                        s->put(", ");
                         build_operand(s, load_or_store->offset);
                     }
-                    s->append("]");
+                    s->put("]");
                 }
             } break;
 
+            // 生成vld1/vst1指令的汇编文本，q寄存器qn对应d(2n)和d(2n+1)
+            case MI_VLD1:
+            case MI_VST1: {
+                auto mem = (MI_Neon_Mem *)I;
+                s->put(I->tag == MI_VLD1 ? "vld1.32" : "vst1.32");
+                s->put(" {d");
+                s->put_int(mem->reg.value * 2);
+                s->put(", d");
+                s->put_int(mem->reg.value * 2 + 1);
+                s->put("}, [");
+                build_operand(s, mem->base);
+                s->put("]");
+            } break;
+
+            // 生成vdup（广播）指令的汇编文本，立即数0用vmov.i32
+            case MI_VDUP: {
+                auto dup = (MI_Neon_Dup *)I;
+                s->put(dup->src.tag == IMM ? "vmov.i32 " : "vdup.32 ");
+                build_operand(s, dup->dst);
+                s->put(", ");
+                build_operand(s, dup->src);
+            } break;
+
+            // 生成向量二元运算指令的汇编文本
+            case MI_NEON_BINARY: {
+                auto bi = (MI_Neon_Binary *)I;
+                if (bi->accumulate)
+                    s->put(bi->op == BINARY_ADD ? "vmla" : "vmls");
+                else if (bi->op == BINARY_ADD)
+                    s->put("vadd");
+                else if (bi->op == BINARY_SUBTRACT)
+                    s->put("vsub");
+                else
+                    s->put("vmul");
+                s->put(".i32 ");
+                build_operand(s, bi->dst);
+                s->put(", ");
+                build_operand(s, bi->lhs);
+                s->put(", ");
+                build_operand(s, bi->rhs);
+            } break;
+
+            // 生成向量求和的汇编文本：两半相加，再两两相加，取第0个元素
+            case MI_VREDUCE: {
+                auto red = (MI_Neon_Reduce *)I;
+                int d = red->src.value * 2;
+                s->append("vadd.i32 d%d, d%d, d%d\n", d, d, d + 1);
+                s->append("    vpadd.i32 d%d, d%d, d%d\n", d, d, d);
+                s->put("    vmov.32 ");
+                build_operand(s, red->dst);
+                s->append(", d%d[0]", d);
+            } break;
+
             // 生成返回指令的汇编文本
             case MI_RETURN: {
-                s->append("bx lr");
+                s->put("bx lr");
             } break;
             }
-            s->append("\n");
+            s->put("\n");
         }
     }
 }
@@ -1970,22 +2391,24 @@ void build_function_asm(String_Builder *s, Func_Asm *func) {
 // 生成整个程序的ARM汇编文本
 void build_program_asm(String_Builder *s, Program_Asm *pro,
                        vector<VariablePtr> &globalVariables) {
-    s->append(".arch armv8-a\n");
+    s->put(".arch armv8-a\n");
 
     build_globals(s, globalVariables);
-    s->append("\n");
+    s->put("\n");
 
-    s->append(".text\n");
-    s->append(".align 2\n");
-    s->append(".syntax unified\n");
-    s->append(".arm\n");
-    s->append(".fpu neon\n");
+    s->put(".text\n");
+    s->put(".align 2\n");
+    s->put(".syntax unified\n");
+    s->put(".arm\n");
+    s->put(".fpu neon\n");
 
-    s->append(".global main\n\n");
+    s->put(".global main\n\n");
     for (int i = 0; i < pro->functions.len; i++) {
+        s->flush();
         build_function_asm(s, pro->functions[i]);
-        s->append("\n\n");
+        s->put("\n\n");
     }
+    s->flush();
 }
 
 // 打印操作数的汇编文本表示
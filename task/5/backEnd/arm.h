@@ -147,7 +147,8 @@ enum Operand_Tag {
     VSREG,                    // 虚拟浮点寄存器
 	IMM,                      // 立即整数值
     SIMM,                     // 立即浮点值
-	ADR_GLOBAL                // 全局地址引用
+	ADR_GLOBAL,               // 全局地址引用
+    QREG                      // 物理NEON四字寄存器，向量化固定使用q8-q15，不参与寄存器分配
 };
 
 /**
@@ -220,7 +221,7 @@ struct MOperand {
         if (tag != b.tag) return tag < b.tag;
 
         // 对于各类寄存器和立即数，比较其值
-        if (tag == REG || tag == VREG || tag == IMM || tag == SREG ||tag == VSREG || tag == SIMM) {
+        if (tag == REG || tag == VREG || tag == IMM || tag == SREG ||tag == VSREG || tag == SIMM || tag == QREG) {
             return value < b.value;
         }
 
@@ -236,7 +237,7 @@ struct MOperand {
     // 相等运算符重载，用于操作数比较
     bool operator==(const MOperand &b) const {
         if (tag != b.tag) return false;
-        if (tag == REG || tag == VREG || tag == IMM || tag == SREG ||tag == VSREG || tag == SIMM) return value == b.value;
+        if (tag == REG || tag == VREG || tag == IMM || tag == SREG ||tag == VSREG || tag == SIMM || tag == QREG) return value == b.value;
         if (tag == ADR_GLOBAL) return adr == b.adr;
         assert(false);
         return false;
@@ -277,7 +278,13 @@ enum MI_Tag {
     MI_VPOP,      // 浮点出栈指令，对应ARM的vpop
     MI_VLOAD,     // 浮点加载指令，对应ARM的vldr
     MI_VSTORE,    // 浮点存储指令，对应ARM的vstr
-    MI_VCVT       // 浮点转换指令，对应ARM的vcvt
+    MI_VCVT,      // 浮点转换指令，对应ARM的vcvt
+    // NEON整数向量指令
+    MI_VLD1,      // 向量加载，对应vld1.32
+    MI_VST1,      // 向量存储，对应vst1.32
+    MI_VDUP,      // 标量广播，对应vdup.32，立即数0对应vmov.i32
+    MI_NEON_BINARY, // 向量二元运算，对应vadd/vsub/vmul/vmla/vmls.i32
+    MI_VREDUCE    // 向量各元素求和到通用寄存器，对应vadd+vpadd+vmov.32
 };
 
 
@@ -496,6 +503,36 @@ struct MI_VCvt : MI {
     MI_VCvt(Vcvt_Type from, Vcvt_Type to) : MI(MI_VCVT), from_type(from), to_type(to) {};
 };
 
+// 向量加载/存储，地址为base，一次访问4个int
+struct MI_Neon_Mem : MI {
+    MOperand reg;                // q寄存器
+    MOperand base;               // 地址寄存器
+    MI_Neon_Mem(MI_Tag tag, MOperand reg, MOperand base) : MI(tag), reg(reg), base(base) {};
+};
+
+// 把通用寄存器或立即数0广播到q寄存器的每个元素
+struct MI_Neon_Dup : MI {
+    MOperand dst;                // q寄存器
+    MOperand src;                // 通用寄存器或IMM 0
+    MI_Neon_Dup(MOperand dst, MOperand src) : MI(MI_VDUP), dst(dst), src(src) {};
+};
+
+// 向量二元运算，op为加、减、乘；accumulate时为dst = dst ± lhs * rhs（vmla/vmls）
+struct MI_Neon_Binary : MI {
+    Binary_Op_Type op;
+    MOperand dst, lhs, rhs;      // q寄存器
+    bool accumulate = false;
+    MI_Neon_Binary(Binary_Op_Type op, MOperand dst, MOperand lhs, MOperand rhs, bool accumulate = false) :
+        MI(MI_NEON_BINARY), op(op), dst(dst), lhs(lhs), rhs(rhs), accumulate(accumulate) {};
+};
+
+// dst = src各元素之和，会破坏src
+struct MI_Neon_Reduce : MI {
+    MOperand dst;                // 通用寄存器
+    MOperand src;                // q寄存器
+    MI_Neon_Reduce(MOperand dst, MOperand src) : MI(MI_VREDUCE), dst(dst), src(src) {};
+};
+
 struct Machine_Block {
     int32 i = -1;                    // 基本块的唯一标识符
     MI *inst = NULL;                 // 基本块中的第一条指令
@@ -612,7 +649,7 @@ void emit_load_of_global_ref(Func_Asm *func_asm, ValuePtr v, MOperand vreg,
 void clear_function_related_variables();
 
 // 生成汇编代码
-Program_Asm *emit_asm(Module program_IR);
+Program_Asm *emit_asm(Module &program_IR);
 
 // 检查寄存器是否为被调用者保存寄存器
 bool is_callee_save(uint8 reg);
@@ -628,6 +665,8 @@ void build_function_asm(String_Builder *s, Func_Asm *func);
 
 // 构建程序的汇编代码
 void build_program_asm(String_Builder *s, Program_Asm *pro, vector<VariablePtr> & globalVariables);
+// 把整个程序编码为机器码，输出ELF可重定位目标文件
+void build_program_object(FILE *out, Program_Asm *pro, vector<VariablePtr> &globalVariables);
 
 // 输出操作数
 void print_operand(MOperand op);
@@ -15,7 +15,11 @@ bool is_exp(int n) {
 void algebraic_identity(Program_Asm *prog) {
     // all operands are SSA
     int erase_count = 0;
-    auto zero_reg = make_reg(0);
+    // 结果为0时改成mov dst, #0；make_reg(0)是物理寄存器r0，不是常量0
+    auto emit_zero = [](MI_Binary *binary, MI *I) {
+        insert(new MI_Move(binary->dst, make_imm(0)), I);
+        I->mark();
+    };
     for(auto f : prog->functions) {
         for(auto mb : f->mbs) {
             for(auto I = mb->inst; I; I=I->next) {
@@ -24,13 +28,13 @@ void algebraic_identity(Program_Asm *prog) {
                     switch (binary->op) {
                         case BINARY_ADD: {
                             // 0 + x
-                            if (binary->lhs.tag == IMM && binary->lhs.value == 0 || binary->lhs == zero_reg) {
+                            if (binary->lhs.tag == IMM && binary->lhs.value == 0) {
                                 replace_operand_by_operand(&binary->dst, &binary->rhs, f);
                                 I->mark();
                             }
                                 
                             // x + 0
-                            else if (binary->rhs.tag == IMM && binary->rhs.value == 0 || binary->rhs == zero_reg) {
+                            else if (binary->rhs.tag == IMM && binary->rhs.value == 0) {
                                 replace_operand_by_operand(&binary->dst, &binary->lhs, f);
                                 I->mark();
                             }
@@ -44,28 +48,25 @@ void algebraic_identity(Program_Asm *prog) {
                         } break;
                         case BINARY_SUBTRACT: {
                             // x - 0
-                            if (binary->rhs.tag == IMM && binary->rhs.value == 0 || binary->rhs == zero_reg) {
+                            if (binary->rhs.tag == IMM && binary->rhs.value == 0) {
                                 replace_operand_by_operand(&binary->dst, &binary->lhs, f);
                                 I->mark();
                             }
                                 
                             // x - x
                             else if (binary->lhs == binary->rhs && binary->rhs.s_tag == Nothing) {
-                                replace_operand_by_operand(&binary->dst, &zero_reg, f);
-                                I->mark();
+                                emit_zero(binary, I);
                             }
                         } break;
                         case BINARY_MULTIPLY: {
                             // 0 * x
                             if (binary->lhs.tag == IMM && binary->lhs.value == 0) {
-                                replace_operand_by_operand(&binary->dst, &zero_reg, f);
-                                I->mark();
+                                emit_zero(binary, I);
                             }
                                 
                             // x * 0
                             else if (binary->rhs.tag == IMM && binary->rhs.value == 0) {
-                                replace_operand_by_operand(&binary->dst, &zero_reg, f);
-                                I->mark();
+                                emit_zero(binary, I);
                             }
 
                             // x * 2^sh
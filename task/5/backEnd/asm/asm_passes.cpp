@@ -2,10 +2,14 @@
 #include "asm_passes.h"
 #include "../arm.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include "PassStats.h"
 
 // Optimization passes
 #include "stack_ra.h"
 #include "register_allocation.h"
+#include "linear_scan.h"
 #include "simplify_asm.h"
 #include "remove_identical_moves.h"
 #include "block_placement.h"
@@ -13,6 +17,7 @@
 #include "condify.h"
 #include "use_analysis.h"
 #include "algebraic_identity.h"
+#include "schedule.h"
 
 inline void run_on_every_function(Program_Asm *program_asm, Asm_Func_Pass pass) {
     for(auto func_asm : program_asm->functions) {
@@ -20,19 +25,57 @@ inline void run_on_every_function(Program_Asm *program_asm, Asm_Func_Pass pass)
     }
 }
 
-#define RUN(pass_name) pass_name(program_asm)
+// 机器指令数与基本块数，用于-time-passes
+static void asm_size(Program_Asm *program_asm, long &instructions, long &blocks) {
+    for (auto func_asm : program_asm->functions) {
+        blocks += func_asm->mbs.len;
+        for (auto mb : func_asm->mbs)
+            for (auto I = mb->inst; I; I = I->next)
+                instructions++;
+    }
+}
+
+template<typename Body>
+static void timed_run(Program_Asm *program_asm, const char *name, Body body) {
+    if (!passStats.enabled()) {
+        body();
+        return;
+    }
+    long ins_before = 0, blocks_before = 0, ins_after = 0, blocks_after = 0;
+    asm_size(program_asm, ins_before, blocks_before);
+    PassTimer timer;
+    body();
+    double seconds = timer.seconds();
+    asm_size(program_asm, ins_after, blocks_after);
+    passStats.record(name, seconds, ins_before, ins_after, blocks_before, blocks_after);
+}
+
+Reg_Alloc_Mode reg_alloc_mode = REG_ALLOC_GRAPH;
+Sched_Mode sched_mode = SCHED_NONE;
+const char *block_profile_path = nullptr;
+bool enable_block_placement = false;
+
+#define RUN(pass_name) timed_run(program_asm, #pass_name, [&] { pass_name(program_asm); })
 void bless(Program_Asm *program_asm, bool opt) {
 	RUN(remove_redundant_ldrs);
     RUN(use_analysis);
     RUN(algebraic_identity);
-    register_allocation(program_asm, opt);
+    if (sched_mode == SCHED_ALL)
+        RUN(schedule_pre_ra);
+    if (reg_alloc_mode == REG_ALLOC_LINEAR)
+        RUN(linear_scan_allocation);
+    else
+        timed_run(program_asm, "register_allocation", [&] { register_allocation(program_asm, opt); });
     RUN(remove_identical_moves);
     RUN(remove_redundant_ldrs);
+    if (sched_mode != SCHED_NONE)
+        RUN(schedule_post_ra);
+    if (enable_block_placement)
+        RUN(block_placement);
     // RUN(stack_ra);
     if (opt) {
         // RUN(simplify_asm);
         // RUN(remove_redundant_ldrs);
-        // RUN(block_placement);
         // RUN(condify);
     }
 }
@@ -119,6 +162,8 @@ Array<MOperand> get_defs(MI *I) {
 
         case MI_VCVT: {} break;
 
+        case MI_VREDUCE: { oprs.push(((MI_Neon_Reduce *)I)->dst); } break;
+
         /*
         case MI_POP:  {
             auto pop = (MI_Pop *) I;
@@ -134,6 +179,11 @@ Array<MOperand> get_defs(MI *I) {
         case MI_POP:
         case MI_STORE: // @TODO: store/load may use self increment thing?
         case MI_BRANCH: 
+        // q寄存器不参与分配
+        case MI_VLD1:
+        case MI_VST1:
+        case MI_VDUP:
+        case MI_NEON_BINARY:
         //----float----
         case MI_VBINARY:
         case MI_VCOMPARE:
@@ -247,6 +297,16 @@ Array<MOperand> get_uses(MI *I, bool func_has_return_value) {
         } break;
         case MI_VCVT: {} break;
 
+        case MI_VLD1:
+        case MI_VST1: {
+            oprs.push(((MI_Neon_Mem *)I)->base);
+        } break;
+        case MI_VDUP: {
+            auto dup = (MI_Neon_Dup *)I;
+            if (dup->src.tag == REG || dup->src.tag == VREG)
+                oprs.push(dup->src);
+        } break;
+
         case MI_POP:
         case MI_BRANCH: 
         //----float----
@@ -254,6 +314,8 @@ Array<MOperand> get_uses(MI *I, bool func_has_return_value) {
         case MI_VCOMPARE:
         case MI_VPUSH:
         case MI_VPOP:
+        case MI_NEON_BINARY:
+        case MI_VREDUCE:
             break;
         default: {
             fprintf(stderr, "unknown instrID: %d\n", I->tag);
@@ -293,6 +355,15 @@ Array<MOperand *> get_defs_ptr(MI *I) {
 
         case MI_VCVT: {} break;
 
+        // 与MI_STORE一样用nullptr占位，使地址寄存器的use被记录
+        case MI_VLD1:
+        case MI_VST1:
+        case MI_VDUP: {
+            oprs.push(nullptr);
+        } break;
+
+        case MI_VREDUCE: { oprs.push(&((MI_Neon_Reduce *)I)->dst); } break;
+
         /*
         case MI_POP:  {
             auto pop = (MI_Pop *) I;
@@ -307,6 +378,7 @@ Array<MOperand *> get_defs_ptr(MI *I) {
         case MI_RETURN:
         case MI_POP:
         case MI_BRANCH: 
+        case MI_NEON_BINARY:
         //----float----
         case MI_VBINARY:
         case MI_VCOMPARE:
@@ -403,6 +475,16 @@ Array<MOperand *> get_uses_ptr(MI *I, bool func_has_return_value) {
         } break;
         case MI_VCVT: {} break;
 
+        case MI_VLD1:
+        case MI_VST1: {
+            oprs.push(&((MI_Neon_Mem *)I)->base);
+        } break;
+        case MI_VDUP: {
+            auto dup = (MI_Neon_Dup *)I;
+            if (dup->src.tag == REG || dup->src.tag == VREG)
+                oprs.push(&dup->src);
+        } break;
+
         case MI_POP:
         case MI_BRANCH: 
         //----float----
@@ -410,6 +492,8 @@ Array<MOperand *> get_uses_ptr(MI *I, bool func_has_return_value) {
         case MI_VCOMPARE:
         case MI_VPUSH:
         case MI_VPOP:
+        case MI_NEON_BINARY:
+        case MI_VREDUCE:
             break;
         default: {
             fprintf(stderr, "unknown instrID: %d\n", I->tag);
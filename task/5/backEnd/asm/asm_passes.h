@@ -15,6 +15,23 @@ typedef ASM_PASS(Asm_Pass);
 
 inline void run_on_every_function(Program_Asm *program_asm, Asm_Func_Pass pass);
 
+// 寄存器分配算法：默认图着色，线性扫描编译更快，用于-regalloc=linear
+enum Reg_Alloc_Mode { REG_ALLOC_GRAPH, REG_ALLOC_LINEAR };
+extern Reg_Alloc_Mode reg_alloc_mode;
+
+// 指令调度：默认不调度，post只在寄存器分配后调度，all时分配前也调度，用于-sched=none|post|all
+// 测例在qemu-user中运行，qemu不模拟流水线停顿，调度的收益在测例耗时上看不出来，
+// 只有-stats中按延迟表估计的节省周期数；在真机上测过之前保持关闭
+enum Sched_Mode { SCHED_NONE, SCHED_POST, SCHED_ALL };
+extern Sched_Mode sched_mode;
+ASM_PASS(schedule_pre_ra);
+ASM_PASS(schedule_post_ra);
+
+// -block-profile指定的边计数文件，为空时按循环深度静态估计分支概率
+extern const char *block_profile_path;
+// 基本块布局：默认关闭，用于-block-placement，给出-block-profile时也会打开
+extern bool enable_block_placement;
+
 void bless(Program_Asm *program_asm, bool opt = false);
 
 void replace_uses(MI *I, MOperand *old_opr, MOperand *new_opr, Func_Asm *func);
@@ -1,51 +1,177 @@
+#include "asm_passes.h"
 
-/* This pass place machine blocks in depth-first order */
+/* This pass places machine blocks so that hot edges become fallthroughs */
 
-void place_function_blocks(Func_Asm *f) {
+// 边的权重来自块频率（每层循环10倍）乘静态分支概率：进入更深循环或向回跳的一侧取0.9
+// 指定-block-profile时改用插桩运行得到的边计数，文件每行为：函数名 源块标签 目标块标签 次数
+// 标签是IR基本块的名字，即汇编中每个块后注释里的名字
+// 按权重从大到小把边的两端连成链（Pettis-Hansen），再把尾块无条件跳回头块的循环链旋转，
+// 让每次迭代只剩循环头的一次向回跳转
 
-    Array<Machine_Block *> new_order;
-    Array<Machine_Block *> stack;
+namespace BLOCK_PLACEMENT {
 
-    for(auto bb : f->mbs) bb->visited = false;
+    // 函数名 -> (源块, 目标块) -> 次数
+    map<string, map<pair<string, string>, double>> profile;
+    bool profile_loaded = false;
 
-    stack.push(f->mbs[0]);
-
-    while(!stack.empty()) {
-        auto bb = stack.back(); stack.pop();
-
-        if (bb->visited) continue;
-        bb->visited = true;
+    static void load_profile() {
+        profile_loaded = true;
+        if (!block_profile_path)
+            return;
+        // 指定了profile却读不了，静默退回静态估计会让人误以为用上了profile
+        std::ifstream file(block_profile_path);
+        if (!file.is_open()) {
+            fprintf(stderr, "error: cannot open block profile %s\n", block_profile_path);
+            exit(1);
+        }
+        // 逐行解析，最后一行少了次数也要报错
+        string line;
+        for (int lineno = 1; std::getline(file, line); lineno++) {
+            std::istringstream fields(line);
+            string func, from, to, rest;
+            double count;
+            if (!(fields >> func))
+                continue;
+            if (!(fields >> from >> to >> count) || fields >> rest) {
+                fprintf(stderr, "error: malformed block profile %s:%d\n", block_profile_path, lineno);
+                exit(1);
+            }
+            profile[func][{from, to}] += count;
+        }
+    }
 
-        new_order.push(bb);
+    struct Edge {
+        Machine_Block *from, *to;
+        double weight;
+    };
 
-        if (bb->control_transfer_inst->tag == MI_RETURN) continue;
+    static uint32 depth(Machine_Block *mb) {
+        return mb->loop_depth == (uint32)-1 ? 0 : mb->loop_depth;
+    }
 
-        assert(bb->control_transfer_inst->tag == MI_BRANCH);
-        auto br = (MI_Branch *) bb->control_transfer_inst;
+    // 静态估计时true分支被执行的概率
+    static double true_probability(Machine_Block *mb, MI_Branch *br) {
+        auto t = br->true_target, f = br->false_target;
+        if (depth(t) != depth(f))
+            return depth(t) > depth(f) ? 0.9 : 0.1;
+        bool t_back = t->i <= mb->i, f_back = f->i <= mb->i;
+        if (t_back != f_back)
+            return t_back ? 0.9 : 0.1;
+        return 0.5;
+    }
 
-        if (br->cond == NO_CONDITION) {
-            stack.push(br->true_target);
-        } else {
-            // group loop body together
-            if ((br->true_target->belongs_to_loop != bb->belongs_to_loop) &&
-                (br->true_target->loop_depth <= bb->loop_depth)) {
-                stack.push(br->true_target);
-                stack.push(br->false_target);
+    static vector<Edge> collect_edges(Func_Asm *f) {
+        vector<Edge> edges;
+        auto prof = profile.find(f->name);
+        auto weight = [&](Machine_Block *from, Machine_Block *to, double p) {
+            if (prof == profile.end())
+                return RA::block_frequency(from) * p;
+            auto it = prof->second.find({from->label->name, to->label->name});
+            return it == prof->second.end() ? 0.0 : it->second;
+        };
+        for (auto mb : f->mbs) {
+            if (!mb->control_transfer_inst || mb->control_transfer_inst->tag != MI_BRANCH)
+                continue;
+            auto br = (MI_Branch *)mb->control_transfer_inst;
+            if (br->cond == NO_CONDITION) {
+                edges.push_back({mb, br->true_target, weight(mb, br->true_target, 1)});
             } else {
-                stack.push(br->false_target);
-                stack.push(br->true_target);
+                double p = true_probability(mb, br);
+                edges.push_back({mb, br->true_target, weight(mb, br->true_target, p)});
+                edges.push_back({mb, br->false_target, weight(mb, br->false_target, 1 - p)});
             }
         }
+        return edges;
+    }
+
+    // 按当前顺序估计的跳转次数：目标不是下一块的边都要跳转
+    static double taken_branches(vector<Edge> &edges) {
+        double taken = 0;
+        for (auto &e : edges)
+            if (e.to->i != e.from->i + 1)
+                taken += e.weight;
+        return taken;
     }
 
+    static void place_function_blocks(Func_Asm *f) {
+        if (f->mbs.len < 3)
+            return;
+        auto edges = collect_edges(f);
+        double before = taken_branches(edges);
+        std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.weight > b.weight; });
 
-    f->mbs = new_order;
-    for(int i = 0; i < f->mbs.len; i++) {
-        f->mbs[i]->i = i;
+        // 每个块所在的链
+        map<Machine_Block *, int> chain_of;
+        vector<vector<Machine_Block *>> chains;
+        for (auto mb : f->mbs) {
+            chain_of[mb] = chains.size();
+            chains.push_back({mb});
+        }
+        auto entry = f->mbs[0];
+        for (auto &e : edges) {
+            int a = chain_of[e.from], b = chain_of[e.to];
+            if (a == b || e.to == entry || chains[a].back() != e.from || chains[b].front() != e.to)
+                continue;
+            for (auto mb : chains[b]) {
+                chains[a].push_back(mb);
+                chain_of[mb] = a;
+            }
+            chains[b].clear();
+        }
+
+        // 循环旋转：链尾无条件跳回链头、链头条件跳转的一侧是链中第二块时，把链头移到链尾
+        for (auto &c : chains) {
+            if (c.size() < 2 || c.front() == entry)
+                continue;
+            auto head = c.front(), tail = c.back();
+            auto tail_br = (MI_Branch *)tail->control_transfer_inst;
+            auto head_br = (MI_Branch *)head->control_transfer_inst;
+            if (!tail_br || tail_br->tag != MI_BRANCH || tail_br->cond != NO_CONDITION || tail_br->true_target != head)
+                continue;
+            if (!head_br || head_br->tag != MI_BRANCH || head_br->cond == NO_CONDITION ||
+                (head_br->true_target != c[1] && head_br->false_target != c[1]))
+                continue;
+            c.erase(c.begin());
+            c.push_back(head);
+        }
+
+        // 入口所在的链放最前，之后每次放与已放置的块之间边权最大的链，相同时按原顺序
+        Array<Machine_Block *> new_order;
+        set<int> placed;
+        int current = chain_of[entry];
+        while (current >= 0) {
+            placed.insert(current);
+            for (auto mb : chains[current])
+                new_order.push(mb);
+            current = -1;
+            double best = -1;
+            map<int, double> connection;
+            for (auto &e : edges)
+                if (placed.count(chain_of[e.from]) && !placed.count(chain_of[e.to]))
+                    connection[chain_of[e.to]] += e.weight;
+            for (auto mb : f->mbs) {
+                int c = chain_of[mb];
+                if (placed.count(c) || chains[c].empty())
+                    continue;
+                double w = connection.count(c) ? connection[c] : 0;
+                if (w > best) {
+                    best = w;
+                    current = c;
+                }
+            }
+        }
+        assert(new_order.len == f->mbs.len);
+
+        f->mbs = new_order;
+        for (size_t i = 0; i < f->mbs.len; i++) {
+            f->mbs[i]->i = i;
+        }
+        passStats.add("block_placement", "estimated taken branches removed", (long)(before - taken_branches(edges)));
     }
-    stack.release();
 }
 
 void block_placement(Program_Asm *prog) {
-    run_on_every_function(prog, place_function_blocks);
+    if (!BLOCK_PLACEMENT::profile_loaded)
+        BLOCK_PLACEMENT::load_profile();
+    run_on_every_function(prog, BLOCK_PLACEMENT::place_function_blocks);
 }
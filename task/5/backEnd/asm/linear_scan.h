@@ -0,0 +1,352 @@
+#include "asm_passes.h"
+
+// 线性扫描寄存器分配（second-chance binpacking），编译速度接近线性，用于快速编译
+// 每个虚拟寄存器的活跃区间是若干不相交的段，段之间的空洞可以放别的区间
+// 放不下的区间溢出到栈上：每次定值后store、使用前load到新的短区间，下一轮重新分配时这些短区间再争取一次寄存器
+// 活跃分析、溢出代码和之后的栈帧处理都复用RA中的实现
+
+namespace LINEAR_SCAN {
+
+    // [from, to)，指令I的使用在I->n，定值在I->n + 1
+    struct Live_Range {
+        int from, to;
+    };
+
+    struct Interval {
+        int vreg = -1;
+        std::vector<Live_Range> ranges; // 按位置升序
+        int reg = -1;
+        int hint = -1;       // 由mov连接的物理寄存器或虚拟寄存器，优先分到同一个寄存器
+        double weight = 0;   // 溢出代价
+        bool no_spill = false;
+
+        int start() const { return ranges.front().from; }
+        int end() const { return ranges.back().to; }
+
+        bool covers(int pos) const {
+            auto it = std::upper_bound(ranges.begin(), ranges.end(), pos,
+                                       [](int p, const Live_Range &r) { return p < r.from; });
+            return it != ranges.begin() && pos < (it - 1)->to;
+        }
+    };
+
+    const int INF = 0x7fffffff;
+
+    std::vector<Interval> intervals;
+    // 物理寄存器被指令直接使用的区间（传参、返回值、call破坏的寄存器等），不能溢出
+    std::vector<std::vector<Live_Range>> fixed;
+
+    static bool allocatable(int r) {
+        return (r >= r0 && r <= r12) || r == lr;
+    }
+
+    // 逆序建区间时新段的位置不大于已有的段，与最前面一段相接或重叠时合并
+    static void add_range(std::vector<Live_Range> &ranges, int from, int to) {
+        if (!ranges.empty() && ranges.back().from <= to) {
+            ranges.back().from = std::min(ranges.back().from, from);
+            ranges.back().to = std::max(ranges.back().to, to);
+        } else {
+            ranges.push_back({from, to});
+        }
+    }
+
+    // a与b第一个共同覆盖的位置，不相交时返回INF
+    static int next_intersection(const std::vector<Live_Range> &a, const std::vector<Live_Range> &b) {
+        if (a.empty() || b.empty())
+            return INF;
+        size_t i = std::lower_bound(a.begin(), a.end(), b.front().from,
+                                    [](const Live_Range &r, int p) { return r.to <= p; }) - a.begin();
+        size_t j = 0;
+        while (i < a.size() && j < b.size()) {
+            int from = std::max(a[i].from, b[j].from);
+            if (from < std::min(a[i].to, b[j].to))
+                return from;
+            if (a[i].to <= b[j].to)
+                i++;
+            else
+                j++;
+        }
+        return INF;
+    }
+
+    // 给指令编号并按mbs的顺序逆序扫描，得到每个虚拟寄存器和物理寄存器的活跃区间
+    void build_intervals(Func_Asm *func_asm) {
+        int vregs = func_asm->vreg_count;
+        intervals.assign(vregs, Interval());
+        fixed.assign(REG_COUNT, {});
+
+        int n = 0;
+        std::vector<int> block_from(func_asm->mbs.len), block_to(func_asm->mbs.len);
+        for (size_t i = 0; i < func_asm->mbs.len; i++) {
+            block_from[i] = n;
+            for (auto I = func_asm->mbs[i]->inst; I; I = I->next) {
+                I->n = n;
+                n += 2;
+            }
+            block_to[i] = n;
+        }
+
+        std::vector<int> hints(vregs, -1);
+        // 物理寄存器在块内最后一次定值的位置，-1表示块内没有定值
+        std::vector<int> last_def(func_asm->mbs.len * REG_COUNT, -1);
+        // 在块入口活跃的物理寄存器(块, 寄存器)
+        std::vector<std::pair<int, int>> phys_live_in;
+        for (int i = func_asm->mbs.len - 1; i >= 0; i--) {
+            auto b = func_asm->mbs[i];
+            int from = block_from[i], to = block_to[i];
+            double freq = RA::block_frequency(b);
+
+            auto &out = RA::live_out[i];
+            for (size_t w = 0; w < out.size(); w++)
+                for (uint64 word = out[w]; word; word &= word - 1)
+                    add_range(intervals[w * 64 + __builtin_ctzll(word)].ranges, from, to);
+
+            // 物理寄存器在块内最后一次使用的位置+1，-1表示不活跃
+            int phys_end[REG_COUNT];
+            std::fill(phys_end, phys_end + REG_COUNT, -1);
+
+            for (auto I = b->last_inst; I; I = I->prev) {
+                auto defs = get_defs(I);
+                auto uses = get_uses(I, func_asm->has_return_value);
+                int pos = I->n;
+
+                for (auto def : defs) {
+                    if (def.tag == VREG) {
+                        auto &iv = intervals[def.value];
+                        // 区间从块头（或后面的使用）连过来时在这里截断，否则是没有使用的定值
+                        if (!iv.ranges.empty() && iv.ranges.back().from == from && iv.ranges.back().to > pos)
+                            iv.ranges.back().from = pos + 1;
+                        else
+                            add_range(iv.ranges, pos + 1, pos + 2);
+                        if (!RA::remat_def[def.value])
+                            iv.weight += freq;
+                    } else if (def.tag == REG && allocatable(def.value)) {
+                        int end = phys_end[def.value] >= 0 ? phys_end[def.value] : pos + 2;
+                        fixed[def.value].push_back({pos + 1, end});
+                        phys_end[def.value] = -1;
+                        if (last_def[i * REG_COUNT + def.value] < 0)
+                            last_def[i * REG_COUNT + def.value] = pos;
+                    }
+                }
+
+                for (auto use : uses) {
+                    if (use.tag == VREG) {
+                        add_range(intervals[use.value].ranges, from, pos + 1);
+                        intervals[use.value].weight += freq;
+                    } else if (use.tag == REG && allocatable(use.value) && phys_end[use.value] < 0) {
+                        phys_end[use.value] = pos + 1;
+                    }
+                }
+
+                if (I->tag == MI_MOVE) {
+                    auto mv = (MI_Move *)I;
+                    if (mv->src.s_tag == Nothing && RA::need_alloc(mv->src) && RA::need_alloc(mv->dst)) {
+                        int src = mv->src.tag == REG ? mv->src.value : REG_COUNT + mv->src.value;
+                        int dst = mv->dst.tag == REG ? mv->dst.value : REG_COUNT + mv->dst.value;
+                        if (mv->dst.tag == VREG && hints[mv->dst.value] < 0)
+                            hints[mv->dst.value] = src;
+                        if (mv->src.tag == VREG && hints[mv->src.value] < 0)
+                            hints[mv->src.value] = dst;
+                    }
+                }
+            }
+
+            for (int r = 0; r < REG_COUNT; r++)
+                if (phys_end[r] >= 0) {
+                    fixed[r].push_back({from, phys_end[r]});
+                    phys_live_in.push_back({i, r});
+                }
+        }
+
+        // 物理寄存器一般只在块内活跃，跨块的情况（如phi消除后在后面的块里读参数寄存器）沿前驱向上传播到定值处
+        std::vector<uint8> phys_live_out(func_asm->mbs.len * REG_COUNT, 0);
+        while (!phys_live_in.empty()) {
+            auto [i, r] = phys_live_in.back();
+            phys_live_in.pop_back();
+            for (auto pred : func_asm->mbs[i]->preds) {
+                int k = pred->i * REG_COUNT + r;
+                if (phys_live_out[k])
+                    continue;
+                phys_live_out[k] = 1;
+                if (last_def[k] >= 0) {
+                    fixed[r].push_back({last_def[k] + 1, block_to[pred->i]});
+                } else {
+                    fixed[r].push_back({block_from[pred->i], block_to[pred->i]});
+                    phys_live_in.push_back({pred->i, r});
+                }
+            }
+        }
+        for (auto &ranges : fixed) {
+            std::sort(ranges.begin(), ranges.end(), [](const Live_Range &a, const Live_Range &b) { return a.from < b.from; });
+            std::vector<Live_Range> merged;
+            for (auto range : ranges) {
+                if (!merged.empty() && range.from <= merged.back().to)
+                    merged.back().to = std::max(merged.back().to, range.to);
+                else
+                    merged.push_back(range);
+            }
+            ranges.swap(merged);
+        }
+        for (int v = 0; v < vregs; v++) {
+            auto &iv = intervals[v];
+            iv.vreg = v;
+            iv.hint = hints[v];
+            std::reverse(iv.ranges.begin(), iv.ranges.end());
+            if (iv.ranges.empty())
+                continue;
+            // 按长度归一化，长而稀疏的区间先溢出；溢出产生的短区间不能再溢出
+            // 入口处活跃的虚拟寄存器没有定值，溢出时没有地方插入store，也不溢出
+            iv.no_spill = in(make_vreg(v), RA::already_spilled) || RA::test_bit(RA::live_in[0], v);
+            iv.weight /= iv.end() - iv.start();
+        }
+    }
+
+    // 分配寄存器，放不下的区间加入RA::spilled_nodes
+    void scan() {
+        std::vector<Interval *> unhandled, active, inactive;
+        for (auto &iv : intervals)
+            if (!iv.ranges.empty())
+                unhandled.push_back(&iv);
+        std::sort(unhandled.begin(), unhandled.end(), [](Interval *a, Interval *b) {
+            return a->start() != b->start() ? a->start() < b->start() : a->vreg < b->vreg;
+        });
+
+        auto spill = [](Interval *iv) {
+            assert(!iv->no_spill);
+            iv->reg = -1;
+            RA::spilled_nodes.push_back(make_vreg(iv->vreg));
+        };
+
+        for (auto cur : unhandled) {
+            int pos = cur->start();
+
+            // 结束的区间移出，inactive中重新活跃的移回active，active中进入空洞的移到inactive
+            for (size_t k = 0; k < inactive.size();) {
+                auto it = inactive[k];
+                if (it->end() > pos && !it->covers(pos)) {
+                    k++;
+                    continue;
+                }
+                if (it->end() > pos)
+                    active.push_back(it);
+                inactive[k] = inactive.back();
+                inactive.pop_back();
+            }
+            for (size_t k = 0; k < active.size();) {
+                auto it = active[k];
+                if (it->end() > pos && it->covers(pos)) {
+                    k++;
+                    continue;
+                }
+                if (it->end() > pos)
+                    inactive.push_back(it);
+                active[k] = active.back();
+                active.pop_back();
+            }
+
+            // 每个寄存器从pos起空闲到哪里
+            int free_until[REG_COUNT];
+            for (int r = 0; r < REG_COUNT; r++)
+                free_until[r] = allocatable(r) ? INF : 0;
+            for (auto it : active)
+                free_until[it->reg] = 0;
+            for (auto it : inactive)
+                if (free_until[it->reg] > 0)
+                    free_until[it->reg] = std::min(free_until[it->reg], next_intersection(it->ranges, cur->ranges));
+            for (int r = 0; r < REG_COUNT; r++)
+                if (free_until[r] > 0)
+                    free_until[r] = std::min(free_until[r], next_intersection(fixed[r], cur->ranges));
+
+            int hint = -1;
+            if (cur->hint >= 0)
+                hint = cur->hint < REG_COUNT ? cur->hint : intervals[cur->hint - REG_COUNT].reg;
+            int reg = -1;
+            if (hint >= 0 && free_until[hint] >= cur->end()) {
+                reg = hint;
+            } else {
+                int best = RA::color_order[0];
+                for (auto r : RA::color_order)
+                    if (free_until[r] > free_until[best])
+                        best = r;
+                if (free_until[best] >= cur->end())
+                    reg = best;
+            }
+
+            if (reg < 0) {
+                // 没有整段空闲的寄存器：找占用者溢出代价最小的寄存器，比当前区间便宜就把占用者溢出
+                double cost[REG_COUNT];
+                for (int r = 0; r < REG_COUNT; r++)
+                    cost[r] = allocatable(r) && next_intersection(fixed[r], cur->ranges) == INF ? 0 : HUGE_VAL;
+                for (auto it : active)
+                    cost[it->reg] += it->no_spill ? HUGE_VAL : it->weight;
+                for (auto it : inactive)
+                    if (next_intersection(it->ranges, cur->ranges) != INF)
+                        cost[it->reg] += it->no_spill ? HUGE_VAL : it->weight;
+                int best = RA::color_order[0];
+                for (auto r : RA::color_order)
+                    if (cost[r] < cost[best])
+                        best = r;
+
+                if (cur->no_spill || cost[best] < cur->weight) {
+                    assert(cost[best] < HUGE_VAL && "no register for spill temporary");
+                    reg = best;
+                    auto evict = [&](std::vector<Interval *> &list, bool check) {
+                        std::vector<Interval *> kept;
+                        for (auto it : list) {
+                            if (it->reg == reg && (!check || next_intersection(it->ranges, cur->ranges) != INF))
+                                spill(it);
+                            else
+                                kept.push_back(it);
+                        }
+                        list.swap(kept);
+                    };
+                    evict(active, false);
+                    evict(inactive, true);
+                } else {
+                    spill(cur);
+                    continue;
+                }
+            }
+
+            cur->reg = reg;
+            active.push_back(cur);
+        }
+    }
+
+    void allocate_function(Func_Asm *func_asm) {
+        RA::begin_function();
+        while (true) {
+            RA::spilled_nodes.clear();
+            RA::analyse_liveness(func_asm);
+            RA::find_remat_defs(func_asm);
+            build_intervals(func_asm);
+            scan();
+            if (RA::spilled_nodes.empty())
+                break;
+            std::sort(RA::spilled_nodes.begin(), RA::spilled_nodes.end());
+            RA::insert_spill_code(func_asm);
+        }
+
+        RA::color.assign(REG_COUNT + func_asm->vreg_count, -1);
+        for (int r = 0; r < REG_COUNT; r++)
+            RA::color[r] = r;
+        for (auto &iv : intervals)
+            if (iv.reg >= 0)
+                RA::color[REG_COUNT + iv.vreg] = iv.reg;
+    }
+}
+
+void linear_scan_allocation(Program_Asm *program_asm)
+{
+    for (auto f : program_asm->functions)
+    {
+        RA::clear_before_allocation();
+        LINEAR_SCAN::allocate_function(f);
+
+        RA::color_register_all(f);
+
+        RA::save_registers(f);
+        RA::recompute_offset(f);
+        RA::allocate_stack(f);
+    }
+}
@@ -1,5 +1,6 @@
 
 #include "asm_passes.h"
+#include "PassStats.h"
 #include <algorithm>
 #include <cmath>
 #include <unordered_map>
@@ -9,28 +10,33 @@
 namespace RA
 {
 
+    // 活跃分析用的位集合，第i位对应虚拟寄存器make_vreg(i)
+    // 每个函数的虚拟寄存器从0开始连续编号（见emit_function_asm），直接用编号作下标
+    typedef std::vector<uint64> Live_Bits;
+
     // liveIn and liveOut for each machine blocks
-    static Array<Set<MOperand>> live_in;  // new operands in a specific liveness period
-    static Array<Set<MOperand>> live_out; // operands used by successor liveness periods
+    static std::vector<Live_Bits> live_in;  // new operands in a specific liveness period
+    static std::vector<Live_Bits> live_out; // operands used by successor liveness periods
+
+    static std::vector<Live_Bits> use_set; // actually 'use without def' set
+    static std::vector<Live_Bits> def_set;
 
-    static Array<Set<MOperand>> use_set; // actually 'use without def' set
-    static Array<Set<MOperand>> def_set;
+    static inline bool test_bit(const Live_Bits &bits, int32 i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+    static inline void set_bit(Live_Bits &bits, int32 i) { bits[i >> 6] |= (uint64)1 << (i & 63); }
 
     void analyse_liveness(Func_Asm *func_asm)
     {
+        int n = func_asm->mbs.len;
+        int words = (func_asm->vreg_count + 63) / 64;
 
-        live_in.release();
-        live_out.release();
-        use_set.release();
-        def_set.release();
-
-        live_in.set_len(func_asm->mbs.len);
-        live_out.set_len(func_asm->mbs.len);
-        use_set.set_len(func_asm->mbs.len);
-        def_set.set_len(func_asm->mbs.len);
+        live_in.assign(n, Live_Bits(words, 0));
+        live_out.assign(n, Live_Bits(words, 0));
+        use_set.assign(n, Live_Bits(words, 0));
+        def_set.assign(n, Live_Bits(words, 0));
 
         // get use and def sets for each machine block
-        for (int i = 0; i < func_asm->mbs.len; i++)
+        // 物理寄存器不参与活跃分析，只记录虚拟寄存器
+        for (int i = 0; i < n; i++)
         {
             for (auto I = func_asm->mbs[i]->inst; I; I = I->next)
             {
@@ -39,96 +45,251 @@ namespace RA
 
                 for (auto use : uses)
                 {
-                    if (use.tag == VREG && def_set[i].find(use) == def_set[i].end())
-                    {
-                        use_set[i].insert(use);
-                    }
+                    if (use.tag != VREG)
+                        continue;
+                    assert(use.value >= 0 && use.value < func_asm->vreg_count);
+                    if (!test_bit(def_set[i], use.value))
+                        set_bit(use_set[i], use.value);
                 }
 
                 for (auto def : defs)
                 {
-                    def_set[i].insert(def);
+                    if (def.tag != VREG)
+                        continue;
+                    assert(def.value >= 0 && def.value < func_asm->vreg_count);
+                    set_bit(def_set[i], def.value);
                 }
             }
         }
 
-        // iteratively updating 'live_in' and 'live_out' until stable
-        bool changed = true;
-        while (changed)
+        // 后序：后继先于前驱出队，大多数块第一次处理时后继的live_in已经算好
+        // 从入口不可达的块排在最后，保证每个块至少处理一次
+        std::vector<int> order;
+        std::vector<uint8> visited(n, 0);
+        std::vector<std::pair<Machine_Block *, int>> stack;
+        for (int root = 0; root < n; root++)
         {
-            changed = false;
-            for (int i = 0; i < func_asm->mbs.len; i++)
+            if (visited[root])
+                continue;
+            visited[root] = 1;
+            stack.push_back({func_asm->mbs[root], 0});
+            while (!stack.empty())
             {
-                Set<MOperand> old_in = live_in[i];
-                Set<MOperand> old_out = live_out[i];
-
-                live_in[i] = use_set[i];
-                for (auto o : live_out[i])
+                auto &top = stack.back();
+                if (top.second < top.first->succs.len)
                 {
-                    if (def_set[i].find(o) == def_set[i].end())
+                    auto succ = top.first->succs[top.second++];
+                    if (!visited[succ->i])
                     {
-                        live_in[i].insert(o);
+                        visited[succ->i] = 1;
+                        stack.push_back({succ, 0});
                     }
+                    continue;
                 }
+                order.push_back(top.first->i);
+                stack.pop_back();
+            }
+        }
 
-                live_out[i].clear();
-                for (auto succ : func_asm->mbs[i]->succs)
-                {
-                    for (auto succ_in : live_in[succ->i])
-                    {
-                        live_out[i].insert(succ_in);
-                    }
-                }
+        // 工作表求解：live_in变化时只把前驱重新放回队列
+        std::vector<int> &worklist = order;
+        std::vector<uint8> queued(n, 1);
+        size_t head = 0;
+        long visits = 0;
+        Live_Bits new_in(words);
+        while (head < worklist.size())
+        {
+            int i = worklist[head++];
+            queued[i] = 0;
+            visits++;
 
-                if (!changed)
+            auto &out = live_out[i];
+            std::fill(out.begin(), out.end(), 0);
+            for (auto succ : func_asm->mbs[i]->succs)
+            {
+                auto &succ_in = live_in[succ->i];
+                for (int w = 0; w < words; w++)
+                    out[w] |= succ_in[w];
+            }
+
+            bool changed = false;
+            for (int w = 0; w < words; w++)
+            {
+                new_in[w] = use_set[i][w] | (out[w] & ~def_set[i][w]);
+                changed |= new_in[w] != live_in[i][w];
+            }
+            if (!changed)
+                continue;
+            live_in[i].swap(new_in);
+            new_in.assign(words, 0);
+
+            for (auto pred : func_asm->mbs[i]->preds)
+            {
+                if (!queued[pred->i])
                 {
-                    if ((live_in[i] != old_in) || (live_out[i] != old_out))
-                    {
-                        changed = true;
-                    }
+                    queued[pred->i] = 1;
+                    worklist.push_back(pred->i);
                 }
             }
+            // 队列只增不减，已处理的部分过长时回收
+            if (head > 4096 && head * 2 > worklist.size())
+            {
+                worklist.erase(worklist.begin(), worklist.begin() + head);
+                head = 0;
+            }
         }
+        passStats.add("register_allocation", "liveness block visits", visits);
     }
 
     int K = 14; // r0~r12, lr
     const int max_push_num = 16;
-    Set<MOperand> precolored;
-    Set<MOperand> initial;
-    Set<MOperand> simplify_worklist;
-    Set<MOperand> freeze_worklist;
-    Set<MOperand> spill_worklist;
-    Set<MOperand> spilled_nodes;
-    Set<MOperand> coalesced_nodes;
-    Set<MOperand> colored_nodes;
-    Set<MOperand> select_set;
-    Array<MOperand> select_stack;
+    // assign caller-save first, then callee-save regs
+    const uint8 color_order[] = {r0, r1, r2, r3, r12, r4, r5, r6, r7, r8, r9, r10, r11, lr};
+
+    // 块的估计执行次数，每层循环按10次计，深度封顶防止溢出
+    inline double block_frequency(Machine_Block *mb)
+    {
+        uint32 depth = mb->loop_depth == (uint32)-1 ? 0 : std::min(mb->loop_depth, 8u);
+        return pow(10, depth);
+    }
+
+    // 冲突图的结点：物理寄存器r编号为r，虚拟寄存器vr编号为REG_COUNT + vr
+    int node_count = 0;
+    inline int node_index(MOperand m)
+    {
+        assert((m.tag == REG && m.value < REG_COUNT) || m.tag == VREG);
+        return m.tag == REG ? m.value : REG_COUNT + m.value;
+    }
+    inline MOperand node_operand(int n) { return n < REG_COUNT ? make_reg(n) : make_vreg(n - REG_COUNT); }
+    inline bool is_precolored(int n) { return n < REG_COUNT; }
+
+    // 结点和传送指令所在的集合，每个元素同一时刻只属于一个集合
+    enum Node_State
+    {
+        NODE_PRECOLORED,
+        NODE_INITIAL,
+        NODE_SIMPLIFY,
+        NODE_FREEZE,
+        NODE_SPILL,
+        NODE_SPILLED,
+        NODE_COALESCED,
+        NODE_COLORED,
+        NODE_SELECT,
+        NODE_STATE_COUNT
+    };
+
+    enum Move_State
+    {
+        MOVE_COALESCED,
+        MOVE_CONSTRAINED,
+        MOVE_FROZEN,
+        MOVE_WORKLIST,
+        MOVE_ACTIVE,
+        MOVE_STATE_COUNT
+    };
+
+    // 侵入式双向链表实现的工作表，元素按下标存放prev/next，移入移出都是O(1)
+    template <int N>
+    struct Worklists
+    {
+        std::vector<int> prev, next;
+        std::vector<uint8> state;
+        int head[N], tail[N], count[N];
+
+        void reset()
+        {
+            prev.clear();
+            next.clear();
+            state.clear();
+            for (int s = 0; s < N; s++)
+            {
+                head[s] = tail[s] = -1;
+                count[s] = 0;
+            }
+        }
+
+        // 新元素加到集合s的末尾，返回它的下标
+        int add(int s)
+        {
+            int x = state.size();
+            prev.push_back(-1);
+            next.push_back(-1);
+            state.push_back(s);
+            link(x);
+            return x;
+        }
+
+        void move(int x, int s)
+        {
+            unlink(x);
+            state[x] = s;
+            link(x);
+        }
+
+        int front(int s) { return head[s]; }
+        bool empty(int s) { return count[s] == 0; }
+
+    private:
+        void link(int x)
+        {
+            int s = state[x];
+            prev[x] = tail[s];
+            next[x] = -1;
+            if (tail[s] >= 0)
+                next[tail[s]] = x;
+            else
+                head[s] = x;
+            tail[s] = x;
+            count[s]++;
+        }
+
+        void unlink(int x)
+        {
+            int s = state[x];
+            if (prev[x] >= 0)
+                next[prev[x]] = next[x];
+            else
+                head[s] = next[x];
+            if (next[x] >= 0)
+                prev[next[x]] = prev[x];
+            else
+                tail[s] = prev[x];
+            count[s]--;
+        }
+    };
+
+    Worklists<NODE_STATE_COUNT> nodes;
+    Worklists<MOVE_STATE_COUNT> moves;
+    std::vector<MI_Move *> move_insts;
+
+    std::vector<int> select_stack;
+    std::vector<MOperand> spilled_nodes;
     Array<uint8> needs_save;
 
     // keep track of already spilled nodes
     // avoid spilling repeatly
     Set<MOperand> already_spilled;
 
-    Set<MI_Move *, MI_Move_Pointer_Cmp> coalesced_moves;
-    Set<MI_Move *, MI_Move_Pointer_Cmp> constrained_moves;
-    Set<MI_Move *, MI_Move_Pointer_Cmp> frozen_moves;
-    Set<MI_Move *, MI_Move_Pointer_Cmp> worklist_moves;
-    Set<MI_Move *, MI_Move_Pointer_Cmp> active_moves;
-
-
-    typedef Pair<MOperand, MOperand> Edge;
-    Set<Edge> adj_set;
-    Map<MOperand, Set<MOperand>> adj_list;
-    Map<MOperand, int> degree; // @default 0?
-
-    Map<MOperand, Set<MI_Move *, MI_Move_Pointer_Cmp>> move_list;
-    Map<MOperand, MOperand> alias;
-    Map<MOperand, int32> color;
-    Map<MOperand, uint32> use_def_count;
-    Map<MOperand, uint32> loop_depth;
+    // 冲突关系的下三角位矩阵，(u, v)且u > v对应第u * (u - 1) / 2 + v位
+    std::vector<uint64> adj_matrix;
+    // 虚拟寄存器的邻接表，物理寄存器不记录邻接表
+    std::vector<std::vector<int>> adj_list;
+    std::vector<int> degree;
+
+    std::vector<std::vector<int>> move_list;
+    std::vector<int> alias;
+    std::vector<int32> color;
+    // 按块频率加权的定值和使用次数
+    std::vector<double> spill_cost;
+    // 可以重新计算的虚拟寄存器的唯一定值（加载常量、全局地址，mov立即数），溢出时在使用前重新计算，不占栈槽
+    std::vector<MI *> remat_def;
     Map<MOperand, int32> spill_load_offset;
     Map<MOperand, int32> spill_store_offset;
 
+    // conservative中给邻居去重
+    std::vector<int> visit_mark;
+    int visit_stamp = 0;
+
     int32 spilled_stack_size = 0;
     bool done_post_work = false;
     bool need_to_legalize_imm = false;
@@ -140,24 +301,27 @@ namespace RA
         return (opr.tag == REG || opr.tag == VREG);
     }
 
-    void add_edge(MOperand u, MOperand v);
+    void add_edge(int u, int v);
     void build(Func_Asm *func_asm);
-    Set<MOperand> adjacent(MOperand n);
-    bool move_related(MOperand n);
+    bool move_related(int n);
     void make_worklist();
-    void enable_moves(Set<MOperand> nodes);
-    void decrement_degree(MOperand m);
+    void enable_moves(int n);
+    void decrement_degree(int m);
     void simplify();
     void coalesce();
-    void add_worklist(MOperand u);
-    bool ok(MOperand t, MOperand r);
-    bool conservative(Set<MOperand> nodes);
-    MOperand get_alias(MOperand n);
-    void combine(MOperand u, MOperand v);
+    void add_worklist(int u);
+    bool ok(int t, int r);
+    bool george(int u, int v);
+    bool conservative(int u, int v);
+    int get_alias(int n);
+    void combine(int u, int v);
     void freeze();
-    void freeze_moves(MOperand u);
+    void freeze_moves(int u);
     void assign_colors();
     void select_spill();
+    void find_remat_defs(Func_Asm *func_asm);
+    void rematerialize(Func_Asm *func_asm, MOperand n);
+    void insert_spill_code(Func_Asm *func_asm);
     void color_register_all(Func_Asm *func_asm);
     void recompute_offset(Func_Asm *func_asm);
     void save_registers(Func_Asm *func_asm);
@@ -166,36 +330,75 @@ namespace RA
     void clear_all();
     void clear_before_allocation();
 
-    void add_edge(MOperand u, MOperand v)
+    inline size_t adj_bit(int u, int v)
     {
-        auto p = Edge{u, v};
-        if (!in(p, adj_set) && !(u == v))
-        {
-            adj_set.insert({u, v});
-            adj_set.insert({v, u});
+        if (u < v)
+            std::swap(u, v);
+        return (size_t)u * (u - 1) / 2 + v;
+    }
 
-            if (u.tag == VREG && (v.tag == REG || v.tag == VREG))
-            {
-                adj_list[u].insert(v);
-                degree[u]++;
-            }
+    inline bool adjacent_to(int u, int v)
+    {
+        size_t b = adj_bit(u, v);
+        return (adj_matrix[b >> 6] >> (b & 63)) & 1;
+    }
 
-            if (v.tag == VREG && (u.tag == REG || u.tag == VREG))
-            {
-                adj_list[v].insert(u);
-                degree[v]++;
-            }
+    void add_edge(int u, int v)
+    {
+        if (u == v || adjacent_to(u, v))
+            return;
+        size_t b = adj_bit(u, v);
+        adj_matrix[b >> 6] |= (uint64)1 << (b & 63);
+
+        if (!is_precolored(u))
+        {
+            adj_list[u].push_back(v);
+            degree[u]++;
+        }
+
+        if (!is_precolored(v))
+        {
+            adj_list[v].push_back(u);
+            degree[v]++;
         }
     }
 
     void build(Func_Asm *func_asm)
     {
-        int cnt = 0;
+        // 当前活跃的结点，稀疏集合：live_pos[n]是n在live中的位置，不活跃时为-1
+        std::vector<int> live;
+        std::vector<int> live_pos(node_count, -1);
+        auto live_insert = [&](int n)
+        {
+            if (live_pos[n] < 0)
+            {
+                live_pos[n] = live.size();
+                live.push_back(n);
+            }
+        };
+        auto live_erase = [&](int n)
+        {
+            int p = live_pos[n];
+            if (p < 0)
+                return;
+            live[p] = live.back();
+            live_pos[live[p]] = p;
+            live.pop_back();
+            live_pos[n] = -1;
+        };
+
         for (auto b : func_asm->mbs)
         {
-            int idx = b->i;
-            auto live = live_out[b->i];
-            for (auto I = func_asm->mbs[b->i]->last_inst; I; I = I->prev)
+            double freq = block_frequency(b);
+            for (auto n : live)
+                live_pos[n] = -1;
+            live.clear();
+            auto &out = live_out[b->i];
+            for (int w = 0; w < out.size(); w++)
+                for (uint64 word = out[w]; word; word &= word - 1)
+                    live_insert(REG_COUNT + w * 64 + __builtin_ctzll(word));
+
+            for (auto I = b->last_inst; I; I = I->prev)
             {
                 auto defs = get_defs(I);
                 auto uses = get_uses(I, func_asm->has_return_value);
@@ -203,160 +406,122 @@ namespace RA
                 {
                     if (need_alloc(defs[0]) && uses.size() > 0 && need_alloc(uses[0]))
                     {
+                        int m = moves.add(MOVE_WORKLIST);
+                        move_insts.push_back((MI_Move *)I);
                         for (auto use : uses)
                         {
                             if (!need_alloc(use))
                                 continue;
-                            live.erase(use);
-                            move_list[use].insert((MI_Move *)I);
+                            live_erase(node_index(use));
+                            move_list[node_index(use)].push_back(m);
                         }
 
                         for (auto def : defs)
                         {
-                            move_list[def].insert((MI_Move *)I);
+                            move_list[node_index(def)].push_back(m);
                         }
-
-                        worklist_moves.insert((MI_Move *)I);
                     }
                 }
 
-                // @Bug, needs to be allocated?
                 for (auto def : defs)
                 {
                     if (need_alloc(def))
                     {
-                        if (b->loop_depth > loop_depth[def])
-                        {
-                            loop_depth[def] = b->loop_depth;
-                        }
+                        int d = node_index(def);
                         for (auto l : live)
-                            add_edge(l, def);
-                        live.insert(def);
-                        use_def_count[def]++;
+                            add_edge(l, d);
+                        live_insert(d);
+                        // 重新计算的值溢出后定值直接删掉，没有store的代价
+                        if (def.tag != VREG || !remat_def[def.value])
+                            spill_cost[d] += freq;
                     }
                 }
 
-                // @Optimize
-                Set<MOperand> new_live;
-                for (auto u : uses)
+                // live = uses + (live - defs)
+                for (auto def : defs)
                 {
-                    if (need_alloc(u))
-                    {
-                        use_def_count[u]++;
-                        if (b->loop_depth > loop_depth[u])
-                        {
-                            loop_depth[u] = b->loop_depth;
-                        }
-                        new_live.insert(u);
-                    }
+                    if (need_alloc(def))
+                        live_erase(node_index(def));
                 }
-                // @TODO: record the inserted MOperand and insert
-                for (auto l : live)
+                for (auto u : uses)
                 {
-                    // if (need_alloc(def) && l != def) {
-                    if (defs.find(l) == -1)
+                    if (need_alloc(u))
                     {
-                        new_live.insert(l);
+                        int n = node_index(u);
+                        spill_cost[n] += freq;
+                        live_insert(n);
                     }
                 }
-                live = new_live;
             }
         }
     }
 
-    // return adjacent set of n
-    Set<MOperand> adjacent(MOperand n)
+    // 遍历n在当前冲突图中的邻居（不含已入栈和已合并的结点）
+    template <typename F>
+    void for_each_adjacent(int n, F f)
     {
-        Set<MOperand> a;
-        auto it = adj_list[n].begin();
-        while (it != adj_list[n].end())
+        for (auto t : adj_list[n])
         {
-            if (!in(*it, select_set) && !in(*it, coalesced_nodes))
-            {
-                a.insert(*it);
-            }
-            it++;
+            if (nodes.state[t] != NODE_SELECT && nodes.state[t] != NODE_COALESCED)
+                f(t);
         }
-        return a;
     }
 
-    // return MI_Move that related to n
-    Set<MI_Move *> node_moves(MOperand n)
+    // is n related to an active MI_Move
+    bool move_related(int n)
     {
-        Set<MI_Move *> s;
-        auto it = move_list[n].begin();
-        while (it != move_list[n].end())
+        for (auto m : move_list[n])
         {
-            if (in(*it, active_moves) || in(*it, worklist_moves))
-            {
-                s.insert(*it);
-            }
-            it++;
+            if (moves.state[m] == MOVE_ACTIVE || moves.state[m] == MOVE_WORKLIST)
+                return true;
         }
-        return s;
-    }
-
-    // is n related to an active MI_Move
-    bool move_related(MOperand n)
-    {
-        return !node_moves(n).empty();
+        return false;
     }
 
     // divide initial into spill_worklist, freeze_worklist and simplify_worklist
     void make_worklist()
     {
-        while (!initial.empty())
+        while (!nodes.empty(NODE_INITIAL))
         {
-            auto n = *(initial.begin());
-            initial.erase(n);
+            int n = nodes.front(NODE_INITIAL);
             if (degree[n] >= K)
             {
-                spill_worklist.insert(n);
+                nodes.move(n, NODE_SPILL);
             }
             else if (move_related(n))
             {
-                freeze_worklist.insert(n);
+                nodes.move(n, NODE_FREEZE);
             }
             else
             {
-                simplify_worklist.insert(n);
+                nodes.move(n, NODE_SIMPLIFY);
             }
         }
     }
 
-    // move active_moves of nodes to worklist_moves 
-    void enable_moves(Set<MOperand> nodes)
+    // move active_moves of n to worklist_moves
+    void enable_moves(int n)
     {
-        for (auto n : nodes)
+        for (auto m : move_list[n])
         {
-            for (auto m : node_moves(n))
-            {
-                if (in(m, active_moves))
-                {
-                    active_moves.erase(m);
-                    worklist_moves.insert(m);
-                }
-            }
+            if (moves.state[m] == MOVE_ACTIVE)
+                moves.move(m, MOVE_WORKLIST);
         }
     }
 
     // decrease degree and try to erase m from spill_worklist
-    void decrement_degree(MOperand m)
+    void decrement_degree(int m)
     {
+        if (is_precolored(m))
+            return;
         int d = degree[m]--;
         if (d == K)
         {
-            auto adj = adjacent(m);
-            adj.insert(m);
-            enable_moves(adj);
-            spill_worklist.erase(m);
-            if (move_related(m))
+            enable_moves(m);
+            for_each_adjacent(m, [](int a) { enable_moves(a); });
+            if (nodes.state[m] == NODE_SPILL)
             {
-                freeze_worklist.insert(m);
-            }
-            else
-            {
-                simplify_worklist.insert(m);
+                nodes.move(m, move_related(m) ? NODE_FREEZE : NODE_SIMPLIFY);
             }
         }
     }
@@ -364,178 +529,138 @@ namespace RA
     // move the front operand from simplify_worklist to select_stack
     void simplify()
     {
-        auto n = *(simplify_worklist.begin());
-        simplify_worklist.erase(n);
-        select_stack.push(n);
-        select_set.insert(n);
-        for (auto m : adjacent(n))
-        {
-            decrement_degree(m);
-        }
+        int n = nodes.front(NODE_SIMPLIFY);
+        nodes.move(n, NODE_SELECT);
+        select_stack.push_back(n);
+        for_each_adjacent(n, [](int m) { decrement_degree(m); });
     }
 
     // delete 'mv dst, src' and replace 'dst' with 'src'
     void coalesce()
     {
-        auto m = *(worklist_moves.begin());
-        worklist_moves.erase(m);
-        auto u = get_alias(m->src);
-        auto v = get_alias(m->dst);
-        auto e = Edge{u, v};
-        if (v.tag == REG)
-        { // @What?
-            auto t = u;
-            u = v;
-            v = t;
-        }
-
-        // @Performance
-        int okok = false;
-        for (auto t : adjacent(v))
+        int m = moves.front(MOVE_WORKLIST);
+        int u = get_alias(node_index(move_insts[m]->src));
+        int v = get_alias(node_index(move_insts[m]->dst));
+        if (is_precolored(v))
         {
-            if (ok(t, u))
-            {
-                okok = true;
-                break;
-            }
-        }
-
-        auto join = adjacent(u);
-        for (auto n : adjacent(v))
-        {
-            join.insert(n);
+            std::swap(u, v);
         }
 
         if (u == v)
         {
-            coalesced_moves.insert(m);
+            moves.move(m, MOVE_COALESCED);
             add_worklist(u);
         }
-        else if (v.tag == REG || in(e, adj_set))
+        else if (is_precolored(v) || adjacent_to(u, v))
         {
-            constrained_moves.insert(m);
+            moves.move(m, MOVE_CONSTRAINED);
             add_worklist(u);
             add_worklist(v);
         }
-        else if ((u.tag == REG && okok) ||
-                 (u.tag != REG && conservative(join)))
+        else if (is_precolored(u) ? george(u, v) : conservative(u, v))
         {
-            coalesced_moves.insert(m);
+            moves.move(m, MOVE_COALESCED);
             combine(u, v);
             add_worklist(u);
         }
         else
         {
-            active_moves.insert(m);
+            moves.move(m, MOVE_ACTIVE);
         }
     }
 
     // try to add u from freeze_worklist to simplify_worklist
-    void add_worklist(MOperand u)
+    void add_worklist(int u)
     {
-        if (u.tag != REG && !move_related(u) && degree[u] < K)
+        if (nodes.state[u] == NODE_FREEZE && !move_related(u) && degree[u] < K)
         {
-            freeze_worklist.erase(u);
-            simplify_worklist.insert(u);
+            nodes.move(u, NODE_SIMPLIFY);
         }
     }
 
-    bool ok(MOperand t, MOperand r)
+    bool ok(int t, int r)
     {
-        auto p = Edge{t, r};
-        return ((degree[t] < K) || (t.tag == REG) || (in(p, adj_set)));
+        return degree[t] < K || is_precolored(t) || adjacent_to(t, r);
     }
 
-    // return 'k < K' where k is the number of nodes that 'degree[n] >= K'
-    bool conservative(Set<MOperand> nodes)
+    // George: v的每个邻居要么度数小，要么是物理寄存器，要么已经和u冲突
+    bool george(int u, int v)
     {
+        bool all_ok = true;
+        for_each_adjacent(v, [&](int t) { all_ok = all_ok && ok(t, u); });
+        return all_ok;
+    }
+
+    // Briggs: 合并后度数不小于K的邻居少于K个
+    bool conservative(int u, int v)
+    {
+        visit_stamp++;
         int k = 0;
-        for (auto n : nodes)
+        auto count = [&](int n)
         {
+            if (visit_mark[n] == visit_stamp)
+                return;
+            visit_mark[n] = visit_stamp;
             if (degree[n] >= K)
-            {
                 k++;
-            }
-        }
+        };
+        for_each_adjacent(u, count);
+        for_each_adjacent(v, count);
         return k < K;
     }
 
-    MOperand get_alias(MOperand n)
+    int get_alias(int n)
     {
-        if (in(n, coalesced_nodes))
-        {
-            return get_alias(alias[n]);
-        }
-        else
-        {
-            return n;
-        }
+        while (nodes.state[n] == NODE_COALESCED)
+            n = alias[n];
+        return n;
     }
 
     // use 'u' to replace 'v'
-    void combine(MOperand u, MOperand v)
+    void combine(int u, int v)
     {
-        if (in(v, freeze_worklist))
-        {
-            freeze_worklist.erase(v);
-        }
-        else
-        {
-            spill_worklist.erase(v);
-        }
-        coalesced_nodes.insert(v);
+        nodes.move(v, NODE_COALESCED);
         alias[v] = u;
 
-        // FIXME
-        for (auto n : move_list[v])
+        for (auto m : move_list[v])
         {
-            move_list[u].insert(n);
+            move_list[u].push_back(m);
         }
+        enable_moves(v);
 
-        for (auto t : adjacent(v))
-        {
+        for_each_adjacent(v, [&](int t)
+                          {
             add_edge(t, u);
-            decrement_degree(t);
-        }
+            decrement_degree(t); });
 
-        if (degree[u] >= K && in(u, freeze_worklist))
+        if (degree[u] >= K && nodes.state[u] == NODE_FREEZE)
         {
-            freeze_worklist.erase(u);
-            spill_worklist.insert(u);
+            nodes.move(u, NODE_SPILL);
         }
     }
 
     // move the front operand of freeze_worklist to simplify_worklist
     void freeze()
     {
-        auto u = *(freeze_worklist.begin());
-        freeze_worklist.erase(u);
-        simplify_worklist.insert(u);
+        int u = nodes.front(NODE_FREEZE);
+        nodes.move(u, NODE_SIMPLIFY);
         freeze_moves(u);
     }
 
-    void freeze_moves(MOperand u)
+    void freeze_moves(int u)
     {
-        for (auto m : node_moves(u))
+        for (auto m : move_list[u])
         {
-            // @Order?
-            auto u = m->src;
-            auto v = m->dst;
-
-            if (in(m, active_moves))
-            {
-                active_moves.erase(m);
-            }
-            else
-            {
-                worklist_moves.erase(m);
-            }
+            if (moves.state[m] != MOVE_ACTIVE && moves.state[m] != MOVE_WORKLIST)
+                continue;
+            int x = get_alias(node_index(move_insts[m]->src));
+            int y = get_alias(node_index(move_insts[m]->dst));
+            int v = (y == get_alias(u)) ? x : y;
 
-            frozen_moves.insert(m);
-            if (node_moves(v).empty() && degree[v] < K)
+            moves.move(m, MOVE_FROZEN);
+            if (nodes.state[v] == NODE_FREEZE && !move_related(v) && degree[v] < K)
             {
-                freeze_worklist.erase(v);
-                simplify_worklist.insert(v);
+                nodes.move(v, NODE_SIMPLIFY);
             }
         }
     }
@@ -550,90 +675,80 @@ namespace RA
     {
         while (!select_stack.empty())
         {
-            auto n = select_stack.back();
-            select_stack.pop();
-            Array<uint8> ok_colors;
-
-            // assign caller-save first
-            ok_colors.push(r0);
-            ok_colors.push(r1);
-            ok_colors.push(r2);
-            ok_colors.push(r3);
-            ok_colors.push(r12);
-
-            // callee-save regs
-            for (uint8 r = r4; r <= r11; r++)
+            int n = select_stack.back();
+            select_stack.pop_back();
+
+            uint32 used_colors = 0;
+            for (auto w : adj_list[n])
             {
-                ok_colors.push(r);
+                int a = get_alias(w);
+                if (nodes.state[a] == NODE_COLORED || nodes.state[a] == NODE_PRECOLORED)
+                {
+                    used_colors |= 1u << color[a];
+                }
             }
-            ok_colors.push(lr);
 
-            for (auto w : adj_list[n])
+            int c = -1;
+            for (auto r : color_order)
             {
-                auto a = get_alias(w);
-                if (in(a, colored_nodes) || in(a, precolored))
+                if (!(used_colors & (1u << r)))
                 {
-                    ok_colors.remove(color[a]);
+                    c = r;
+                    break;
                 }
             }
-            if (ok_colors.empty())
+            if (c < 0)
             {
-                spilled_nodes.insert(n);
+                nodes.move(n, NODE_SPILLED);
+                spilled_nodes.push_back(node_operand(n));
             }
             else
             {
-                colored_nodes.insert(n);
-                auto c = ok_colors.front();
+                nodes.move(n, NODE_COLORED);
                 color[n] = c;
             }
         }
-        for (auto n : coalesced_nodes)
+        for (int n = nodes.front(NODE_COALESCED); n >= 0; n = nodes.next[n])
         {
             color[n] = color[get_alias(n)];
         }
+        std::sort(spilled_nodes.begin(), spilled_nodes.end());
     }
 
     void select_spill()
     {
-        // auto m = *(spill_worklist.begin());
-        MOperand m = {};
+        int m = -1;
         double min_cost = 1e40;
-        bool is_already_spilled = false;
-        Set<MOperand> spilled;
-        for (auto it = spill_worklist.begin();
-             it != spill_worklist.end();
-             it++)
+        std::vector<int> spilled;
+        for (int n = nodes.front(NODE_SPILL); n >= 0; n = nodes.next[n])
         {
             // when regs already spilled, erase from spill_worklist
-            if (in(*it, already_spilled)) {
-                is_already_spilled = true;
-                spilled.insert(*it);
+            if (in(node_operand(n), already_spilled)) {
+                spilled.push_back(n);
                 continue;
             }
 
-            assert(degree[*it] != 0);
+            assert(degree[n] != 0);
 
-            double cost = use_def_count[*it] * pow(10, loop_depth[*it]) / degree[*it];
+            double cost = spill_cost[n] / degree[n];
 
             if (cost < min_cost)
             {
-                m = *it;
+                m = n;
                 min_cost = cost;
             }
         }
 
-        if (m.tag == ERRORTYPE && is_already_spilled) {
-            for (auto it = spilled.begin(); it != spilled.end(); it++) {
-                spill_worklist.erase(*it);
-                simplify_worklist.insert(*it);
-                freeze_moves(*it);
+        if (m < 0) {
+            assert(!spilled.empty());
+            for (auto n : spilled) {
+                nodes.move(n, NODE_SIMPLIFY);
+                freeze_moves(n);
             }
-            if (m.tag == ERRORTYPE) return;
+            return;
         }
-        assert(m.tag != ERRORTYPE);
 
-        spill_worklist.erase(m);
-        simplify_worklist.insert(m);
+        nodes.move(m, NODE_SIMPLIFY);
         freeze_moves(m);
     }
 
@@ -641,9 +756,9 @@ namespace RA
     {
         if (m.tag == VREG)
         {
-            assert(color.find(m) != color.end());
-            uint8 reg = color[m];
-            m.value = reg;
+            int n = node_index(m);
+            assert(n < color.size() && color[n] >= 0);
+            m.value = color[n];
             m.tag = REG;
         }
 
@@ -658,129 +773,235 @@ namespace RA
 
         analyse_liveness(func_asm);
 
+        node_count = REG_COUNT + func_asm->vreg_count;
+        adj_matrix.assign(((size_t)node_count * (node_count - 1) / 2 + 63) / 64, 0);
+        adj_list.assign(node_count, {});
+        degree.assign(node_count, 0);
+        move_list.assign(node_count, {});
+        alias.assign(node_count, -1);
+        color.assign(node_count, -1);
+        spill_cost.assign(node_count, 0);
+        visit_mark.assign(node_count, 0);
+        visit_stamp = 0;
+
         for (int i = 0; i < REG_COUNT; i++) {
-            auto r = make_reg(i);
-            precolored.insert(r);
-            color[r] = i;
+            nodes.add(NODE_PRECOLORED);
+            color[i] = i;
         }
 
         for (int i = 0; i < func_asm->vreg_count; i++) {
-            initial.insert(make_vreg(i));
+            nodes.add(NODE_INITIAL);
         }
 
+        find_remat_defs(func_asm);
         build(func_asm);
+        long edges = 0;
+        for (auto &adj : adj_list)
+            edges += adj.size();
+        passStats.add("register_allocation", "interference edges", edges / 2);
+
         make_worklist();
         do {
-            if (!simplify_worklist.empty())
+            if (!nodes.empty(NODE_SIMPLIFY))
                 simplify();
-            else if (!worklist_moves.empty())
+            else if (!moves.empty(MOVE_WORKLIST))
                 coalesce();
-            else if (!freeze_worklist.empty())
+            else if (!nodes.empty(NODE_FREEZE))
                 freeze();
-            else if (!spill_worklist.empty())
+            else if (!nodes.empty(NODE_SPILL))
                 select_spill();
         } while (
-            !simplify_worklist.empty() ||
-            !worklist_moves.empty() ||
-            !freeze_worklist.empty() ||
-            !spill_worklist.empty());
-
-        assign_colors();  
-        if (!spilled_nodes.empty()) {
-            // insert stores and restores for each spilled node
-            for (MOperand n : spilled_nodes) {
-                already_spilled.insert(n);
-
-                printf("spilling nodes: ");
-                print_operand(n);
-                printf("\n");
-                spilled_stack_size += 4;
-                bool is_defined = false;
-
-                for (auto bb : func_asm->mbs) {
-                    bool marked = false;
-                    for (auto I = bb->inst; I; I = I->next) {
-                        auto defs = get_defs(I);
-                        auto uses = get_uses(I, func_asm->has_return_value);
-
-                        bool inserted_store = false;
-                        bool inserted_use = false;
-                        // insert store after def
-                        if (defs.find(n) != -1) {
-                            // avoid load -> store
-                            // if(I->tag == MI_LOAD && spill_store_offset.count(n)) {
-                            //     auto load = (MI_Load *)I;
-                            //     if(load->mem_tag == MEM_LOAD_SPILL) {
-                            //         I->mark();
-                            //         marked = true;
-                            //         continue;
-                            //     }
-                            // }
-
-                            auto str = new MI_Store;
-                            // str->reg = make_vreg(func_asm->vreg_count++);
-                            // @IMPORTANT: do not allocate new reg
-                            str->reg = n;
-                                
-                            str->base = make_reg(sp);
-                            str->offset = make_imm(-(spilled_stack_size));
-                            str->mem_tag = MEM_SAVE_SPILL;
-                            // already_spilled.insert(str->reg);
-
-                            // replace_defs(I, &n, &str->reg, func_asm);
-                            insert((MI *)str, I->next); // @Last?
-                            I = I->next;                // jump past newly inserted str
-                            inserted_store = true;
-                            is_defined = true;
-                            spill_store_offset[n] = -(spilled_stack_size);
-                        }
+            !nodes.empty(NODE_SIMPLIFY) ||
+            !moves.empty(MOVE_WORKLIST) ||
+            !nodes.empty(NODE_FREEZE) ||
+            !nodes.empty(NODE_SPILL));
+
+        assign_colors();
+        if (!spilled_nodes.empty())
+            insert_spill_code(func_asm);
+    }
 
-                        // insert load before use
-                        if (uses.find(n) != -1) {
-                            // avoid load -> store
-                            if(I->tag == MI_STORE && spill_load_offset.count(n)) {
-                                auto store = (MI_Store *)I;
-                                if(store->mem_tag == MEM_SAVE_SPILL) {
-                                    I->mark();
-                                    marked = true;
-                                    continue;
-                                }
-                            }
+    static bool is_rematerializable(MI *I)
+    {
+        if (I->cond != NO_CONDITION || I->update_flags)
+            return false;
+        if (I->tag == MI_LOAD)
+        {
+            auto ldr = (MI_Load *)I;
+            return ldr->mem_tag == MEM_LOAD_FROM_LITERAL_POOL || ldr->mem_tag == MEM_LOAD_GLOBAL_REF;
+        }
+        if (I->tag == MI_MOVE)
+        {
+            auto mv = (MI_Move *)I;
+            return mv->src.tag == IMM && mv->src.s_tag == Nothing;
+        }
+        return false;
+    }
 
-                            auto ldr = new MI_Load;
-                            ldr->mem_tag = MEM_LOAD_SPILL;
-                            ldr->reg = make_vreg(func_asm->vreg_count++);
-                            // @IMPORTANT: do not allocate new reg
-                            // ldr->reg = n;
-            
-                            ldr->base = make_reg(sp);
-                            ldr->offset = make_imm(-(spilled_stack_size));
-                            already_spilled.insert(ldr->reg);
-                            replace_uses(I, &n, &ldr->reg, func_asm);
-                            // @TODO: get uses based on arg count
-                            insert((MI *)ldr, I);
-                            inserted_use = true;
-                            spill_load_offset[ldr->reg] = -(spilled_stack_size);
-                        }
-                        assert(!(inserted_use && inserted_store));
-                    }
-                    if(marked)
-                        bb->erase_marked_values();
+    // 只有一个无条件定值，且定值可以在任何地方重新执行的虚拟寄存器才能重新计算
+    void find_remat_defs(Func_Asm *func_asm)
+    {
+        remat_def.assign(func_asm->vreg_count, nullptr);
+        std::vector<uint8> def_count(func_asm->vreg_count, 0);
+        for (auto mb : func_asm->mbs)
+        {
+            for (auto I = mb->inst; I; I = I->next)
+            {
+                for (auto def : get_defs(I))
+                {
+                    if (def.tag != VREG)
+                        continue;
+                    if (def_count[def.value] < 2)
+                        def_count[def.value]++;
+                    remat_def[def.value] = def_count[def.value] == 1 && is_rematerializable(I) ? I : nullptr;
                 }
-                if(!is_defined) {
-                    fprintf(stderr, "error: vr%d is not defined\n", n.value);
-                    fflush(stderr);
+            }
+        }
+    }
+
+    // 在n的每个使用前复制一份定值到新的虚拟寄存器，再删掉原来的定值
+    void rematerialize(Func_Asm *func_asm, MOperand n)
+    {
+        MI *def = remat_def[n.value];
+        for (auto bb : func_asm->mbs)
+        {
+            for (auto I = bb->inst; I; I = I->next)
+            {
+                if (I == def || get_uses(I, func_asm->has_return_value).find(n) == -1)
+                    continue;
+
+                auto tmp = make_vreg(func_asm->vreg_count++);
+                MI *copy;
+                if (def->tag == MI_LOAD)
+                {
+                    auto ldr = new MI_Load;
+                    ldr->mem_tag = ((MI_Load *)def)->mem_tag;
+                    ldr->reg = tmp;
+                    ldr->base = ((MI_Load *)def)->base;
+                    ldr->offset = ((MI_Load *)def)->offset;
+                    copy = ldr;
+                }
+                else
+                {
+                    auto mv = new MI_Move(tmp, ((MI_Move *)def)->src);
+                    mv->neg = ((MI_Move *)def)->neg;
+                    copy = mv;
                 }
-                assert(is_defined);
+                already_spilled.insert(tmp);
+                replace_uses(I, &n, &tmp, func_asm);
+                insert(copy, I);
+                passStats.add("register_allocation", "rematerialized uses");
+            }
+        }
+        def->mark();
+        def->mb->erase_marked_values();
+        remat_def[n.value] = nullptr;
+    }
+
+    // 在spilled_nodes的每个定值后插入store，每个使用前插入load到新的虚拟寄存器
+    // 能重新计算的值不占栈槽，在使用前重新计算
+    void insert_spill_code(Func_Asm *func_asm)
+    {
+        // insert stores and restores for each spilled node
+        for (MOperand n : spilled_nodes) {
+            already_spilled.insert(n);
+            if (remat_def[n.value]) {
+                passStats.add("register_allocation", "virtual registers rematerialized");
+                rematerialize(func_asm, n);
+                continue;
             }
-            func_asm->stack_size += spilled_stack_size;
-            func_asm->reg_spill_size += spilled_stack_size;
+            passStats.add("register_allocation", "virtual registers spilled");
 
-            printf(">>> spilled stack size: %d\n", spilled_stack_size);
-            printf(">>> after spilling: \n");
+            printf("spilling nodes: ");
+            print_operand(n);
             printf("\n");
+            spilled_stack_size += 4;
+            bool is_defined = false;
+
+            for (auto bb : func_asm->mbs) {
+                bool marked = false;
+                for (auto I = bb->inst; I; I = I->next) {
+                    auto defs = get_defs(I);
+                    auto uses = get_uses(I, func_asm->has_return_value);
+
+                    bool inserted_store = false;
+                    bool inserted_use = false;
+                    // insert store after def
+                    if (defs.find(n) != -1) {
+                        // avoid load -> store
+                        // if(I->tag == MI_LOAD && spill_store_offset.count(n)) {
+                        //     auto load = (MI_Load *)I;
+                        //     if(load->mem_tag == MEM_LOAD_SPILL) {
+                        //         I->mark();
+                        //         marked = true;
+                        //         continue;
+                        //     }
+                        // }
+
+                        auto str = new MI_Store;
+                        // str->reg = make_vreg(func_asm->vreg_count++);
+                        // @IMPORTANT: do not allocate new reg
+                        str->reg = n;
+                            
+                        str->base = make_reg(sp);
+                        str->offset = make_imm(-(spilled_stack_size));
+                        str->mem_tag = MEM_SAVE_SPILL;
+                        // already_spilled.insert(str->reg);
+
+                        // replace_defs(I, &n, &str->reg, func_asm);
+                        insert((MI *)str, I->next); // @Last?
+                        passStats.add("register_allocation", "spill stores inserted");
+                        I = I->next;                // jump past newly inserted str
+                        inserted_store = true;
+                        is_defined = true;
+                        spill_store_offset[n] = -(spilled_stack_size);
+                    }
+
+                    // insert load before use
+                    if (uses.find(n) != -1) {
+                        // avoid load -> store
+                        if(I->tag == MI_STORE && spill_load_offset.count(n)) {
+                            auto store = (MI_Store *)I;
+                            if(store->mem_tag == MEM_SAVE_SPILL) {
+                                I->mark();
+                                marked = true;
+                                continue;
+                            }
+                        }
+
+                        auto ldr = new MI_Load;
+                        ldr->mem_tag = MEM_LOAD_SPILL;
+                        ldr->reg = make_vreg(func_asm->vreg_count++);
+                        // @IMPORTANT: do not allocate new reg
+                        // ldr->reg = n;
+        
+                        ldr->base = make_reg(sp);
+                        ldr->offset = make_imm(-(spilled_stack_size));
+                        already_spilled.insert(ldr->reg);
+                        replace_uses(I, &n, &ldr->reg, func_asm);
+                        // @TODO: get uses based on arg count
+                        insert((MI *)ldr, I);
+                        passStats.add("register_allocation", "spill loads inserted");
+                        inserted_use = true;
+                        spill_load_offset[ldr->reg] = -(spilled_stack_size);
+                    }
+                    assert(!(inserted_use && inserted_store));
+                }
+                if(marked)
+                    bb->erase_marked_values();
+            }
+            if(!is_defined) {
+                fprintf(stderr, "error: vr%d is not defined\n", n.value);
+                fflush(stderr);
+            }
+            assert(is_defined);
         }
+        func_asm->stack_size += spilled_stack_size;
+        func_asm->reg_spill_size += spilled_stack_size;
 
+        printf(">>> spilled stack size: %d\n", spilled_stack_size);
+        printf(">>> after spilling: \n");
+        printf("\n");
     }
 
     void color_register_all(Func_Asm *func_asm) {
@@ -866,6 +1087,23 @@ namespace RA
                 }
                 break;
 
+                case MI_VLD1:
+                case MI_VST1: {
+                    color_register(((MI_Neon_Mem *)I)->base);
+                }
+                break;
+
+                case MI_VDUP: {
+                    color_register(((MI_Neon_Dup *)I)->src);
+                }
+                break;
+
+                case MI_VREDUCE: {
+                    color_register(((MI_Neon_Reduce *)I)->dst);
+                }
+                break;
+
+                case MI_NEON_BINARY:
                 case MI_VBINARY:
                 case MI_VCOMPARE:
                 case MI_VPUSH:
@@ -1102,29 +1340,11 @@ namespace RA
     }
 
     void clear_all() {
-        precolored.clear();
-        initial.clear();
-        simplify_worklist.clear();
-        freeze_worklist.clear();
-        spill_worklist.clear();
+        nodes.reset();
+        moves.reset();
+        move_insts.clear();
         spilled_nodes.clear();
-        coalesced_nodes.clear();
-        colored_nodes.clear();
-        coalesced_moves.clear();
-        constrained_moves.clear();
-        frozen_moves.clear();
-        select_set.clear();
-        worklist_moves.clear();
-        active_moves.clear();
-        adj_set.clear();
-        adj_list.clear();
-        degree.clear();
-        move_list.clear();
-        alias.clear();
-        use_def_count.clear();
-        loop_depth.clear();
-
-        select_stack.len = 0;
+        select_stack.clear();
     }
 
     void clear_before_allocation() {
@@ -1132,13 +1352,19 @@ namespace RA
         needs_save.len = 0;
     }
 
-    void allocate_single_function(Func_Asm *func_asm, bool opt)
+    // 每个函数开始分配前清空溢出相关的状态
+    void begin_function()
     {
         spilled_stack_size = 0;
         done_post_work = false;
         already_spilled.clear();
         spill_load_offset.clear();
         spill_store_offset.clear();
+    }
+
+    void allocate_single_function(Func_Asm *func_asm, bool opt)
+    {
+        begin_function();
         do {
             allocate_register(func_asm);
         } while(!spilled_nodes.empty());
@@ -0,0 +1,362 @@
+#include "asm_passes.h"
+
+// 基本块内的表调度（list scheduling），按Cortex-A72的延迟估计让load、乘除法的结果尽量晚被使用
+// 调用、跳转、返回、push/pop和浮点指令是屏障，只在屏障之间的区域内重排，分配前条件执行的指令也是屏障
+// 依赖来自get_defs/get_uses（与MI_Use链一致），再补上q寄存器、条件标志和内存的依赖
+// 寄存器分配前调度能暴露更多并行，但会拉长活跃区间，所以只在活跃值较少时才按关键路径贪心
+// 寄存器分配后调度只受物理寄存器的依赖限制，不影响分配
+
+namespace SCHEDULE {
+
+    // 各类指令从发射到结果可用的周期数
+    static int latency(MI *I) {
+        switch (I->tag) {
+            // 基址为全局变量或立即数时输出的是mov/movw/movt，不访存
+            case MI_LOAD: {
+                auto tag = ((MI_Load *)I)->base.tag;
+                return tag == ADR_GLOBAL || tag == IMM ? 2 : 4;
+            }
+            case MI_COMPLEXMUL: return 4;
+            case MI_BINARY: {
+                auto bi = (MI_Binary *)I;
+                if (bi->op == BINARY_MULTIPLY || bi->op == BINARY_SMMUL)
+                    return 3;
+                if (bi->op == BINARY_DIVIDE)
+                    return 12;
+                return bi->rhs.s_tag != Nothing ? 2 : 1;
+            }
+            case MI_VLD1: return 5;
+            case MI_VDUP: return 3;
+            case MI_NEON_BINARY: {
+                auto nb = (MI_Neon_Binary *)I;
+                if (nb->accumulate)
+                    return 5;
+                return nb->op == BINARY_MULTIPLY ? 4 : 3;
+            }
+            case MI_VREDUCE: return 7;
+            default: return 1;
+        }
+    }
+
+    static bool is_barrier(MI *I, bool pre_ra) {
+        // 寄存器分配把条件执行的定值当作普通定值，movge/movlt这样成对的定值之间不能插入别的指令
+        if (pre_ra && I->cond != NO_CONDITION)
+            return true;
+        switch (I->tag) {
+            case MI_FUNC_CALL:
+            case MI_BRANCH:
+            case MI_RETURN:
+            case MI_PUSH:
+            case MI_POP:
+            case MI_VMOVE:
+            case MI_VBINARY:
+            case MI_VCOMPARE:
+            case MI_VPUSH:
+            case MI_VPOP:
+            case MI_VLOAD:
+            case MI_VSTORE:
+            case MI_VCVT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    typedef pair<int, int32> Key;           // (操作数类型, 编号)
+    const Key FLAGS = {-1, 0};               // 条件标志
+
+    struct Node {
+        MI *I;
+        int index;                           // 原顺序
+        vector<Key> defs, uses;
+        bool load = false, store = false;
+        Key base = {-1, -1};                 // 可区分地址时的基址寄存器及其版本
+        int base_version = -1;
+        int32 offset = 0;
+        vector<pair<int, int>> succs;        // (后继, 延迟)
+        vector<pair<int, int>> preds_lat;    // (前驱, 延迟)
+        int preds = 0;
+        int height = 0;
+        int earliest = 0;
+    };
+
+    static void add_reg(vector<Key> &keys, const MOperand &o) {
+        if (o.tag == REG || o.tag == VREG || o.tag == QREG)
+            keys.push_back({o.tag, o.value});
+    }
+
+    static void collect(Node &n, Func_Asm *func) {
+        MI *I = n.I;
+        for (auto &o : get_defs(I))
+            add_reg(n.defs, o);
+        for (auto &o : get_uses(I, func->has_return_value))
+            add_reg(n.uses, o);
+        switch (I->tag) {
+            case MI_VLD1: add_reg(n.defs, ((MI_Neon_Mem *)I)->reg); n.load = true; break;
+            case MI_VST1: add_reg(n.uses, ((MI_Neon_Mem *)I)->reg); n.store = true; break;
+            case MI_VDUP: add_reg(n.defs, ((MI_Neon_Dup *)I)->dst); break;
+            case MI_NEON_BINARY: {
+                auto nb = (MI_Neon_Binary *)I;
+                add_reg(n.defs, nb->dst);
+                add_reg(n.uses, nb->lhs);
+                add_reg(n.uses, nb->rhs);
+                if (nb->accumulate)
+                    add_reg(n.uses, nb->dst);
+            } break;
+            // 归约会破坏源寄存器
+            case MI_VREDUCE: add_reg(n.uses, ((MI_Neon_Reduce *)I)->src); add_reg(n.defs, ((MI_Neon_Reduce *)I)->src); break;
+            case MI_LOAD: {
+                auto ldr = (MI_Load *)I;
+                // 参数、全局地址和字面量池在函数内不会被写
+                n.load = ldr->mem_tag != MEM_LOAD_ARG && ldr->mem_tag != MEM_LOAD_GLOBAL_REF && ldr->mem_tag != MEM_LOAD_FROM_LITERAL_POOL;
+                if ((ldr->base.tag == REG || ldr->base.tag == VREG) && (ldr->offset.tag == ERRORTYPE || ldr->offset.tag == IMM)) {
+                    n.base = {ldr->base.tag, ldr->base.value};
+                    n.offset = ldr->offset.tag == IMM ? ldr->offset.value : 0;
+                }
+            } break;
+            case MI_STORE: {
+                auto str = (MI_Store *)I;
+                n.store = true;
+                if ((str->base.tag == REG || str->base.tag == VREG) && (str->offset.tag == ERRORTYPE || str->offset.tag == IMM)) {
+                    n.base = {str->base.tag, str->base.value};
+                    n.offset = str->offset.tag == IMM ? str->offset.value : 0;
+                }
+            } break;
+            default: break;
+        }
+        // 条件执行的指令读标志，不执行时保留原值，相当于也读了目标寄存器
+        if (I->cond != NO_CONDITION) {
+            n.uses.push_back(FLAGS);
+            for (auto &d : n.defs)
+                n.uses.push_back(d);
+        }
+        if (I->tag == MI_COMPARE || I->update_flags)
+            n.defs.push_back(FLAGS);
+    }
+
+    // 同一基址（中间没有被重新定值）、偏移相差至少一个字的两次字访问不重叠
+    static bool disjoint(const Node &a, const Node &b) {
+        if (a.I->tag == MI_VLD1 || a.I->tag == MI_VST1 || b.I->tag == MI_VLD1 || b.I->tag == MI_VST1)
+            return false;
+        if (a.base_version < 0 || a.base != b.base || a.base_version != b.base_version)
+            return false;
+        return abs(a.offset - b.offset) >= 4;
+    }
+
+    static void add_edge(vector<Node> &nodes, int from, int to, int lat) {
+        if (from < 0 || from == to)
+            return;
+        nodes[from].succs.push_back({to, lat});
+        nodes[to].preds_lat.push_back({from, lat});
+        nodes[to].preds++;
+    }
+
+    static void build_dag(vector<Node> &nodes) {
+        map<Key, int> last_def, version;
+        map<Key, vector<int>> readers;
+        vector<int> stores, loads;
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            auto &n = nodes[i];
+            if (n.base.first >= 0)
+                n.base_version = version[n.base];
+            for (auto &u : n.uses)
+                if (last_def.count(u))
+                    add_edge(nodes, last_def[u], i, latency(nodes[last_def[u]].I));
+            for (auto &d : n.defs) {
+                if (last_def.count(d))
+                    add_edge(nodes, last_def[d], i, 0);
+                for (int r : readers[d])
+                    add_edge(nodes, r, i, 0);
+            }
+            if (n.load || n.store) {
+                for (int s : stores)
+                    if (!disjoint(nodes[s], n))
+                        add_edge(nodes, s, i, 1);
+                if (n.store)
+                    for (int l : loads)
+                        if (!disjoint(nodes[l], n))
+                            add_edge(nodes, l, i, 0);
+                (n.store ? stores : loads).push_back(i);
+            }
+            for (auto &u : n.uses)
+                readers[u].push_back(i);
+            for (auto &d : n.defs) {
+                last_def[d] = i;
+                readers[d].clear();
+                version[d]++;
+            }
+        }
+        for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+            nodes[i].height = latency(nodes[i].I);
+            for (auto &s : nodes[i].succs)
+                nodes[i].height = std::max(nodes[i].height, s.second + nodes[s.first].height);
+        }
+    }
+
+    // 单发射顺序流水线上按给定顺序执行所需的周期数
+    static int estimate(vector<Node> &nodes, const vector<int> &order) {
+        vector<int> issue(nodes.size(), 0);
+        int cycle = 0;
+        for (int i : order) {
+            int t = cycle;
+            for (auto &p : nodes[i].preds_lat)
+                t = std::max(t, issue[p.first] + p.second);
+            issue[i] = t;
+            cycle = t + 1;
+        }
+        return cycle;
+    }
+
+    // 分配前调度时活跃值超过这个数就优先选不增加活跃值的指令
+    const int pressure_limit = 8;
+
+    static vector<int> list_schedule(vector<Node> &nodes, bool pre_ra) {
+        int count = nodes.size();
+        // 区域内定值的虚拟寄存器还有多少个未调度的使用者
+        map<Key, int> pending;
+        if (pre_ra) {
+            set<Key> defined;
+            for (auto &n : nodes) {
+                for (auto &u : n.uses)
+                    if (u.first == VREG && defined.count(u))
+                        pending[u]++;
+                for (auto &d : n.defs)
+                    if (d.first == VREG)
+                        defined.insert(d);
+            }
+        }
+        auto pressure_delta = [&](Node &n) {
+            int delta = 0;
+            for (auto &d : n.defs)
+                if (pending.count(d) && pending[d] > 0)
+                    delta++;
+            for (auto &u : n.uses)
+                if (pending.count(u) && pending[u] == 1)
+                    delta--;
+            return delta;
+        };
+
+        vector<int> ready, order;
+        for (int i = 0; i < count; i++)
+            if (nodes[i].preds == 0)
+                ready.push_back(i);
+        int cycle = 0, live = 0;
+        while (!ready.empty()) {
+            // 已就绪的指令按关键路径选，都没就绪就选最早就绪的
+            int best = -1;
+            for (int k = 0; k < (int)ready.size(); k++) {
+                auto &n = nodes[ready[k]];
+                if (best < 0) { best = k; continue; }
+                auto &b = nodes[ready[best]];
+                bool n_ready = n.earliest <= cycle, b_ready = b.earliest <= cycle;
+                if (pre_ra && live >= pressure_limit) {
+                    int dn = pressure_delta(n), db = pressure_delta(b);
+                    if (dn != db) {
+                        if (dn < db) best = k;
+                        continue;
+                    }
+                }
+                if (n_ready != b_ready) {
+                    if (n_ready) best = k;
+                    continue;
+                }
+                if (!n_ready && n.earliest != b.earliest) {
+                    if (n.earliest < b.earliest) best = k;
+                    continue;
+                }
+                if (n.height != b.height) {
+                    if (n.height > b.height) best = k;
+                    continue;
+                }
+                if (n.index < b.index)
+                    best = k;
+            }
+            int i = ready[best];
+            ready.erase(ready.begin() + best);
+            auto &n = nodes[i];
+            if (pre_ra) {
+                live += pressure_delta(n);
+                for (auto &u : n.uses)
+                    if (pending.count(u) && pending[u] > 0)
+                        pending[u]--;
+            }
+            cycle = std::max(cycle, n.earliest) + 1;
+            order.push_back(i);
+            for (auto &s : n.succs) {
+                auto &m = nodes[s.first];
+                m.earliest = std::max(m.earliest, cycle - 1 + s.second);
+                if (--m.preds == 0)
+                    ready.push_back(s.first);
+            }
+        }
+        assert((int)order.size() == count);
+        return order;
+    }
+
+    // 调度[begin, end)中的指令，返回估计节省的周期数
+    static int schedule_region(vector<MI *> &insts, int begin, int end, Func_Asm *func, bool pre_ra) {
+        if (end - begin < 2)
+            return 0;
+        vector<Node> nodes(end - begin);
+        for (int k = begin; k < end; k++) {
+            nodes[k - begin].I = insts[k];
+            nodes[k - begin].index = k - begin;
+            collect(nodes[k - begin], func);
+        }
+        build_dag(nodes);
+        vector<int> original(nodes.size());
+        for (int k = 0; k < (int)nodes.size(); k++)
+            original[k] = k;
+        int before = estimate(nodes, original);
+        auto order = list_schedule(nodes, pre_ra);
+        int after = estimate(nodes, order);
+        // 估计不比原顺序好时保持原样
+        if (after >= before)
+            return 0;
+        for (int k = 0; k < (int)order.size(); k++)
+            insts[begin + k] = nodes[order[k]].I;
+        return before - after;
+    }
+
+    static void schedule_block(Machine_Block *mb, Func_Asm *func, bool pre_ra, long &saved) {
+        vector<MI *> insts;
+        for (auto I = mb->inst; I; I = I->next)
+            insts.push_back(I);
+        int begin = 0;
+        for (int k = 0; k <= (int)insts.size(); k++) {
+            if (k == (int)insts.size() || is_barrier(insts[k], pre_ra)) {
+                saved += schedule_region(insts, begin, k, func, pre_ra);
+                begin = k + 1;
+            }
+        }
+        // 按新顺序重新连接链表
+        MI *prev = NULL;
+        for (auto I : insts) {
+            I->prev = prev;
+            if (prev)
+                prev->next = I;
+            else
+                mb->inst = I;
+            prev = I;
+        }
+        if (prev)
+            prev->next = NULL;
+        mb->last_inst = prev;
+    }
+
+    static void run(Program_Asm *program_asm, bool pre_ra, const char *name) {
+        long saved = 0;
+        for (auto func : program_asm->functions)
+            for (auto mb : func->mbs)
+                schedule_block(mb, func, pre_ra, saved);
+        passStats.add(name, "estimated cycles saved", saved);
+    }
+}
+
+void schedule_pre_ra(Program_Asm *program_asm) {
+    SCHEDULE::run(program_asm, true, "schedule_pre_ra");
+}
+
+void schedule_post_ra(Program_Asm *program_asm) {
+    SCHEDULE::run(program_asm, false, "schedule_post_ra");
+}
@@ -11,24 +11,45 @@ void report_error(const char *format, ...) {
     assert(false);
 }
 
-// @TODO: ditch sprintf because performance is too bad
-// but for debugging purposes (e.g. printing the AST)
-// this should be fine
 void String_Builder::append(const char *s, ...) {
-    char buf[8192]; // @Overflow
-    va_list args;
-
+    va_list args, copy;
     va_start(args, s);
-    size_t len = vsprintf(buf, s, args);
+    va_copy(copy, args);
+    // 先按剩余空间直接格式化进缓冲区，放不下时扩容后再来一次
+    size_t room = buffer.cap - buffer.len;
+    int len = vsnprintf(buffer.a ? buffer.a + buffer.len : NULL, buffer.a ? room : 0, s, args);
     va_end(args);
-
-    // @note: +1 for \0
-    buffer.maygrow(len+1);
-    //strcpy_s(buffer.a+buffer.len, len, buf);
-    strcpy(buffer.a+buffer.len, buf);
+    assert(len >= 0);
+    if ((size_t)len >= room || !buffer.a) {
+        buffer.maygrow(len + 1); // @note: +1 for \0
+        vsnprintf(buffer.a + buffer.len, len + 1, s, copy);
+    }
+    va_end(copy);
     buffer.len += len;
 }
 
+void String_Builder::put_int(int64 v) {
+    char digits[24];
+    int n = 0;
+    uint64 u = v < 0 ? -(uint64)v : (uint64)v;
+    do {
+        digits[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        digits[n++] = '-';
+    buffer.maygrow(n);
+    while (n)
+        buffer.a[buffer.len++] = digits[--n];
+}
+
+void String_Builder::flush() {
+    if (!out)
+        return;
+    fwrite(buffer.a, 1, buffer.len, out);
+    buffer.len = 0;
+}
+
 bool fits_into(int64 v, uint8 bits) {
     uint8 clear_bits = (sizeof(v) * 8) - bits;
     int64 b = (v << clear_bits) >> clear_bits;
@@ -46,13 +46,30 @@ using Set = std::set<A, Compare>;
 template <typename A>
 using Queue = std::queue<A>;
 
+// 汇编文本缓冲区
+// 指定out时flush()把已生成的文本写入文件并清空缓冲区，内存占用只取决于两次flush之间的文本
 struct String_Builder {
     Array<char> buffer;
+    FILE *out = NULL;
+
+    String_Builder() {}
+    String_Builder(FILE *out) : out(out) {}
 
     size_t size() { return buffer.len; }
     char *c_str() { return buffer.a; } // @NOTE Don't append after acquiring this!!!
     void add_terminator() { buffer.push('\0'); }
-    void append(const char *s, ...);
+    void append(const char *s, ...); // 带格式的输出，只用于不常见的路径
+
+    // 不经过printf格式解析的输出
+    void put(const char *s, size_t len) {
+        buffer.maygrow(len);
+        memcpy(buffer.a + buffer.len, s, len);
+        buffer.len += len;
+    }
+    void put(const char *s) { put(s, strlen(s)); }
+    void put(char c) { buffer.push(c); }
+    void put_int(int64 v);
+    void flush();
 };
 
 
@@ -0,0 +1,587 @@
+#include "arm.h"
+#include <algorithm>
+#include <elf.h>
+
+/* This file encodes Program_Asm into ARM machine code and writes a relocatable ELF object */
+
+// 指令选择与build_function_asm输出的汇编文本一一对应，得到的.text与汇编器的结果相同：
+// 立即数放不下时按汇编器的习惯换成add/sub、mov/mvn、cmp/cmn、and/bic的另一条，
+// 单个寄存器的push/pop编码为str/ldr
+// 常量和全局地址都用movw/movt加载，不需要文字池
+// 函数内的跳转和对本文件函数的调用直接算出偏移，对外部函数的调用和全局地址生成重定位
+
+namespace ELF_OBJECT {
+
+    // 条件码
+    enum : uint32 { COND_EQ = 0, COND_NE = 1, COND_GE = 10, COND_LT = 11, COND_GT = 12, COND_LE = 13, COND_AL = 14 };
+
+    // 数据处理指令的操作码
+    enum : uint32 { OP_AND = 0, OP_SUB = 2, OP_RSB = 3, OP_ADD = 4, OP_CMP = 10, OP_CMN = 11, OP_ORR = 12, OP_MOV = 13, OP_BIC = 14, OP_MVN = 15 };
+
+    struct Symbol {
+        string name;
+        uint32 value = 0, size = 0;
+        uint16 shndx = SHN_UNDEF;
+        uint8 type = STT_NOTYPE;
+        bool global = false;
+    };
+
+    struct Reloc {
+        uint32 offset;
+        string symbol;
+        uint8 type;
+    };
+
+    // 对函数的调用，等所有函数编码完后再决定直接回填还是生成重定位
+    struct Call {
+        uint32 offset;
+        const char *name;
+        uint32 cond;
+    };
+
+    Array<uint32> text;
+    Array<uint8> data_bytes;
+    uint32 bss_size;
+    vector<Symbol> symbols;
+    vector<Reloc> relocs;
+    vector<Call> calls;
+
+    static uint32 cond_bits(Branch_Condition c) {
+        switch (c) {
+        case NO_CONDITION: return COND_AL;
+        case LESS_THAN: return COND_LT;
+        case GREATER_THAN: return COND_GT;
+        case NOT_EQUAL: return COND_NE;
+        case GREATER_THAN_OR_EQUAL: return COND_GE;
+        case LESS_THAN_OR_EQUAL: return COND_LE;
+        case EQUAL: return COND_EQ;
+        default: assert(false && "unsupported condition in object emission");
+        }
+        return COND_AL;
+    }
+
+    static uint32 reg(MOperand op) {
+        assert(op.tag == REG && "unallocated register in object emission");
+        return op.value;
+    }
+
+    // NEON q寄存器qn对应d(2n)，返回D:Vd的拆分
+    static uint32 dreg_d(int d) { return (d >> 4) & 1; }
+    static uint32 dreg_v(int d) { return d & 0xf; }
+
+    static uint32 offset() { return text.len * 4; }
+    static void emit(uint32 word) { text.push(word); }
+
+    // 循环右移立即数：imm8循环右移2*rot位，取rot最小的编码
+    static bool encode_ror_imm(uint32 v, uint32 *bits) {
+        for (uint32 rot = 0; rot < 16; rot++) {
+            uint32 x = rot ? (v << (2 * rot)) | (v >> (32 - 2 * rot)) : v;
+            if (x <= 0xff) {
+                *bits = rot << 8 | x;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static uint32 shift_type(Shift_Tag s) {
+        switch (s) {
+        case LSR: return 1;
+        case ASR: return 2;
+        default: return 0; // LSL、ASL
+        }
+    }
+
+    // 寄存器移位立即数位数的操作数，lsr/asr #32编码为0
+    static uint32 shifted_reg(uint32 rm, Shift_Tag s, uint32 amount) {
+        assert(amount <= 32);
+        return (amount & 31) << 7 | shift_type(s) << 5 | rm;
+    }
+
+    static void emit_movw(uint32 cond, uint32 rd, uint32 imm16, bool top = false) {
+        emit(cond << 28 | (top ? 0x03400000 : 0x03000000) | (imm16 >> 12) << 16 | rd << 12 | (imm16 & 0xfff));
+    }
+
+    // 数据处理指令，立即数编码不下时换成等价的另一条指令
+    static void emit_data_processing(uint32 cond, uint32 opcode, bool set_flags, uint32 rn, uint32 rd, MOperand op2) {
+        uint32 operand;
+        if (op2.tag == IMM) {
+            uint32 v = op2.value, bits;
+            if (!encode_ror_imm(v, &bits)) {
+                switch (opcode) {
+                case OP_ADD: opcode = OP_SUB; v = -v; break;
+                case OP_SUB: opcode = OP_ADD; v = -v; break;
+                case OP_CMP: opcode = OP_CMN; v = -v; break;
+                case OP_CMN: opcode = OP_CMP; v = -v; break;
+                case OP_MOV: opcode = OP_MVN; v = ~v; break;
+                case OP_MVN: opcode = OP_MOV; v = ~v; break;
+                case OP_AND: opcode = OP_BIC; v = ~v; break;
+                case OP_BIC: opcode = OP_AND; v = ~v; break;
+                }
+                if (!encode_ror_imm(v, &bits)) {
+                    // mov不能编码的16位立即数用movw
+                    assert(opcode == OP_MVN && !set_flags && (~v & 0xffff) == ~v && "immediate cannot be encoded");
+                    emit_movw(cond, rd, ~v);
+                    return;
+                }
+            }
+            operand = 1 << 25 | bits;
+        } else {
+            operand = shifted_reg(reg(op2), op2.s_tag, op2.s_value);
+        }
+        emit(cond << 28 | opcode << 21 | (set_flags ? 1 << 20 : 0) | rn << 16 | rd << 12 | operand);
+    }
+
+    // lsl/lsr/asr rd, rm, #imm|rs 都是mov rd, rm, <shift>
+    static void emit_shift(uint32 cond, bool set_flags, Shift_Tag s, uint32 rd, MOperand rm, MOperand amount) {
+        assert(rm.s_tag == Nothing);
+        uint32 operand;
+        if (amount.tag == IMM)
+            operand = shifted_reg(reg(rm), s, amount.value);
+        else
+            operand = reg(amount) << 8 | shift_type(s) << 5 | 1 << 4 | reg(rm);
+        emit(cond << 28 | OP_MOV << 21 | (set_flags ? 1 << 20 : 0) | rd << 12 | operand);
+    }
+
+    // 乘法类指令：rd = rn * rm (+ ra)
+    static void emit_multiply(uint32 cond, uint32 base, bool set_flags, uint32 rd, uint32 rn, uint32 rm, uint32 ra) {
+        emit(cond << 28 | base | (set_flags ? 1 << 20 : 0) | rd << 16 | ra << 12 | rm << 8 | rn);
+    }
+
+    // ldr/str rt, [rn, #imm | rm, <shift>]
+    static void emit_memory(uint32 cond, bool load, uint32 rt, uint32 rn, MOperand offset) {
+        uint32 word = cond << 28 | 1 << 26 | 1 << 24 | (load ? 1 << 20 : 0) | rn << 16 | rt << 12;
+        if (offset.tag == ERRORTYPE) {
+            word |= 1 << 23;
+        } else if (offset.tag == IMM) {
+            int32 v = offset.value;
+            assert(v >= -4095 && v <= 4095 && "memory offset out of range");
+            word |= (v >= 0 ? 1 << 23 : 0) | (v >= 0 ? v : -v);
+        } else {
+            word |= 1 << 25 | 1 << 23 | shifted_reg(reg(offset), offset.s_tag, offset.s_value);
+        }
+        emit(word);
+    }
+
+    // 加载常量，与汇编文本中的选择相同
+    static void emit_constant(uint32 cond, uint32 rd, int32 val) {
+        uint32 bits;
+        if (encode_ror_imm(val, &bits)) {
+            emit(cond << 28 | 1 << 25 | OP_MOV << 21 | rd << 12 | bits);
+        } else if ((val & 0xFFFF) == val) {
+            emit_movw(cond, rd, val);
+        } else if (val < 0 && val > -258) {
+            emit_data_processing(cond, OP_MVN, false, 0, rd, make_imm(-val - 1));
+        } else {
+            emit_movw(cond, rd, val & 0xFFFF);
+            emit_movw(cond, rd, (val >> 16) & 0xFFFF, true);
+        }
+    }
+
+    static void emit_branch(uint32 cond, Machine_Block *target, vector<pair<uint32, Machine_Block *>> &fixups) {
+        fixups.push_back({offset(), target});
+        emit(cond << 28 | 0x0a000000);
+    }
+
+    static void encode_function(Func_Asm *func) {
+        uint32 start = offset();
+        vector<uint32> block_offset(func->mbs.len);
+        vector<pair<uint32, Machine_Block *>> fixups;
+        for (int32 i = 0; i < (int32)func->mbs.len; i++) {
+            Machine_Block *next_bb = NULL;
+            if (i != (int32)func->mbs.len - 1)
+                next_bb = func->mbs[i + 1];
+            block_offset[i] = offset();
+            for (auto I = func->mbs[i]->inst; I; I = I->next) {
+                uint32 cond = cond_bits(I->cond);
+                bool set_flags = I->update_flags;
+                switch (I->tag) {
+                case MI_MOVE: {
+                    auto mv = (MI_Move *)I;
+                    emit_data_processing(cond, mv->neg ? OP_MVN : OP_MOV, set_flags, 0, reg(mv->dst), mv->src);
+                } break;
+
+                case MI_CLZ: {
+                    auto clz = (MI_Clz *)I;
+                    emit(cond << 28 | 0x016f0f10 | reg(clz->dst) << 12 | reg(clz->operand));
+                } break;
+
+                case MI_BINARY: {
+                    auto bi = (MI_Binary *)I;
+                    uint32 rd = reg(bi->dst);
+                    switch (bi->op) {
+                    case BINARY_ADD: emit_data_processing(cond, OP_ADD, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_SUBTRACT: emit_data_processing(cond, OP_SUB, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_RSB: emit_data_processing(cond, OP_RSB, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_BITWISE_AND: emit_data_processing(cond, OP_AND, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_BITWISE_OR: emit_data_processing(cond, OP_ORR, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_BIC: emit_data_processing(cond, OP_BIC, set_flags, reg(bi->lhs), rd, bi->rhs); break;
+                    case BINARY_LSL:
+                    case BINARY_ASL: emit_shift(cond, set_flags, LSL, rd, bi->lhs, bi->rhs); break;
+                    case BINARY_LSR: emit_shift(cond, set_flags, LSR, rd, bi->lhs, bi->rhs); break;
+                    case BINARY_ASR: emit_shift(cond, set_flags, ASR, rd, bi->lhs, bi->rhs); break;
+                    case BINARY_MULTIPLY: emit_multiply(cond, 0x00000090, set_flags, rd, reg(bi->lhs), reg(bi->rhs), 0); break;
+                    case BINARY_DIVIDE: emit_multiply(cond, 0x0710f010, false, rd, reg(bi->lhs), reg(bi->rhs), 0); break;
+                    case BINARY_SMMUL: emit_multiply(cond, 0x0750f010, false, rd, reg(bi->lhs), reg(bi->rhs), 0); break;
+                    default: assert(false && "unknown binary asm instruction.");
+                    }
+                } break;
+
+                case MI_COMPLEXMUL: {
+                    auto complex = (MI_ComplexMul *)I;
+                    uint32 base = complex->op == COMPLEX_MLA ? 0x00200090 : 0x00600090;
+                    emit_multiply(cond, base, set_flags, reg(complex->dst), reg(complex->lhs), reg(complex->rhs), reg(complex->extra));
+                } break;
+
+                case MI_COMPARE: {
+                    auto cmp = (MI_Compare *)I;
+                    emit_data_processing(cond, cmp->neg ? OP_CMN : OP_CMP, true, reg(cmp->lhs), 0, cmp->rhs);
+                } break;
+
+                // 跳转的选择与build_function_asm相同
+                case MI_BRANCH: {
+                    auto br = (MI_Branch *)I;
+                    if (next_bb && next_bb->condified)
+                        break;
+                    if (br->cond == NO_CONDITION) {
+                        if (br->true_target->i != i + 1)
+                            emit_branch(COND_AL, br->true_target, fixups);
+                    } else if (br->true_target->i == i + 1) {
+                        emit_branch(cond_bits(invert_branch_cond(br->cond)), br->false_target, fixups);
+                    } else if (br->false_target->i == i + 1) {
+                        emit_branch(cond, br->true_target, fixups);
+                    } else {
+                        emit_branch(cond, br->true_target, fixups);
+                        emit_branch(COND_AL, br->false_target, fixups);
+                    }
+                } break;
+
+                // push/pop为stmdb/ldmia sp!，只有一个寄存器时为str/ldr的前变址/后变址形式
+                case MI_PUSH:
+                case MI_POP: {
+                    auto push_or_pop = (MI_Push *)I;
+                    bool push = I->tag == MI_PUSH;
+                    if (push_or_pop->operands.len == 1) {
+                        uint32 rt = reg(push_or_pop->operands[0]);
+                        emit(cond << 28 | (push ? 0x052d0004 : 0x049d0004) | rt << 12);
+                    } else {
+                        uint32 list = 0;
+                        for (auto op : push_or_pop->operands)
+                            list |= 1 << reg(op);
+                        emit(cond << 28 | (push ? 0x092d0000 : 0x08bd0000) | list);
+                    }
+                } break;
+
+                case MI_FUNC_CALL: {
+                    auto call = (MI_Func_Call *)I;
+                    calls.push_back({offset(), call->func_name, cond});
+                    emit(cond << 28 | 0x0b000000);
+                } break;
+
+                case MI_LOAD:
+                case MI_STORE: {
+                    auto load_or_store = (MI_Load *)I;
+                    uint32 rt = reg(load_or_store->reg);
+                    if (load_or_store->base.tag == ADR_GLOBAL) {
+                        relocs.push_back({offset(), load_or_store->base.adr, R_ARM_MOVW_ABS_NC});
+                        emit_movw(cond, rt, 0);
+                        relocs.push_back({offset(), load_or_store->base.adr, R_ARM_MOVT_ABS});
+                        emit_movw(cond, rt, 0, true);
+                    } else if (load_or_store->base.tag == IMM) {
+                        emit_constant(cond, rt, load_or_store->base.value);
+                    } else {
+                        emit_memory(cond, I->tag == MI_LOAD, rt, reg(load_or_store->base), load_or_store->offset);
+                    }
+                } break;
+
+                // vld1.32/vst1.32 {d(2n), d(2n+1)}, [rn]
+                case MI_VLD1:
+                case MI_VST1: {
+                    auto mem = (MI_Neon_Mem *)I;
+                    int d = mem->reg.value * 2;
+                    emit((I->tag == MI_VLD1 ? 0xf4200a8f : 0xf4000a8f) | dreg_d(d) << 22 | reg(mem->base) << 16 | dreg_v(d) << 12);
+                } break;
+
+                case MI_VDUP: {
+                    auto dup = (MI_Neon_Dup *)I;
+                    int d = dup->dst.value * 2;
+                    if (dup->src.tag == IMM) {
+                        // vmov.i32 qd, #imm8
+                        uint32 v = dup->src.value;
+                        assert(v <= 0xff);
+                        emit(0xf2800050 | (v >> 7) << 24 | dreg_d(d) << 22 | ((v >> 4) & 7) << 16 | dreg_v(d) << 12 | (v & 0xf));
+                    } else {
+                        emit(0xeea00b10 | dreg_v(d) << 16 | reg(dup->src) << 12 | dreg_d(d) << 7);
+                    }
+                } break;
+
+                case MI_NEON_BINARY: {
+                    auto bi = (MI_Neon_Binary *)I;
+                    uint32 base;
+                    if (bi->accumulate)
+                        base = bi->op == BINARY_ADD ? 0xf2200940 : 0xf3200940;
+                    else if (bi->op == BINARY_ADD)
+                        base = 0xf2200840;
+                    else if (bi->op == BINARY_SUBTRACT)
+                        base = 0xf3200840;
+                    else
+                        base = 0xf2200950;
+                    int d = bi->dst.value * 2, n = bi->lhs.value * 2, m = bi->rhs.value * 2;
+                    emit(base | dreg_d(d) << 22 | dreg_v(n) << 16 | dreg_v(d) << 12 | dreg_d(n) << 7 | dreg_d(m) << 5 | dreg_v(m));
+                } break;
+
+                // vadd.i32 d, d, d+1; vpadd.i32 d, d, d; vmov.32 rt, d[0]
+                case MI_VREDUCE: {
+                    auto red = (MI_Neon_Reduce *)I;
+                    int d = red->src.value * 2;
+                    emit(0xf2200800 | dreg_d(d) << 22 | dreg_v(d) << 16 | dreg_v(d) << 12 | dreg_d(d) << 7 | dreg_d(d + 1) << 5 | dreg_v(d + 1));
+                    emit(0xf2200b10 | dreg_d(d) << 22 | dreg_v(d) << 16 | dreg_v(d) << 12 | dreg_d(d) << 7 | dreg_d(d) << 5 | dreg_v(d));
+                    emit(0xee100b10 | dreg_v(d) << 16 | reg(red->dst) << 12 | dreg_d(d) << 7);
+                } break;
+
+                case MI_RETURN: {
+                    emit(COND_AL << 28 | 0x012fff10 | lr);
+                } break;
+
+                // 汇编文本也不输出VFP指令，后端目前不会生成它们
+                default:
+                    assert(false && "unsupported instruction in object emission");
+                }
+            }
+        }
+
+        for (auto &f : fixups) {
+            int32 delta = (int32)(block_offset[f.second->i] - (f.first + 8)) >> 2;
+            text[f.first / 4] |= delta & 0xffffff;
+        }
+
+        Symbol sym;
+        sym.name = func->name;
+        sym.value = start;
+        sym.size = offset() - start;
+        sym.shndx = 1;
+        sym.type = STT_FUNC;
+        sym.global = func->name == "main";
+        symbols.push_back(sym);
+    }
+
+    // 全局变量的布局与build_globals相同：int和有初值的数组放.data，全零数组放.bss
+    static void layout_globals(vector<VariablePtr> &globals) {
+        auto put_word = [](uint32 w) {
+            for (int k = 0; k < 4; k++)
+                data_bytes.push((w >> (8 * k)) & 0xff);
+        };
+        for (auto &g : globals) {
+            Symbol sym;
+            sym.name = g->name;
+            sym.type = STT_OBJECT;
+            if (g->type->isInt()) {
+                sym.shndx = 3;
+                sym.value = data_bytes.len;
+                put_word(dynamic_cast<Int *>(g.get())->intVal);
+            } else if (g->type->isArr()) {
+                auto arr = dynamic_cast<Arr *>(g.get());
+                if (arr->zero()) {
+                    sym.shndx = 4;
+                    sym.value = bss_size;
+                    bss_size += dynamic_cast<ArrType *>(arr->type.get())->getSize() * 4;
+                } else {
+                    sym.shndx = 3;
+                    sym.value = data_bytes.len;
+                    vector<Pair<string, int>> init_inst;
+                    get_init_sequence(g, init_inst);
+                    for (auto &inst : init_inst) {
+                        if (inst.first == ".word")
+                            put_word(inst.second);
+                        else
+                            for (int k = 0; k < inst.second; k++)
+                                data_bytes.push(0);
+                    }
+                }
+            } else {
+                continue;
+            }
+            sym.size = (sym.shndx == 3 ? data_bytes.len : bss_size) - sym.value;
+            symbols.push_back(sym);
+        }
+    }
+
+    // 回填对本文件函数的调用，其余生成R_ARM_CALL（条件调用为R_ARM_JUMP24）
+    static void resolve_calls() {
+        map<string, uint32> defined;
+        for (auto &sym : symbols)
+            if (sym.type == STT_FUNC)
+                defined[sym.name] = sym.value;
+        set<string> undefined;
+        for (auto &c : calls) {
+            auto it = defined.find(c.name);
+            if (it != defined.end()) {
+                int32 delta = (int32)(it->second - (c.offset + 8)) >> 2;
+                text[c.offset / 4] |= delta & 0xffffff;
+                continue;
+            }
+            // REL格式的加数-8写在指令里
+            text[c.offset / 4] |= 0xfffffe;
+            relocs.push_back({c.offset, c.name, (uint8)(c.cond == COND_AL ? R_ARM_CALL : R_ARM_JUMP24)});
+            if (undefined.insert(c.name).second) {
+                Symbol sym;
+                sym.name = c.name;
+                sym.global = true;
+                symbols.push_back(sym);
+            }
+        }
+    }
+
+    // .ARM.attributes：与汇编文本的.arch armv8-a、.fpu neon一致，浮点参数用VFP寄存器传递（与运行库相同）
+    static void build_attributes(Array<uint8> &out) {
+        const uint8 attrs[] = {
+            6, 14,   // Tag_CPU_arch: v8
+            7, 'A',  // Tag_CPU_arch_profile: Application
+            8, 1,    // Tag_ARM_ISA_use
+            10, 3,   // Tag_FP_arch: VFPv3
+            12, 1,   // Tag_Advanced_SIMD_arch: NEONv1
+            28, 1,   // Tag_ABI_VFP_args: VFP registers
+        };
+        auto put_word = [&](uint32 w) {
+            for (int k = 0; k < 4; k++)
+                out.push((w >> (8 * k)) & 0xff);
+        };
+        uint32 file_size = 1 + 4 + sizeof(attrs);
+        uint32 vendor_size = 4 + 6 + file_size;
+        out.push('A');
+        put_word(vendor_size);
+        for (auto c : "aeabi")
+            out.push(c);
+        out.push(1); // Tag_File
+        put_word(file_size);
+        for (auto a : attrs)
+            out.push(a);
+    }
+
+    // 把各节按顺序拼到image中
+    struct Section {
+        const char *name;
+        Elf32_Shdr header;
+    };
+
+    static void write_object(FILE *out) {
+        // 局部符号在前，sh_info为第一个全局符号的下标
+        std::stable_partition(symbols.begin(), symbols.end(), [](const Symbol &s) { return !s.global; });
+        Array<uint8> strtab, symtab, rel, attributes, shstrtab;
+        strtab.push(0);
+        map<string, uint32> symbol_index;
+        auto put = [](Array<uint8> &a, const void *p, size_t n) {
+            for (size_t k = 0; k < n; k++)
+                a.push(((const uint8 *)p)[k]);
+        };
+        Elf32_Sym null_sym = {};
+        put(symtab, &null_sym, sizeof(null_sym));
+        // .text、.data、.bss的节符号
+        for (uint16 shndx = 1; shndx <= 4; shndx++) {
+            if (shndx == 2)
+                continue;
+            Elf32_Sym s = {};
+            s.st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION);
+            s.st_shndx = shndx;
+            put(symtab, &s, sizeof(s));
+        }
+        uint32 first_global = symtab.len / sizeof(Elf32_Sym);
+        for (auto &sym : symbols) {
+            Elf32_Sym s = {};
+            s.st_name = strtab.len;
+            put(strtab, sym.name.c_str(), sym.name.size() + 1);
+            s.st_value = sym.value;
+            s.st_size = sym.size;
+            s.st_info = ELF32_ST_INFO(sym.global ? STB_GLOBAL : STB_LOCAL, sym.type);
+            s.st_shndx = sym.shndx;
+            if (!sym.global)
+                first_global = symtab.len / sizeof(Elf32_Sym) + 1;
+            symbol_index[sym.name] = symtab.len / sizeof(Elf32_Sym);
+            put(symtab, &s, sizeof(s));
+        }
+        for (auto &r : relocs) {
+            assert(symbol_index.count(r.symbol) && "relocation against unknown symbol");
+            Elf32_Rel e;
+            e.r_offset = r.offset;
+            e.r_info = ELF32_R_INFO(symbol_index[r.symbol], r.type);
+            put(rel, &e, sizeof(e));
+        }
+        build_attributes(attributes);
+
+        Section sections[] = {
+            {"", {}},
+            {".text", {0, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 0, 0, (Elf32_Word)offset(), 0, 0, 4, 0}},
+            {".rel.text", {0, SHT_REL, SHF_INFO_LINK, 0, 0, (Elf32_Word)rel.len, 6, 1, 4, sizeof(Elf32_Rel)}},
+            {".data", {0, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, 0, 0, (Elf32_Word)data_bytes.len, 0, 0, 4, 0}},
+            {".bss", {0, SHT_NOBITS, SHF_ALLOC | SHF_WRITE, 0, 0, bss_size, 0, 0, 4, 0}},
+            {".ARM.attributes", {0, SHT_ARM_ATTRIBUTES, 0, 0, 0, (Elf32_Word)attributes.len, 0, 0, 1, 0}},
+            {".symtab", {0, SHT_SYMTAB, 0, 0, 0, (Elf32_Word)symtab.len, 7, first_global, 4, sizeof(Elf32_Sym)}},
+            {".strtab", {0, SHT_STRTAB, 0, 0, 0, (Elf32_Word)strtab.len, 0, 0, 1, 0}},
+            {".shstrtab", {0, SHT_STRTAB, 0, 0, 0, 0, 0, 0, 1, 0}},
+        };
+        const int section_count = sizeof(sections) / sizeof(sections[0]);
+        shstrtab.push(0);
+        for (int k = 1; k < section_count; k++) {
+            sections[k].header.sh_name = shstrtab.len;
+            put(shstrtab, sections[k].name, strlen(sections[k].name) + 1);
+        }
+        sections[section_count - 1].header.sh_size = shstrtab.len;
+
+        Array<uint8> *contents[] = {NULL, NULL, &rel, &data_bytes, NULL, &attributes, &symtab, &strtab, &shstrtab};
+        Array<uint8> image;
+        image.set_len(sizeof(Elf32_Ehdr));
+        for (int k = 1; k < section_count; k++) {
+            auto &h = sections[k].header;
+            while (image.len % h.sh_addralign)
+                image.push(0);
+            h.sh_offset = image.len;
+            if (k == 1)
+                put(image, text.a, offset());
+            else if (contents[k])
+                put(image, contents[k]->a, contents[k]->len);
+        }
+        while (image.len % 4)
+            image.push(0);
+
+        Elf32_Ehdr eh = {};
+        memcpy(eh.e_ident, ELFMAG, SELFMAG);
+        eh.e_ident[EI_CLASS] = ELFCLASS32;
+        eh.e_ident[EI_DATA] = ELFDATA2LSB;
+        eh.e_ident[EI_VERSION] = EV_CURRENT;
+        eh.e_type = ET_REL;
+        eh.e_machine = EM_ARM;
+        eh.e_version = EV_CURRENT;
+        eh.e_flags = EF_ARM_EABI_VER5 | EF_ARM_ABI_FLOAT_HARD;
+        eh.e_ehsize = sizeof(Elf32_Ehdr);
+        eh.e_shentsize = sizeof(Elf32_Shdr);
+        eh.e_shnum = section_count;
+        eh.e_shstrndx = section_count - 1;
+        eh.e_shoff = image.len;
+        memcpy(image.a, &eh, sizeof(eh));
+        for (int k = 0; k < section_count; k++)
+            put(image, &sections[k].header, sizeof(Elf32_Shdr));
+
+        fwrite(image.a, 1, image.len, out);
+        image.release();
+        strtab.release();
+        symtab.release();
+        rel.release();
+        attributes.release();
+        shstrtab.release();
+    }
+}
+
+void build_program_object(FILE *out, Program_Asm *pro, vector<VariablePtr> &globalVariables) {
+    using namespace ELF_OBJECT;
+    text.len = 0;
+    data_bytes.len = 0;
+    bss_size = 0;
+    symbols.clear();
+    relocs.clear();
+    calls.clear();
+    layout_globals(globalVariables);
+    for (size_t i = 0; i < pro->functions.len; i++)
+        encode_function(pro->functions[i]);
+    resolve_calls();
+    write_object(out);
+}
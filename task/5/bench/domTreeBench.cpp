@@ -0,0 +1,88 @@
+// domTree的微基准：生成1k/10k/100k个基本块的合成CFG，测量计算支配树和支配边界的时间
+// 构建：cmake --build <build> --target task5-domtree-bench
+// 运行：task5-domtree-bench [块数...]，不给参数时依次测1000 10000 100000
+// 参考结果（-O2 -DNDEBUG，单核，三次取最好，单位毫秒）：
+//       blocks  structured/ms      random/ms
+//         1000          0.163          0.372
+//        10000          2.239          5.085
+//       100000         26.394        120.516
+//      1000000        554.137       2439.116
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "mem2reg.h"
+#include "createCFG.h"
+
+// 结构化的CFG：顺序块中穿插if-else菱形和回边，接近内联展开后的SysY函数
+static FunctionPtr structuredCFG(int n, std::mt19937& rng)
+{
+    auto func = FunctionPtr(new Function(IRArenaPtr(new IRArena())));
+    func->basicBlocks.clear();
+    vector<BasicBlockPtr> bbs;
+    for(int i = 0; i < n; i++) {
+        bbs.push_back(func->newBasicBlock());
+        func->pushBasicBlock(bbs.back());
+    }
+    for(int i = 0; i + 1 < n; i++) {
+        addEdgeInCFG(bbs[i], bbs[i + 1]);
+        if(i % 3 == 0 && i + 3 < n)
+            addEdgeInCFG(bbs[i], bbs[i + 3]);
+        // 回到前面不远处，形成嵌套的循环
+        if(i % 7 == 0 && i > 10)
+            addEdgeInCFG(bbs[i], bbs[i - 1 - rng() % 10]);
+    }
+    return func;
+}
+
+// 随机稀疏图：每个块两条出边，其中一条指向任意块，支配树很浅、支配边界很大
+static FunctionPtr randomCFG(int n, std::mt19937& rng)
+{
+    auto func = FunctionPtr(new Function(IRArenaPtr(new IRArena())));
+    func->basicBlocks.clear();
+    vector<BasicBlockPtr> bbs;
+    for(int i = 0; i < n; i++) {
+        bbs.push_back(func->newBasicBlock());
+        func->pushBasicBlock(bbs.back());
+    }
+    for(int i = 0; i + 1 < n; i++) {
+        addEdgeInCFG(bbs[i], bbs[i + 1]);
+        int target = 1 + rng() % (n - 1);
+        if(target != i + 1)
+            addEdgeInCFG(bbs[i], bbs[target]);
+    }
+    return func;
+}
+
+// 重复runs次取最短时间，单位毫秒
+static double timeDomTree(FunctionPtr func, int runs)
+{
+    double best = 1e18;
+    for(int r = 0; r < runs; r++) {
+        auto start = std::chrono::steady_clock::now();
+        domTree(func);
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    vector<int> sizes;
+    for(int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if(sizes.empty())
+        sizes = {1000, 10000, 100000};
+    std::mt19937 rng(42);
+    printf("%10s %14s %14s\n", "blocks", "structured/ms", "random/ms");
+    for(int n : sizes) {
+        if(n < 2)
+            continue;
+        int runs = n <= 10000 ? 5 : 3;
+        double structured = timeDomTree(structuredCFG(n, rng), runs);
+        double random = timeDomTree(randomCFG(n, rng), runs);
+        printf("%10d %14.3f %14.3f\n", n, structured, random);
+    }
+    return 0;
+}
@@ -23,75 +23,52 @@ void printUse(ValuePtr val)
 
 void MyVisitor::opt()
 {
-    for (auto &func : (irModule.globalFunctions))
+    // 各pass需要的分析由analysisManager按需计算，见opt/analysisManager.h
+    auto& am = analysisManager;
+    // 各函数互不影响的阶段按函数并行，模块级pass在两个阶段之间串行执行
+    forEachFunction(irModule, optThreads, [&](FunctionPtr func)
     {
-        if (!func->isLib)
-        {
-            computeCFG(func);
-            domTree(func);
-            mem2reg(func);
-        }
-    }
-    for (auto &func : (irModule.globalFunctions))
+        RUN_PASS(am, func, mem2reg);
+    });
+    forEachFunction(irModule, optThreads, [&](FunctionPtr func)
     {
-        if (!func->isLib)
-        {
-            dce(func);
-            reassociate(func);
-        }
-    }
-    globalConstReplace(irModule);
-    inliner(irModule);
-    for (auto &func : (irModule.globalFunctions))
+        RUN_PASS(am, func, dce);
+        RUN_PASS(am, func, reassociate);
+    });
+    RUN_PASS(am, irModule, globalConstReplace);
+    // 内联的代价模型用到被调函数经指针形参访问内存的摘要
+    RUN_PASS(am, irModule, computeCallEffects);
+    RUN_PASS(am, irModule, inliner);
+    forEachFunction(irModule, optThreads, [&](FunctionPtr func)
     {
-        if (!func->isLib)
-        {
-            computeCFG(func);
-            domTree(func);
-            simplifyCFG(func);
-            computeCFG(func);
-            domTree(func);
-            computeUse(func);
-        }
-    }
-
-    for (auto &func : (irModule.globalFunctions))
+#ifdef VERIFY_CFG
+        if(!verifyCFG(func))
+            abort();
+#endif
+        RUN_PASS(am, func, simplifyCFG);
+    });
+
+    // LICM、gvn需要被调函数的副作用摘要，内联后重新统一算好，并行阶段不再读其他函数的函数体
+    RUN_PASS(am, irModule, computeCallEffects);
+    forEachFunction(irModule, optThreads, [&](FunctionPtr func)
     {
-        if (!func->isLib)
-        {
-            loopAnalysis(func);
-            dce(func);
-            cse(func);
-            strengthReduction(func);
-            constPropogation(func);
-            LICM(func);
-            LCSSA(func);
-            // unrollLoop(func);
-            computeUse(func);
-            reassociate(func);
-            computeUse(func);
-            dce(func);
-            computeUse(func);
-            // constPropogation(func);
-        }
-    }
-
-    // for (auto &func : (irModule.globalFunctions))
-    // {
-    //     if (!func->isLib)
-    //     {
-    //         computeCFG(func);
-    //         domTree(func);
-    //         simplifyCFG(func);
-    //         computeCFG(func);
-    //         domTree(func);
-    //         cse(func);
-    //         computeUse(func);
-    //         constPropogation(func);
-    //         computeCFG(func);
-    //         domTree(func);
-    //     }
-    // }
+        RUN_PASS(am, func, dce);
+        RUN_PASS(am, func, gvn);
+        // load被转发之后，很多store不再有人读
+        RUN_PASS(am, func, deadStorageElimination);
+        RUN_PASS(am, func, strengthReduction);
+        RUN_PASS(am, func, sccp);
+        RUN_PASS(am, func, LICM);
+        RUN_PASS(am, func, LCSSA);
+        RUN_PASS(am, func, loopUnroll);
+        // 展开后的副本中归纳变量成了常量，顺带折叠分支
+        RUN_PASS(am, func, sccp);
+        RUN_PASS(am, func, reassociate);
+        RUN_PASS(am, func, dce);
+        // 后端依赖准确的use链，向量化还要用到循环信息
+        am.require(func, AnalysisUse | AnalysisLoop);
+    });
+    am.reportStats();
 }
 
 //访问CompUnit，即整个代码
@@ -145,25 +122,25 @@ antlrcpp::Any MyVisitor::visitListInitVal(SysY2022Parser::ListInitValContext *ct
 antlrcpp::Any MyVisitor::visitFuncFParam(SysY2022Parser::FuncFParamContext *ctx)
 {
     auto name = ctx->Identifier()->getText();
-    auto type = TypePtr(new Type(ctx->bType()->getText()));
+    auto type = Type::get(ctx->bType()->getText());
     if (ctx->children.size() == 2)
     {
         assert(type->isInt() || type->isFloat());
         if (type->isInt())
-            return VariablePtr(new Int(name, false, false));
+            return newIR<Int>(name, false, false);
         else
-            return VariablePtr(new Float(name, false, false));
+            return newIR<Float>(name, false, false);
     }
     else
     {
         auto curr = type;
         for (int childInd = ctx->children.size() - 2; childInd >= 5; childInd -= 3)
         {
-            curr = TypePtr(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+            curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
             // curr = TypePtr(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
         }  
-        curr = TypePtr(new PtrType(curr));
-        return VariablePtr(new Ptr(name, false, false, curr));
+        curr = PtrType::get(curr);
+        return newIR<Ptr>(name, false, false, curr);
     }
 }
 
@@ -180,10 +157,10 @@ antlrcpp::Any MyVisitor::visitFuncFParams(SysY2022Parser::FuncFParamsContext *ct
 
 antlrcpp::Any MyVisitor::visitFuncDef(SysY2022Parser::FuncDefContext *ctx)
 {
-    auto type = TypePtr(new Type(ctx->funcType()->getText()));
+    auto type = Type::get(ctx->funcType()->getText());
     auto name = ctx->Identifier()->getText();
 
-    irModule.pushFunc(FunctionPtr(new Function()));
+    irModule.pushFunc(FunctionPtr(new Function(irModule.arena)));
     auto params = vector<ValuePtr>();
     if (ctx->children.size() == 6)
     {
@@ -197,21 +174,21 @@ antlrcpp::Any MyVisitor::visitFuncDef(SysY2022Parser::FuncDefContext *ctx)
             addr->name += ".addr";
             irModule.paramStringTable->variableTable[var->name] = addr;
             irModule.getFunc()->pushVariable(addr);
-            irModule.getBasicBlock()->pushInstruction(InstructionPtr(new StoreInstruction(addr, var, irModule.getBasicBlock())));
+            irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(addr, var, irModule.getBasicBlock()));
         }
     }
-    auto func = FunctionPtr(new Function(type, name, params));
+    auto func = FunctionPtr(new Function(irModule.arena, type, name, params));
     func->setReturnBasicBlock();
     irModule.pushGlobalFunction(func);
     if (type->isInt())
     {
-        VariablePtr retVal = VariablePtr(new Int("retval", false, false));
+        VariablePtr retVal = newIR<Int>("retval", false, false);
         irModule.getFunc()->pushVariable(retVal);
         func->retVal = retVal;
     }
     else if (type->isFloat())
     {
-        VariablePtr retVal = VariablePtr(new Float("retval", false, false));
+        VariablePtr retVal = newIR<Float>("retval", false, false);
         irModule.getFunc()->pushVariable(retVal);
         func->retVal = retVal;
     }
@@ -219,7 +196,7 @@ antlrcpp::Any MyVisitor::visitFuncDef(SysY2022Parser::FuncDefContext *ctx)
         func->retVal = Void::get();
     ctx->block()->accept(this);
     if (type->isVoid() || !irModule.getBasicBlock()->endInstruction)
-        irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(irModule.globalFunctions.back()->returnBasicBlock->label, irModule.getBasicBlock())));
+        irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(irModule.globalFunctions.back()->returnBasicBlock->label, irModule.getBasicBlock()));
     
     irModule.getFunc()->allocLocalVariable();
     irModule.getFunc()->setBBbelongFunc(irModule.globalFunctions.back());
@@ -276,7 +253,7 @@ antlrcpp::Any MyVisitor::visitReturnStmt(SysY2022Parser::ReturnStmtContext *ctx)
                 }
                 else
                 {
-                    auto instruction = shared_ptr<FptosiInstruction>(new FptosiInstruction(value, irModule.getBasicBlock()));
+                    auto instruction = newIR<FptosiInstruction>(value, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     value = instruction->reg;
                 }
@@ -288,20 +265,20 @@ antlrcpp::Any MyVisitor::visitReturnStmt(SysY2022Parser::ReturnStmtContext *ctx)
                     value = Const::getConst(Type::getFloat(),float(dynamic_cast<Const *>(value.get())->intVal), value->name);
                 }
                 else{
-                    auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(value, irModule.getBasicBlock()));
+                    auto instruction = newIR<SitofpInstruction>(value, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     value = instruction->reg;
                 }
             }
             // to-do
         }
-        irModule.getBasicBlock()->pushInstruction(InstructionPtr(new StoreInstruction(irModule.globalFunctions.back()->retVal, value, irModule.getBasicBlock())));
+        irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(irModule.globalFunctions.back()->retVal, value, irModule.getBasicBlock()));
     }
     else
     {
         value = Void::get();
     }
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(irModule.globalFunctions.back()->returnBasicBlock->label, irModule.getBasicBlock())));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(irModule.globalFunctions.back()->returnBasicBlock->label, irModule.getBasicBlock()));
 
     return nullptr;
 }
@@ -323,20 +300,20 @@ antlrcpp::Any MyVisitor::visitVarDefWithOutInitVal(SysY2022Parser::VarDefWithOut
         if (childSize == 1)
         {
             if (irModule.declType->isInt())
-                irModule.pushVariable(VariablePtr(new Int(name, true, false)));
+                irModule.pushVariable(newIR<Int>(name, true, false));
             else if (irModule.declType->isFloat())
-                irModule.pushVariable(VariablePtr(new Float(name, true, false)));
+                irModule.pushVariable(newIR<Float>(name, true, false));
         }
         else
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 2]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 2]->accept(this))->getStr()));
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 2]->accept(this).as<ValuePtr>()->getStr())));
             for (int childInd = childSize - 5; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
-            VariablePtr variable = shared_ptr<Arr>(new Arr(name, true, false, curr));
+            VariablePtr variable = newIR<Arr>(name, true, false, curr);
             irModule.pushVariable(variable);
         }
     }
@@ -346,21 +323,21 @@ antlrcpp::Any MyVisitor::visitVarDefWithOutInitVal(SysY2022Parser::VarDefWithOut
         {
             VariablePtr variable;
             if (irModule.declType->isInt())
-                variable = VariablePtr(new Int(name, false, false));
+                variable = newIR<Int>(name, false, false);
             else if (irModule.declType->isFloat())
-                variable = VariablePtr(new Float(name, false, false));
+                variable = newIR<Float>(name, false, false);
             irModule.registerVariable(variable);
         }
         else
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 2]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 2]->accept(this))->getStr()));
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 2]->accept(this).as<ValuePtr>()->getStr())));
             for (int childInd = childSize - 5; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
-            VariablePtr variable = shared_ptr<Arr>(new Arr(name, false, false, curr));
+            VariablePtr variable = newIR<Arr>(name, false, false, curr);
             irModule.registerVariable(variable);
         }
     }
@@ -373,15 +350,15 @@ VariablePtr MyVisitor::arrInitItem(SysY2022Parser::ItemInitValContext *ctx, Type
     auto number = std::any_cast<ValuePtr>(dynamic_cast<SysY2022Parser::ItemInitValContext *>(ctx)->accept(this));
     // auto number = dynamic_cast<SysY2022Parser::ItemInitValContext *>(ctx)->accept(this).as<ValuePtr>();
     if (irModule.declType->isInt())
-        return VariablePtr(new Int("", false, false, number));
+        return newIR<Int>("", false, false, number);
     else
-        return VariablePtr(new Float("", false, false, number));
+        return newIR<Float>("", false, false, number);
 }
 
 shared_ptr<Arr> MyVisitor::arrInitList(SysY2022Parser::ListInitValContext *ctx, TypePtr type)
 {
     int sz = ctx->children.size();
-    shared_ptr<Arr> rst = shared_ptr<Arr>(new Arr(string("__const.") + to_string(constArr++), true, true, type));
+    shared_ptr<Arr> rst = newIR<Arr>(string("__const.") + to_string(constArr++), true, true, type);
     for (int ind = 1; ind < sz - 1; ind += 2)
     {
         VariablePtr curr;
@@ -402,13 +379,13 @@ VariablePtr MyVisitor::arrInitItem(SysY2022Parser::ItemConstInitValContext *ctx,
 {
     string number = dynamic_cast<SysY2022Parser::ItemConstInitValContext *>(ctx)->getText();
     assert(!number.empty());
-    return VariablePtr(new Int("", false, false, stoi(number)));
+    return newIR<Int>("", false, false, stoi(number));
 }
 
 shared_ptr<Arr> MyVisitor::arrInitList(SysY2022Parser::ListConstInitValContext *ctx, TypePtr type)
 {
     int sz = ctx->children.size();
-    shared_ptr<Arr> rst = shared_ptr<Arr>(new Arr("", true, true, type));
+    shared_ptr<Arr> rst = newIR<Arr>("", true, true, type);
     for (int ind = 1; ind < sz - 1; ind += 2)
     {
         VariablePtr curr;
@@ -504,10 +481,10 @@ void MyVisitor::arrSetList(SysY2022Parser::ListInitValContext *ctx, ValuePtr val
             if (ctx->children[i]->children.size() == 1)
             { // 值
                 auto reg = std::any_cast<ValuePtr>(ctx->children[i]->accept(this));
-                auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(value, indexs, irModule.getBasicBlock()));
+                auto ins = newIR<GetElementPtrInstruction>(value, indexs, irModule.getBasicBlock());
                 if (!value->isReg && dynamic_cast<Variable *>(value.get())->isGlobal)
                 {
-                    irModule.getBasicBlock()->pushInstruction(InstructionPtr(new StoreInstruction(ins, reg, irModule.getBasicBlock())));
+                    irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(ins, reg, irModule.getBasicBlock()));
                 }
                 else
                 {
@@ -518,19 +495,19 @@ void MyVisitor::arrSetList(SysY2022Parser::ListInitValContext *ctx, ValuePtr val
                         if (val->type->isInt() && reg->type->isFloat())
                         {
                             // to-do: isconst
-                            auto ins = shared_ptr<FptosiInstruction>(new FptosiInstruction(reg, irModule.getBasicBlock()));
+                            auto ins = newIR<FptosiInstruction>(reg, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(ins);
                             reg = ins->reg;
                         }
                         else if (val->type->isFloat() && reg->type->isInt())
                         {
                             // to-do: isconst
-                            auto ins = shared_ptr<SitofpInstruction>(new SitofpInstruction(reg, irModule.getBasicBlock()));
+                            auto ins = newIR<SitofpInstruction>(reg, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(ins);
                             reg = ins->reg;
                         }
                     }
-                    irModule.getBasicBlock()->pushInstruction(InstructionPtr(new StoreInstruction(val, reg, irModule.getBasicBlock())));
+                    irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(val, reg, irModule.getBasicBlock()));
                     // irModule.getBasicBlock()->instructions.back()->print();
                 }
 
@@ -539,7 +516,7 @@ void MyVisitor::arrSetList(SysY2022Parser::ListInitValContext *ctx, ValuePtr val
             else
             { // 列表
                 vector<ValuePtr> inner = {indexs[0], indexs[1]};
-                auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(value, inner, irModule.getBasicBlock()));
+                auto ins = newIR<GetElementPtrInstruction>(value, inner, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
                 arrSetList(dynamic_cast<SysY2022Parser::ListInitValContext *>(ctx->children[i]), ins->reg);
                 // indexs[1] = ValuePtr(new Const(Type::getInt64(), dynamic_cast<Const *>(indexs[1].get())->intVal + 1));
@@ -562,23 +539,23 @@ antlrcpp::Any MyVisitor::visitVarDefWithInitVal(SysY2022Parser::VarDefWithInitVa
         if (childSize == 3)
         {
             if (irModule.declType->isInt())
-                irModule.pushVariable(VariablePtr(new Int(name, true, false, std::any_cast<ValuePtr>(ctx->initVal()->accept(this)))));
+                irModule.pushVariable(newIR<Int>(name, true, false, std::any_cast<ValuePtr>(ctx->initVal()->accept(this))));
                 // irModule.pushVariable(VariablePtr(new Int(name, true, false, ctx->initVal()->accept(this).as<ValuePtr>())));
             else if (irModule.declType->isFloat())
                 // irModule.pushVariable(VariablePtr(new Float(name, true, false, ctx->initVal()->accept(this).as<ValuePtr>())));
-                irModule.pushVariable(VariablePtr(new Float(name, true, false, std::any_cast<ValuePtr>(ctx->initVal()->accept(this)))));
+                irModule.pushVariable(newIR<Float>(name, true, false, std::any_cast<ValuePtr>(ctx->initVal()->accept(this))));
         }
         else
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr()));
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 4]->accept(this).as<ValuePtr>()->getStr())));
             for (int childInd = childSize - 7; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
             auto initVal = arrInitList(dynamic_cast<SysY2022Parser::ListInitValContext *>(ctx->initVal()), curr);
-            auto variable = shared_ptr<Arr>(new Arr(name, true, false, curr));
+            auto variable = newIR<Arr>(name, true, false, curr);
             variable->inner = initVal->inner;
             irModule.pushVariable(variable);
         }
@@ -589,41 +566,41 @@ antlrcpp::Any MyVisitor::visitVarDefWithInitVal(SysY2022Parser::VarDefWithInitVa
         {
             VariablePtr variable;
             if (irModule.declType->isInt())
-                variable = VariablePtr(new Int(name, false, false));
+                variable = newIR<Int>(name, false, false);
             else if (irModule.declType->isFloat())
-                variable = VariablePtr(new Float(name, false, false));
+                variable = newIR<Float>(name, false, false);
             auto exp = std::any_cast<ValuePtr>(ctx->initVal()->accept(this));
             // auto exp = ctx->initVal()->accept(this).as<ValuePtr>();
             if(exp->type->ID!=variable->type->ID){
                 //int->float
                 if(exp->type->isInt()){
-                    auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(exp, irModule.getBasicBlock()));
+                    auto instruction = newIR<SitofpInstruction>(exp, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     exp = instruction->reg;
                 }
                 //float->int
                 else{
-                    auto instruction = shared_ptr<FptosiInstruction>(new FptosiInstruction(exp, irModule.getBasicBlock()));
+                    auto instruction = newIR<FptosiInstruction>(exp, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     exp = instruction->reg;
                 }
             }
             
-            irModule.getBasicBlock()->pushInstruction(InstructionPtr(new StoreInstruction(variable, exp, irModule.getBasicBlock())));
+            irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(variable, exp, irModule.getBasicBlock()));
             irModule.registerVariable(variable);
         }
         else // 数组
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr()));
             
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 4]->accept(this).as<ValuePtr>()->getStr())));
             for (int childInd = childSize - 7; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
 
-            VariablePtr variable = shared_ptr<Arr>(new Arr(name, false, false, curr));
+            VariablePtr variable = newIR<Arr>(name, false, false, curr);
             irModule.registerVariable(variable);
 
             bool isConstInitVal = dfsInitVal(ctx->initVal());
@@ -655,7 +632,7 @@ antlrcpp::Any MyVisitor::visitVarDefWithInitVal(SysY2022Parser::VarDefWithInitVa
                 // }
 
                 // 暴力 set
-                auto arrBitCast = shared_ptr<BitCastInstruction>(new BitCastInstruction(variable, irModule.getFunc()->getReg(TypePtr(new PtrType(Type::getInt8()))), irModule.getBasicBlock()));
+                auto arrBitCast = newIR<BitCastInstruction>(variable, irModule.getFunc()->getReg(PtrType::get(Type::getInt8())), irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(arrBitCast);
                 // vector<ValuePtr> argv = {arrBitCast->reg,
                 //                          ValuePtr(new Const(Type::getInt8(), 0)),
@@ -665,13 +642,13 @@ antlrcpp::Any MyVisitor::visitVarDefWithInitVal(SysY2022Parser::VarDefWithInitVa
                                          Const::getConst(Type::getInt8(), int8_t(0)),
                                          Const::getConst(Type::getInt64(),(long long)( dynamic_cast<ArrType *>(variable->type.get())->getSize() * 4)),
                                          Const::getConst(Type::getBool(),false)};
-                irModule.getBasicBlock()->pushInstruction(InstructionPtr(new CallInstruction(irModule.globalFunctions[0], argv, irModule.getBasicBlock())));
+                irModule.getBasicBlock()->pushInstruction(newIR<CallInstruction>(irModule.globalFunctions[0], argv, irModule.getBasicBlock()));
                 arrSetList(dynamic_cast<SysY2022Parser::ListInitValContext *>(ctx->initVal()), variable);
             }
             else
             {
                 // 无脑 memset 0
-                auto arrBitCast = shared_ptr<BitCastInstruction>(new BitCastInstruction(variable, irModule.getFunc()->getReg(TypePtr(new PtrType(Type::getInt8()))), irModule.getBasicBlock()));
+                auto arrBitCast = newIR<BitCastInstruction>(variable, irModule.getFunc()->getReg(PtrType::get(Type::getInt8())), irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(arrBitCast);
                 // vector<ValuePtr> argv = {arrBitCast->reg,
                 //                          ValuePtr(new Const(Type::getInt8(), 0)),
@@ -681,7 +658,7 @@ antlrcpp::Any MyVisitor::visitVarDefWithInitVal(SysY2022Parser::VarDefWithInitVa
                                          Const::getConst(Type::getInt8(), 0),
                                          Const::getConst(Type::getInt64(), dynamic_cast<ArrType *>(variable->type.get())->getSize() * 4),
                                          Const::getConst(Type::getBool(),false)};
-                irModule.getBasicBlock()->pushInstruction(InstructionPtr(new CallInstruction(irModule.globalFunctions[0], argv, irModule.getBasicBlock())));
+                irModule.getBasicBlock()->pushInstruction(newIR<CallInstruction>(irModule.globalFunctions[0], argv, irModule.getBasicBlock()));
 
                 // 初始值一位一位 set
                 arrSetList(dynamic_cast<SysY2022Parser::ListInitValContext *>(ctx->initVal()), variable);
@@ -699,7 +676,7 @@ antlrcpp::Any MyVisitor::visitConstDecl(SysY2022Parser::ConstDeclContext *ctx)
 
 antlrcpp::Any MyVisitor::visitBType(SysY2022Parser::BTypeContext *ctx)
 {
-    irModule.declType = TypePtr(new Type(ctx->getText()));
+    irModule.declType = Type::get(ctx->getText());
     return nullptr;
 }
 
@@ -714,20 +691,20 @@ antlrcpp::Any MyVisitor::visitConstDef(SysY2022Parser::ConstDefContext *ctx)
         if (childSize == 3)
         {
             if (irModule.declType->isInt())
-                irModule.pushVariable(VariablePtr(new Int(name, true, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this)))));
+                irModule.pushVariable(newIR<Int>(name, true, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this))));
                 // irModule.pushVariable(VariablePtr(new Int(name, true, true, ctx->constInitVal()->accept(this).as<ValuePtr>())));
             else if (irModule.declType->isFloat())
-                irModule.pushVariable(VariablePtr(new Float(name, true, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this)))));
+                irModule.pushVariable(newIR<Float>(name, true, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this))));
                 // irModule.pushVariable(VariablePtr(new Float(name, true, true, ctx->constInitVal()->accept(this).as<ValuePtr>())));
         }
         else
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr()));
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 4]->accept(this).as<ValuePtr>()->getStr())));
             
             for (int childInd = childSize - 7; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
 
@@ -744,21 +721,21 @@ antlrcpp::Any MyVisitor::visitConstDef(SysY2022Parser::ConstDefContext *ctx)
         {
             VariablePtr variable;
             if (irModule.declType->isInt())
-                variable = VariablePtr(new Int(name, false, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this))));
+                variable = newIR<Int>(name, false, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this)));
                 // variable = VariablePtr(new Int(name, false, true, ctx->constInitVal()->accept(this).as<ValuePtr>()));
             else if (irModule.declType->isFloat())
-                variable = VariablePtr(new Float(name, false, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this))));
+                variable = newIR<Float>(name, false, true, std::any_cast<ValuePtr>(ctx->constInitVal()->accept(this)));
                 // variable = VariablePtr(new Float(name, false, true, ctx->constInitVal()->accept(this).as<ValuePtr>()));
             irModule.currStringTable->insert(variable);
         }
         else // 数组
         {
-            auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr())));
+            auto curr = ArrType::get(irModule.declType, stoi(std::any_cast<ValuePtr>(ctx->children[childSize - 4]->accept(this))->getStr()));
             // auto curr = shared_ptr<ArrType>(new ArrType(irModule.declType, stoi(ctx->children[childSize - 4]->accept(this).as<ValuePtr>()->getStr())));
             
             for (int childInd = childSize - 7; childInd > 1; childInd -= 3)
             {
-                curr = shared_ptr<ArrType>(new ArrType(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr())));
+                curr = ArrType::get(curr, stoi(std::any_cast<ValuePtr>(ctx->children[childInd]->accept(this))->getStr()));
                 // curr = shared_ptr<ArrType>(new ArrType(curr, stoi(ctx->children[childInd]->accept(this).as<ValuePtr>()->getStr())));
             }
 
@@ -787,26 +764,26 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
             if (val->type->isInt() && exp->type->isFloat())
             {
                 // to-do: isconst
-                auto ins = shared_ptr<FptosiInstruction>(new FptosiInstruction(exp, irModule.getBasicBlock()));
+                auto ins = newIR<FptosiInstruction>(exp, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
                 exp = ins->reg;
             }
             else if (val->type->isFloat() && exp->type->isInt())
             {
                 // to-do: isconst
-                auto ins = shared_ptr<SitofpInstruction>(new SitofpInstruction(exp, irModule.getBasicBlock()));
+                auto ins = newIR<SitofpInstruction>(exp, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
                 exp = ins->reg;
             }
         }
-        irModule.getBasicBlock()->pushInstruction(shared_ptr<StoreInstruction>(new StoreInstruction(val, exp, irModule.getBasicBlock())));
+        irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(val, exp, irModule.getBasicBlock()));
     }
     else
     {
         ValuePtr curr = val;
         if (val->type->isPtr())
         {
-            auto ins = shared_ptr<LoadInstruction>(new LoadInstruction(curr, irModule.getFunc()->getReg(dynamic_cast<PtrType *>(curr->type.get())->inner), irModule.getBasicBlock()));
+            auto ins = newIR<LoadInstruction>(curr, irModule.getFunc()->getReg(dynamic_cast<PtrType *>(curr->type.get())->inner), irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(ins);
             curr = ins->to;
 
@@ -822,12 +799,12 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
                 }
                 else
                 {
-                    auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                    auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(sextIns);
                     ind = sextIns->reg;
                 }
             }
-            auto inst = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, vector<ValuePtr>({ind}), irModule.getBasicBlock()));
+            auto inst = newIR<GetElementPtrInstruction>(curr, vector<ValuePtr>({ind}), irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(inst);
             curr = inst->reg;
 
@@ -849,14 +826,14 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
                         }
                         else
                         {
-                            auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                            auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(sextIns);
                             ind = sextIns->reg;
                         }
                     }
                     indexs.emplace_back(ind);
                 }
-                inst = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, indexs, irModule.getBasicBlock()));
+                inst = newIR<GetElementPtrInstruction>(curr, indexs, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(inst);
                 curr = inst->reg;
             }
@@ -878,20 +855,20 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
                         if (val->type->isInt() && exp->type->isFloat())
                         {
                             // to-do: isconst
-                            auto ins = shared_ptr<FptosiInstruction>(new FptosiInstruction(exp, irModule.getBasicBlock()));
+                            auto ins = newIR<FptosiInstruction>(exp, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(ins);
                             exp = ins->reg;
                         }
                         else if (val->type->isFloat() && exp->type->isInt())
                         {
                             // to-do: isconst
-                            auto ins = shared_ptr<SitofpInstruction>(new SitofpInstruction(exp, irModule.getBasicBlock()));
+                            auto ins = newIR<SitofpInstruction>(exp, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(ins);
                             exp = ins->reg;
                         }
                     }
                 }
-            irModule.getBasicBlock()->pushInstruction(shared_ptr<StoreInstruction>(new StoreInstruction(curr, exp, irModule.getBasicBlock())));
+            irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(curr, exp, irModule.getBasicBlock()));
         }
         else
         {
@@ -910,7 +887,7 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
                     }
                     else
                     {
-                        auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                        auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                         irModule.getBasicBlock()->pushInstruction(sextIns);
                         ind = sextIns->reg;
                     }
@@ -918,21 +895,21 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
                 indexs.emplace_back(ind);
             }
 
-            auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, indexs, irModule.getBasicBlock()));
+            auto ins = newIR<GetElementPtrInstruction>(curr, indexs, irModule.getBasicBlock());
             curr = ins->reg;
             if (!curr->type->operator==(exp->type))
             {
                 if (curr->type->isInt() && exp->type->isFloat())
                 {
                     // to-do: isconst
-                    auto ins = shared_ptr<FptosiInstruction>(new FptosiInstruction(exp, irModule.getBasicBlock()));
+                    auto ins = newIR<FptosiInstruction>(exp, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(ins);
                     exp = ins->reg;
                 }
                 else if (curr->type->isFloat() && exp->type->isInt())
                 {
                     // to-do: isconst
-                    auto ins = shared_ptr<SitofpInstruction>(new SitofpInstruction(exp, irModule.getBasicBlock()));
+                    auto ins = newIR<SitofpInstruction>(exp, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(ins);
                     exp = ins->reg;
                 }
@@ -956,7 +933,7 @@ antlrcpp::Any MyVisitor::visitAssignStmt(SysY2022Parser::AssignStmtContext *ctx)
             //     }
             // }
             irModule.getBasicBlock()->pushInstruction(ins);
-            irModule.getBasicBlock()->pushInstruction(shared_ptr<StoreInstruction>(new StoreInstruction(curr, exp, irModule.getBasicBlock())));
+            irModule.getBasicBlock()->pushInstruction(newIR<StoreInstruction>(curr, exp, irModule.getBasicBlock()));
         }
     }
     return exp; // 返回值
@@ -983,7 +960,7 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
         // cerr<<indexs.size()<<endl;
         if (val->type->isPtr()) // 函数参数访问
         {
-            auto ins = shared_ptr<LoadInstruction>(new LoadInstruction(curr, irModule.getFunc()->getReg(dynamic_cast<PtrType *>(curr->type.get())->inner), irModule.getBasicBlock()));
+            auto ins = newIR<LoadInstruction>(curr, irModule.getFunc()->getReg(dynamic_cast<PtrType *>(curr->type.get())->inner), irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(ins);
             curr = ins->to;
 
@@ -998,12 +975,12 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                 }
                 else
                 {
-                    auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                    auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(sextIns);
                     ind = sextIns->reg;
                 }
             }
-            auto inst = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, vector<ValuePtr>({ind}), irModule.getBasicBlock()));
+            auto inst = newIR<GetElementPtrInstruction>(curr, vector<ValuePtr>({ind}), irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(inst);
             curr = inst->reg;
             indexs.erase(indexs.begin());
@@ -1024,18 +1001,18 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                         }
                         else
                         {
-                            auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                            auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                             irModule.getBasicBlock()->pushInstruction(sextIns);
                             ind = sextIns->reg;
                         }
                         indexs[i] = ind;
                     }
                 }
-                inst = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, indexs, irModule.getBasicBlock()));
+                inst = newIR<GetElementPtrInstruction>(curr, indexs, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(inst);
                 curr = inst->reg;
             }
-            ins = shared_ptr<LoadInstruction>(new LoadInstruction(curr, irModule.getFunc()->getReg(curr->type), irModule.getBasicBlock()));
+            ins = newIR<LoadInstruction>(curr, irModule.getFunc()->getReg(curr->type), irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(ins);
             return ins->to;
         }
@@ -1085,7 +1062,7 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                     }
                     else
                     {
-                        auto sextIns = shared_ptr<ExtInstruction>(new ExtInstruction(ind, Type::getInt64(), true, irModule.getBasicBlock()));
+                        auto sextIns = newIR<ExtInstruction>(ind, Type::getInt64(), true, irModule.getBasicBlock());
                         irModule.getBasicBlock()->pushInstruction(sextIns);
                         ind = sextIns->reg;
                     }
@@ -1114,9 +1091,9 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                 //         return inst->to;
                 //     }
                 // }
-                auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(val, indexs, irModule.getBasicBlock()));
+                auto ins = newIR<GetElementPtrInstruction>(val, indexs, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
-                inst = shared_ptr<LoadInstruction>(new LoadInstruction(ins->reg, irModule.getFunc()->getReg(ins->reg->type), irModule.getBasicBlock()));
+                inst = newIR<LoadInstruction>(ins->reg, irModule.getFunc()->getReg(ins->reg->type), irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(inst);
                 return inst->to;
             }
@@ -1130,8 +1107,8 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                 // cerr<<indexs.size()<<endl;
                 // indexs.emplace_back(ValuePtr(new Const(Type::getInt64(), 0)));
                 indexs.emplace_back(Const::getConst(Type::getInt64(), 0));
-                auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(curr, indexs, irModule.getBasicBlock()));
-                ins->reg->type = TypePtr(new PtrType(ins->reg->type)); // 指针化
+                auto ins = newIR<GetElementPtrInstruction>(curr, indexs, irModule.getBasicBlock());
+                ins->reg->type = PtrType::get(ins->reg->type); // 指针化
                 // ins->reg->type  = TypePtr(new PtrType(dynamic_cast<ArrType *>(ins->reg->type.get())->inner));
                 irModule.getBasicBlock()->pushInstruction(ins);
                 return ins->reg;
@@ -1159,14 +1136,14 @@ antlrcpp::Any MyVisitor::visitLVal(SysY2022Parser::LValContext *ctx)
                 vector<ValuePtr> index = {
                     Const::getConst(Type::getInt64(), 0),
                     Const::getConst(Type::getInt64(), 0)};
-                auto ins = shared_ptr<GetElementPtrInstruction>(new GetElementPtrInstruction(val, index, irModule.getBasicBlock()));
+                auto ins = newIR<GetElementPtrInstruction>(val, index, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
-                ins->reg->type = TypePtr(new PtrType(ins->reg->type));
+                ins->reg->type = PtrType::get(ins->reg->type);
                 return ins->reg;
             }
             else
             {
-                auto ins = shared_ptr<LoadInstruction>(new LoadInstruction(val, irModule.getFunc()->getReg(val->type), irModule.getBasicBlock()));
+                auto ins = newIR<LoadInstruction>(val, irModule.getFunc()->getReg(val->type), irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
                 return ins->to;
             }
@@ -1245,13 +1222,13 @@ antlrcpp::Any MyVisitor::visitFunctionCallUnaryExp(SysY2022Parser::FunctionCallU
             {
                 if (argv[i]->type->isFloat() && func->formArguments[i]->type->isInt())
                 {
-                    auto ins = shared_ptr<FptosiInstruction>(new FptosiInstruction(argv[i], irModule.getBasicBlock()));
+                    auto ins = newIR<FptosiInstruction>(argv[i], irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(ins);
                     argv[i] = ins->reg;
                 }
                 else if (argv[i]->type->isInt() && func->formArguments[i]->type->isFloat())
                 {
-                    auto ins = shared_ptr<SitofpInstruction>(new SitofpInstruction(argv[i], irModule.getBasicBlock()));
+                    auto ins = newIR<SitofpInstruction>(argv[i], irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(ins);
                     argv[i] = ins->reg;
                 }
@@ -1261,14 +1238,14 @@ antlrcpp::Any MyVisitor::visitFunctionCallUnaryExp(SysY2022Parser::FunctionCallU
                 // }
                 else
                 {
-                    auto ins = shared_ptr<BitCastInstruction>(new BitCastInstruction(argv[i], irModule.getFunc()->getReg(func->formArguments[i]->type), irModule.getBasicBlock(), func->formArguments[i]->type));
+                    auto ins = newIR<BitCastInstruction>(argv[i], irModule.getFunc()->getReg(func->formArguments[i]->type), irModule.getBasicBlock(), func->formArguments[i]->type);
                     irModule.getBasicBlock()->pushInstruction(ins);
                     argv[i] = ins->reg;
                 }
             }
         }
     }
-    auto ins = shared_ptr<CallInstruction>(new CallInstruction(func, argv, irModule.getBasicBlock()));
+    auto ins = newIR<CallInstruction>(func, argv, irModule.getBasicBlock());
     irModule.getBasicBlock()->pushInstruction(ins);
     return ins->reg;
 }
@@ -1308,20 +1285,20 @@ antlrcpp::Any MyVisitor::visitUnaryUnaryExp(SysY2022Parser::UnaryUnaryExpContext
         {
             if (exp->type->isBool())
             {
-                auto ins = shared_ptr<ExtInstruction>(new ExtInstruction(exp, Type::getInt(), false, irModule.getBasicBlock()));
+                auto ins = newIR<ExtInstruction>(exp, Type::getInt(), false, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                 exp = ins->reg;
             }
             if (exp->type->isInt())
             {
                 // auto ins = shared_ptr<BinaryInstruction>(new BinaryInstruction(ValuePtr(new Const(0)), exp, op, irModule.getBasicBlock()));
-                auto ins = shared_ptr<BinaryInstruction>(new BinaryInstruction(Const::getConst(Type::getInt(),0), exp, op, irModule.getBasicBlock()));
+                auto ins = newIR<BinaryInstruction>(Const::getConst(Type::getInt(),0), exp, op, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                 exp = ins->reg;
             }
             else if (exp->type->isFloat())
             {
-                auto ins = shared_ptr<FnegInstruction>(new FnegInstruction(exp, irModule.getBasicBlock()));
+                auto ins = newIR<FnegInstruction>(exp, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(ins);
                 exp = ins->reg;
             }
@@ -1333,7 +1310,7 @@ antlrcpp::Any MyVisitor::visitUnaryUnaryExp(SysY2022Parser::UnaryUnaryExpContext
             dynamic_cast<Const *>(exp.get())->intVal = (int)0x80000000;
         if (exp->type->isBool())
         {
-            auto ins = shared_ptr<ExtInstruction>(new ExtInstruction(exp, Type::getInt(), false, irModule.getBasicBlock()));
+            auto ins = newIR<ExtInstruction>(exp, Type::getInt(), false, irModule.getBasicBlock());
             irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
             exp = ins->reg;
         }
@@ -1343,13 +1320,13 @@ antlrcpp::Any MyVisitor::visitUnaryUnaryExp(SysY2022Parser::UnaryUnaryExpContext
         {
             if (exp->type->isFloat())
             {
-                auto instruction = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), exp));
+                auto instruction = newIR<FcmpInstruction>(irModule.getBasicBlock(), exp);
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 exp = instruction->reg;
             }
             else
             {
-                auto instruction = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), exp));
+                auto instruction = newIR<IcmpInstruction>(irModule.getBasicBlock(), exp);
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 exp = instruction->reg;
             }
@@ -1370,7 +1347,7 @@ antlrcpp::Any MyVisitor::visitUnaryUnaryExp(SysY2022Parser::UnaryUnaryExpContext
         else
         {
             // auto ins = shared_ptr<BinaryInstruction>(new BinaryInstruction(exp, ValuePtr(new Const(true)), op, irModule.getBasicBlock()));
-            auto ins = shared_ptr<BinaryInstruction>(new BinaryInstruction(exp, Const::getConst(Type::getBool(),true), op, irModule.getBasicBlock()));
+            auto ins = newIR<BinaryInstruction>(exp, Const::getConst(Type::getBool(),true), op, irModule.getBasicBlock());
             // ins->print();
             irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
             exp = ins->reg;
@@ -1434,7 +1411,7 @@ antlrcpp::Any MyVisitor::visitMulMulExp(SysY2022Parser::MulMulExpContext *ctx)
             }
             else
             {
-                auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(a, irModule.getBasicBlock()));
+                auto instruction = newIR<SitofpInstruction>(a, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 a = instruction->reg;
             }
@@ -1451,13 +1428,13 @@ antlrcpp::Any MyVisitor::visitMulMulExp(SysY2022Parser::MulMulExpContext *ctx)
             }
             else
             {
-                auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(b, irModule.getBasicBlock()));
+                auto instruction = newIR<SitofpInstruction>(b, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 b = instruction->reg;
             }
         }
     }
-    auto instruction = shared_ptr<BinaryInstruction>(new BinaryInstruction(a, b, op, irModule.getBasicBlock()));
+    auto instruction = newIR<BinaryInstruction>(a, b, op, irModule.getBasicBlock());
     irModule.getBasicBlock()->pushInstruction(instruction);
     return instruction->reg;
 }
@@ -1517,7 +1494,7 @@ antlrcpp::Any MyVisitor::visitAddAddExp(SysY2022Parser::AddAddExpContext *ctx)
             }
             else
             {
-                auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(a, irModule.getBasicBlock()));
+                auto instruction = newIR<SitofpInstruction>(a, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 a = instruction->reg;
             }
@@ -1534,13 +1511,13 @@ antlrcpp::Any MyVisitor::visitAddAddExp(SysY2022Parser::AddAddExpContext *ctx)
             }
             else
             {
-                auto instruction = shared_ptr<SitofpInstruction>(new SitofpInstruction(b, irModule.getBasicBlock()));
+                auto instruction = newIR<SitofpInstruction>(b, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 b = instruction->reg;
             }
         }
     }
-    auto instruction = shared_ptr<BinaryInstruction>(new BinaryInstruction(a, b, op, irModule.getBasicBlock()));
+    auto instruction = newIR<BinaryInstruction>(a, b, op, irModule.getBasicBlock());
     irModule.getBasicBlock()->pushInstruction(instruction);
 
     return instruction->reg;
@@ -1566,10 +1543,10 @@ antlrcpp::Any MyVisitor::visitIfStmt(SysY2022Parser::IfStmtContext *ctx)
     irModule.trueLabelStack.pop();
     irModule.falseLabelStack.pop();
 
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(trueLabel)));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(trueLabel));
     ctx->stmt()->accept(this);
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(falseLabel, irModule.getBasicBlock())));
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(falseLabel)));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(falseLabel, irModule.getBasicBlock()));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(falseLabel));
     return nullptr;
 }
 
@@ -1584,13 +1561,13 @@ antlrcpp::Any MyVisitor::visitIfElseStmt(SysY2022Parser::IfElseStmtContext *ctx)
     irModule.trueLabelStack.pop();
     irModule.falseLabelStack.pop();
 
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(trueLabel)));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(trueLabel));
     ctx->children[4]->accept(this);
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(endLabel, irModule.getBasicBlock())));
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(falseLabel)));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(endLabel, irModule.getBasicBlock()));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(falseLabel));
     ctx->children[6]->accept(this);
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(endLabel, irModule.getBasicBlock())));
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(endLabel)));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(endLabel, irModule.getBasicBlock()));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(endLabel));
 
     return nullptr;
 }
@@ -1601,8 +1578,8 @@ antlrcpp::Any MyVisitor::visitWhileStmt(SysY2022Parser::WhileStmtContext *ctx)
     auto falseLabel = LabelPtr(new Label(BrInstruction::getwhileEndStr()));
     auto condLabel = LabelPtr(new Label(BrInstruction::getWhileCondStr()));
 
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(condLabel, irModule.getBasicBlock())));
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(condLabel)));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(condLabel, irModule.getBasicBlock()));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(condLabel));
     irModule.whileCondStack.emplace(condLabel);
     irModule.whileEndStack.emplace(falseLabel);
     irModule.trueLabelStack.emplace(trueLabel);
@@ -1610,10 +1587,10 @@ antlrcpp::Any MyVisitor::visitWhileStmt(SysY2022Parser::WhileStmtContext *ctx)
     ctx->cond()->accept(this);
     irModule.trueLabelStack.pop();
     irModule.falseLabelStack.pop();
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(trueLabel)));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(trueLabel));
     ctx->stmt()->accept(this);
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(condLabel, irModule.getBasicBlock())));
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(falseLabel)));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(condLabel, irModule.getBasicBlock()));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(falseLabel));
     irModule.whileEndStack.pop();
     irModule.whileCondStack.pop();
 
@@ -1622,13 +1599,13 @@ antlrcpp::Any MyVisitor::visitWhileStmt(SysY2022Parser::WhileStmtContext *ctx)
 
 antlrcpp::Any MyVisitor::visitBreakStmt(SysY2022Parser::BreakStmtContext *ctx)
 {
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(irModule.whileEndStack.top(), irModule.getBasicBlock())));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(irModule.whileEndStack.top(), irModule.getBasicBlock()));
     return nullptr;
 }
 
 antlrcpp::Any MyVisitor::visitContinueStmt(SysY2022Parser::ContinueStmtContext *ctx)
 {
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr(new BrInstruction(irModule.whileCondStack.top(), irModule.getBasicBlock())));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(irModule.whileCondStack.top(), irModule.getBasicBlock()));
     return nullptr;
 }
 
@@ -1681,7 +1658,7 @@ antlrcpp::Any MyVisitor::visitRelRelExp(SysY2022Parser::RelRelExpContext *ctx)
                     b = Const::getConst(a->type,float(dynamic_cast<Const *>(b.get())->intVal), b->name);
                 }
             }
-            auto ins = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), a, b, op));
+            auto ins = newIR<FcmpInstruction>(irModule.getBasicBlock(), a, b, op);
             irModule.getBasicBlock()->pushInstruction(ins);
             auto trueLabel = irModule.trueLabelStack.top();
             auto falseLabel = irModule.falseLabelStack.top();
@@ -1689,7 +1666,7 @@ antlrcpp::Any MyVisitor::visitRelRelExp(SysY2022Parser::RelRelExpContext *ctx)
         }
         else
         {
-            auto ins = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), a, b, op));
+            auto ins = newIR<IcmpInstruction>(irModule.getBasicBlock(), a, b, op);
             irModule.getBasicBlock()->pushInstruction(ins);
             auto trueLabel = irModule.trueLabelStack.top();
             auto falseLabel = irModule.falseLabelStack.top();
@@ -1735,10 +1712,10 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
             if (a->type->isBool())
             {
                 if(b->type->isInt()){
-                    auto instruction = shared_ptr<ExtInstruction>(new ExtInstruction(a, Type::getInt(), false, irModule.getBasicBlock()));
+                    auto instruction = newIR<ExtInstruction>(a, Type::getInt(), false, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     a = instruction->reg;
-                    auto ins = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                    auto ins = newIR<IcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                     irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                     auto trueLabel = irModule.trueLabelStack.top();
                     auto falseLabel = irModule.falseLabelStack.top();
@@ -1746,13 +1723,13 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
                 }
                 //float
                 else{
-                    auto instruction = shared_ptr<ExtInstruction>(new ExtInstruction(a, Type::getInt(), false, irModule.getBasicBlock()));
+                    auto instruction = newIR<ExtInstruction>(a, Type::getInt(), false, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     a = instruction->reg;
-                    auto instruction2 = shared_ptr<SitofpInstruction>(new SitofpInstruction(a, irModule.getBasicBlock()));
+                    auto instruction2 = newIR<SitofpInstruction>(a, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction2);
                     a = instruction2->reg;
-                    auto ins = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                    auto ins = newIR<FcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                     irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                     auto trueLabel = irModule.trueLabelStack.top();
                     auto falseLabel = irModule.falseLabelStack.top();
@@ -1761,23 +1738,23 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
             }
             else if(b->type->isBool()){
                 if(a->type->isInt()){
-                    auto instruction = shared_ptr<ExtInstruction>(new ExtInstruction(b, Type::getInt(), false, irModule.getBasicBlock()));
+                    auto instruction = newIR<ExtInstruction>(b, Type::getInt(), false, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     b = instruction->reg;
-                    auto ins = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                    auto ins = newIR<IcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                     irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                     auto trueLabel = irModule.trueLabelStack.top();
                     auto falseLabel = irModule.falseLabelStack.top();
                     return ins->reg;
                 }
                 else{
-                    auto instruction = shared_ptr<ExtInstruction>(new ExtInstruction(b, Type::getInt(), false, irModule.getBasicBlock()));
+                    auto instruction = newIR<ExtInstruction>(b, Type::getInt(), false, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction);
                     b = instruction->reg;
-                    auto instruction2 = shared_ptr<SitofpInstruction>(new SitofpInstruction(b, irModule.getBasicBlock()));
+                    auto instruction2 = newIR<SitofpInstruction>(b, irModule.getBasicBlock());
                     irModule.getBasicBlock()->pushInstruction(instruction2);
                     b = instruction2->reg;
-                    auto ins = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                    auto ins = newIR<FcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                     irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                     auto trueLabel = irModule.trueLabelStack.top();
                     auto falseLabel = irModule.falseLabelStack.top();
@@ -1791,7 +1768,7 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
                         // b->type = Type::getFloat();
                         // dynamic_cast<Const *>(b.get())->floatVal = dynamic_cast<Const *>(b.get())->intVal;
                         b = Const::getConst(Type::getFloat(),float(dynamic_cast<Const *>(b.get())->intVal), b->name);
-                        auto ins = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                        auto ins = newIR<FcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                         irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                         auto trueLabel = irModule.trueLabelStack.top();
                         auto falseLabel = irModule.falseLabelStack.top();
@@ -1806,7 +1783,7 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
                         // a->type = Type::getFloat();
                         // dynamic_cast<Const *>(a.get())->floatVal = dynamic_cast<Const *>(a.get())->intVal;
                         a = Const::getConst(Type::getFloat(),float(dynamic_cast<Const *>(a.get())->intVal), a->name);
-                        auto ins = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                        auto ins = newIR<FcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                         irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                         auto trueLabel = irModule.trueLabelStack.top();
                         auto falseLabel = irModule.falseLabelStack.top();
@@ -1819,10 +1796,10 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
             }
             else
             {
-                auto instruction = shared_ptr<ExtInstruction>(new ExtInstruction(b, Type::getInt(), false, irModule.getBasicBlock()));
+                auto instruction = newIR<ExtInstruction>(b, Type::getInt(), false, irModule.getBasicBlock());
                 irModule.getBasicBlock()->pushInstruction(instruction);
                 b = instruction->reg;
-                auto ins = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), a, b, op));
+                auto ins = newIR<IcmpInstruction>(irModule.getBasicBlock(), a, b, op);
                 irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
                 auto trueLabel = irModule.trueLabelStack.top();
                 auto falseLabel = irModule.falseLabelStack.top();
@@ -1830,7 +1807,7 @@ antlrcpp::Any MyVisitor::visitEqEqExp(SysY2022Parser::EqEqExpContext *ctx)
             }
         }
         //无特殊情况
-        auto ins = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), a, b, op));
+        auto ins = newIR<IcmpInstruction>(irModule.getBasicBlock(), a, b, op);
         irModule.getBasicBlock()->pushInstruction(InstructionPtr(ins));
         auto trueLabel = irModule.trueLabelStack.top();
         auto falseLabel = irModule.falseLabelStack.top();
@@ -1855,18 +1832,18 @@ antlrcpp::Any MyVisitor::visitEqLAndExp(SysY2022Parser::EqLAndExpContext *ctx)
     {
         if (val->type->isFloat())
         {
-            auto instruction = shared_ptr<FcmpInstruction>(new FcmpInstruction(irModule.getBasicBlock(), val));
+            auto instruction = newIR<FcmpInstruction>(irModule.getBasicBlock(), val);
             irModule.getBasicBlock()->pushInstruction(instruction);
             val = instruction->reg;
         }
         else
         {
-            auto instruction = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), val));
+            auto instruction = newIR<IcmpInstruction>(irModule.getBasicBlock(), val);
             irModule.getBasicBlock()->pushInstruction(instruction);
             val = instruction->reg;
         }
     }
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr((new BrInstruction(val, trueLabel, falseLabel, irModule.getBasicBlock()))));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(val, trueLabel, falseLabel, irModule.getBasicBlock()));
     if (val->isConst)
         return val;
     else
@@ -1883,16 +1860,16 @@ antlrcpp::Any MyVisitor::visitLAndLAndExp(SysY2022Parser::LAndLAndExpContext *ct
     auto lAnd = ctx->lAndExp()->accept(this);
     irModule.trueLabelStack.pop();
 
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(andLabel)));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(andLabel));
     auto val = std::any_cast<ValuePtr>(ctx->eqExp()->accept(this));
     // auto val = ctx->eqExp()->accept(this).as<ValuePtr>();
     if (!val->type->isBool())
     {
-        auto instruction = shared_ptr<IcmpInstruction>(new IcmpInstruction(irModule.getBasicBlock(), val));
+        auto instruction = newIR<IcmpInstruction>(irModule.getBasicBlock(), val);
         irModule.getBasicBlock()->pushInstruction(instruction);
         val = instruction->reg;
     }
-    irModule.getBasicBlock()->setEndInstruction(InstructionPtr((new BrInstruction(val, trueLabel, falseLabel, irModule.getBasicBlock()))));
+    irModule.getBasicBlock()->setEndInstruction(newIR<BrInstruction>(val, trueLabel, falseLabel, irModule.getBasicBlock()));
 
     if (lAnd.has_value()&& lAnd.type() != typeid(nullptr)&& val->isConst)
     {
@@ -1904,11 +1881,11 @@ antlrcpp::Any MyVisitor::visitLAndLAndExp(SysY2022Parser::LAndLAndExpContext *ct
         irModule.getFunc()->basicBlocks.pop_back();
         if (rst)
         {
-            irModule.getBasicBlock()->endInstruction = InstructionPtr(new BrInstruction(trueLabel, irModule.getBasicBlock()));
+            irModule.getBasicBlock()->endInstruction = newIR<BrInstruction>(trueLabel, irModule.getBasicBlock());
         }
         else
         {
-            irModule.getBasicBlock()->endInstruction = InstructionPtr(new BrInstruction(falseLabel, irModule.getBasicBlock()));
+            irModule.getBasicBlock()->endInstruction = newIR<BrInstruction>(falseLabel, irModule.getBasicBlock());
         }
         // return ValuePtr(new Const(Type::getBool(), rst));
         return Const::getConst(Type::getBool(), rst);
@@ -1930,7 +1907,7 @@ antlrcpp::Any MyVisitor::visitLOrLOrExp(SysY2022Parser::LOrLOrExpContext *ctx)
     irModule.falseLabelStack.emplace(orLabel);
     auto lOr = ctx->lOrExp()->accept(this);
     irModule.falseLabelStack.pop();
-    irModule.getFunc()->pushBasicBlock(BasicBlockPtr(new BasicBlock(orLabel)));
+    irModule.getFunc()->pushBasicBlock(irModule.getFunc()->newBasicBlock(orLabel));
     auto lAnd = ctx->lAndExp()->accept(this);
     if (lAnd.has_value()&& lAnd.type() != typeid(nullptr) && lOr.has_value()&& lOr.type() == typeid(nullptr))
     {
@@ -1955,11 +1932,11 @@ antlrcpp::Any MyVisitor::visitLOrLOrExp(SysY2022Parser::LOrLOrExpContext *ctx)
         irModule.getFunc()->basicBlocks.pop_back();
         if (rst)
         {
-            irModule.getBasicBlock()->endInstruction = InstructionPtr(new BrInstruction(trueLabel, irModule.getBasicBlock()));
+            irModule.getBasicBlock()->endInstruction = newIR<BrInstruction>(trueLabel, irModule.getBasicBlock());
         }
         else
         {
-            irModule.getBasicBlock()->endInstruction = InstructionPtr(new BrInstruction(falseLabel, irModule.getBasicBlock()));
+            irModule.getBasicBlock()->endInstruction = newIR<BrInstruction>(falseLabel, irModule.getBasicBlock());
         }
         // return ValuePtr(new Const(Type::getBool(), rst));
         return Const::getConst(Type::getBool(), rst);
@@ -11,23 +11,27 @@
 #include "reg2mem.h"
 #include "constReplace.h"
 #include "dce.h"
-#include "cse.h"
+#include "gvn.h"
 #include "loopAnalysis.h"
 #include "reassociate.h"
 #include "strengthReduction.h"
 #include "DSE.h"
+#include "callEffects.h"
 #include "LICM.h"
-#include "constPro.h"
+#include "sccp.h"
 #include "LCSSA.h"
 #include "inliner.h"
 #include "loopUnroll.h"
 #include "computeUse.h"
 #include "simplifyCFG.h"
+#include "parallel.h"
 
 class MyVisitor : public SysY2022BaseVisitor
 {
 public:
   Module irModule;
+  // 优化时并行处理函数的线程数，1为串行，输出与线程数无关
+  int optThreads = 1;
 
   void print();
   void opt();
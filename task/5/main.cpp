@@ -9,6 +9,7 @@
 #include "MyVisitor.h"
 #include "arm.h"
 #include "asm_passes.h"
+#include "PassStats.h"
 
 using namespace antlr4;
 
@@ -22,6 +23,72 @@ namespace Py = pybind11;
 #endif
 
 int main(int argc, char ** argv) {
+  // -j N：优化阶段并行处理函数的线程数，默认串行
+  // -time-passes：输出各pass的耗时和前后的指令数、基本块数
+  // -stats：输出各pass的计数（删除的指令数、外提的load数、插入的spill等）
+  // -stats-json FILE：以上内容以JSON写到FILE
+  // -regalloc=linear|graph：寄存器分配算法，linear为线性扫描（编译快），默认graph为图着色
+  // -sched=none|post|all：指令调度，默认none不调度，post只在寄存器分配后调度，all时分配前也调度
+  // -block-placement：按分支概率重排基本块，默认关闭
+  // -block-profile FILE：基本块布局使用的边计数，每行为“函数名 源块标签 目标块标签 次数”，同时打开-block-placement
+  // -emit-obj：直接输出ELF可重定位目标文件（.o）而不是汇编文本，不再需要汇编器
+  // -partial-inline：没有整体内联的调用点复制被调函数开头的提前返回判断，只在判断不成立时调用
+  // -gvn-load=0|1：gvn是否消除重复的load并转发store的值，默认1
+  // -unroll-factor=N：循环次数不是小常量时部分展开的倍数，默认4，小于2时不做部分展开
+  // 其余参数的位置不变
+  int optThreads = 1;
+  const char *statsJson = nullptr;
+  bool emitObj = false;
+  static option longOptions[] = {
+    {"time-passes", no_argument, nullptr, 'T'},
+    {"stats", no_argument, nullptr, 'S'},
+    {"stats-json", required_argument, nullptr, 'J'},
+    {"regalloc", required_argument, nullptr, 'R'},
+    {"sched", required_argument, nullptr, 'D'},
+    {"block-placement", no_argument, nullptr, 'B'},
+    {"block-profile", required_argument, nullptr, 'P'},
+    {"emit-obj", no_argument, nullptr, 'O'},
+    {"partial-inline", no_argument, nullptr, 'I'},
+    {"unroll-factor", required_argument, nullptr, 'U'},
+    {"gvn-load", required_argument, nullptr, 'G'},
+    {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long_only(argc, argv, "j:", longOptions, nullptr)) != -1) {
+    if (c == 'j')
+      optThreads = std::max(1, atoi(optarg));
+    else if (c == 'T')
+      passStats.timePasses = true;
+    else if (c == 'S')
+      passStats.stats = true;
+    else if (c == 'J') {
+      statsJson = optarg;
+      passStats.timePasses = passStats.stats = true;
+    }
+    else if (c == 'R')
+      reg_alloc_mode = std::string(optarg) == "linear" ? REG_ALLOC_LINEAR : REG_ALLOC_GRAPH;
+    else if (c == 'D') {
+      std::string mode = optarg;
+      sched_mode = mode == "none" ? SCHED_NONE : mode == "all" ? SCHED_ALL : SCHED_POST;
+    }
+    else if (c == 'B')
+      enable_block_placement = true;
+    else if (c == 'P') {
+      block_profile_path = optarg;
+      enable_block_placement = true;
+    }
+    else if (c == 'O')
+      emitObj = true;
+    else if (c == 'I')
+      partialInline = true;
+    else if (c == 'U')
+      unrollFactor = atoi(optarg);
+    else if (c == 'G')
+      gvnLoads = atoi(optarg) != 0;
+  }
+  argv += optind - 1;
+  argc -= optind - 1;
+
   std::ifstream sourceFile(argv[1]);
   assert(sourceFile.is_open());
   
@@ -41,6 +108,7 @@ int main(int argc, char ** argv) {
   SysY2022Parser parser(&tokens);
   SysY2022Parser::CompUnitContext* tree = parser.compUnit();
   MyVisitor visitor;
+  visitor.optThreads = optThreads;
   visitor.visitCompUnit(tree);
   visitor.opt();
   visitor.print();
@@ -60,17 +128,27 @@ int main(int argc, char ** argv) {
 #else
   auto program_asm=emit_asm(visitor.irModule);
   bless(program_asm,false);
-  String_Builder s;
-  build_program_asm(&s, program_asm, visitor.irModule.globalVariables);
-  s.add_terminator();
-
-  FILE* assembly_file = fopen(argv[2], "w");
+  FILE* assembly_file = fopen(argv[2], emitObj ? "wb" : "w");
   if (assembly_file == NULL) {
       assert(false && "error opening assembly output file");
   }
 
-  fprintf(assembly_file, "%s", s.c_str());
+  if (emitObj)
+    build_program_object(assembly_file, program_asm, visitor.irModule.globalVariables);
+  else {
+    // 每生成完一个函数就写入文件
+    String_Builder s(assembly_file);
+    build_program_asm(&s, program_asm, visitor.irModule.globalVariables);
+    s.flush();
+  }
   fclose(assembly_file);
 #endif
+
+  if (statsJson) {
+    std::ofstream statsFile(statsJson);
+    passStats.printJSON(statsFile);
+  }
+  else if (passStats.enabled())
+    passStats.print(std::cerr);
   return 0;
 }
@@ -1,71 +1,161 @@
 #include "BasicBlock.h"
 #include "Loop.h"
+#include "Function.h"
 
 
 void BasicBlock::pushInstruction(InstructionPtr instruction)
 {
-    if(!endInstruction) instructions.emplace_back(instruction);
-    instruction->basicblock = this->instructions[0]->basicblock;
+    // 已经设置了结束指令时，后面的指令不可达，不再加入，也不能留下它对操作数的use
+    if(endInstruction) {
+        deleteUser(instruction.get());
+        return;
+    }
+    instructions.push_back(instruction);
+    instruction->basicblock = this;
 }
 
 void BasicBlock::pushInstruction(vector<InstructionPtr> toInsert)
 {
-    auto tmpEnd = instructions.empty() ? nullptr : instructions.back();
-    vector<InstructionPtr> newInstr(instructions);
-    auto bb = instructions[0]->basicblock;
-
-    if(tmpEnd) {
+    // 插在末尾的br/return前
+    auto pos = instructions.end();
+    if(!instructions.empty()) {
+        auto tmpEnd = instructions.back();
         assert(tmpEnd->type == Br || tmpEnd->type == Return);
-        newInstr.pop_back();
-        endInstruction = nullptr;
+        pos = instructions.iteratorTo(tmpEnd.get());
+        endInstruction = tmpEnd;
     }
     for(auto instr: toInsert) {
-        instr->basicblock = bb;
-        newInstr.emplace_back(instr);
-    }
-    if(tmpEnd) {
-        newInstr.emplace_back(tmpEnd);
-        endInstruction = tmpEnd;
+        instr->basicblock = this;
+        instructions.insert(pos, instr);
     }
-    instructions = newInstr;
 }
 
 // 将instruction 插入到next前
 void BasicBlock::insertInstruction(InstructionPtr instruction, InstructionPtr next)
 {
-    auto curInstruction = instructions.begin();
-    while (curInstruction != instructions.end())
-    {
-        if (*curInstruction == next) break;
-        curInstruction++;
-    }
     // make sure next can be found
-    assert(curInstruction != instructions.end());
-    instructions.emplace(curInstruction, instruction);
-    // instruction->basicblock = this->instructions[0]->basicblock;
+    assert(next->ownerList == &instructions);
+    instructions.insert(instructions.iteratorTo(next.get()), instruction);
     instruction->basicblock = next->basicblock;
 }
 
 void BasicBlock::removeInsturction(InstructionPtr instruction)
 {
     assert(instruction != endInstruction);
-    auto curInstruction = instructions.begin();
-    int time = 0;
-    while (curInstruction != instructions.end())
-    {
-        // cerr << time++ << endl;
-        if (*curInstruction == instruction) break;
-        curInstruction++;
-    }
-    // cerr << "[passed] loop" << endl;
-    // make sure next can be found
-    assert(curInstruction != instructions.end());
-    instructions.erase(curInstruction);
+    // make sure instruction can be found
+    assert(instruction->ownerList == &instructions);
+    instructions.remove(instructions.iteratorTo(instruction.get()));
 }
 
 void BasicBlock::setEndInstruction(InstructionPtr instruction)
 {
     if(!endInstruction) endInstruction = instruction;
+    // 已有结束指令时新的跳转不可达，被丢弃，去掉它对操作数的use
+    else if(instruction != endInstruction && !instruction->ownerList) deleteUser(instruction.get());
+}
+
+BasicBlockBitSet BasicBlock::getAllDoms()
+{
+    BasicBlockBitSet doms;
+    if(!hasDomNumber())
+        return doms;
+    // domTree给每个块的DF设置了所属函数的domOrder
+    doms.setUniverse(DF.universe);
+    doms.insert(nonOwning(this));
+    for(auto bb = directDominator; bb; bb = bb->directDominator)
+        doms.insert(bb);
+    return doms;
+}
+
+vector<pair<uint32_t, uint64_t>>::iterator BasicBlockBitSet::findWord(uint32_t w)
+{
+    return lower_bound(words.begin(), words.end(), w, [](const pair<uint32_t, uint64_t>& x, uint32_t w) { return x.first < w; });
+}
+
+vector<pair<uint32_t, uint64_t>>::const_iterator BasicBlockBitSet::findWord(uint32_t w) const
+{
+    return lower_bound(words.begin(), words.end(), w, [](const pair<uint32_t, uint64_t>& x, uint32_t w) { return x.first < w; });
+}
+
+bool BasicBlockBitSet::insert(const shared_ptr<BasicBlock>& bb)
+{
+    assert(universe && bb->hasDomNumber() && bb->domPreIdx < universe->size() && (*universe)[bb->domPreIdx] == bb.get());
+    uint32_t w = bb->domPreIdx / 64;
+    uint64_t mask = 1ull << (bb->domPreIdx % 64);
+    auto it = findWord(w);
+    if(it == words.end() || it->first != w) {
+        words.insert(it, {w, mask});
+        return true;
+    }
+    bool inserted = !(it->second & mask);
+    it->second |= mask;
+    return inserted;
+}
+
+size_t BasicBlockBitSet::erase(const shared_ptr<BasicBlock>& bb)
+{
+    if(!bb->hasDomNumber())
+        return 0;
+    uint32_t w = bb->domPreIdx / 64;
+    uint64_t mask = 1ull << (bb->domPreIdx % 64);
+    auto it = findWord(w);
+    if(it == words.end() || it->first != w || !(it->second & mask))
+        return 0;
+    it->second &= ~mask;
+    if(!it->second)
+        words.erase(it);
+    return 1;
+}
+
+size_t BasicBlockBitSet::count(const shared_ptr<BasicBlock>& bb) const
+{
+    if(!bb->hasDomNumber())
+        return 0;
+    uint32_t w = bb->domPreIdx / 64;
+    auto it = findWord(w);
+    return it != words.end() && it->first == w && (it->second >> (bb->domPreIdx % 64) & 1);
+}
+
+void BasicBlockBitSet::unite(const BasicBlockBitSet& other)
+{
+    assert(!universe || !other.universe || universe == other.universe);
+    if(!universe)
+        universe = other.universe;
+    vector<pair<uint32_t, uint64_t>> merged;
+    merged.reserve(words.size() + other.words.size());
+    auto a = words.cbegin();
+    auto b = other.words.cbegin();
+    while(a != words.end() || b != other.words.end()) {
+        if(b == other.words.end() || (a != words.end() && a->first < b->first))
+            merged.push_back(*a++);
+        else if(a == words.end() || b->first < a->first)
+            merged.push_back(*b++);
+        else
+            merged.push_back({a->first, (a++)->second | (b++)->second});
+    }
+    words.swap(merged);
+}
+
+void BasicBlockBitSet::assign(vector<uint32_t>& idx)
+{
+    assert(universe);
+    sort(idx.begin(), idx.end());
+    words.clear();
+    for(auto i : idx) {
+        assert(i < universe->size());
+        uint32_t w = i / 64;
+        if(words.empty() || words.back().first != w)
+            words.push_back({w, 0});
+        words.back().second |= 1ull << (i % 64);
+    }
+}
+
+size_t BasicBlockBitSet::size() const
+{
+    size_t n = 0;
+    for(auto& w : words)
+        n += __builtin_popcountll(w.second);
+    return n;
 }
 
 void BasicBlock::print()
@@ -4,33 +4,164 @@
 #include <memory>
 #include <functional>
 #include "Instruction.h"
+#include "InstructionList.h"
 #include "Label.h"
+#include "IRArena.h"
 #include <algorithm>
 #include <map>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
 
 using namespace std;
 
 struct Instruction;
 struct Function;
 struct Loop;
+struct BasicBlock;
 
+// 基本块的小集合，前驱/后继/支配树子节点用它存
+// 这些集合通常只有一两个元素：不超过inlineCapacity个时直接存在对象里，不另外分配堆内存，超出后才转到vector
+// 元素是不持有所有权的指针（块都在IRArena中），遍历、拷贝不动引用计数；遍历顺序即插入顺序，输出稳定
+// 边存指针而不存块下标：内联等pass会把块在函数之间搬动，下标需要整体重映射
+struct BasicBlockSet
+{
+    static constexpr int inlineCapacity = 2;
+    typedef shared_ptr<BasicBlock>* iterator;
+    typedef const shared_ptr<BasicBlock>* const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+
+    // 先线性查重，只适合元素少的集合；已知不重复时用push_back
+    pair<iterator, bool> insert(const shared_ptr<BasicBlock>& bb) {
+        auto it = find(bb);
+        if(it != end()) return {it, false};
+        push_back(bb);
+        return {end() - 1, true};
+    }
+    // 调用方保证bb不在集合中，省去查找（支配树的根可能有上万个儿子）
+    void push_back(const shared_ptr<BasicBlock>& bb) {
+        if(!onHeap && num == inlineCapacity) {
+            heapBlocks.assign(inlineBlocks, inlineBlocks + num);
+            for(auto& x : inlineBlocks) x = nullptr;
+            onHeap = true;
+        }
+        if(onHeap) heapBlocks.push_back(nonOwning(bb));
+        else inlineBlocks[num] = nonOwning(bb);
+        num++;
+    }
+    size_t erase(const shared_ptr<BasicBlock>& bb) {
+        auto it = find(bb);
+        if(it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+    // 删除it处的元素，保持其余元素的顺序
+    iterator erase(iterator it) {
+        std::move(it + 1, end(), it);
+        num--;
+        if(onHeap) heapBlocks.pop_back();
+        else inlineBlocks[num] = nullptr;
+        return it;
+    }
+    // 原地把old替换为bb，保持顺序
+    void replace(const shared_ptr<BasicBlock>& old, const shared_ptr<BasicBlock>& bb) {
+        auto it = find(old);
+        assert(it != end() && !count(bb));
+        *it = nonOwning(bb);
+    }
+    iterator find(const shared_ptr<BasicBlock>& bb)             { return std::find(begin(), end(), bb); }
+    const_iterator find(const shared_ptr<BasicBlock>& bb) const { return std::find(begin(), end(), bb); }
+    size_t count(const shared_ptr<BasicBlock>& bb) const        { return find(bb) != end(); }
+    iterator begin()                                            { return onHeap ? heapBlocks.data() : inlineBlocks; }
+    iterator end()                                              { return begin() + num; }
+    const_iterator begin() const                                { return onHeap ? heapBlocks.data() : inlineBlocks; }
+    const_iterator end() const                                  { return begin() + num; }
+    reverse_iterator rbegin()                                   { return reverse_iterator(end()); }
+    reverse_iterator rend()                                     { return reverse_iterator(begin()); }
+    const shared_ptr<BasicBlock>& operator[](size_t i) const    { return begin()[i]; }
+    size_t size() const                                         { return num; }
+    bool empty() const                                          { return num == 0; }
+    void clear() {
+        for(auto& x : inlineBlocks) x = nullptr;
+        heapBlocks.clear();
+        num = 0;
+        onHeap = false;
+    }
+
+private:
+    shared_ptr<BasicBlock> inlineBlocks[inlineCapacity];
+    vector<shared_ptr<BasicBlock>> heapBlocks;
+    uint32_t num = 0;
+    bool onHeap = false;
+};
+
+// 以支配树先序编号domPreIdx为下标的基本块位集，用于支配边界和支配者集合
+// 支配边界一般只覆盖少数几段编号，按64位字稀疏存储非零字，块数很多时不会按块数平方占内存
+// universe是编号到块的映射（所属函数的domOrder），由domTree设置；遍历按编号从小到大
+struct BasicBlockBitSet
+{
+    struct const_iterator
+    {
+        const BasicBlockBitSet* set;
+        size_t word;
+        uint64_t rest;
+
+        shared_ptr<BasicBlock> operator*() const {
+            int bit = __builtin_ctzll(rest);
+            return nonOwning((*set->universe)[set->words[word].first * 64 + bit]);
+        }
+        const_iterator& operator++() {
+            rest &= rest - 1;
+            if(!rest && ++word < set->words.size())
+                rest = set->words[word].second;
+            return *this;
+        }
+        bool operator==(const const_iterator& o) const { return word == o.word && rest == o.rest; }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+    };
+    typedef const_iterator iterator;
+
+    const vector<BasicBlock*>* universe = nullptr;
+
+    void setUniverse(const vector<BasicBlock*>* u)              { universe = u; }
+    bool insert(const shared_ptr<BasicBlock>& bb);
+    size_t erase(const shared_ptr<BasicBlock>& bb);
+    size_t count(const shared_ptr<BasicBlock>& bb) const;
+    // this |= other，两者需有相同的universe
+    void unite(const BasicBlockBitSet& other);
+    // 用universe中的下标整体重建集合，idx会被排序；成员多时比逐个insert快（insert在中间插入新字）
+    void assign(vector<uint32_t>& idx);
+    const_iterator begin() const                                { return {this, 0, words.empty() ? 0 : words[0].second}; }
+    const_iterator end() const                                  { return {this, words.size(), 0}; }
+    size_t size() const;
+    bool empty() const                                          { return words.empty(); }
+    void clear()                                                { words.clear(); }
+
+private:
+    // (字号, 该字的64位)，按字号升序，不存全零的字
+    vector<pair<uint32_t, uint64_t>> words;
+    vector<pair<uint32_t, uint64_t>>::iterator findWord(uint32_t w);
+    vector<pair<uint32_t, uint64_t>>::const_iterator findWord(uint32_t w) const;
+};
 
 struct BasicBlock
 {
     // 每一个basicblock有一个label
     LabelPtr label;
-    // 该 basicblock 的指令
-    vector<shared_ptr<Instruction>> instructions;
+    // 该 basicblock 的指令，侵入式链表，插入删除O(1)
+    InstructionList instructions;
     // 该 basicblock 的endins
     shared_ptr<Instruction> endInstruction= nullptr;
-    // 所属的func
-    shared_ptr<Function> belongfunc;
+    // 所属的func，不持有所有权（函数通过basicBlocks持有块，这里再持有会成环）
+    Function *belongfunc = nullptr;
+    // 在所属函数basicBlocks中的下标，由Function::renumberBasicBlocks维护，用于按下标开数组代替哈希表
+    int idx = -1;
 
-    BasicBlock(LabelPtr label=LabelPtr(new Label())): label{label} ,belongfunc{nullptr}{};
+    BasicBlock(LabelPtr label=LabelPtr(new Label())): label{label} {};
     void setBelongFunc(shared_ptr<Function> func){
-        belongfunc = func;
+        belongfunc = func.get();
     }
-    shared_ptr<Function> getParent() { return belongfunc; }
+    shared_ptr<Function> getParent() { return nonOwning(belongfunc); }
 
     // 在指令集末尾插入指令
     void pushInstruction(shared_ptr<Instruction> instruction);
@@ -39,6 +170,7 @@ struct BasicBlock
     void insertInstruction(shared_ptr<Instruction> instruction, shared_ptr<Instruction> next);
     // 设置endinstruction
     void setEndInstruction(shared_ptr<Instruction> instruction);
+    // 把指令从块中摘下，不删除它的use，用于移动指令
     void removeInsturction(shared_ptr<Instruction> instruction);
 
     //用于后续优化阶段的标记
@@ -53,17 +185,18 @@ struct BasicBlock
     static void domTreeDFSPost(shared_ptr<BasicBlock> bb, function<bool(shared_ptr<BasicBlock>)> cond, function<void(shared_ptr<BasicBlock>)> action);
 
     //前继后继基本块
-    unordered_set<shared_ptr<BasicBlock>> predBasicBlocks;
-    unordered_set<shared_ptr<BasicBlock>> succBasicBlocks;
+    BasicBlockSet predBasicBlocks;
+    BasicBlockSet succBasicBlocks;
     
     //该基本块直接支配的子基本块
-    unordered_set<shared_ptr<BasicBlock>> dominatorSon;
+    BasicBlockSet dominatorSon;
     //支配边界
-    unordered_set<shared_ptr<BasicBlock>> DF;
+    BasicBlockBitSet DF;
     //用来存储直接支配该基本块的基本块
     shared_ptr<BasicBlock> directDominator = nullptr;
-    //能够支配的该基本块所有基本块
-    unordered_set<shared_ptr<BasicBlock>> allDoms;
+    //支配树上的先序/后序编号，由domTree计算，-1表示不可达或CFG变化后新建的块
+    int domPreIdx = -1;
+    int domPostIdx = -1;
 
     // 添加一个前驱基本块
     void addPredBasicBlock(shared_ptr<BasicBlock> bb)       { predBasicBlocks.insert(bb); }
@@ -74,9 +207,9 @@ struct BasicBlock
     // 删除一个后继基本块
     void deleteSuccBasicBlock(shared_ptr<BasicBlock> bb)    { succBasicBlocks.erase(bb); }
     // 获取所有前驱基本块
-    unordered_set<shared_ptr<BasicBlock>> getPredecessor()  { return predBasicBlocks; }
+    const BasicBlockSet& getPredecessor()                   { return predBasicBlocks; }
     // 获取所有后继基本块
-    unordered_set<shared_ptr<BasicBlock>> getSuccessor()    { return succBasicBlocks; }
+    const BasicBlockSet& getSuccessor()                     { return succBasicBlocks; }
     // 获取入度（前驱基本块的数量）
     int getIndegree()                                       { return predBasicBlocks.size(); }
     // 获取出度（后继基本块的数量）
@@ -92,17 +225,23 @@ struct BasicBlock
     // 删除一个支配边界基本块
     void deleteDF(shared_ptr<BasicBlock> bb)                { DF.erase(bb); }
     // 获取所有被该基本块直接支配的子基本块
-    unordered_set<shared_ptr<BasicBlock>> getDominatorSon() { return dominatorSon; }
+    const BasicBlockSet& getDominatorSon()                  { return dominatorSon; }
     // 获取所有支配边界基本块
-    unordered_set<shared_ptr<BasicBlock>> getDF()           { return DF; }
+    const BasicBlockBitSet& getDF()                         { return DF; }
     // 设置直接支配该基本块的基本块
     void setDirectDominator(shared_ptr<BasicBlock> bb)      { directDominator = bb; }
-    // 设置能够支配该基本块的所有基本块
-    void setAllDoms(unordered_set<shared_ptr<BasicBlock>> doms) { allDoms = doms; }
     // 获取直接支配该基本块的基本块
     shared_ptr<BasicBlock> getDirectDominator()             { return directDominator; }
-    // 获取能够支配该基本块的所有基本块
-    unordered_set<shared_ptr<BasicBlock>> getAllDoms()      { return allDoms; }
+    // 获取能够支配该基本块的所有基本块（含自身），沿直接支配链现算，判断支配关系请用dominates
+    BasicBlockBitSet getAllDoms();
+    // 是否已有支配树编号
+    bool hasDomNumber()                                     { return domPreIdx >= 0; }
+    // O(1)判断该基本块是否支配bb（两者都需有支配树编号）
+    bool dominates(shared_ptr<BasicBlock> bb) {
+        if(!hasDomNumber() || !bb->hasDomNumber())
+            return false;
+        return domPreIdx <= bb->domPreIdx && bb->domPostIdx <= domPostIdx;
+    }
 
     void print();
 };
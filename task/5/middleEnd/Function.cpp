@@ -1,31 +1,41 @@
 #include "Function.h"
 
 void Function::setReturnBasicBlock(){
-    returnBasicBlock = BasicBlockPtr(new BasicBlock(LabelPtr(new Label("return"))));
+    returnBasicBlock = newBasicBlock(LabelPtr(new Label("return")));
 }
 
-Function::Function() : regNum(0) {
-    basicBlocks.emplace_back(std::make_shared<BasicBlock>());
+Function::Function(IRArenaPtr arena) : arena{arena}, regNum(0) {
+    basicBlocks.emplace_back(newBasicBlock());
 }
 
-Function::Function(TypePtr returnType, string name, vector<ValuePtr> formArguments) : retVal{ValuePtr(new Reg(returnType, "retval"))}, name{name}, formArguments{formArguments}, isLib{false}, isReenterable{true}
+Function::Function(IRArenaPtr arena, TypePtr returnType, string name, vector<ValuePtr> formArguments) : retVal{arena->make<Reg>(returnType, "retval")}, name{name}, formArguments{formArguments}, isLib{false}, isReenterable{true}, arena{arena}
 {
-    basicBlocks.emplace_back(std::make_shared<BasicBlock>());
+    basicBlocks.emplace_back(newBasicBlock());
     regNum = 0;
 };
 
+BasicBlockPtr Function::newBasicBlock(LabelPtr label)
+{
+    return arena->make<BasicBlock>(label);
+}
+
+BasicBlockPtr Function::newBasicBlock()
+{
+    return arena->make<BasicBlock>();
+}
+
 void Function::solveReturnBasicBlock()
 {
     if (retVal->type->isVoid())
     {
-        returnBasicBlock->setEndInstruction(InstructionPtr(new ReturnInstruction(retVal, returnBasicBlock)));
+        returnBasicBlock->setEndInstruction(newIR<ReturnInstruction>(retVal, returnBasicBlock));
         pushBasicBlock(returnBasicBlock);
     }
     else
     {
-        auto ins = shared_ptr<LoadInstruction>(new LoadInstruction(retVal, getReg(retVal->type), returnBasicBlock));
+        auto ins = newIR<LoadInstruction>(retVal, getReg(retVal->type), returnBasicBlock);
         returnBasicBlock->pushInstruction(ins);
-        returnBasicBlock->setEndInstruction(InstructionPtr(new ReturnInstruction(ins->to, returnBasicBlock)));
+        returnBasicBlock->setEndInstruction(newIR<ReturnInstruction>(ins->to, returnBasicBlock));
         pushBasicBlock(returnBasicBlock);
     }
 }
@@ -66,7 +76,7 @@ void Function::print()
 
 void Function::setBBbelongFunc(shared_ptr<Function> func){
     for(auto bb:basicBlocks){
-        bb->belongfunc = func;
+        bb->setBelongFunc(func);
     }
 }
 
@@ -92,38 +102,48 @@ VariablePtr Function::findVariable(string name)
 
 void Function::allocLocalVariable()
 {
-    auto tmp = basicBlocks[0]->instructions;
-    basicBlocks[0]->instructions.clear();
-    for (auto &var : variables) basicBlocks[0]->instructions.emplace_back(InstructionPtr(new AllocaInstruction(var.second, basicBlocks[0])));
-    for(auto &ins: tmp) basicBlocks[0]->instructions.emplace_back(ins);
+    auto& entry = basicBlocks[0]->instructions;
+    auto first = entry.begin();
+    for (auto &var : variables) entry.insert(first, newIR<AllocaInstruction>(var.second, basicBlocks[0]));
 }
 
 void Function::solveEndInstruction()
 {
     for (auto &basicBlock : basicBlocks)
     {
-        vector<shared_ptr<Instruction>> newIns;
-        int i  =0;
-        for(;i<basicBlock->instructions.size();i++){
-            // cerr<<i<<"  "<<basicBlock->instructions[i]->type<<endl;
-            newIns.push_back(basicBlock->instructions[i]);
-            if(basicBlock->instructions[i]->type==Store&&dynamic_cast<StoreInstruction*>(basicBlock->instructions[i].get())->des->name=="retval"){
+        // 删掉对retval的store之后的指令
+        auto it = basicBlock->instructions.begin();
+        for(;it!=basicBlock->instructions.end();it++){
+            if((*it)->type==Store&&dynamic_cast<StoreInstruction*>(it->get())->des->name=="retval"){
+                it++;
                 break;
             }
-            
         }
-        basicBlock->instructions = newIns;
+        basicBlock->instructions.erase(it, basicBlock->instructions.end());
 
         assert(basicBlock->endInstruction);
-        basicBlock->instructions.emplace_back(basicBlock->endInstruction);
+        basicBlock->instructions.push_back(basicBlock->endInstruction);
     }
 }
 
 void Function::pushBasicBlock(shared_ptr<BasicBlock> basicblock)
 {
+    basicblock->idx = basicBlocks.size();
     basicBlocks.emplace_back(basicblock);
 }
 
+void Function::renumberBasicBlocks()
+{
+    for(int i=0;i<basicBlocks.size();i++){
+        basicBlocks[i]->idx = i;
+    }
+}
+
+bool Function::isNumbered(const shared_ptr<BasicBlock>& bb)
+{
+    return bb->idx >= 0 && bb->idx < basicBlocks.size() && basicBlocks[bb->idx] == bb;
+}
+
 
 void Function::clearBBToLoop() {
     bbToLoop.clear();
@@ -135,6 +155,7 @@ void Function::clearBBToLoop() {
 
 void Function::clearLoops() {
     loops.clear();
+    topLoops.clear();
 }
 
 BasicBlockPtr Function::getEntryBlock() {
@@ -6,6 +6,7 @@
 #include "StringTable.h"
 #include "Label.h"
 #include "Loop.h"
+#include "IRArena.h"
 
 struct Loop;
 struct BasicBlock;
@@ -34,9 +35,12 @@ struct Function:public std::enable_shared_from_this<Function>
     // 记录调用该函数的ins
     unordered_set<shared_ptr<Instruction>> callerIns;
 
-    Function();
-    Function(TypePtr returnType, string name, vector<ValuePtr> formArguments);
-    Function(TypePtr returnType, string name, bool isReenterable, vector<ValuePtr> formArguments=vector<ValuePtr>()) : retVal{ValuePtr(new Reg(returnType, "retval"))}, name{name}, formArguments{formArguments}, isLib{true} , isReenterable{isReenterable} {};
+    // 基本块分配在所属Module的arena中，函数持有arena保证块的生命周期不短于函数
+    IRArenaPtr arena;
+
+    Function(IRArenaPtr arena);
+    Function(IRArenaPtr arena, TypePtr returnType, string name, vector<ValuePtr> formArguments);
+    Function(TypePtr returnType, string name, bool isReenterable, vector<ValuePtr> formArguments=vector<ValuePtr>()) : retVal{newIR<Reg>(returnType, "retval")}, name{name}, formArguments{formArguments}, isLib{true} , isReenterable{isReenterable} {};
     // 设置returnBasicBlock
     void setReturnBasicBlock();
     void solveReturnBasicBlock();
@@ -46,7 +50,7 @@ struct Function:public std::enable_shared_from_this<Function>
 
     // from Blcok
     int regNum;
-    ValuePtr getReg(TypePtr type){return ValuePtr(new Reg(type, regNum++));}
+    ValuePtr getReg(TypePtr type){return newIR<Reg>(type, regNum++);}
     // 用于装载基本块
     vector<shared_ptr<BasicBlock>> basicBlocks;
     // 每一个variables有一个名字，通过map将其联系起来
@@ -54,6 +58,12 @@ struct Function:public std::enable_shared_from_this<Function>
     // 每一个basicblock有一个label，通过map将其联系起来
     unordered_map<LabelPtr, shared_ptr<BasicBlock>> LabelBBMap;
     void getLabelBBMap();
+    // 按basicBlocks中的顺序给基本块重新编号，增删基本块后需要调用
+    void renumberBasicBlocks();
+    // bb是否属于该函数且编号有效
+    bool isNumbered(const shared_ptr<BasicBlock>& bb);
+    // 支配树先序编号到基本块的映射，由domTree计算，是各块DF位集的universe
+    vector<BasicBlock*> domOrder;
 
     // loops
     vector<shared_ptr<Loop>> loops;
@@ -71,6 +81,9 @@ struct Function:public std::enable_shared_from_this<Function>
 
     // 设置Block所属的函数
     void setBBbelongFunc(shared_ptr<Function> func);
+    // 在arena中新建一个基本块（不加入basicBlocks）
+    shared_ptr<BasicBlock> newBasicBlock(LabelPtr label);
+    shared_ptr<BasicBlock> newBasicBlock();
     // 添加一个basicblock
     void pushBasicBlock(shared_ptr<BasicBlock> basicblock);
     void pushVariable(VariablePtr variable);
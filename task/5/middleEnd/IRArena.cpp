@@ -0,0 +1,52 @@
+#include "IRArena.h"
+#include <cstdint>
+#include <cstdlib>
+
+static thread_local IRArena* currentArena = nullptr;
+
+IRArena* IRArena::current()
+{
+    return currentArena;
+}
+
+IRArena::Scope::Scope(IRArena* arena) : saved{currentArena}
+{
+    currentArena = arena;
+}
+
+IRArena::Scope::~Scope()
+{
+    currentArena = saved;
+}
+
+void* IRArena::allocate(size_t size, size_t align)
+{
+    uintptr_t p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~(uintptr_t)(align - 1);
+    if(!cur || p + size > reinterpret_cast<uintptr_t>(end)) {
+        // 超大对象单独开一块，不影响当前chunk剩余空间的使用
+        size_t bytes = size + align > chunkSize ? size + align : chunkSize;
+        char* chunk = static_cast<char*>(std::malloc(bytes));
+        if(!chunk) throw std::bad_alloc();
+        chunks.push_back(chunk);
+        p = (reinterpret_cast<uintptr_t>(chunk) + align - 1) & ~(uintptr_t)(align - 1);
+        if(bytes == chunkSize) {
+            cur = chunk;
+            end = chunk + bytes;
+        } else {
+            allocated += size;
+            return reinterpret_cast<void*>(p);
+        }
+    }
+    cur = reinterpret_cast<char*>(p + size);
+    allocated += size;
+    return reinterpret_cast<void*>(p);
+}
+
+IRArena::~IRArena()
+{
+    // 按分配的逆序析构，后建的对象可能引用先建的对象
+    for(auto it = dtors.rbegin(); it != dtors.rend(); it++)
+        it->destroy(it->obj);
+    for(auto chunk : chunks)
+        std::free(chunk);
+}
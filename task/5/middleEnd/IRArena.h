@@ -0,0 +1,103 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+#include <cassert>
+
+using std::shared_ptr;
+using std::vector;
+
+// 生成一个不持有所有权的shared_ptr（没有控制块），拷贝时不会动引用计数
+// 用于指向由IRArena管理的对象，以及基本块->函数、指令->基本块这类反向指针，避免shared_ptr成环
+template<typename T>
+shared_ptr<T> nonOwning(T* ptr)
+{
+    return shared_ptr<T>(shared_ptr<T>(), ptr);
+}
+
+template<typename T>
+shared_ptr<T> nonOwning(const shared_ptr<T>& ptr)
+{
+    return nonOwning(ptr.get());
+}
+
+// 按Module划分的IR内存池
+// 基本块、指令和寄存器、变量等Value都按块（chunk）连续分配，生命周期与整个Module相同，
+// Module析构时统一析构并一次性释放，删除指令只是把它从块中摘下并去掉它对操作数的use
+// make返回的是不持有所有权的shared_ptr，原有以shared_ptr为接口的代码可以不改，拷贝时也不动引用计数；make可以在多个线程中调用
+// 这些指针不能比arena活得久：Module和它的每个Function都持有arena，只在IR存在期间使用
+// 析构按分配的逆序进行，IR对象的析构函数只能释放自己的成员，不能再访问其他IR对象
+// 常量和Type是全局驻留的单例，在所有Module间共享，不在arena中
+struct IRArena
+{
+    IRArena() = default;
+    IRArena(const IRArena&) = delete;
+    IRArena& operator=(const IRArena&) = delete;
+    ~IRArena();
+
+    template<typename T, typename... Args>
+    shared_ptr<T> make(Args&&... args)
+    {
+        void* mem;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            mem = allocate(sizeof(T), alignof(T));
+        }
+        T* obj = new (mem) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            dtors.push_back({obj, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return nonOwning(obj);
+    }
+
+    // 当前线程新建指令和Value时使用的arena，见newIR
+    static IRArena* current();
+    // 在当前线程中切换到arena，析构时切回原来的arena；Module构造时切到自己的arena，并行优化的工作线程切到函数的arena
+    struct Scope
+    {
+        Scope(IRArena* arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        IRArena* saved;
+    };
+
+    // 已分配的字节数与chunk数量，用于统计
+    size_t bytesAllocated() const { return allocated; }
+    size_t numChunks() const { return chunks.size(); }
+
+private:
+    static constexpr size_t chunkSize = 64 * 1024;
+
+    struct Dtor
+    {
+        void* obj;
+        void (*destroy)(void*);
+    };
+
+    void* allocate(size_t size, size_t align);
+
+    vector<char*> chunks;
+    char* cur = nullptr;
+    char* end = nullptr;
+    size_t allocated = 0;
+    vector<Dtor> dtors;
+    // 并行优化时多个函数会同时新建基本块和指令
+    std::mutex mutex;
+};
+typedef shared_ptr<IRArena> IRArenaPtr;
+
+// 在当前线程的arena中新建指令或Value，代替shared_ptr<T>(new T(...))
+// Instruction、Reg和Variable删除了普通的operator new，只能这样创建
+template<typename T, typename... Args>
+shared_ptr<T> newIR(Args&&... args)
+{
+    IRArena* arena = IRArena::current();
+    assert(arena && "no IRArena in this thread");
+    return arena->make<T>(std::forward<Args>(args)...);
+}
@@ -1,22 +1,66 @@
 #include "Instruction.h"
 
-int CallInstruction::callRegNum = 0;
-int BinaryInstruction::BinaryRegNum = 0;
-int FnegInstruction::FnegRegNum = 0;
-int GetElementPtrInstruction::arrayIdxNum = 0;
-int GetElementPtrInstruction::arrayElementNum = 0;
-int IcmpInstruction::cmpRegNum = 0;
-int PhiInstruction::phiRegNum = 0;
-int BrInstruction::ifThenNum = 0;
-int BrInstruction::ifElseNum = 0;
-int BrInstruction::ifEndNum = 0;
-int BrInstruction::orNum = 0;
-int BrInstruction::andNum = 0;
-int BrInstruction::whileCondNum = 0;
-int BrInstruction::whileBodyNum = 0;
-int BrInstruction::whileEndNum = 0;
-int ExtInstruction::extNum = 0;
-int SitofpInstruction::convNum = 0;
+NameCounter CallInstruction::callRegNum;
+NameCounter BinaryInstruction::BinaryRegNum;
+NameCounter FnegInstruction::FnegRegNum;
+NameCounter GetElementPtrInstruction::arrayIdxNum;
+NameCounter GetElementPtrInstruction::arrayElementNum;
+NameCounter IcmpInstruction::cmpRegNum;
+NameCounter PhiInstruction::phiRegNum;
+NameCounter BrInstruction::ifThenNum;
+NameCounter BrInstruction::ifElseNum;
+NameCounter BrInstruction::ifEndNum;
+NameCounter BrInstruction::orNum;
+NameCounter BrInstruction::andNum;
+NameCounter BrInstruction::whileCondNum;
+NameCounter BrInstruction::whileBodyNum;
+NameCounter BrInstruction::whileEndNum;
+NameCounter ExtInstruction::extNum;
+NameCounter SitofpInstruction::convNum;
+
+// 全局计数，用局部静态变量保证在各个计数器构造之前初始化
+static vector<int>& globalNameCounters()
+{
+    static vector<int> counters;
+    return counters;
+}
+
+// 当前线程使用的计数，为空时使用全局计数
+static thread_local vector<int>* activeNameCounters = nullptr;
+
+NameCounter::NameCounter() : id{(int)globalNameCounters().size()}
+{
+    globalNameCounters().push_back(0);
+}
+
+int NameCounter::operator++(int)
+{
+    auto& counters = activeNameCounters ? *activeNameCounters : globalNameCounters();
+    return counters[id]++;
+}
+
+NameCounter::Scope::Scope(vector<int>& counters) : saved{activeNameCounters}
+{
+    assert(counters.size() == globalNameCounters().size());
+    activeNameCounters = &counters;
+}
+
+NameCounter::Scope::~Scope()
+{
+    activeNameCounters = saved;
+}
+
+vector<int> NameCounter::snapshot()
+{
+    return globalNameCounters();
+}
+
+void NameCounter::merge(const vector<int>& counters)
+{
+    auto& global = globalNameCounters();
+    for (size_t i = 0; i < global.size(); i++)
+        global[i] = max(global[i], counters[i]);
+}
 // maybe wrong
 map<string, IcmpKind> IcmpInstruction::kindMap{{"==", ICmpEQ}, {"!=", ICmpNE}, {"<", ICmpSLT},
                              {"<=", ICmpSLE}, {">", ICmpSGT}, {">=", ICmpSGE}};
@@ -48,41 +92,31 @@ string Instruction::getName()
 
 void Instruction::replaceAllUsesWith(ValuePtr V)
 {
-    assert(false && "replaceAllUseWith donnot finish");
+    assert(reg && "cannot replaceAllUsesWith without reg");
+    replaceUses(reg, V);
 }
 void Instruction::replaceAllUsesWith(shared_ptr<Instruction> I)
 {
     replaceAllUsesWith(I->reg);
 }
 
-// to-do   O(n)得想想办法优化，可以建立一个哈希表映射
-vector<shared_ptr<Instruction>>::iterator Instruction::getIterator()
+InstructionList::iterator Instruction::getIterator()
 {
-    for (auto it = basicblock->instructions.begin(); it != basicblock->instructions.end(); it++)
-    {
-        if ((*it).get() == this)
-        {
-            return it;
-        }
-    }
-    assert(false && "getIterator error 你迭代器呢");
-    return vector<shared_ptr<Instruction>>().end();
+    assert(ownerList && "getIterator error 你迭代器呢");
+    return ownerList->iteratorTo(this);
 }
 
 void Instruction::deleteSelfInBB()
 {
-    for (auto it = basicblock->instructions.begin(); it != basicblock->instructions.end(); it++)
-    {
-        if ((*it).get() == this)
-        {
-            basicblock->instructions.erase(it);
-            break;
-        }
-    }
+    // erase会去掉指令对操作数的use；不在块中的指令直接去掉use
+    if(ownerList)
+        ownerList->erase(ownerList->iteratorTo(this));
+    else
+        deleteUser(this);
 }
 
 // I为insertbefore //insert不了，还是在外面insert吧
-BinaryInstruction::BinaryInstruction(ValuePtr a, ValuePtr b, char op, Instruction *I) : Instruction{InsID::Binary, I->basicblock, getBinaryReg(a->type)}, a{a}, b{b}, op{op}
+BinaryInstruction::BinaryInstruction(ValuePtr a, ValuePtr b, char op, Instruction *I) : Instruction{InsID::Binary, nonOwning(I->basicblock), getBinaryReg(a->type)}, a{a}, b{b}, op{op}
 {
     // cerr<<"create Binary\n";
     // cerr<<b->name<<endl;
@@ -579,6 +613,7 @@ void deleteUser(ValuePtr user)
     int numOperands = I->getNumOperands();
     for(int i = 0; i < numOperands; i ++) {
         auto operand = I->getOperand(i);
+        SharedUseLock lock(operand.get());
         Use *use = operand->useHead;
         while(use != nullptr) {
             if(use->user == I) {
@@ -598,6 +633,7 @@ void deleteUser(InstructionPtr user) {
     int numOperands = I->getNumOperands();
     for(int i = 0; i < numOperands; i ++) {
         auto operand = I->getOperand(i);
+        SharedUseLock lock(operand.get());
         Use *use = operand->useHead;
         while(use != nullptr) {
             if(use->user == I) {
@@ -618,6 +654,7 @@ void deleteUser(Instruction* user) {
     for (int i = 0; i < numOperands; i++)
     {
         auto operand = I->getOperand(i);
+        SharedUseLock lock(operand.get());
         Use *use = operand->useHead;
         while (use != nullptr)
         {
@@ -631,59 +668,51 @@ void deleteUser(Instruction* user) {
 }
 
 
-void replaceVarByVar(ValuePtr from, ValuePtr to)
+// 判断user的操作数里是否有value
+static bool isOperandOf(Instruction *user, ValuePtr value)
+{
+    for (unsigned i = 0; i < user->getNumOperands(); i++)
+        if (user->getOperand(i) == value)
+            return true;
+    return false;
+}
+
+void replaceUses(ValuePtr from, ValuePtr to)
 {
-    // from已经不会再使用，所以没必要维护from的Use
-    // cerr<<"enter replaceVarByVar\n";
+    // 逐个把from的use节点挂到to上，userVal不变，def-use链保持准确，不需要再重建
     Use *p = from->useHead;
-    // bool is_needed = false;
-    // if(from->name == "func.binary456.copy0") {
-    //     is_needed = true;
-    //     printf("replace %s <- %s\n", from->name.c_str(), to->name.c_str());
-    // }
-    
     while (p != nullptr)
-    {   
-        // cerr<<"replaceVarByVar1\n";
+    {
         auto user = p->user;
-        // cerr<<"replaceVarByVar2\n";
-        int numOperand = user->getNumOperands();
-        // cerr<<"replaceVarByVar3\n";
-        // if(is_needed) {
-        //     printf("user: ");
-        //     user->print();
-        // }
-        if (!user->replaceValue(from, to))
+        auto next = p->next;
+        // 同一条指令多次使用from时会有多个use节点，phi、call等的replaceValue第一次就全部替换了
+        if (!user->replaceValue(from, to) && !isOperandOf(user, to))
         {
-            std::cerr << user->reg->name << " error " << user->type << "\n";
+            std::cerr << (user->reg ? user->reg->name : "") << " error " << user->type << "\n";
             // assert(false && "error when replaceVarByVar");
         }
-        auto tmp = p->next;
-        p->rmUse();
-        newUse(to.get(), user);
-        p = tmp;
+        p->set(to.get());
+        p = next;
     }
+}
+
+void replaceVarByVar(ValuePtr from, ValuePtr to)
+{
+    // from已经不会再使用，顺便摘掉定义from的指令对其操作数的use
+    replaceUses(from, to);
     deleteUser(from);
-    // cerr<<"after replaceVarByVar\n";
 }
 
 void replaceVarByVarForLCSSA(ValuePtr from, ValuePtr to, Use *use)
 {
-    // from已经不会再使用，所以没必要维护from的Use
-    int cnt = 0;
-    Instruction *la = nullptr;
-    unordered_map<Instruction *, bool> mp;
-
+    // 只替换循环外的这一处使用，from本身仍然有效，不能摘掉其定义指令的use
     auto user = use->user;
-    int numOperand = user->getNumOperands();
-    if (!user->replaceValue(from, to))
+    if (!user->replaceValue(from, to) && !isOperandOf(user, to))
     {
-        cerr << user->reg->name << " error " << user->type << "\n";
+        cerr << (user->reg ? user->reg->name : "") << " error " << user->type << "\n";
         // assert(false && "error when replaceVarByVar");
     }
-    use->rmUse();
-    newUse(to.get(), user);
-    deleteUser(from);
+    use->set(to.get());
 }
 
 unsigned ReturnInstruction::getNumOperands()
@@ -890,7 +919,18 @@ void PhiInstruction::removeIncomingByBB(shared_ptr<BasicBlock> bb)
     if(indexToRemove >= 0)
     {
         auto use1 = from.at(indexToRemove).first;
-        deleteUser(use1);
+        // 同一个值可能从多个前驱流入，只摘掉这一项对应的use
+        SharedUseLock lock(use1.get());
+        Use *use = use1->useHead;
+        while (use != nullptr)
+        {
+            if (use->user == this)
+            {
+                use->rmUse();
+                break;
+            }
+            use = use->next;
+        }
         from.erase(from.begin()+indexToRemove);
 
         // for(auto i = 0; i < operands.size(); i++)
@@ -898,55 +938,3 @@ void PhiInstruction::removeIncomingByBB(shared_ptr<BasicBlock> bb)
     }
 
 }
-
-ReturnInstruction::~ReturnInstruction(){
-    deleteUser(this);
-}
-AllocaInstruction::~AllocaInstruction(){
-    deleteUser(this);
-}
-GetElementPtrInstruction::~GetElementPtrInstruction(){
-    deleteUser(this);
-}
-StoreInstruction::~StoreInstruction(){
-    deleteUser(this);
-}
-LoadInstruction::~LoadInstruction(){
-    deleteUser(this);
-}
-BitCastInstruction::~BitCastInstruction(){
-    deleteUser(this);
-}
-ExtInstruction::~ExtInstruction(){
-    deleteUser(this);
-}
-SitofpInstruction::~SitofpInstruction(){
-    deleteUser(this);
-}
-FptosiInstruction::~FptosiInstruction(){
-    deleteUser(this);
-}
-
-CallInstruction::~CallInstruction(){
-    deleteUser(this);
-}
-BinaryInstruction::~BinaryInstruction(){
-    deleteUser(this);
-}
-FnegInstruction::~FnegInstruction(){
-    deleteUser(this);
-}
-
-IcmpInstruction::~IcmpInstruction(){
-    deleteUser(this);
-}
-FcmpInstruction::~FcmpInstruction(){
-    deleteUser(this);
-}
-
-BrInstruction::~BrInstruction(){
-    deleteUser(this);
-}
-PhiInstruction::~PhiInstruction(){
-    deleteUser(this);
-}
\ No newline at end of file
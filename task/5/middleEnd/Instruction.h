@@ -5,6 +5,7 @@
 #include "Function.h"
 #include "Label.h"
 #include "utils.h"
+#include "InstructionList.h"
 #include <stdlib.h>
 #include <map>
 #include <iostream>
@@ -12,8 +13,30 @@
 struct Function;
 struct BasicBlock;
 struct Instruction;
-using std::enable_shared_from_this;
 
+// 指令寄存器和基本块标号的命名计数器
+// 默认使用全局计数；并行优化时每个函数使用自己的一份计数（NameCounter::Scope），
+// 名字只需在函数内唯一，这样生成的名字与线程数和调度顺序无关
+struct NameCounter
+{
+    NameCounter();
+    int operator++(int);
+
+    // 在当前线程中把所有计数器切换到counters，析构时切回原来的计数
+    struct Scope
+    {
+        Scope(vector<int>& counters);
+        ~Scope();
+        vector<int>* saved;
+    };
+    // 全局计数的快照，作为各函数计数的起点
+    static vector<int> snapshot();
+    // 并行结束后把各函数用到的计数合并回全局，保证之后新建的名字不重复
+    static void merge(const vector<int>& counters);
+
+private:
+    int id;
+};
 
 // 所有指令类型
 enum InsID
@@ -37,16 +60,24 @@ enum InsID
 };
 
 
-struct Instruction: public enable_shared_from_this<Instruction> {
+struct Instruction {
     // 指令类型
     InsID type;
-    // 所属的basicblock
-    shared_ptr<BasicBlock> basicblock;
+    // 所属的basicblock，基本块分配在Module的arena中，这里只是反向指针；不在任何块中时为nullptr
+    BasicBlock *basicblock = nullptr;
     // 指令的返回值
     ValuePtr reg;
-
-    Instruction(InsID type, shared_ptr<BasicBlock> bb, ValuePtr reg = nullptr): type{type}, basicblock{bb}, reg{reg} {}
+    // 所在指令链表中的前后指令，由InstructionList维护；指令都在arena中，nextInBB不持有所有权
+    Instruction *prevInBB = nullptr;
+    shared_ptr<Instruction> nextInBB;
+    // 所在的指令链表，不在任何基本块中时为nullptr
+    InstructionList *ownerList = nullptr;
+
+    Instruction(InsID type, shared_ptr<BasicBlock> bb, ValuePtr reg = nullptr): type{type}, basicblock{bb.get()}, reg{reg} {}
+    // 指令分配在Module的arena中，用newIR创建；Module析构时才析构，析构时不再碰操作数的use链
     virtual ~Instruction(){}
+    static void* operator new(size_t) = delete;
+    static void* operator new(size_t, void* mem) { return mem; }
     virtual void print() {}
 
     virtual bool replaceValue(ValuePtr target, ValuePtr newValue) { return false; }
@@ -65,12 +96,12 @@ struct Instruction: public enable_shared_from_this<Instruction> {
     // 将This指令移动到I指令之前
     void moveBefore(shared_ptr<Instruction> I, shared_ptr<Instruction> This);
 
-    // 将当前指令的返回值替换为V或I的返回值
+    // 将当前指令返回值的所有使用替换为V或I的返回值
     void replaceAllUsesWith(ValuePtr V);
     void replaceAllUsesWith(shared_ptr<Instruction> I);
     
-    //获得在basicblock的instructions列表中的迭代器
-    vector<shared_ptr<Instruction>>::iterator getIterator();
+    //获得在所在指令链表中的迭代器
+    InstructionList::iterator getIterator();
 
     // 修改指令返回值的名字
     void setName(string newName);
@@ -78,8 +109,8 @@ struct Instruction: public enable_shared_from_this<Instruction> {
     string getName();
     // 从basicBlock中删除指令
     void deleteSelfInBB();
-    // 返回这个指令的shared_ptr
-    shared_ptr<Instruction> getSharedThis() { return shared_from_this(); }
+    // 返回这个指令的shared_ptr（不持有所有权）
+    shared_ptr<Instruction> getSharedThis() { return nonOwning(this); }
 };
 typedef shared_ptr<Instruction> InstructionPtr;
 
@@ -90,7 +121,6 @@ struct ReturnInstruction:public Instruction {
     ReturnInstruction(ValuePtr retValue, shared_ptr<BasicBlock> bb) : Instruction{InsID::Return, bb}, retValue{retValue} {
         newUse(retValue.get(), this);
     }; 
-    ~ReturnInstruction();
     
     // 所有的print函数都是用于输出llvmir
     virtual void print() override;
@@ -107,7 +137,6 @@ struct AllocaInstruction:public Instruction {
     AllocaInstruction(ValuePtr des, shared_ptr<BasicBlock> bb) : Instruction{InsID::Alloca, bb}, des{des} {
         des->I = this;
     };
-    ~AllocaInstruction();
 
     virtual void print() override;
     virtual bool replaceValue(ValuePtr target, ValuePtr newValue) override;
@@ -118,13 +147,12 @@ struct AllocaInstruction:public Instruction {
 // gep指令
 struct GetElementPtrInstruction:public Instruction {
     // 
-    static int arrayIdxNum;
-    static int arrayElementNum;
-    static ValuePtr getArrayIdxReg(TypePtr type) { return ValuePtr(new Reg(type, "arrayidx" + to_string(arrayIdxNum++))); }
-    static ValuePtr getArrayElementReg(TypePtr type) { return ValuePtr(new Reg(type, "arrayinit.element" + to_string(arrayElementNum++))); }
+    static NameCounter arrayIdxNum;
+    static NameCounter arrayElementNum;
+    static ValuePtr getArrayIdxReg(TypePtr type) { return newIR<Reg>(type, "arrayidx" + to_string(arrayIdxNum++)); }
+    static ValuePtr getArrayElementReg(TypePtr type) { return newIR<Reg>(type, "arrayinit.element" + to_string(arrayElementNum++)); }
     ValuePtr from;
     vector<ValuePtr> index;
-    ~GetElementPtrInstruction();
     GetElementPtrInstruction(ValuePtr from, vector<ValuePtr> index, shared_ptr<BasicBlock> bb) : Instruction{InsID::GEP, bb}, from{from}, index{index}
     {
         if (index.size() == 1)
@@ -164,7 +192,6 @@ struct StoreInstruction:public Instruction {
     shared_ptr<GetElementPtrInstruction> gep;
     // 存储的值
     ValuePtr value;
-    ~StoreInstruction();
     StoreInstruction(shared_ptr<GetElementPtrInstruction> gep, ValuePtr value, shared_ptr<BasicBlock> bb) : Instruction{InsID::Store, bb}, gep{gep}, des{gep->reg}, value{value} {
         newUse(gep->reg.get(), this);
         newUse(value.get(), this);
@@ -193,7 +220,6 @@ struct LoadInstruction:public Instruction {
         to->I = this;
         reg = to;
     };
-    ~LoadInstruction();
     LoadInstruction(shared_ptr<GetElementPtrInstruction> gep, ValuePtr to, shared_ptr<BasicBlock> bb) : Instruction{InsID::Load, bb}, gep{gep}, from{gep->reg}, to{to} {
         newUse(gep->reg.get(), this, to.get());
         to->I = this;
@@ -210,8 +236,7 @@ struct BitCastInstruction:public Instruction {
     ValuePtr from;
     // 目标转换类型
     TypePtr toType;
-    ~BitCastInstruction();
-    BitCastInstruction(ValuePtr from, ValuePtr reg, shared_ptr<BasicBlock> bb, TypePtr toType = TypePtr(new PtrType(Type::getInt8()))) : Instruction{InsID::Bitcast, bb, reg}, from{from}, toType{toType} {
+    BitCastInstruction(ValuePtr from, ValuePtr reg, shared_ptr<BasicBlock> bb, TypePtr toType = PtrType::get(Type::getInt8())) : Instruction{InsID::Bitcast, bb, reg}, from{from}, toType{toType} {
         newUse(from.get(), this, reg.get());
         //reg即这条指令本身
         reg->I = this;
@@ -225,9 +250,8 @@ struct BitCastInstruction:public Instruction {
 // 对应zext(零扩展)和sext(符号扩展)指令
 struct ExtInstruction:public Instruction {
     // 保证命名不重复
-    static int extNum;
-    static ValuePtr getExtReg(TypePtr type) { return ValuePtr(new Reg(type, "ext" + to_string(extNum++))); }
-    ~ExtInstruction();
+    static NameCounter extNum;
+    static ValuePtr getExtReg(TypePtr type) { return newIR<Reg>(type, "ext" + to_string(extNum++)); }
     // 待扩展的源操作数
     ValuePtr from;
     // 目标类型
@@ -248,11 +272,10 @@ struct ExtInstruction:public Instruction {
 // 用于将有符号整数转换为浮点数
 struct SitofpInstruction:public Instruction {
     // 保证命名不重复
-    static int convNum;
-    static ValuePtr getConvReg(TypePtr type) { return ValuePtr(new Reg(type, "conv" + to_string(convNum++))); }
+    static NameCounter convNum;
+    static ValuePtr getConvReg(TypePtr type) { return newIR<Reg>(type, "conv" + to_string(convNum++)); }
     // 待转换的源操作数
     ValuePtr from;
-    ~SitofpInstruction();
     SitofpInstruction(ValuePtr from, shared_ptr<BasicBlock> bb) : Instruction{InsID::Sitofp, bb, getConvReg(Type::getFloat())}, from{from} {
         newUse(from.get(), this, reg.get());
         //reg即这条指令本身
@@ -270,7 +293,6 @@ struct SitofpInstruction:public Instruction {
 struct FptosiInstruction:public Instruction {
     // 源操作数
     ValuePtr from;
-    ~FptosiInstruction();
     FptosiInstruction(ValuePtr from, shared_ptr<BasicBlock> bb) : Instruction{InsID::Fptosi, bb, SitofpInstruction::getConvReg(Type::getInt())}, from{from} {
         newUse(from.get(), this, reg.get());
         //reg即这条指令本身
@@ -283,11 +305,10 @@ struct FptosiInstruction:public Instruction {
 };
 
 struct CallInstruction:public Instruction {
-    static int callRegNum;
-    static ValuePtr getCallReg(TypePtr type) { return ValuePtr(new Reg(type, "call" + to_string(callRegNum++))); }
+    static NameCounter callRegNum;
+    static ValuePtr getCallReg(TypePtr type) { return newIR<Reg>(type, "call" + to_string(callRegNum++)); }
     shared_ptr<Function> func;
     vector<ValuePtr> argv;
-    ~CallInstruction();
     CallInstruction(shared_ptr<Function> func, vector<ValuePtr> argv, shared_ptr<BasicBlock> bb);
     virtual void print() override;
     virtual bool replaceValue(ValuePtr target, ValuePtr newValue) override;
@@ -316,14 +337,13 @@ enum BinaryInstructionOps
 struct BinaryInstruction : public Instruction
 {
     // 用于命名，防止重复
-    static int BinaryRegNum;
-    static ValuePtr getBinaryReg(TypePtr type) { return ValuePtr(new Reg(type, "binary" + to_string(BinaryRegNum++))); }
+    static NameCounter BinaryRegNum;
+    static ValuePtr getBinaryReg(TypePtr type) { return newIR<Reg>(type, "binary" + to_string(BinaryRegNum++)); }
     // 两个操作数
     ValuePtr a;
     ValuePtr b;
     // 运算类型
     char op;
-    ~BinaryInstruction();
     BinaryInstruction(ValuePtr a, ValuePtr b, char op, shared_ptr<BasicBlock> bb) : Instruction{InsID::Binary, bb, getBinaryReg(a->type)}, a{a}, b{b}, op{op}
     {
         // std::cerr << "new Binary is here" << std::endl;
@@ -456,11 +476,10 @@ struct BinaryInstruction : public Instruction
 // fneg指令
 struct FnegInstruction:public Instruction {
     // 保证不重复
-    static int FnegRegNum;
-    static ValuePtr getFnegReg() { return ValuePtr(new Reg(Type::getFloat(), "fneg" + to_string(FnegRegNum++))); }
+    static NameCounter FnegRegNum;
+    static ValuePtr getFnegReg() { return newIR<Reg>(Type::getFloat(), "fneg" + to_string(FnegRegNum++)); }
     // 待取负的操作数
     ValuePtr a;
-    ~FnegInstruction();
     FnegInstruction(ValuePtr a, shared_ptr<BasicBlock> bb) : Instruction{InsID::Fneg, bb, getFnegReg()}, a{a} {
         newUse(a.get(), this, reg.get());
         reg->I = this;
@@ -473,9 +492,9 @@ struct FnegInstruction:public Instruction {
 
 // icmp指令，整数的比较
 struct IcmpInstruction:public Instruction {
-    static int cmpRegNum; // 这里本来应该是 block 来处理，我看 llvm ir 不会报错就偷懒没改了
+    static NameCounter cmpRegNum; // 这里本来应该是 block 来处理，我看 llvm ir 不会报错就偷懒没改了
     static std::map<string, IcmpKind> kindMap;
-    static ValuePtr getCmpReg() { return ValuePtr(new Reg(Type::getBool(), "cmp" + to_string(cmpRegNum++))); }
+    static ValuePtr getCmpReg() { return newIR<Reg>(Type::getBool(), "cmp" + to_string(cmpRegNum++)); }
     // 比较指令的操作数
     ValuePtr a;
     ValuePtr b;
@@ -484,7 +503,6 @@ struct IcmpInstruction:public Instruction {
     // 比较操作符的枚举形态，与上者是同样的东西
     IcmpKind kind;
 
-    ~IcmpInstruction();
     IcmpInstruction(shared_ptr<BasicBlock> bb, ValuePtr a, ValuePtr b = Const::getConst(Type::getInt(), 0)/*ValuePtr(new Const(Type::getInt(), 0))*/, string op = "!=") : Instruction{InsID::Icmp, bb, getCmpReg()}, a{a}, b{b}, op{op} {
         newUse(a.get(), this, reg.get());
         newUse(b.get(), this, reg.get());
@@ -507,7 +525,6 @@ struct FcmpInstruction:public Instruction {
     ValuePtr b;
     // 操作符
     string op;
-    ~FcmpInstruction();
     FcmpInstruction(shared_ptr<BasicBlock> bb, ValuePtr a, ValuePtr b = Const::getConst(Type::getFloat(), (float)0)/*ValuePtr(new Const(Type::getFloat(), (float)0))*/, string op = "!=") : Instruction{InsID::Fcmp, bb, IcmpInstruction::getCmpReg()}, a{a}, b{b}, op{op} {
         newUse(a.get(), this, reg.get());
         newUse(b.get(), this, reg.get());
@@ -522,14 +539,14 @@ struct FcmpInstruction:public Instruction {
 // 跳转指令
 struct BrInstruction:public Instruction {
     // 用于命名不重复
-    static int ifThenNum;
-    static int ifEndNum;
-    static int ifElseNum;
-    static int orNum;
-    static int andNum;
-    static int whileCondNum;
-    static int whileBodyNum;
-    static int whileEndNum;
+    static NameCounter ifThenNum;
+    static NameCounter ifEndNum;
+    static NameCounter ifElseNum;
+    static NameCounter orNum;
+    static NameCounter andNum;
+    static NameCounter whileCondNum;
+    static NameCounter whileBodyNum;
+    static NameCounter whileEndNum;
     static string getifThenStr() { return "if.then" + to_string(ifThenNum++); }
     static string getifEndStr() { return "if.end" + to_string(ifEndNum++); }
     static string getifElseStr() { return "if.else" + to_string(ifElseNum++); }
@@ -543,7 +560,6 @@ struct BrInstruction:public Instruction {
     // 跳转目标块的label
     LabelPtr label_true;
     LabelPtr label_false;
-    ~BrInstruction();
     BrInstruction(ValuePtr exp, LabelPtr label_true, LabelPtr label_false, shared_ptr<BasicBlock> bb) : Instruction{InsID::Br, bb}, exp{exp}, label_true{label_true}, label_false{label_false} {
         newUse(exp.get(), this);
     }
@@ -556,14 +572,13 @@ struct BrInstruction:public Instruction {
 // phi指令
 struct PhiInstruction:public Instruction {
     // 用于命名不重复
-    static int phiRegNum; 
-    static ValuePtr getPhiReg(TypePtr type) { return ValuePtr(new Reg(type, "phi" + to_string(phiRegNum++))); }
+    static NameCounter phiRegNum; 
+    static ValuePtr getPhiReg(TypePtr type) { return newIR<Reg>(type, "phi" + to_string(phiRegNum++)); }
     ValuePtr val; // mem2reg中才会用到
     // 跳转的块以及对应的值
     // 例如：对于 %x = phi i32 [ 1, %bb1 ], [ 2, %bb2 ]
     vector<std::pair<ValuePtr,shared_ptr<BasicBlock>>> from;
     string op;
-    ~PhiInstruction();
     PhiInstruction(shared_ptr<BasicBlock> bb, ValuePtr val) : Instruction{InsID::Phi, bb, getPhiReg(val->type)}, val{val} {
         reg->I = this;
     }; 
@@ -592,8 +607,89 @@ struct PhiInstruction:public Instruction {
 };
 
 
+// 把from的所有使用替换为to，并原地维护def-use链
+void replaceUses(ValuePtr from, ValuePtr to);
+// 同上，且from的定义指令已经无用，一并摘掉它对操作数的use
 void replaceVarByVar(ValuePtr from, ValuePtr to);
 void replaceVarByVarForLCSSA(ValuePtr from, ValuePtr to, Use* use); 
 void deleteUser(ValuePtr user);
 void deleteUser(InstructionPtr user);
-void deleteUser(Instruction* user);
\ No newline at end of file
+void deleteUser(Instruction* user);
+// InstructionList的实现，需要Instruction是完整类型
+inline InstructionList::iterator::reference InstructionList::iterator::operator*() const
+{
+    return node->prevInBB ? node->prevInBB->nextInBB : list->head;
+}
+
+inline InstructionList::iterator& InstructionList::iterator::operator++()
+{
+    node = node->nextInBB.get();
+    return *this;
+}
+
+inline InstructionList::iterator& InstructionList::iterator::operator--()
+{
+    node = node ? node->prevInBB : list->tail;
+    return *this;
+}
+
+inline const shared_ptr<Instruction>& InstructionList::back() const
+{
+    return *iteratorTo(tail);
+}
+
+inline InstructionList::iterator InstructionList::iteratorTo(Instruction* ins) const
+{
+    assert(ins->ownerList == this);
+    return {this, ins};
+}
+
+inline InstructionList::iterator InstructionList::insert(iterator pos, shared_ptr<Instruction> ins)
+{
+    assert(pos.list == this && !ins->ownerList);
+    Instruction* prev = pos.node ? pos.node->prevInBB : tail;
+    auto& slot = prev ? prev->nextInBB : head;
+    ins->nextInBB = std::move(slot);
+    ins->prevInBB = prev;
+    if(pos.node)
+        pos.node->prevInBB = ins.get();
+    else
+        tail = ins.get();
+    ins->ownerList = this;
+    count++;
+    slot = std::move(ins);
+    return {this, slot.get()};
+}
+
+inline InstructionList::iterator InstructionList::remove(iterator pos)
+{
+    Instruction* ins = pos.node;
+    assert(ins && ins->ownerList == this);
+    Instruction* next = ins->nextInBB.get();
+    if(next)
+        next->prevInBB = ins->prevInBB;
+    else
+        tail = ins->prevInBB;
+    auto& slot = ins->prevInBB ? ins->prevInBB->nextInBB : head;
+    slot = std::move(ins->nextInBB);
+    ins->prevInBB = nullptr;
+    ins->ownerList = nullptr;
+    count--;
+    return {this, next};
+}
+
+inline InstructionList::iterator InstructionList::erase(iterator pos)
+{
+    deleteUser(pos.node);
+    return remove(pos);
+}
+
+inline void InstructionList::splice(iterator pos, InstructionList& other, iterator first, iterator last)
+{
+    // 每条指令都要改ownerList，逐条摘下再插入
+    while(first != last) {
+        auto ins = *first;
+        first = other.remove(first);
+        insert(pos, ins);
+    }
+}
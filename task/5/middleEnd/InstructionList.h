@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <iterator>
+#include <cstddef>
+
+using std::shared_ptr;
+
+struct Instruction;
+
+// 基本块中的指令链表，前后指针直接存在Instruction里（侵入式双向链表）
+// 插入、删除、取得指令所在位置都是O(1)；指令都在Module的arena中，链表只串起指针，不持有所有权
+// erase删除指令：摘下来并去掉它对操作数的use；remove只摘下来，用于把指令移到别处
+// 迭代器解引用得到链表中指向该指令的InstructionPtr；摘下当前指令后迭代器失效，用erase/remove的返回值继续
+// 成员函数的定义在Instruction.h末尾，那里Instruction已经是完整类型
+struct InstructionList
+{
+    struct iterator
+    {
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef shared_ptr<Instruction> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const shared_ptr<Instruction>* pointer;
+        typedef const shared_ptr<Instruction>& reference;
+
+        const InstructionList* list = nullptr;
+        // 为nullptr时表示end
+        Instruction* node = nullptr;
+
+        iterator() = default;
+        iterator(const InstructionList* list, Instruction* node) : list{list}, node{node} {}
+        inline reference operator*() const;
+        pointer operator->() const { return &**this; }
+        inline iterator& operator++();
+        inline iterator& operator--();
+        iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+        iterator operator--(int) { auto tmp = *this; --*this; return tmp; }
+        bool operator==(const iterator& other) const { return node == other.node; }
+        bool operator!=(const iterator& other) const { return node != other.node; }
+    };
+    typedef iterator const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef reverse_iterator const_reverse_iterator;
+
+    InstructionList() = default;
+    InstructionList(const InstructionList&) = delete;
+    InstructionList& operator=(const InstructionList&) = delete;
+
+    iterator begin() const                          { return {this, head.get()}; }
+    iterator end() const                            { return {this, nullptr}; }
+    reverse_iterator rbegin() const                 { return reverse_iterator(end()); }
+    reverse_iterator rend() const                   { return reverse_iterator(begin()); }
+    size_t size() const                             { return count; }
+    bool empty() const                              { return count == 0; }
+    const shared_ptr<Instruction>& front() const    { return head; }
+    inline const shared_ptr<Instruction>& back() const;
+
+    // 指令ins在本链表中的位置
+    inline iterator iteratorTo(Instruction* ins) const;
+
+    // 在pos前插入ins，返回指向ins的迭代器；ins不能已经在某个链表中
+    inline iterator insert(iterator pos, shared_ptr<Instruction> ins);
+    void push_back(shared_ptr<Instruction> ins)     { insert(end(), ins); }
+    void push_front(shared_ptr<Instruction> ins)    { insert(begin(), ins); }
+    // 删除pos处的指令，返回下一条指令的迭代器
+    inline iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last)   { while(first != last) first = erase(first); return last; }
+    void pop_back()                                 { erase(iteratorTo(tail)); }
+    // 只摘下pos处的指令，保留它的use，之后可以插到别处；返回下一条指令的迭代器
+    inline iterator remove(iterator pos);
+    // 用ins替换pos处的指令（原指令被删除），返回指向ins的迭代器
+    iterator replace(iterator pos, shared_ptr<Instruction> ins) { auto it = insert(pos, ins); erase(pos); return it; }
+    // 把[first, last)从other中移到本链表的pos前，指令本身不复制
+    inline void splice(iterator pos, InstructionList& other, iterator first, iterator last);
+
+private:
+    shared_ptr<Instruction> head;
+    Instruction* tail = nullptr;
+    size_t count = 0;
+};
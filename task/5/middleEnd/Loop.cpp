@@ -1,6 +1,6 @@
 #include "Loop.h"
 
-Loop::Loop(shared_ptr<BasicBlock> header, int id): header(header), id(id), parent(header->belongfunc), parentLoop(nullptr), indCondVar(nullptr),
+Loop::Loop(shared_ptr<BasicBlock> header, int id): header(header), id(id), parent(header->getParent()), parentLoop(nullptr), indCondVar(nullptr),
     indEnd(nullptr), indPhi(nullptr), tripCount(0) {
     // bbSet.insert(header);
     addBasicBlock(header);
@@ -10,6 +10,9 @@ bool Loop::isADominatorB(BasicBlockPtr A, BasicBlockPtr B, BasicBlockPtr entry)
     if(A == entry){
         return true;
     }
+    if(A->hasDomNumber() && B->hasDomNumber()){
+        return A->dominates(B);
+    }
     while(B!=entry){
         if(B == A){
             return true;
@@ -68,7 +71,7 @@ SCEV operator+(ValuePtr lhs, const SCEV& rhs)
     // cerr << "[passed] at " << endl;
     // cerr << "lhs is " << lhs->getStr() << endl; 
     // cerr << "rhs is " << rhs.at(0)->getStr() << endl; 
-    auto add = new BinaryInstruction(lhs,rhs.at(0),'+',BasicBlockPtr(nullptr));
+    auto add = newSCEVBinary(lhs,rhs.at(0), '+');
     // cerr << "[passed] create instr" << endl;
     std::vector<ValuePtr> initialVals;
     initialVals.push_back(add->reg);
@@ -105,7 +108,7 @@ SCEV operator+(const SCEV& lhs, const SCEV& rhs)
                     continue;
                 }
             }
-            auto add = new BinaryInstruction(lhs.at(i),rhs.at(i),'+',BasicBlockPtr(nullptr));
+            auto add = newSCEVBinary(lhs.at(i),rhs.at(i), '+');
             binaryHasBeenCreated.push_back(add);
             initialVals.push_back(add->reg);
         }
@@ -132,7 +135,7 @@ SCEV operator+(const SCEV& lhs, const SCEV& rhs)
 
 SCEV operator-(const SCEV& lhs, ValuePtr rhs)
 {
-    auto sub = new BinaryInstruction(lhs.at(0),rhs,'-',BasicBlockPtr(nullptr));
+    auto sub = newSCEVBinary(lhs.at(0),rhs, '-');
     std::vector<ValuePtr> initialVals;
     initialVals.push_back(sub->reg);
     for(int i = 1; i < lhs.size(); i++)
@@ -165,7 +168,7 @@ SCEV operator-(const SCEV& lhs, const SCEV& rhs)
                     continue;
                 }
             }
-            auto add = new BinaryInstruction(lhs.at(i),rhs.at(i),'-',BasicBlockPtr(nullptr));
+            auto add = newSCEVBinary(lhs.at(i),rhs.at(i), '-');
             binaryHasBeenCreated.push_back(add);
             initialVals.push_back(add->reg);
         }
@@ -204,7 +207,7 @@ SCEV operator*(ValuePtr lhs, const SCEV& rhs)
                 continue;
             }
         }
-        auto mul = new BinaryInstruction(lhs, initem, '*', BasicBlockPtr(nullptr));
+        auto mul = newSCEVBinary(lhs, initem, '*');
         binaryHasBeenCreated.push_back(mul);
         initialVals.push_back(mul->reg);
     }
@@ -248,26 +251,16 @@ void SCEV::getItemChains(unsigned i, std::vector<BinaryInstruction*>& instrChain
     
 }
 
-void unuseall(Instruction* ins)
+BinaryInstruction* newSCEVBinary(ValuePtr a, ValuePtr b, char op)
 {
-    auto operands_num = ins->getNumOperands();
-    for(int i=0;i<operands_num;i++)
-    {
-        auto operand = ins->getOperand(i);
-        if(operand)
-        {
-            deleteUser(operand);
-        }
-    }
+    auto binary = newIR<BinaryInstruction>(a, b, op, BasicBlockPtr(nullptr)).get();
+    // 临时指令只用来描述表达式，不算作a、b的使用者，否则会一直挡住dce等依赖use链的优化
+    deleteUser(binary);
+    return binary;
 }
 
 void SCEV::clear()
 {
-    for(auto bin : instructionsHasBeenCaculated)
-    {
-        if(!bin->basicblock)
-            unuseall(bin);
-    }
     instructionsHasBeenCaculated.clear();
     scevVal.clear();
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include "Instruction.h"
 #include "BasicBlock.h"
+#include "IRArena.h"
 #include "utils.h"
 using namespace std;
 
@@ -50,6 +51,9 @@ public:
 };
 typedef shared_ptr<SCEV> SCEVPtr;
 
+// 构造SCEV表达式中的临时二元指令，不插入任何基本块，也不登记到操作数的use链上
+BinaryInstruction* newSCEVBinary(ValuePtr a, ValuePtr b, char op);
+
 struct Loop
 {
     set<shared_ptr<BasicBlock>> bbSet;
@@ -84,6 +88,7 @@ struct Loop
     Loop(shared_ptr<BasicBlock> header, int id);
 
     bool contains(shared_ptr<BasicBlock> bb) { return bbSet.count(bb); }
+    bool contains(BasicBlock *bb)            { return bbSet.count(nonOwning(bb)); }
 
     shared_ptr<BasicBlock> getHeader()                   { return header; }
     shared_ptr<BasicBlock> getPreheader()                { return preHeader; }
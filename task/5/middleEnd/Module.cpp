@@ -6,49 +6,49 @@ Module::Module()
     currStringTable = globalStringTable;
 
     vector<ValuePtr> memsetArgv = {
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getInt8())), "")),
-        RegPtr(new Reg(Type::getInt8(), "")),
-        RegPtr(new Reg(Type::getInt64(), "")),
-        RegPtr(new Reg(Type::getBool(), ""))};
+        newIR<Reg>(PtrType::get(Type::getInt8()), ""),
+        newIR<Reg>(Type::getInt8(), ""),
+        newIR<Reg>(Type::getInt64(), ""),
+        newIR<Reg>(Type::getBool(), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "llvm.memset.p0i8.i64", true, memsetArgv)));
     
     vector<ValuePtr> memcpyArgv = {
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getInt8())), "")),
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getInt8())), "")),
-        RegPtr(new Reg(Type::getInt64(), "")),
-        RegPtr(new Reg(Type::getBool(), ""))};
+        newIR<Reg>(PtrType::get(Type::getInt8()), ""),
+        newIR<Reg>(PtrType::get(Type::getInt8()), ""),
+        newIR<Reg>(Type::getInt64(), ""),
+        newIR<Reg>(Type::getBool(), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "llvm.memcpy.p0i8.p0i8.i64", true, memcpyArgv)));
     
     vector<ValuePtr> putintArgv = {
-        RegPtr(new Reg(Type::getInt(), ""))};
+        newIR<Reg>(Type::getInt(), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "putint", false, putintArgv)));
     
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "putch", false, putintArgv)));
     
     vector<ValuePtr> putfloatArgv = {
-        RegPtr(new Reg(Type::getFloat(), ""))};
+        newIR<Reg>(Type::getFloat(), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "putfloat", false, putfloatArgv)));
     
     vector<ValuePtr> putArrayArgv = {
-        RegPtr(new Reg(Type::getInt(), "")),
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getInt())), ""))};
+        newIR<Reg>(Type::getInt(), ""),
+        newIR<Reg>(PtrType::get(Type::getInt()), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "putarray", false, putArrayArgv)));
     vector<ValuePtr> putfArrayArgv = {
-        RegPtr(new Reg(Type::getInt(), "")),
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getFloat())), ""))};
+        newIR<Reg>(Type::getInt(), ""),
+        newIR<Reg>(PtrType::get(Type::getFloat()), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "putfarray", false, putfArrayArgv)));
 
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getInt(), "getint", false)));
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getInt(), "getch", false)));
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getFloat(), "getfloat", false)));
     vector<ValuePtr> getArrayArgv = {
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getInt())), ""))};
+        newIR<Reg>(PtrType::get(Type::getInt()), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getInt(), "getarray", false, getArrayArgv)));
     vector<ValuePtr> getfArrayArgv = {
-        RegPtr(new Reg(TypePtr(new PtrType(Type::getFloat())), ""))};
+        newIR<Reg>(PtrType::get(Type::getFloat()), "")};
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getInt(), "getfarray", false, getfArrayArgv)));
     vector<ValuePtr> timeArgv = {
-        RegPtr(new Reg(Type::getInt(), ""))};
+        newIR<Reg>(Type::getInt(), "")};
 
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "_sysy_starttime", false, timeArgv)));
     globalFunctions.emplace_back(FunctionPtr(new Function(Type::getVoid(), "_sysy_stoptime", false, timeArgv)));
@@ -8,6 +8,10 @@ using std::stack;
 
 struct Module
 {
+    // 基本块、指令、Value等IR对象的内存池，随最后一个持有者（Module或其中的函数）一起释放
+    IRArenaPtr arena = IRArenaPtr(new IRArena());
+    // 构造Module的线程此后新建的IR对象都放在arena中，Module析构时切回原来的arena
+    IRArena::Scope arenaScope{arena.get()};
     // 所有全局函数
     vector<FunctionPtr> globalFunctions;
     // 所有全局变量
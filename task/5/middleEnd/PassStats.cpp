@@ -0,0 +1,106 @@
+#include "PassStats.h"
+#include <cstdio>
+
+PassStats passStats;
+
+void PassStats::record(const string& pass, double seconds, long insBefore, long insAfter, long blocksBefore, long blocksAfter)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = recordIndex.find(pass);
+    if (it == recordIndex.end())
+    {
+        it = recordIndex.insert({pass, (int)records.size()}).first;
+        records.push_back(Record());
+        records.back().name = pass;
+    }
+    auto& r = records[it->second];
+    r.runs++;
+    r.seconds += seconds;
+    r.insBefore += insBefore;
+    r.insAfter += insAfter;
+    r.blocksBefore += blocksBefore;
+    r.blocksAfter += blocksAfter;
+}
+
+void PassStats::add(const string& pass, const string& counter, long n)
+{
+    if (!stats)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = std::make_pair(pass, counter);
+    auto it = counters.find(key);
+    if (it == counters.end())
+    {
+        counterOrder.push_back(key);
+        counters[key] = n;
+    }
+    else
+        it->second += n;
+}
+
+// JSON字符串转义，pass名和计数名里一般不会有特殊字符
+static string quote(const string& s)
+{
+    string ret = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            ret += '\\';
+        ret += c;
+    }
+    return ret + "\"";
+}
+
+void PassStats::print(std::ostream& os)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    char line[256];
+    if (timePasses)
+    {
+        double total = 0;
+        for (auto& r : records)
+            total += r.seconds;
+        os << "===== Pass execution timing report =====" << std::endl;
+        snprintf(line, sizeof(line), "%-24s %6s %10s %7s %21s %19s", "pass", "runs", "time(ms)", "%", "instructions", "blocks");
+        os << line << std::endl;
+        for (auto& r : records)
+        {
+            snprintf(line, sizeof(line), "%-24s %6d %10.3f %6.1f%% %10ld -> %-7ld %9ld -> %-7ld", r.name.c_str(), r.runs,
+                     r.seconds * 1000, total > 0 ? r.seconds / total * 100 : 0.0, r.insBefore, r.insAfter, r.blocksBefore, r.blocksAfter);
+            os << line << std::endl;
+        }
+        snprintf(line, sizeof(line), "%-24s %6s %10.3f", "total", "", total * 1000);
+        os << line << std::endl;
+    }
+    if (stats)
+    {
+        os << "===== Statistics =====" << std::endl;
+        for (auto& key : counterOrder)
+        {
+            snprintf(line, sizeof(line), "%10ld %-24s - %s", counters[key], key.first.c_str(), key.second.c_str());
+            os << line << std::endl;
+        }
+    }
+}
+
+void PassStats::printJSON(std::ostream& os)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "{\n  \"passes\": [";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        auto& r = records[i];
+        os << (i ? "," : "") << "\n    {\"name\": " << quote(r.name) << ", \"runs\": " << r.runs
+           << ", \"ms\": " << r.seconds * 1000
+           << ", \"instructions\": [" << r.insBefore << ", " << r.insAfter << "]"
+           << ", \"blocks\": [" << r.blocksBefore << ", " << r.blocksAfter << "]}";
+    }
+    os << "\n  ],\n  \"counters\": [";
+    for (size_t i = 0; i < counterOrder.size(); i++)
+    {
+        auto& key = counterOrder[i];
+        os << (i ? "," : "") << "\n    {\"pass\": " << quote(key.first) << ", \"name\": " << quote(key.second)
+           << ", \"value\": " << counters[key] << "}";
+    }
+    os << "\n  ]\n}" << std::endl;
+}
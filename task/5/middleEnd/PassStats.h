@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// -time-passes/-stats：每个pass的耗时和前后IR规模，以及pass自己的计数（例如dce删除的指令数）
+// 同名pass的多次运行累加在一起；并行优化时各线程同时记录，耗时是各函数上耗时之和
+struct PassStats
+{
+    // 记录耗时与IR规模
+    bool timePasses = false;
+    // 记录pass的计数
+    bool stats = false;
+
+    struct Record
+    {
+        string name;
+        int runs = 0;
+        double seconds = 0;
+        // 运行前后的指令数与基本块数
+        long insBefore = 0, insAfter = 0;
+        long blocksBefore = 0, blocksAfter = 0;
+    };
+
+    bool enabled() const { return timePasses || stats; }
+    // pass运行了一次
+    void record(const string& pass, double seconds, long insBefore, long insAfter, long blocksBefore, long blocksAfter);
+    // 给pass的某个计数加n，没有打开-stats时什么也不做
+    void add(const string& pass, const string& counter, long n = 1);
+
+    // 表格，输出到终端
+    void print(std::ostream& os);
+    // JSON，便于脚本比较不同版本的编译时间
+    void printJSON(std::ostream& os);
+
+private:
+    std::mutex mutex;
+    // 按第一次运行的顺序输出
+    std::vector<Record> records;
+    std::map<string, int> recordIndex;
+    std::vector<std::pair<string, string>> counterOrder;
+    std::map<std::pair<string, string>, long> counters;
+};
+
+extern PassStats passStats;
+
+// 从构造开始计时
+struct PassTimer
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+};
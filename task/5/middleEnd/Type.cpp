@@ -1,4 +1,5 @@
 #include "Type.h"
+#include <mutex>
 
 vector<shared_ptr<Type>> Type::types = {
     TypePtr(new Type(VoidID)),
@@ -8,36 +9,22 @@ vector<shared_ptr<Type>> Type::types = {
     TypePtr(new Type(Int8ID)),
     TypePtr(new Type(Int64ID))};
 
-Type::Type(string type)
+TypePtr Type::get(const string& type)
 {
     if (type == "int")
-    {
-        ID = IntID;
-    }
+        return getInt();
     else if (type == "void")
-    {
-        ID = VoidID;
-    }
+        return getVoid();
     else if (type == "bool")
-    {
-        ID = BoolID;
-    }
+        return getBool();
     else if (type == "float")
-    {
-        ID = FLoatID;
-    }
+        return getFloat();
     else if (type == "int8")
-    {
-        ID = Int8ID;
-    }
+        return getInt8();
     else if (type == "int64")
-    {
-        ID = Int64ID;
-    }
-    else
-    {
-        cout << "wrong type: " << type << endl;
-    }
+        return getInt64();
+    cout << "wrong type: " << type << endl;
+    return getVoid();
 }
 
 string Type::getStr()
@@ -72,48 +59,32 @@ string Type::getStr()
     }
 }
 
-string ArrType::getStr()
+ArrType::ArrType(const TypePtr& inner, int length) : Type{ArrID}, inner{inner}, length{length}
 {
-    return "[" + to_string(length) + " x " + inner->getStr() + "]";
+    size = length * inner->getNumElements();
+    depth = inner->isArr() ? 1 + dynamic_cast<ArrType *>(inner.get())->depth : 1;
+    str = "[" + to_string(length) + " x " + inner->getStr() + "]";
 }
 
-int ArrType::getSize()
+shared_ptr<ArrType> ArrType::get(const TypePtr& inner, int length)
 {
-    if (inner->isArr())
-        return length * (dynamic_cast<ArrType *>(inner.get())->getSize());
-    else
-        return length;
+    // 唯一化表，键为inner的地址（inner本身也是唯一的）；用局部静态变量，全局对象初始化时也能安全调用
+    static std::map<std::pair<Type *, int>, shared_ptr<ArrType>> arrTypes;
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& type = arrTypes[{inner.get(), length}];
+    if (!type)
+        type = shared_ptr<ArrType>(new ArrType(inner, length));
+    return type;
 }
 
-int ArrType::getDepth()
+shared_ptr<PtrType> PtrType::get(const TypePtr& inner)
 {
-    if(inner->isArr()) return 1 + dynamic_cast<ArrType*>(inner.get())->getDepth();
-    else return 1;
-}
-
-bool ArrType::operator==(shared_ptr<Type> ptr)
-{
-    if (ptr->isArr())
-    {
-        auto arrPtr = dynamic_cast<ArrType *>(ptr.get());
-        return arrPtr->length == length && inner->operator==(arrPtr->inner); // 这里可能有问题
-    }
-    else
-        return false;
-}
-
-string PtrType::getStr()
-{
-    return inner->getStr() + "*";
-}
-
-bool PtrType::operator==(shared_ptr<Type> ptr)
-{
-    if (ptr->isPtr())
-    {
-        auto another = dynamic_cast<PtrType *>(ptr.get());
-        return inner->operator==(another->inner); // 这里可能有问题
-    }
-    else
-        return false;
+    static std::map<Type *, shared_ptr<PtrType>> ptrTypes;
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& type = ptrTypes[inner.get()];
+    if (!type)
+        type = shared_ptr<PtrType>(new PtrType(inner));
+    return type;
 }
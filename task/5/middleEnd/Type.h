@@ -25,24 +25,25 @@ enum TypeID
     PtrID
 };
 
+// 类型是唯一化的：同一种类型全局只有一个对象，比较类型直接比较指针
+// 基本类型用getInt等获取，数组、指针类型用ArrType::get、PtrType::get获取，不要直接new
 struct Type
 {
     // 变量类型
     TypeID ID;
 
-    Type(TypeID type = VoidID) : ID{type} {};
-    Type(string type);
-
     // 简单的返回信息函数
     int getID() { return (int)ID; }
     virtual string getStr();
-    virtual bool operator==(shared_ptr<Type> ptr) { return ID == ptr->ID; }
+    bool operator==(const shared_ptr<Type>& ptr) { return this == ptr.get(); }
     bool isVoid() { return ID == VoidID; }
     bool isBool() { return ID == BoolID; }
     bool isInt() { return ID == IntID || ID == Int8ID || ID == Int64ID; }
     bool isFloat() { return ID == FLoatID; }
     bool isArr() { return ID == ArrID; }
     bool isPtr() { return ID == PtrID; }
+    // 按标量元素计的大小，非数组类型为1
+    virtual int getNumElements() { return 1; }
 
     // 方便我们进行变量类型设定
     static vector<shared_ptr<Type>> types;
@@ -52,6 +53,11 @@ struct Type
     static shared_ptr<Type> getFloat() { return Type::types[3]; }
     static shared_ptr<Type> getInt8() { return Type::types[4]; }
     static shared_ptr<Type> getInt64() { return Type::types[5]; }
+    // 由源码中的类型名（int、float、void等）得到对应的基本类型
+    static shared_ptr<Type> get(const string& type);
+
+protected:
+    Type(TypeID type = VoidID) : ID{type} {};
 };
 typedef shared_ptr<Type> TypePtr;
 
@@ -61,20 +67,33 @@ struct ArrType : Type
     TypePtr inner;
     // 数组长度
     int length;
-    ArrType(TypePtr inner, int length) : Type{ArrID}, inner{inner}, length{length} {};
-    virtual string getStr() override;
-    // inner类型以及数组长度一样为true
-    virtual bool operator==(shared_ptr<Type> ptr) override;
-    int getSize();
-    int getDepth();
+    // 获取inner[length]对应的唯一类型
+    static shared_ptr<ArrType> get(const TypePtr& inner, int length);
+    virtual string getStr() override { return str; }
+    // 元素总数
+    int getSize() { return size; }
+    virtual int getNumElements() override { return size; }
+    // 第一维下标加1时跨过的元素数，即inner的元素总数
+    int getStride() { return inner->getNumElements(); }
+    int getDepth() { return depth; }
+
+private:
+    ArrType(const TypePtr& inner, int length);
+    // 类型不可变，大小、维数和字符串形式在构造时算好
+    int size;
+    int depth;
+    string str;
 };
 
 struct PtrType : Type
 {
     // 指针指向的数据类型type
     TypePtr inner;
-    PtrType(TypePtr inner) : Type{PtrID}, inner{inner} {}
-    virtual string getStr() override;
-    // inner类型一样为true
-    virtual bool operator==(shared_ptr<Type> ptr) override;
+    // 获取inner*对应的唯一类型
+    static shared_ptr<PtrType> get(const TypePtr& inner);
+    virtual string getStr() override { return str; }
+
+private:
+    PtrType(const TypePtr& inner) : Type{PtrID}, inner{inner}, str{inner->getStr() + "*"} {}
+    string str;
 };
@@ -7,6 +7,8 @@ unordered_map<float, ValuePtr> Const::FloatConstMap;
 unordered_map<bool, ValuePtr> Const::BoolConstMap;
 unordered_map<long long, ValuePtr> Const::longlongConstMap;
 unordered_map<int8_t, ValuePtr> Const::Int8ConstMap;
+// 优化pass可能在多个线程里同时取常量
+static std::mutex constMapMutex;
 
 
 ValuePtr Const::getConst(TypePtr type,int val,string name){
@@ -22,6 +24,7 @@ ValuePtr Const::getConst(TypePtr type,int val,string name){
     if(type == Type::getInt64()){
         return getConst(type,(long long)(val),name);
     }
+    std::lock_guard<std::mutex> lock(constMapMutex);
     if(IntConstMap.find(val)!=IntConstMap.end()){
         return IntConstMap[val];
     }
@@ -41,6 +44,7 @@ ValuePtr Const::getConst(TypePtr type,int8_t val,string name){
     if(type == Type::getInt64()){
         return getConst(type,(long long)(val),name);
     }
+    std::lock_guard<std::mutex> lock(constMapMutex);
     if(Int8ConstMap.find(val)!=Int8ConstMap.end()){
         return Int8ConstMap[val];
     }
@@ -54,6 +58,7 @@ ValuePtr Const::getConst(TypePtr type,float val,string name){
     if(type == Type::getBool()){
         return getConst(type,bool(val),name);
     }
+    std::lock_guard<std::mutex> lock(constMapMutex);
     if(FloatConstMap.find(val)!=FloatConstMap.end()){
         return FloatConstMap[val];
     }
@@ -68,6 +73,7 @@ ValuePtr Const::getConst(TypePtr type,bool val,string name){
         return getConst(type,float(val),name);
     }
     // std::cerr<<val<<std::endl;
+    std::lock_guard<std::mutex> lock(constMapMutex);
     if(BoolConstMap.find(val)!=BoolConstMap.end()){
         return BoolConstMap[val];
     }
@@ -89,6 +95,7 @@ ValuePtr Const::getConst(TypePtr type,long long val,string name){
     if(type == Type::getInt()){
         return getConst(type,(int)(val),name);
     }
+    std::lock_guard<std::mutex> lock(constMapMutex);
     if(longlongConstMap.find(val)!=longlongConstMap.end()){
         return longlongConstMap[val];
     }
@@ -124,25 +131,54 @@ ValuePtr Const::getConst(TypePtr type,string val,string name){
     }
 }
 
-Use *newUse(Value *value, Instruction *user) {
-    auto use = new Use;
-    use->val = value;
-    use->user = user;
-    use->userVal = nullptr;
-    value->addUse(use);
+// Use节点按slab批量分配，rmUse后放回空闲表复用，避免频繁new且不再泄漏
+// 空闲表按线程划分，节点可以在一个线程分配、在另一个线程回收；
+// 空闲表不析构，程序退出时全局对象析构IR还会回收节点
+static const int useSlabSize = 4096;
+static thread_local vector<Use *> &freeUses = *new vector<Use *>();
+
+static std::recursive_mutex sharedUseMutex;
+
+SharedUseLock::SharedUseLock(Value *value) : locked{value->sharedUses} {
+    if (locked)
+        sharedUseMutex.lock();
+}
+
+SharedUseLock::~SharedUseLock() {
+    if (locked)
+        sharedUseMutex.unlock();
+}
+
+static Use *allocUse() {
+    if (freeUses.empty()) {
+        Use *slab = new Use[useSlabSize];
+        for (int i = useSlabSize - 1; i >= 0; i--)
+            freeUses.push_back(&slab[i]);
+    }
+    Use *use = freeUses.back();
+    freeUses.pop_back();
+    *use = Use();
     return use;
 }
 
+Use *newUse(Value *value, Instruction *user) {
+    return newUse(value, user, nullptr);
+}
+
 Use *newUse(Value *value, Instruction *user, Value *userVal) {
-    auto use = new Use;
+    if (!value->trackUses)
+        return nullptr;
+    auto use = allocUse();
     use->val = value;
     use->user = user;
     use->userVal = userVal;
+    SharedUseLock lock(value);
     value->addUse(use);
     return use;
 }
 
 Use *findUse(Value *value, Value *userVal) {
+    SharedUseLock lock(value);
     Use *use = value->useHead, *next = nullptr;
     while(use)
     {
@@ -154,6 +190,7 @@ Use *findUse(Value *value, Value *userVal) {
 }
 
 Use *findUse(Value *value, Instruction *user) {
+    SharedUseLock lock(value);
     Use *use = value->useHead, *next = nullptr;
     while(use)
     {
@@ -165,6 +202,35 @@ Use *findUse(Value *value, Instruction *user) {
 }
 
 void Use::rmUse() {
+    assert(!isDead && "remove a removed use twice");
+    {
+        SharedUseLock lock(val);
+        unlink();
+    }
+    isDead = true;
+    freeUses.push_back(this);
+}
+
+void Use::set(Value *value) {
+    assert(!isDead && "set on a removed use");
+    if (value == val)
+        return;
+    {
+        SharedUseLock lock(val);
+        unlink();
+    }
+    // 换成常量之后不再挂链，节点直接回收
+    if (!value->trackUses) {
+        isDead = true;
+        freeUses.push_back(this);
+        return;
+    }
+    val = value;
+    SharedUseLock lock(value);
+    value->addUse(this);
+}
+
+void Use::unlink() {
     if (prev == nullptr && next == nullptr) {
         val->useHead = nullptr;
     } 
@@ -186,6 +252,7 @@ void Use::rmUse() {
 }
 
 bool rmInstructionUse(shared_ptr<Instruction> I,ValuePtr v){
+    SharedUseLock lock(v.get());
     auto useH = v->useHead;
     bool flag = false;
     while(useH!=nullptr){
@@ -201,6 +268,7 @@ bool rmInstructionUse(shared_ptr<Instruction> I,ValuePtr v){
 
 //非智能指针版本
 bool rmInstructionUse(Instruction* I,ValuePtr v){
+    SharedUseLock lock(v.get());
     auto useH = v->useHead;
     bool flag = false;
     while(useH!=nullptr){
@@ -247,13 +315,13 @@ string Variable::getStr()
 shared_ptr<Variable> Variable::copy(shared_ptr<Variable> var)
 {
     if (var->type->isInt())
-        return VariablePtr(new Int(var->name, var->isGlobal, var->isConst));
+        return newIR<Int>(var->name, var->isGlobal, var->isConst);
     else if (var->type->isFloat())
-        return VariablePtr(new Float(var->name, var->isGlobal, var->isConst));
+        return newIR<Float>(var->name, var->isGlobal, var->isConst);
     else if (var->type->isArr())
-        return VariablePtr(new Arr(var->name, var->isGlobal, var->isConst, var->type));
+        return newIR<Arr>(var->name, var->isGlobal, var->isConst, var->type);
     else
-        return VariablePtr(new Ptr(var->name, var->isGlobal, var->isConst, var->type));
+        return newIR<Ptr>(var->name, var->isGlobal, var->isConst, var->type);
 }
 
 Int::Int(string name, bool isGlobal, bool isConst, ValuePtr value) : Variable{Type::getInt(), name, isGlobal, isConst}
@@ -358,7 +426,7 @@ bool Arr::push(VariablePtr variable)
             {
                 if (inner.size() < getElementLength())
                 {
-                    inner.emplace_back(VariablePtr(new Arr(name, isGlobal, isConst, getElementType())));
+                    inner.emplace_back(newIR<Arr>(name, isGlobal, isConst, getElementType()));
                     return dynamic_cast<Arr *>(inner.back().get())->push(variable);
                 }
                 else
@@ -384,14 +452,14 @@ void Arr::fill()
     {
         if (sonType->isArr())
         {
-            auto tmp = shared_ptr<Arr>(new Arr(name, isGlobal, true, sonType));
+            auto tmp = newIR<Arr>(name, isGlobal, true, sonType);
             tmp->fill();
             inner.emplace_back(tmp);
         }
         else
         {
-            if(sonType->isInt()) inner.emplace_back(VariablePtr(new Int(name, isGlobal, true, 0)));
-            else if(sonType->isFloat()) inner.emplace_back(VariablePtr(new Float(name, isGlobal, true, 0)));
+            if(sonType->isInt()) inner.emplace_back(newIR<Int>(name, isGlobal, true, 0));
+            else if(sonType->isFloat()) inner.emplace_back(newIR<Float>(name, isGlobal, true, 0));
         }
     }
 }
@@ -423,13 +491,13 @@ void Arr::printHelper()
             cout << ", ";
             if (getElementType()->isArr())
             {
-                VariablePtr(new Arr(name, isGlobal, true, getElementType()))->printHelper();
+                newIR<Arr>(name, isGlobal, true, getElementType())->printHelper();
             }
             else if(getElementType()->isInt())
             {
-                VariablePtr(new Int(name, isGlobal, false, 0))->printHelper();
+                newIR<Int>(name, isGlobal, false, 0)->printHelper();
             }else if(getElementType()->isFloat()){
-                VariablePtr(new Float(name, isGlobal, false, 0))->printHelper();
+                newIR<Float>(name, isGlobal, false, 0)->printHelper();
             }
         }
         cout << "]";
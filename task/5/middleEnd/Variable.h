@@ -6,7 +6,9 @@
 #include <cinttypes>
 #include <iostream>
 #include <unordered_map>
+#include <mutex>
 #include "Type.h"
+#include "IRArena.h"
 
 using std::unordered_map;
 using std::vector;
@@ -30,13 +32,18 @@ struct Use {
     Instruction *user;
     // 指令的value，我们没有很好的和llvm一样统一value和ins
     Value *userVal;
-    // 是否无人使用
+    // 是否已从链表中删除（删除后节点会被回收复用）
     bool isDead = false;
-    // 删除自身
+    // 删除自身，重复删除同一个节点是安全的
     void rmUse();
+    // 把该use改挂到value的链表上，user和userVal不变，用于替换操作数时原地维护def-use链
+    void set(Value *value);
     void useDead() {
         isDead = true; 
     }
+private:
+    // 只从链表中摘下，不回收
+    void unlink();
 };
 
 struct Value
@@ -51,7 +58,11 @@ struct Value
     bool isReg=false;
     // 是否是void
     bool isVoid=false;
-    Value(TypePtr type, string name, bool isConst, bool isReg, bool isVoid) : type{type}, name{name}, isConst{isConst}, isReg{isReg}, isVoid{isVoid} {}
+    // 常量和void在所有函数间共享，不维护use链，否则并行优化各函数时会互相修改同一条链表
+    bool trackUses=true;
+    // 全局变量的use链被所有函数共享，增删时要加锁（SharedUseLock）
+    bool sharedUses=false;
+    Value(TypePtr type, string name, bool isConst, bool isReg, bool isVoid) : type{type}, name{name}, isConst{isConst}, isReg{isReg}, isVoid{isVoid}, trackUses{!isConst && !isVoid} {}
     virtual string getStr(){return "";}
     // 输出llvm ir相关的函数
     virtual string myTypeStr() { return type->getStr(); };
@@ -66,7 +77,7 @@ struct Value
     
     //记录该reg所代表的指令
     Instruction *I = nullptr;
-    // 添加use到链表
+    // 添加use到链表，调用方负责判断trackUses以及对共享链表加锁
     void addUse(Use * u){
         u->prev = nullptr;
         if(useHead){
@@ -82,7 +93,18 @@ struct Value
     }
 };
 typedef shared_ptr<Value> ValuePtr;
-// 创建与查找use类
+
+// 遍历或修改value的use链期间持有，只对sharedUses的value真正加锁，可重入
+struct SharedUseLock {
+    explicit SharedUseLock(Value *value);
+    ~SharedUseLock();
+    SharedUseLock(const SharedUseLock&) = delete;
+    SharedUseLock& operator=(const SharedUseLock&) = delete;
+private:
+    bool locked;
+};
+
+// 创建与查找use类，value不维护use链时返回nullptr
 Use *newUse(Value *value, Instruction *user);
 Use *newUse(Value *value, Instruction *user, Value *userVal);
 Use *findUse(Value *value, Value *userVal);
@@ -92,10 +114,13 @@ Use *findUse(Value *value, Instruction *user);
 
 struct Reg : Value
 {
-    static ValuePtr getReg(TypePtr type, int id) { return ValuePtr(new Reg(type, id)); }
+    static ValuePtr getReg(TypePtr type, int id) { return newIR<Reg>(type, id); }
     //暂时加个reg，不然跑不了
     Reg(TypePtr type, int id) : Value{type, "reg" + to_string(id), false, true, false} {}
     Reg(TypePtr type, string name) : Value{type, name, false, true, false} {}
+    // 寄存器分配在arena中，只能用newIR创建
+    static void* operator new(size_t) = delete;
+    static void* operator new(size_t, void* mem) { return mem; }
     virtual string getStr() override { return "%" + name; }
 };
 typedef shared_ptr<Reg> RegPtr;
@@ -176,7 +201,14 @@ struct Variable : Value
 {
     // 是否是全局变量
     bool isGlobal;
-    Variable(TypePtr type, string name, bool isGlobal, bool isConst) : Value{type, name, isConst, false, false}, isGlobal{isGlobal} {};
+    // const变量同样需要use链（globalConstReplace按use替换）
+    Variable(TypePtr type, string name, bool isGlobal, bool isConst) : Value{type, name, isConst, false, false}, isGlobal{isGlobal} {
+        trackUses = true;
+        sharedUses = isGlobal;
+    };
+    // 变量分配在arena中，只能用newIR创建
+    static void* operator new(size_t) = delete;
+    static void* operator new(size_t, void* mem) { return mem; }
     virtual string getStr() override;
 
     virtual void print() = 0;
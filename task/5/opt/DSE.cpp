@@ -1,72 +1,86 @@
 #include "DSE.h"
-#include "LICM.h"
 
-// @FIXME: bug when compiling 09_BFS and almost useless
-void deadStorageElimination(FunctionPtr func) {
-    int removeCount = 0;
-    for (auto bbIter = func->basicBlocks.rbegin(); bbIter != func->basicBlocks.rend(); bbIter ++) {
-        auto &bb = *bbIter;
-        std::set<InstructionPtr> instrToErase;
-        for (int i = bb->instructions.size() - 1; i >= 0; i --) {
-            auto &ins = bb->instructions[i];
-            if (ins->type == Alloca) {
-                auto alloc = dynamic_cast<AllocaInstruction *>(ins.get());
-                // unused allocation
-                if (alloc->des->useHead == nullptr)
-                    instrToErase.insert(ins);
-            }
-            else if (ins->type == Store) {
-                auto store = dynamic_cast<StoreInstruction *>(ins.get());
-                // cannot predict whether an GEP will be accessed, skip GEP
-                if (store->des->getNumUses() > 1 || store->gep != nullptr)
-                    continue;
-                if (store->des->I != nullptr && store->des->I->type == GEP)
-                    continue;
-                
-                // remove store instruction
-                instrToErase.insert(ins);
-                Use *toDeleteValueUse = findUse(store->value.get(), ins.get());
-                Use *toDeleteDesUse = findUse(store->des.get(), ins.get());
-                assert(toDeleteValueUse != nullptr && toDeleteValueUse != nullptr);
-                toDeleteValueUse->rmUse();
-                toDeleteDesUse->rmUse();
+static bool isMemset(Instruction *ins) {
+    return ins->type == Call && ((CallInstruction *)ins)->func->name.rfind("llvm.memset", 0) == 0;
+}
 
-                std::deque<ValuePtr> queue;
-                InstructionPtr valInstr = shared_ptr<Instruction>(store->value->I);
-                // remove the calculation of store value, if the value is used only once
-                if (valInstr != nullptr && store->value->getNumUses() == 1) {
-                    if (valInstr->type == Call) {
-                        auto call = dynamic_cast<CallInstruction *>(valInstr.get());
-                        if(isCallIdempotent(call)) queue.push_back(store->value);
-                    }
-                    else 
-                        queue.push_back(store->value);
-                }
+// 被覆盖的写入的位置：store的地址，memset的基址（整块内存，偏移未知）
+static MemoryLocation getWrittenLocation(Instruction *ins) {
+    if(ins->type == Store)
+        return getMemoryLocation(((StoreInstruction *)ins)->des.get());
+    auto loc = getMemoryLocation(((CallInstruction *)ins)->argv[0].get());
+    loc.constOffset = false;
+    loc.offset = 0;
+    return loc;
+}
 
-                // execute BFS to traverse dead instruction chains
-                while (!queue.empty()) {
-                    auto val = queue.front();
-                    queue.pop_front();
-                    Use *use = val->useHead, *nextUse = nullptr;
-                    while(use) {
-                        nextUse = use->next;
-                        ValuePtr user = ValuePtr(use->userVal);
-                        assert(user != nullptr);
-                        if (user->getNumUses() > 1) {
-                            use = nextUse;
-                            continue;
-                        }
-                        queue.push_back(user);
-                        instrToErase.insert(InstructionPtr(val->I));
-                        use->rmUse();
-                        use = nextUse;
-                    }
-                }
-            }
+// killer一定写了loc的全部内容；地址是同一个值且中间没有经过MemoryPhi时，说明还在同一次迭代里
+static bool mustOverwrite(Instruction *killer, const MemoryLocation& loc, bool crossedPhi) {
+    if(killer->type != Store)
+        return false;
+    auto other = getMemoryLocation(((StoreInstruction *)killer)->des.get());
+    if(loc.baseKind != UnknownBase && other.base == loc.base && loc.constOffset && other.constOffset)
+        return other.offset == loc.offset;
+    return !crossedPhi && other.addr == loc.addr;
+}
+
+// 从def出发沿内存的使用者向后找，遇到可能读loc的访问就说明def是活的
+static bool isDeadStore(MemorySSA& mssa, MemoryAccess *def, const MemoryLocation& loc) {
+    set<pair<MemoryAccess *, bool>> visited;
+    vector<pair<MemoryAccess *, bool>> worklist;
+    auto push = [&](MemoryAccess *access, bool crossedPhi) {
+        for(auto user : access->users)
+            if(visited.insert({user, crossedPhi}).second)
+                worklist.push_back({user, crossedPhi});
+    };
+    push(def, false);
+    while(!worklist.empty()) {
+        auto [access, crossedPhi] = worklist.back();
+        worklist.pop_back();
+        if(access->kind == MemoryPhi) {
+            push(access, true);
+            continue;
         }
-        for (auto &instr: instrToErase) {
-            instr->deleteSelfInBB();
-            removeCount ++;
+        if(mssa.mayRead(access->instr, loc))
+            return false;
+        if(access->kind == MemoryDef && !mustOverwrite(access->instr, loc, crossedPhi))
+            push(access, crossedPhi);
+    }
+    return true;
+}
+
+void deadStorageElimination(FunctionPtr func) {
+    MemorySSA mssa(func);
+    int removed = 0;
+    for(auto& bb : func->basicBlocks) {
+        // 拷贝一份，删除指令不影响遍历
+        vector<InstructionPtr> instructions(bb->instructions.begin(), bb->instructions.end());
+        for(auto& ins : instructions) {
+            if(ins->type != Store && !isMemset(ins.get()))
+                continue;
+            auto access = mssa.getAccess(ins.get());
+            if(!access)
+                continue;
+            auto loc = getWrittenLocation(ins.get());
+            if(!isDeadStore(mssa, access, loc))
+                continue;
+            mssa.removeAccess(access);
+            ins->deleteSelfInBB();
+            removed++;
+            // memset的地址是单独的bitcast，一并删掉
+            if(ins->type == Call) {
+                auto cast = ((CallInstruction *)ins.get())->argv[0]->I;
+                if(cast && cast->type == Bitcast && cast->reg->useHead == nullptr)
+                    cast->deleteSelfInBB();
+            }
         }
     }
-}
\ No newline at end of file
+    // 局部数组的读写都删光后，alloca也不再需要
+    for(auto& bb : func->basicBlocks) {
+        vector<InstructionPtr> instructions(bb->instructions.begin(), bb->instructions.end());
+        for(auto& ins : instructions)
+            if(ins->type == Alloca && ((AllocaInstruction *)ins.get())->des->useHead == nullptr)
+                ins->deleteSelfInBB();
+    }
+    passStats.add("deadStorageElimination", "stores removed", removed);
+}
@@ -4,5 +4,12 @@
 #include <set>
 #include <queue>
 #include "Module.h"
+#include "analysisManager.h"
+#include "memorySSA.h"
 
-void deadStorageElimination(FunctionPtr func);
\ No newline at end of file
+// 基于MemorySSA删除死存储：store（和局部数组初始化的memset）之后，沿内存定义链在读到它之前
+// 每条路径上都被写同一位置的store覆盖，或者一直没被读到，就删掉它。
+// 全局数组、局部数组和形参数组的常量下标gep能区分出不同元素；最后删掉不再使用的alloca
+void deadStorageElimination(FunctionPtr func);
+const unsigned deadStorageEliminationRequires = AnalysisCFG | AnalysisDom;
+const unsigned deadStorageEliminationPreserves = AnalysisAll;
@@ -15,7 +15,7 @@ void computeDefInUseOut(Loop *loop, unordered_set<InstructionPtr> &DefInUseOut)
                 Instruction *UserInstr = use->user; // 枚举所有使用当前指令的指令
                 fflush(stdout);
                 fflush(stdout);
-                auto userBB = UserInstr->basicblock;
+                auto userBB = nonOwning(UserInstr->basicblock);
                 assert(UserInstr);
                 fflush(stdout);
                 auto phi2 = dynamic_cast<PhiInstruction *>(UserInstr);
@@ -56,9 +56,9 @@ PhiInstruction *getIncomingValAtBB(BasicBlockPtr bb, InstructionPtr instr,
         return value;
     }
 
-    auto phi = new PhiInstruction(bb, instr->reg);
+    auto phi = newIR<PhiInstruction>(bb, instr->reg).get();
     phi->setName(phi->getName() + ".lcssa");
-    bb->insertInstruction(InstructionPtr(phi), bb->instructions[0]);
+    bb->insertInstruction(phi->getSharedThis(), bb->instructions.front());
     BBToPhi[bb] = phi;
 
     for (auto Pred : phi->from)
@@ -73,16 +73,16 @@ PhiInstruction *getIncomingValAtBB(BasicBlockPtr bb, InstructionPtr instr,
 void insertLoopClosedPhi(Loop *loop, InstructionPtr instr)
 {
     unordered_map<BasicBlockPtr, PhiInstruction *> BBToPhi;
-    auto bb = instr->basicblock;
+    auto bb = nonOwning(instr->basicblock);
 
     for (auto exit : loop->getExitBlocks())
     {
-        if (!BBToPhi.count(exit) && exit->getAllDoms().count(bb)) // 1 是exit块，且被当前instr支配，支配边界 + 直接支配 = 支配集合
+        if (!BBToPhi.count(exit) && bb->dominates(exit)) // 1 是exit块，且被当前instr支配，支配边界 + 直接支配 = 支配集合
         {
             // cerr << "here1: " << exit->label->name << endl;
-            auto phi = new PhiInstruction(exit, instr->reg);
+            auto phi = newIR<PhiInstruction>(exit, instr->reg).get();
             phi->setName(phi->getName() + ".lcssa");
-            exit->insertInstruction(InstructionPtr(phi), exit->instructions[0]); // 2
+            exit->insertInstruction(phi->getSharedThis(), exit->instructions.front()); // 2
             BBToPhi[exit] = phi;                                                 // 如果这个块的头部被插入了phi指令代替liveout instr
 
             for (auto Pred : exit->predBasicBlocks)
@@ -105,7 +105,7 @@ void insertLoopClosedPhi(Loop *loop, InstructionPtr instr)
         // if(auto userInstr = dynamic_cast<Instruction*>(user)) // User有可能不是Instruction吗？
         //{
         auto user = Pair.first;
-        auto userBB = user->basicblock;
+        auto userBB = nonOwning(user->basicblock);
         if (auto phi = dynamic_cast<PhiInstruction *>(user))
         {
             for (auto Pred : phi->from)
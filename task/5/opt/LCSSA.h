@@ -1,4 +1,6 @@
+#pragma once
 #include "Module.h"
+#include "analysisManager.h"
 #include "Loop.h"
 #include <set>
 #include <unordered_set>
@@ -13,4 +15,6 @@ unordered_map<BasicBlockPtr, PhiInstruction*>& BBToPhi, Loop* loop);
 
 void insertLoopClosedPhi(Loop* loop, InstructionPtr instr);
 void runOnLoop(Loop* loop);
-void LCSSA(FunctionPtr func);
\ No newline at end of file
+void LCSSA(FunctionPtr func);
+const unsigned LCSSARequires = AnalysisLoop;
+const unsigned LCSSAPreserves = AnalysisAll;
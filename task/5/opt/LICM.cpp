@@ -2,95 +2,6 @@
 
 // #define DEBUG
 
-std::unordered_map<FunctionPtr, bool> idemFunctions;
-
-bool isCallIdempotent(CallInstruction *ins) {
-    int numOperands = ins->getNumOperands();
-    bool isIdempotent = true;
-    // traverse all arguments
-    for(int i = 0; i < numOperands; i ++) {
-        auto arg = ins->getOperand(i);
-        // global variable or pointer
-        if(dynamic_cast<Variable *>(arg.get())) {
-            auto var = dynamic_cast<Variable *>(arg.get());
-            if(var->isGlobal) {
-                isIdempotent = false;
-                break;
-            }
-            else if(var->type->getID() == PtrID || (var->I && var->I->type == GEP)) {
-                isIdempotent = false;
-                break;
-            }
-        }
-        // pointer
-        else if(dynamic_cast<Const *>(arg.get())) {
-            auto constant = dynamic_cast<Const *>(arg.get());
-            if(constant->type->getID() == PtrID) {
-                isIdempotent = false;
-                break;
-            }
-        }
-        else {
-            isIdempotent = true;
-            break;
-        }
-    }
-    if(!isIdempotent) 
-        return false;
-    
-    auto call = ins;
-    FunctionPtr f = call->func;
-    if(idemFunctions.find(f) != idemFunctions.end()) {
-        isIdempotent = idemFunctions[f];
-    }
-    else {
-        // to avoid recursive callling, mark current function 'f' as false
-        idemFunctions[f] = false;
-        if(f->isLib)
-            isIdempotent = false;
-        else {
-            for(auto basicBlock: f->basicBlocks) {
-                for(auto instr: basicBlock->instructions) {
-                    if(instr->type == Load) {
-                        auto load = dynamic_cast<LoadInstruction *>(instr.get());
-                        if(dynamic_cast<Variable *>(load->from.get()) || load->gep) {
-                            isIdempotent = false;
-                            break;
-                        }
-                    }
-                    else if(instr->type == Store) {
-                        auto store = dynamic_cast<StoreInstruction *>(instr.get());
-                        if(dynamic_cast<Variable *>(store->des.get()) || store->gep) {
-                            isIdempotent = false;
-                            break;
-                        }
-                    }
-                    else if(instr->type == GEP) {
-                        isIdempotent = false;
-                        break;
-                    }
-                    else if(instr->type == Call) {
-                        auto innerCall = dynamic_cast<CallInstruction *>(instr.get());
-                        if(idemFunctions.find(innerCall->func) != idemFunctions.end()) {
-                            if(idemFunctions[innerCall->func] == false) {
-                                isIdempotent = false;
-                                break;
-                            }
-                        }
-                        else {
-                            isIdempotent = isCallIdempotent(innerCall);
-                            if(!isIdempotent) break;
-                        }
-                    }
-                }
-                if(!isIdempotent) break;
-            }
-        }
-        idemFunctions[f] = isIdempotent;
-    }
-    return isIdempotent;
-}
-
 // determinate whether the execution of an instruction will incur effects besides calculating
 bool isSafeToSpeculativelyExecute(InstructionPtr instr) {
     auto type = instr->type;
@@ -124,12 +35,12 @@ bool isSafeToSpeculativelyExecute(InstructionPtr instr) {
             safe = true;
         } break;
 
-        // @TODO: use isSpeculative instead isCallIdempotent
+        // 不读写内存、不递归的调用可以推测执行；只读内存的调用可能越界读，也可能在本不会执行它的路径上不终止
         case Call: {
             auto call = dynamic_cast<CallInstruction *>(instr.get());
             safe = isCallIdempotent(call);
-        }
-            
+        } break;
+
         case Alloca:
         case Phi:
         case Return:
@@ -143,38 +54,21 @@ bool isSafeToSpeculativelyExecute(InstructionPtr instr) {
 
 bool safeToHoist(InstructionPtr instr, LoopPtr curLoop, FunctionPtr func) {
     bool cond1 = isSafeToSpeculativelyExecute(instr);
-    // handled in isLoopInvariant
-    if(instr->type == Call) 
-        cond1 = true;
+    // 不能推测执行的指令，只有所在块支配所有出口（进入循环就一定执行到）时才外提；没有出口的循环不外提
     unordered_set<BasicBlockPtr> exitBlocks = curLoop->getExitBlocks();
-    auto instrBlock = instr->basicblock;
+    auto instrBlock = nonOwning(instr->basicblock);
     auto entry = func->basicBlocks[0];
-    bool cond2 = std::accumulate(exitBlocks.begin(), exitBlocks.end(), true, 
+    bool cond2 = !exitBlocks.empty() && std::accumulate(exitBlocks.begin(), exitBlocks.end(), true, 
                                 [&](bool acc, BasicBlockPtr exitBlock) {
                                     return acc && Loop::isADominatorB(instrBlock, exitBlock, entry);
                                 });
     return cond1 || cond2;
 }
 
-bool isArgInCall(ValuePtr value, CallInstruction *call) {
-    int numArg = call->argv.size();
-    for(int i = 0; i < numArg; i ++) {
-        auto arg = call->getOperand(i);
-        if(arg == value)
-            return true;
-
-        auto argGEP = dynamic_cast<GetElementPtrInstruction *>(arg->I);
-        if(argGEP && argGEP->from == value)
-            return true;
-    }
-    return false;
-}
-
 // determinate whether the loaded variable '%v' in Inst '%0 = load i32, i32* %v' will be changed in loop blocks
 bool isChangedInBlock(LoadInstruction *load, LoopPtr curLoop, FunctionPtr func) {
     vector<BasicBlockPtr> loopBlocks = curLoop->getLoopBasicBlocks();
     auto from = load->from;
-    auto fromVar = dynamic_cast<Variable *>(from.get());
     // if load from GEP, avoid storing to same base
     while(dynamic_cast<GetElementPtrInstruction *>(from->I)) {
         from = dynamic_cast<GetElementPtrInstruction *>(from->I)->from;
@@ -197,52 +91,53 @@ bool isChangedInBlock(LoadInstruction *load, LoopPtr curLoop, FunctionPtr func)
                 }
             }
             else if(loopInstr->type == Call) {
-                auto call = dynamic_cast<CallInstruction *>(loopInstr.get());
-                // if variable '%v' is passed as function call parameter, return true
-                if(isArgInCall(from, call))
+                // 被调函数可能经全局变量或指针实参写到load的地址
+                if(callMayModify(dynamic_cast<CallInstruction *>(loopInstr.get()), getMemoryBase(from.get())))
                     return true;
-
-                // if 'loadFrom' is a global variable, determinate whether it's changed(stored) in the called function
-                FunctionPtr f = call->func;
-                // lib in sysy means IO, which doesn't change the value a pointer points to
-                if(f->isLib)
-                    continue;
-                if(fromVar && fromVar->isGlobal) {
-                    for(auto calledBB: f->basicBlocks) {
-                        for(auto calledInstr: calledBB->instructions) {
-                            if(calledInstr->type == Store) {
-                                auto store = dynamic_cast<StoreInstruction *>(calledInstr.get());
-                                auto des = store->des;
-                                if(from == des) 
-                                    return true;
-
-                                // call to same array base
-                                auto desGEP = dynamic_cast<GetElementPtrInstruction *>(des->I);
-                                if(desGEP) {
-                                }
-                                if(desGEP && desGEP->from == from) {
-                                    return true;
-                                }
-                            }
-                            else if(calledInstr->type == Call) {
-                                auto call = dynamic_cast<CallInstruction *>(calledInstr.get());
-                                return true;
-                            }
-                        }
-                    }
-                }
             }
         }
     }
     return false;
 }
 
+// 只读内存的调用：循环中没有store或call会改写它读的内存时，结果在循环中不变
+// 它不能推测执行，能否外提还要看safeToHoist
+bool isReadOnlyCallInvariant(CallInstruction *call, LoopPtr curLoop) {
+    auto& effects = getFunctionEffects(call->func.get());
+    if(!effects.isReadOnly() || effects.recursive)
+        return false;
+    for(auto bb: curLoop->getLoopBasicBlocks()) {
+        for(auto loopInstr: bb->instructions) {
+            if(loopInstr->type == Store) {
+                auto store = dynamic_cast<StoreInstruction *>(loopInstr.get());
+                if(callMayRef(call, getMemoryBase(store->des.get())))
+                    return false;
+            }
+            else if(loopInstr->type == Call && loopInstr.get() != call) {
+                auto other = dynamic_cast<CallInstruction *>(loopInstr.get());
+                auto& otherEffects = getFunctionEffects(other->func.get());
+                if(otherEffects.unknownWritten)
+                    return false;
+                for(auto global: otherEffects.globalsWritten)
+                    if(callMayRef(call, global))
+                        return false;
+                for(int i = 0; i < other->argv.size(); i ++)
+                    if(i < otherEffects.argsWritten.size() && otherEffects.argsWritten[i]
+                        && callMayRef(call, getMemoryBase(other->argv[i].get())))
+                        return false;
+            }
+        }
+    }
+    return true;
+}
+
 bool isLoopInvariant(InstructionPtr instr, LoopPtr curLoop, FunctionPtr func, set<Instruction *>& toDelete) {
     auto type = instr->type;
     // condition 1: One of the invariant instruction classes
     bool cond1 = (type == Alloca
         || (type == Load && !isChangedInBlock(dynamic_cast<LoadInstruction *>(instr.get()), curLoop, func))
-        || (type == Call && isCallIdempotent(dynamic_cast<CallInstruction *>(instr.get())))
+        || (type == Call && (isCallIdempotent(dynamic_cast<CallInstruction *>(instr.get()))
+            || isReadOnlyCallInvariant(dynamic_cast<CallInstruction *>(instr.get()), curLoop)))
         || type == Bitcast || type == Sitofp || type == Fptosi
         || type == GEP || type == Binary || type == Fneg || type == Ext);
     
@@ -323,12 +218,15 @@ void runForLoop(LoopPtr curLoop, int& moveCount, FunctionPtr func) {
         }
 
         // hoist
+        #ifdef DEBUG
         int instrCnt = bb->instructions.size();
+        #endif
         set<Instruction *> searchDelete;
         vector<InstructionPtr> toDeleteInstr;
         vector<InstructionPtr> toMoveExitInstr;
-        for(int i = 0; i < instrCnt; i ++) {
-            auto instr = bb->instructions[i];
+        int i = 0;
+        for(auto it = bb->instructions.begin(); it != bb->instructions.end(); it ++, i ++) {
+            auto instr = *it;
             #ifdef DEBUG
             cout << endl << "  " << i << "/" << instrCnt << ": ";
             instr->print();
@@ -344,7 +242,8 @@ void runForLoop(LoopPtr curLoop, int& moveCount, FunctionPtr func) {
             if(cond1 && cond2) {
                 toDeleteInstr.push_back(instr);
                 searchDelete.insert(instr.get());
-                preheader->pushInstruction(instr);
+                // 先记到preheader名下，后面的指令判断不变量时会看到
+                instr->basicblock = preheader.get();
                 #ifdef DEBUG
                 // cout << "to delete instruction: ";
                 // instr->print();
@@ -352,7 +251,12 @@ void runForLoop(LoopPtr curLoop, int& moveCount, FunctionPtr func) {
             }
         }
         if(toDeleteInstr.size() > 0) {
+            for(auto instr: toDeleteInstr)
+                bb->instructions.remove(bb->instructions.iteratorTo(instr.get()));
             preheader->pushInstruction(toDeleteInstr);
+            for(auto instr: toDeleteInstr)
+                if(instr->type == Load)
+                    passStats.add("LICM", "loads hoisted");
             #ifdef DEBUG
             cout << "instructions to be hoist:" << endl;
             for(auto instr: toDeleteInstr) {
@@ -360,13 +264,6 @@ void runForLoop(LoopPtr curLoop, int& moveCount, FunctionPtr func) {
             }
             #endif
 
-            vector<InstructionPtr> newInstructions;
-            for(int i = 0; i < bb->instructions.size(); i ++) {
-                if(searchDelete.find(bb->instructions[i].get()) == searchDelete.end()) {
-                    newInstructions.emplace_back(bb->instructions[i]);
-                }
-            }
-            bb->instructions = newInstructions;
             moveCount += toDeleteInstr.size();
         }
     }
@@ -379,4 +276,5 @@ void LICM(FunctionPtr func) {
     for(int i = 0; i < numLoops; i ++) {
         runForLoop(postorderLoops[i], moveCount, func);
     }
+    passStats.add("LICM", "instructions hoisted", moveCount);
 }
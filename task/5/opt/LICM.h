@@ -1,11 +1,16 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <numeric>
 #include <queue>
 #include "Module.h"
+#include "analysisManager.h"
 #include "Loop.h"
+#include "callEffects.h"
 
-bool isCallIdempotent(CallInstruction *ins);
 void LICM(FunctionPtr func);
+// 只把指令移到preheader
+const unsigned LICMRequires = AnalysisLoop;
+const unsigned LICMPreserves = AnalysisCFG | AnalysisDom | AnalysisLoop | AnalysisUse;
 bool isLoopInvariant(InstructionPtr instr, LoopPtr curLoop, FunctionPtr func, set<Instruction *>& toDelete);
\ No newline at end of file
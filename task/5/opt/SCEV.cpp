@@ -25,7 +25,7 @@ void BIV2SCEV(LoopPtr loop, PhiInstruction* phi, std::set<ValuePtr>& adds, std::
         for(auto sub : subs)
         {
             // auto binary = new BinaryInst(step->getType(), Instruction::Sub, step, sub, nullptr, "scevsubtmp");
-            auto binary = new BinaryInstruction(step,sub,'-',BasicBlockPtr(nullptr));
+            auto binary = newSCEVBinary(step,sub, '-');
             binaryStore.insert(binary);
             step = binary->reg;
             // step = binary;
@@ -33,7 +33,7 @@ void BIV2SCEV(LoopPtr loop, PhiInstruction* phi, std::set<ValuePtr>& adds, std::
         for(auto add : adds)
         {
             // auto binary = new BinaryInst(step->getType(), Instruction::Add, step, add, nullptr, "scevaddtmp");
-            auto binary = new BinaryInstruction(step,add,'+',BasicBlockPtr(nullptr));
+            auto binary = newSCEVBinary(step,add, '+');
             binaryStore.insert(binary);
             step = binary->reg;
             // step = binary;
@@ -57,13 +57,13 @@ void BIV2SCEV(LoopPtr loop, PhiInstruction* phi, std::set<ValuePtr>& adds, std::
     // cerr << "BIV2SCEV passed step 3" << endl;
     std::set<BinaryInstruction*> binaryStore;
     int myval =0;
-    auto step = new BinaryInstruction(ValuePtr(new Const(myval, "scevsubtmp")),sub,'-',BasicBlockPtr(nullptr));
+    auto step = newSCEVBinary(ValuePtr(new Const(myval, "scevsubtmp")),sub, '-');
     // cerr << "BIV2SCEV passed step 4" << endl;
     // auto step = new BinaryInst(Type::getInt32Ty(), Instruction::Sub, ConstantInt::getZero(Type::getInt32Ty()), sub, nullptr, "scevsubtmp");
     binaryStore.insert(step);
     for(auto sub : subs)
     {
-        step = new BinaryInstruction(ValuePtr(new Const(myval, "scevsubtmp")),sub,'-',BasicBlockPtr(nullptr));
+        step = newSCEVBinary(ValuePtr(new Const(myval, "scevsubtmp")),sub, '-');
         binaryStore.insert(step);
     }
     // cerr << "BIV2SCEV passed step 5" << endl;
@@ -357,29 +357,141 @@ void ScalarEvolution(LoopPtr loop)
 
     } while(!fixed);
 
-    if(loop->indPhi && loop->hasSCEV(loop->indPhi))
+    LoopBound bound;
+    if(getLoopBound(loop, bound))
     {
+        auto c = getConstTripCount(bound);
+        loop->tripCount = c > 0 ? c : 0;
+    }
+}
 
-        // cerr << "indPhi" << endl;
-        auto phi = loop->indPhi;
-        auto& scev = loop->getSCEV(phi);
-        auto endval = loop->indEnd;
-        auto initval = scev.at(0);
-        auto stepval = scev.at(1);
-        if(endval && endval->isConst && initval && initval ->isConst && stepval && stepval->isConst)
-        {
-            // cerr << "May have trip count" << endl;
-            auto cEnd = dynamic_cast<Const *>(endval.get());
-            auto cInitial = dynamic_cast<Const *>(initval.get());
-            auto cStep = dynamic_cast<Const *>(stepval.get());
-            int c;
-            if (loop->icmpKind == ICmpEQ || loop->icmpKind == ICmpSGE || loop->icmpKind == ICmpSLE)
-                c = (cEnd->intVal + 1 - cInitial->intVal) / cStep->intVal;
-            else
-                c = (cEnd->intVal - cInitial->intVal) / cStep->intVal;
-            // cerr << "loop trip count is" << c << endl;
-            loop->tripCount = c;
-        }
+static IcmpKind swapKind(IcmpKind kind)
+{
+    switch(kind)
+    {
+        case ICmpSLT: return ICmpSGT;
+        case ICmpSGT: return ICmpSLT;
+        case ICmpSLE: return ICmpSGE;
+        case ICmpSGE: return ICmpSLE;
+        default: return kind;
     }
 }
 
+static IcmpKind invertKind(IcmpKind kind)
+{
+    switch(kind)
+    {
+        case ICmpEQ: return ICmpNE;
+        case ICmpNE: return ICmpEQ;
+        case ICmpSLT: return ICmpSGE;
+        case ICmpSGT: return ICmpSLE;
+        case ICmpSLE: return ICmpSGT;
+        default: return ICmpSLT;
+    }
+}
+
+bool getLoopBound(LoopPtr loop, LoopBound& bound)
+{
+    auto header = loop->getHeader();
+    auto preHeader = loop->getPreheader();
+    auto latch = loop->getLatchBlock();
+    if(!preHeader || !latch || header->predBasicBlocks.size() != 2)
+        return false;
+    for(auto bb : loop->getLoopBasicBlocks())
+    {
+        if(!bb->endInstruction || bb->endInstruction->type != Br)
+            return false;
+        if(bb != header)
+            for(auto succ : bb->getSuccessor())
+                if(!loop->contains(succ))
+                    return false;
+    }
+
+    auto br = dynamic_cast<BrInstruction *>(header->endInstruction.get());
+    if(!br->exp || !br->exp->I || br->exp->I->type != Icmp || br->exp->I->basicblock != header.get())
+        return false;
+    auto func = header->belongfunc;
+    auto trueBB = func->LabelBBMap[br->label_true];
+    auto falseBB = func->LabelBBMap[br->label_false];
+    if(loop->contains(trueBB) == loop->contains(falseBB))
+        return false;
+    auto icmp = (IcmpInstruction *)br->exp->I;
+    auto kind = icmp->kind;
+    ValuePtr ind = icmp->a, end = icmp->b;
+    if(!ind->I || ind->I->type != Phi)
+    {
+        swap(ind, end);
+        kind = swapKind(kind);
+    }
+    if(!ind->I || ind->I->type != Phi || ind->I->basicblock != header.get() || !ind->type->isInt()
+        || !end->type->isInt() || !loop->isSimpleLoopInvariant(end))
+        return false;
+    if(!loop->contains(trueBB))
+        kind = invertKind(kind);
+    bound.body = loop->contains(trueBB) ? trueBB : falseBB;
+    bound.exit = loop->contains(trueBB) ? falseBB : trueBB;
+
+    // latch传回的值是phi加减常量
+    auto phi = (PhiInstruction *)ind->I;
+    ValuePtr next;
+    bound.init = nullptr;
+    for(auto& [val, bb] : phi->from)
+    {
+        if(bb == preHeader)
+            bound.init = val;
+        else if(bb == latch)
+            next = val;
+    }
+    if(!bound.init || !next || !next->I || next->I->type != Binary)
+        return false;
+    auto binary = (BinaryInstruction *)next->I;
+    long long step;
+    if(binary->op == '+' && binary->a == ind && binary->b->isConst)
+        step = ((Const *)binary->b.get())->intVal;
+    else if(binary->op == '+' && binary->b == ind && binary->a->isConst)
+        step = ((Const *)binary->a.get())->intVal;
+    else if(binary->op == '-' && binary->a == ind && binary->b->isConst)
+        step = -(long long)((Const *)binary->b.get())->intVal;
+    else
+        return false;
+    if(step > INT32_MAX)
+        return false;
+    bound.step = step;
+
+    bound.indPhi = phi;
+    bound.end = end;
+    bound.kind = kind;
+    if(kind == ICmpSLT || kind == ICmpSLE)
+        return bound.step > 0;
+    if(kind == ICmpSGT || kind == ICmpSGE)
+        return bound.step < 0;
+    return false;
+}
+
+long long getConstTripCount(const LoopBound& bound)
+{
+    if(!bound.init->isConst || !bound.end->isConst)
+        return -1;
+    long long init = ((Const *)bound.init.get())->intVal;
+    long long end = ((Const *)bound.end.get())->intVal;
+    long long step = bound.step;
+    // 统一成 i < end，step > 0
+    if(bound.kind == ICmpSLE)
+        end++;
+    else if(bound.kind == ICmpSGT || bound.kind == ICmpSGE)
+    {
+        init = -init;
+        end = bound.kind == ICmpSGE ? -end + 1 : -end;
+        step = -step;
+    }
+    if(init >= end)
+        return 0;
+    long long count = (end - init + step - 1) / step;
+    // 最后一次加上step后跳出循环，这个值也要在int范围内，否则会回绕继续循环
+    long long last = init + count * step;
+    if(bound.kind == ICmpSGT || bound.kind == ICmpSGE)
+        last = -last;
+    if(last > INT32_MAX || last < INT32_MIN)
+        return -1;
+    return count;
+}
@@ -1,3 +1,4 @@
+#pragma once
 
 #include <iostream>
 #include <vector>
@@ -12,3 +13,19 @@
 
 void ScalarEvolution(LoopPtr loop);
 
+// 形如 for(i = init; i kind end; i += step) 的循环：只有header一个出口，
+// 比较已规范成“phi在左边、条件成立时继续循环”，kind为SLT/SLE时step>0，为SGT/SGE时step<0
+struct LoopBound {
+    PhiInstruction *indPhi;
+    ValuePtr init;
+    int step;
+    ValuePtr end;
+    IcmpKind kind;
+    // header跳进循环体和跳出循环的目标
+    BasicBlockPtr body, exit;
+};
+
+// 识别上述形式的循环，要求有preheader和唯一的latch，header的前驱只有这两个
+bool getLoopBound(LoopPtr loop, LoopBound& bound);
+// 初值和终值都是常量时循环体执行的次数，不确定（或迭代中归纳变量会溢出）时返回-1
+long long getConstTripCount(const LoopBound& bound);
@@ -0,0 +1,127 @@
+#include "analysisManager.h"
+#include "createCFG.h"
+#include "mem2reg.h"
+#include "computeUse.h"
+#include "loopAnalysis.h"
+
+AnalysisManager analysisManager;
+
+static const char* analysisName[AnalysisNum] = {"CFG", "Dom", "Use", "Loop"};
+
+// 计算某个分析之前需要有效的分析
+static unsigned prerequisites(AnalysisKind kind) {
+    switch(kind) {
+        case AnalysisDom:   return AnalysisCFG;
+        // SCEV需要遍历use链
+        case AnalysisLoop:  return AnalysisCFG | AnalysisDom | AnalysisUse;
+        default:            return AnalysisNone;
+    }
+}
+
+// 某个分析失效后需要一并失效的分析，use链与CFG、循环结构无关
+static unsigned dependents(AnalysisKind kind) {
+    switch(kind) {
+        case AnalysisCFG:   return AnalysisDom | AnalysisLoop;
+        case AnalysisDom:   return AnalysisLoop;
+        default:            return AnalysisNone;
+    }
+}
+
+// 函数的指令数与基本块数
+static void irSize(FunctionPtr func, long& instructions, long& blocks) {
+    blocks += func->basicBlocks.size();
+    for(auto bb: func->basicBlocks)
+        instructions += bb->instructions.size();
+}
+
+static void irSize(Module& ir, long& instructions, long& blocks) {
+    for(auto& func: ir.globalFunctions)
+        if(!func->isLib)
+            irSize(func, instructions, blocks);
+}
+
+// 运行pass，打开-time-passes/-stats时记录耗时和前后的IR规模
+template<typename Target, typename Body>
+static void timedRun(Target& target, const string& name, Body body) {
+    if(!passStats.enabled()) {
+        body();
+        return;
+    }
+    long insBefore = 0, blocksBefore = 0, insAfter = 0, blocksAfter = 0;
+    irSize(target, insBefore, blocksBefore);
+    PassTimer timer;
+    body();
+    double seconds = timer.seconds();
+    irSize(target, insAfter, blocksAfter);
+    passStats.record(name, seconds, insBefore, insAfter, blocksBefore, blocksAfter);
+}
+
+static void computeAnalysis(FunctionPtr func, AnalysisKind kind) {
+    switch(kind) {
+        case AnalysisCFG:   computeCFG(func); break;
+        case AnalysisDom:   domTree(func); break;
+        case AnalysisUse:   computeUse(func); break;
+        case AnalysisLoop:  loopAnalysis(func); break;
+        default:            assert(false && "unknown analysis");
+    }
+}
+
+// 分析的耗时单独列出，不算在需要它的pass上
+static void compute(FunctionPtr func, int i) {
+    timedRun(func, string("analysis:") + analysisName[i], [&] { computeAnalysis(func, (AnalysisKind)(1 << i)); });
+}
+
+unsigned& AnalysisManager::state(FunctionPtr func) {
+    // 插入可能引起rehash，但已有元素的引用不会失效
+    std::lock_guard<std::mutex> lock(mutex);
+    return valid[func];
+}
+
+void AnalysisManager::require(FunctionPtr func, unsigned analyses) {
+    // 按枚举顺序计算即满足依赖顺序
+    for(int i = 0; i < AnalysisNum; i++) {
+        auto kind = (AnalysisKind)(1 << i);
+        if(!(analyses & kind))
+            continue;
+        if(state(func) & kind) {
+            hits[i]++;
+            continue;
+        }
+        require(func, prerequisites(kind));
+        misses[i]++;
+        compute(func, i);
+        state(func) |= kind;
+    }
+}
+
+void AnalysisManager::invalidate(FunctionPtr func, unsigned analyses) {
+    for(int i = 0; i < AnalysisNum; i++) {
+        auto kind = (AnalysisKind)(1 << i);
+        if(analyses & kind)
+            analyses |= dependents(kind);
+    }
+    state(func) &= ~analyses;
+}
+
+void AnalysisManager::run(FunctionPtr func, void (*pass)(FunctionPtr), unsigned required, unsigned preserved, const char* name) {
+    require(func, required);
+    timedRun(func, name, [&] { pass(func); });
+    preserve(func, preserved);
+}
+
+void AnalysisManager::run(Module& ir, void (*pass)(Module&), unsigned required, unsigned preserved, const char* name) {
+    for(auto& func : ir.globalFunctions)
+        if(!func->isLib)
+            require(func, required);
+    timedRun(ir, name, [&] { pass(ir); });
+    for(auto& func : ir.globalFunctions)
+        if(!func->isLib)
+            preserve(func, preserved);
+}
+
+void AnalysisManager::reportStats() {
+    for(int i = 0; i < AnalysisNum; i++) {
+        passStats.add("analysisManager", string(analysisName[i]) + " reused", hits[i]);
+        passStats.add("analysisManager", string(analysisName[i]) + " computed", misses[i]);
+    }
+}
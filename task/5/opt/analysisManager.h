@@ -0,0 +1,58 @@
+#pragma once
+#include <iostream>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include "Module.h"
+#include "PassStats.h"
+
+// 函数级分析，按位组合成集合
+enum AnalysisKind {
+    // 前驱后继与LabelBBMap，computeCFG
+    AnalysisCFG = 1 << 0,
+    // 支配树、支配边界与支配树编号，domTree
+    AnalysisDom = 1 << 1,
+    // def-use链，由指令增量维护，computeUse只刷新指令所在块并可选校验
+    AnalysisUse = 1 << 2,
+    // 循环森林及其SCEV，loopAnalysis
+    AnalysisLoop = 1 << 3,
+    AnalysisNum = 4,
+};
+const unsigned AnalysisNone = 0;
+const unsigned AnalysisAll = (1 << AnalysisNum) - 1;
+
+// 缓存每个函数上哪些分析仍然有效，pass声明依赖和保持的分析，其余分析在pass结束后失效，
+// 需要时再惰性重算。不同函数上的分析可以在多个线程中同时维护
+struct AnalysisManager
+{
+    unordered_map<FunctionPtr, unsigned> valid;
+    // 需要时已有效的次数与实际计算的次数
+    std::atomic<int> hits[AnalysisNum] = {};
+    std::atomic<int> misses[AnalysisNum] = {};
+
+    // 保证func上analyses中的分析有效，会先补齐它们依赖的分析
+    void require(FunctionPtr func, unsigned analyses);
+    // 使func上的analyses失效，依赖它们的分析一并失效
+    void invalidate(FunctionPtr func, unsigned analyses);
+    // pass结束后只保留preserved中的分析
+    void preserve(FunctionPtr func, unsigned preserved)     { invalidate(func, AnalysisAll & ~preserved); }
+    // 运行函数级pass，name用于-time-passes/-stats
+    void run(FunctionPtr func, void (*pass)(FunctionPtr), unsigned required, unsigned preserved, const char* name);
+    // 运行模块级pass，对所有非库函数生效
+    void run(Module& ir, void (*pass)(Module&), unsigned required, unsigned preserved, const char* name);
+    // 清空缓存，例如IR被整体替换之后
+    void clear()                                            { valid.clear(); }
+    // 把命中/重算次数加到-stats的计数中
+    void reportStats();
+
+private:
+    // func上仍然有效的分析，只有处理该函数的线程会读写
+    unsigned& state(FunctionPtr func);
+    std::mutex mutex;
+};
+
+// 优化流水线共用的分析管理器，pass中途改动了声明保持的分析时可直接调用invalidate
+extern AnalysisManager analysisManager;
+
+// 按XRequires/XPreserves的命名约定运行pass X，target为函数或模块
+#define RUN_PASS(am, target, pass) (am).run(target, pass, pass##Requires, pass##Preserves, #pass)
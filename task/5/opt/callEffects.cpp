@@ -0,0 +1,211 @@
+#include "callEffects.h"
+#include "callGraph.h"
+
+// 在并行优化各函数之前统一计算，之后只读，各线程不再去遍历正在被其他线程修改的函数体
+static std::unordered_map<Function *, FunctionEffects> functionEffects;
+
+static bool anyOf(const vector<bool>& flags) {
+    for(auto flag: flags)
+        if(flag)
+            return true;
+    return false;
+}
+
+static bool flagAt(const vector<bool>& flags, int i) {
+    return i < flags.size() && flags[i];
+}
+
+bool FunctionEffects::readsMemory() const {
+    return unknownRead || !globalsRead.empty() || anyOf(argsRead);
+}
+
+bool FunctionEffects::writesMemory() const {
+    return unknownWritten || !globalsWritten.empty() || anyOf(argsWritten);
+}
+
+static bool sameEffects(const FunctionEffects& a, const FunctionEffects& b) {
+    return a.globalsRead == b.globalsRead && a.globalsWritten == b.globalsWritten
+        && a.argsRead == b.argsRead && a.argsWritten == b.argsWritten
+        && a.unknownRead == b.unknownRead && a.unknownWritten == b.unknownWritten
+        && a.io == b.io && a.recursive == b.recursive;
+}
+
+const FunctionEffects& getFunctionEffects(Function *func) {
+    static const FunctionEffects worst = [] {
+        FunctionEffects effects;
+        effects.unknownRead = effects.unknownWritten = effects.io = effects.recursive = true;
+        return effects;
+    }();
+    auto it = functionEffects.find(func);
+    return it == functionEffects.end() ? worst : it->second;
+}
+
+Value *getMemoryBase(Value *addr) {
+    while(addr->I) {
+        if(addr->I->type == GEP)
+            addr = ((GetElementPtrInstruction *)addr->I)->from.get();
+        else if(addr->I->type == Bitcast)
+            addr = ((BitCastInstruction *)addr->I)->from.get();
+        else
+            break;
+    }
+    return addr;
+}
+
+static bool isGlobalBase(Value *base) {
+    auto var = dynamic_cast<Variable *>(base);
+    return var && var->isGlobal;
+}
+
+static bool isLocalBase(Value *base) {
+    return base->I && base->I->type == Alloca;
+}
+
+// 库函数：memset/memcpy和数组输入输出会读写指针实参，其余只做输入输出
+static FunctionEffects libEffects(Function *func) {
+    FunctionEffects effects;
+    int n = func->formArguments.size();
+    effects.argsRead.assign(n, false);
+    effects.argsWritten.assign(n, false);
+    auto& name = func->name;
+    if(name.rfind("llvm.memset", 0) == 0)
+        effects.argsWritten[0] = true;
+    else if(name.rfind("llvm.memcpy", 0) == 0) {
+        effects.argsWritten[0] = true;
+        effects.argsRead[1] = true;
+    }
+    else if(name == "getarray" || name == "getfarray") {
+        effects.io = true;
+        effects.argsWritten[0] = true;
+    }
+    else if(name == "putarray" || name == "putfarray") {
+        effects.io = true;
+        effects.argsRead[1] = true;
+    }
+    else
+        effects.io = true;
+    return effects;
+}
+
+// 按当前已知的被调函数摘要重新计算func的摘要
+static FunctionEffects scanFunction(Function *func) {
+    FunctionEffects effects;
+    int n = func->formArguments.size();
+    effects.argsRead.assign(n, false);
+    effects.argsWritten.assign(n, false);
+    effects.recursive = getFunctionEffects(func).recursive;
+    unordered_map<Value *, int> argIndex;
+    for(int i = 0; i < n; i++)
+        argIndex[func->formArguments[i].get()] = i;
+
+    auto access = [&](Value *addr, bool write) {
+        auto base = getMemoryBase(addr);
+        if(isGlobalBase(base))
+            (write ? effects.globalsWritten : effects.globalsRead).insert(base);
+        else if(isLocalBase(base))
+            return;
+        else if(argIndex.count(base))
+            (write ? effects.argsWritten : effects.argsRead)[argIndex[base]] = true;
+        else
+            (write ? effects.unknownWritten : effects.unknownRead) = true;
+    };
+    for(auto& bb: func->basicBlocks) {
+        for(auto& instr: bb->instructions) {
+            if(instr->type == Load)
+                access(((LoadInstruction *)instr.get())->from.get(), false);
+            else if(instr->type == Store)
+                access(((StoreInstruction *)instr.get())->des.get(), true);
+            else if(instr->type == Call) {
+                auto call = (CallInstruction *)instr.get();
+                auto& callee = getFunctionEffects(call->func.get());
+                effects.globalsRead.insert(callee.globalsRead.begin(), callee.globalsRead.end());
+                effects.globalsWritten.insert(callee.globalsWritten.begin(), callee.globalsWritten.end());
+                effects.unknownRead |= callee.unknownRead;
+                effects.unknownWritten |= callee.unknownWritten;
+                effects.io |= callee.io;
+                // 被调函数对指针形参的读写落到实参的基址上
+                for(int i = 0; i < call->argv.size(); i++) {
+                    if(flagAt(callee.argsRead, i))
+                        access(call->argv[i].get(), false);
+                    if(flagAt(callee.argsWritten, i))
+                        access(call->argv[i].get(), true);
+                }
+            }
+        }
+    }
+    return effects;
+}
+
+void computeCallEffects(Module& ir) {
+    functionEffects.clear();
+    vector<Function *> funcs;
+    for(auto& func: ir.globalFunctions) {
+        if(func->isLib)
+            functionEffects[func.get()] = libEffects(func.get());
+        else
+            funcs.push_back(func.get());
+    }
+
+    // 自底向上处理调用图的强连通分量，分量内的函数先从空摘要开始，反复计算直到不再变化
+    for(auto& scc: callGraphSCCs(ir)) {
+        bool recursive = isRecursiveSCC(scc);
+        for(auto g: scc) {
+            functionEffects[g] = FunctionEffects();
+            functionEffects[g].recursive = recursive;
+        }
+        for(bool changed = true; changed;) {
+            changed = false;
+            for(auto g: scc) {
+                auto effects = scanFunction(g);
+                if(!sameEffects(effects, functionEffects[g])) {
+                    functionEffects[g] = effects;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for(auto f: funcs) {
+        auto& effects = functionEffects[f];
+        if(effects.isPure())
+            passStats.add("computeCallEffects", "pure functions");
+        else if(effects.isReadOnly())
+            passStats.add("computeCallEffects", "readonly functions");
+    }
+}
+
+// 可能与base指向同一块内存的实参：基址相同，或基址来历不明（可能指向任何全局数组）
+static bool argMayAlias(Value *arg, Value *base) {
+    auto argBase = getMemoryBase(arg);
+    return argBase == base || (!isGlobalBase(argBase) && !isLocalBase(argBase));
+}
+
+static bool callMayAccess(CallInstruction *call, Value *base, bool write) {
+    auto& effects = getFunctionEffects(call->func.get());
+    if(write ? effects.unknownWritten : effects.unknownRead)
+        return true;
+    auto& globals = write ? effects.globalsWritten : effects.globalsRead;
+    auto& args = write ? effects.argsWritten : effects.argsRead;
+    // base本身来历不明时，被调函数访问的任何内存都可能是它
+    if(!isGlobalBase(base) && !isLocalBase(base))
+        return !globals.empty() || anyOf(args);
+    if(globals.count(base))
+        return true;
+    for(int i = 0; i < call->argv.size(); i++)
+        if(flagAt(args, i) && argMayAlias(call->argv[i].get(), base))
+            return true;
+    return false;
+}
+
+bool callMayModify(CallInstruction *call, Value *base) {
+    return callMayAccess(call, base, true);
+}
+
+bool callMayRef(CallInstruction *call, Value *base) {
+    return callMayAccess(call, base, false);
+}
+
+bool isCallIdempotent(CallInstruction *ins) {
+    auto& effects = getFunctionEffects(ins->func.get());
+    return effects.isPure() && !effects.recursive;
+}
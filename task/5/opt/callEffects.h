@@ -0,0 +1,42 @@
+#pragma once
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Module.h"
+#include "analysisManager.h"
+
+// 函数的副作用摘要（mod/ref），由computeCallEffects沿调用图自底向上计算
+struct FunctionEffects {
+    // 读写的全局变量，经gep访问全局数组时记录数组本身
+    unordered_set<Value *> globalsRead, globalsWritten;
+    // 各形参指向的内存是否被读写，只对指针形参有意义
+    vector<bool> argsRead, argsWritten;
+    // 访问了基址无法确定的内存
+    bool unknownRead = false, unknownWritten = false;
+    // 做了输入输出
+    bool io = false;
+    // 处在调用图的环上（直接或间接递归）
+    bool recursive = false;
+
+    bool readsMemory() const;
+    bool writesMemory() const;
+    // 不写内存、不做输入输出，结果只取决于参数和读到的内存
+    bool isReadOnly() const { return !io && !writesMemory(); }
+    // 在isReadOnly的基础上也不读内存，结果只取决于参数
+    bool isPure() const { return isReadOnly() && !readsMemory(); }
+};
+
+// 计算各函数的摘要，之后各pass只读这里的结果，需要在并行优化各函数之前运行
+void computeCallEffects(Module& ir);
+const unsigned computeCallEffectsRequires = AnalysisNone;
+const unsigned computeCallEffectsPreserves = AnalysisAll;
+
+// 没有摘要的函数按最坏情况处理
+const FunctionEffects& getFunctionEffects(Function *func);
+// 地址去掉gep和bitcast之后的基址
+Value *getMemoryBase(Value *addr);
+// 调用是否可能写/读基址为base的内存，base是调用者中的值
+bool callMayModify(CallInstruction *call, Value *base);
+bool callMayRef(CallInstruction *call, Value *base);
+// 被调函数不读写内存、不做输入输出且不递归，调用可以删除、合并或外提
+bool isCallIdempotent(CallInstruction *ins);
@@ -0,0 +1,68 @@
+#include "callGraph.h"
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+vector<Function *> directCallees(Function *func) {
+    vector<Function *> callees;
+    for(auto& bb: func->basicBlocks)
+        for(auto& instr: bb->instructions)
+            if(instr->type == Call && !((CallInstruction *)instr.get())->func->isLib)
+                callees.push_back(((CallInstruction *)instr.get())->func.get());
+    return callees;
+}
+
+vector<vector<Function *>> callGraphSCCs(Module& ir) {
+    vector<Function *> funcs;
+    unordered_map<Function *, vector<Function *>> callees;
+    for(auto& func: ir.globalFunctions) {
+        if(func->isLib)
+            continue;
+        funcs.push_back(func.get());
+        callees[func.get()] = directCallees(func.get());
+    }
+
+    // 分量按被调者在前的顺序产生，正好自底向上
+    vector<vector<Function *>> sccs;
+    unordered_map<Function *, int> index, low;
+    unordered_set<Function *> onStack;
+    vector<Function *> stack;
+    int counter = 0;
+    std::function<void(Function *)> strongConnect = [&](Function *f) {
+        index[f] = low[f] = counter++;
+        stack.push_back(f);
+        onStack.insert(f);
+        for(auto g: callees[f]) {
+            if(!index.count(g)) {
+                strongConnect(g);
+                low[f] = std::min(low[f], low[g]);
+            }
+            else if(onStack.count(g))
+                low[f] = std::min(low[f], index[g]);
+        }
+        if(low[f] != index[f])
+            return;
+        vector<Function *> scc;
+        Function *g;
+        do {
+            g = stack.back();
+            stack.pop_back();
+            onStack.erase(g);
+            scc.push_back(g);
+        } while(g != f);
+        sccs.push_back(scc);
+    };
+    for(auto f: funcs)
+        if(!index.count(f))
+            strongConnect(f);
+    return sccs;
+}
+
+bool isRecursiveSCC(const vector<Function *>& scc) {
+    if(scc.size() > 1)
+        return true;
+    for(auto g: directCallees(scc[0]))
+        if(g == scc[0])
+            return true;
+    return false;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <vector>
+#include "Module.h"
+
+// 函数中调用的非库函数，按出现的顺序，每个调用点一项
+vector<Function *> directCallees(Function *func);
+// 调用图的强连通分量（Tarjan），只含非库函数；被调者所在的分量排在前面，即自底向上的顺序，
+// 分量之间和分量内部的顺序只取决于ir.globalFunctions的顺序
+vector<vector<Function *>> callGraphSCCs(Module& ir);
+// 函数处在调用图的环上（直接或间接递归），scc为它所在的分量
+bool isRecursiveSCC(const vector<Function *>& scc);
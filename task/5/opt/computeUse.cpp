@@ -1,36 +1,85 @@
 #include "computeUse.h"
+#include <unordered_set>
+#include <cstdlib>
 
 bool hasUser(InsID id) {
     return !(id == Return || id == Br || id == Store || id == Call);
 }
 
-void computeUse(FunctionPtr func) {
-    // delete all use
-    for(auto arg: func->formArguments) {
-        arg->useHead = nullptr;
-    }
+// 统计value的use链表中user的出现次数
+static unordered_map<Instruction*, int> countUsers(Value *value) {
+    unordered_map<Instruction*, int> users;
+    for(Use *use = value->useHead; use; use = use->next)
+        users[use->user]++;
+    return users;
+}
+
+bool verifyUse(FunctionPtr func) {
+    bool ok = true;
+    unordered_set<Instruction*> live;
+    vector<ValuePtr> values(func->formArguments.begin(), func->formArguments.end());
     for(auto bb: func->basicBlocks) {
         for(auto instr: bb->instructions) {
+            live.insert(instr.get());
             if(instr->reg)
-                instr->reg->useHead = nullptr;
+                values.push_back(instr->reg);
+        }
+    }
+
+    // 每个寄存器/形参的use链表和函数内实际的操作数一一对应
+    for(auto value: values) {
+        unordered_map<Instruction*, int> expect;
+        for(auto bb: func->basicBlocks) {
+            for(auto instr: bb->instructions) {
+                if(instr->type == Alloca)
+                    continue;
+                for(int i = 0; i < instr->getNumOperands(); i ++)
+                    if(instr->getOperand(i) == value)
+                        expect[instr.get()]++;
+            }
+        }
+        auto actual = countUsers(value.get());
+        int numUses = 0;
+        for(auto& [user, cnt]: actual) {
+            numUses += cnt;
+            if(!live.count(user)) {
+                cerr << "[verifyUse] " << func->name << ": %" << value->name << " is used by a removed instruction" << endl;
+                ok = false;
+            } else if(expect[user] != cnt) {
+                cerr << "[verifyUse] " << func->name << ": %" << value->name << " use count mismatch (" << cnt << " in list, " << expect[user] << " in operands)" << endl;
+                ok = false;
+            }
+        }
+        for(auto& [user, cnt]: expect) {
+            // replaceVarByVar之后原定义指令已经摘掉了对操作数的use，留给dce删除
+            if(user->reg && !user->reg->useHead && hasUser(user->type))
+                continue;
+            if(!actual.count(user)) {
+                cerr << "[verifyUse] " << func->name << ": %" << value->name << " missing use" << endl;
+                ok = false;
+            }
+        }
+        if(numUses != value->numUses) {
+            cerr << "[verifyUse] " << func->name << ": %" << value->name << " numUses out of sync" << endl;
+            ok = false;
         }
     }
+    return ok;
+}
 
-    // create new use
+// use链由指令的构造、replaceVarByVar、deleteSelfInBB等增量维护，这里不再重建，
+// 只刷新指令所在块和寄存器的定义指令；定义VERIFY_USE时顺带检查use链是否准确
+void computeUse(FunctionPtr func) {
     for(auto bb: func->basicBlocks) {
         for(auto instr: bb->instructions) {
-            instr->basicblock = bb;
+            instr->basicblock = bb.get();
             if(instr->reg)
                 instr->reg->I = instr.get();
-            int numOperand = instr->getNumOperands();
-            if(instr->type == Alloca)
-                continue;
-            for(int i = 0; i < numOperand; i ++) {
-                if(hasUser(instr->type))
-                    newUse(instr->getOperand(i).get(), instr.get(), instr->reg.get());
-                else
-                    newUse(instr->getOperand(i).get(), instr.get());
-            }
         }
     }
+#ifdef VERIFY_USE
+    // 不依赖assert，定义了NDEBUG的构建里也生效
+    if(!verifyUse(func))
+        abort();
+#endif
 }
@@ -4,5 +4,10 @@
 #include "Function.h"
 #include "Instruction.h"
 
+// 编译时定义VERIFY_USE（-DVERIFY_USE，或构建task5-classic-verify）时，computeUse会用verifyUse
+// 检查增量维护的use链；检查与指令数成平方，默认构建不开
+
 bool hasUser(InsID id);
+// 检查函数内寄存器和形参的use链与指令操作数是否一致，不一致时输出到cerr
+bool verifyUse(FunctionPtr func);
 void computeUse(FunctionPtr func);
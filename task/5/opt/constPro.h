@@ -1,9 +0,0 @@
-#pragma once
-#include <iostream>
-#include <vector>
-#include <set>
-#include <queue>
-#include "Module.h"
-#include "createCFG.h"
-
-void constPropogation(FunctionPtr func);
\ No newline at end of file
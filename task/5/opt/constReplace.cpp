@@ -131,6 +131,7 @@ void globalConstReplace(Module &ir)
             while (p != nullptr)
             {
                 auto user = p->user;
+                auto tem = p->next;
                 if (user->type == InsID::Load)
                 {
                     auto loadIns = dynamic_cast<LoadInstruction *>(user);
@@ -138,17 +139,16 @@ void globalConstReplace(Module &ir)
                     //replaceVarByVar remove use
                     replaceVarByVar(reg, constVal);
                     // cerr<<var->getTypeStr()<<endl;
+                    //deleteSelfInBB会摘掉p
                     user->deleteSelfInBB();
                 }
                 else
                 {
                     cerr << "not load global replace" << endl;
-                    //replaceValue donot remove use
+                    //replaceValue只改操作数，use直接挂到constVal上
                     user->replaceValue(var, constVal);
+                    p->set(constVal.get());
                 }
-                auto tem = p->next;
-            
-                p->rmUse();
                 p = tem;
             }
         }
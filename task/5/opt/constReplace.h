@@ -1,4 +1,7 @@
 #pragma once
 #include "Module.h"
+#include "analysisManager.h"
 
-void globalConstReplace(Module& ir);
\ No newline at end of file
+void globalConstReplace(Module& ir);
+const unsigned globalConstReplaceRequires = AnalysisUse;
+const unsigned globalConstReplacePreserves = AnalysisCFG | AnalysisDom | AnalysisLoop | AnalysisUse;
@@ -0,0 +1,208 @@
+#include "copyInstruction.h"
+
+
+//copy个Value
+VariablePtr copyVariable(VariablePtr old){
+    //arr的inner就不要了，因为在局部变量中其会转换成gep和store指令，所以可以在后续获得
+    //intval floatval也都不要了，其以store、load指令存在，variable其实不应该有这几个量存在
+    VariablePtr ret = Variable::copy(old);
+    //清除use，这些use会在之后copy指令的过程中重新建立
+    ret->name = ret->name+".copy";
+    ret->useHead = nullptr;
+    ret->numUses = 0;
+    return ret;
+}
+
+
+ValuePtr getNewOperand(ValuePtr old, unordered_map<ValuePtr, ValuePtr>&ValueMap){
+    //const use same pointer
+    if(old->isConst){
+        return old;
+    }
+    if(ValueMap.find(old) == ValueMap.end()){
+        //打个补丁，phi中可能会用到
+        if(!dynamic_pointer_cast<Variable>(old)){
+            ValueMap[old] =  newIR<Reg>(old->type,old->name);
+            return ValueMap[old];
+        }
+        ValueMap[old] = copyVariable(dynamic_pointer_cast<Variable>(old));
+    }
+    return ValueMap[old];
+}
+
+
+
+InstructionPtr copyInstruction(InstructionPtr old, unordered_map<ValuePtr,ValuePtr>&ValueMap,
+                                        unordered_map<BasicBlockPtr,BasicBlockPtr>&BBMap,
+                                        unordered_map<LabelPtr,LabelPtr>&LabelMap){
+    
+    if(old->type == Return){
+        ReturnInstruction* RI = dynamic_cast<ReturnInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<ReturnInstruction>(getNewOperand(RI->retValue,ValueMap),nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Br){
+        BrInstruction* RI = dynamic_cast<BrInstruction*>(old.get());
+        if(RI->exp){
+            //这里的label使用label获得，其实block里有labelbbmap，但实在是太麻烦了，就算了。
+            InstructionPtr ret =  newIR<BrInstruction>(getNewOperand(RI->exp,ValueMap),LabelMap[RI->label_true],LabelMap[RI->label_false],nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;
+        }
+        else{
+            InstructionPtr ret =  newIR<BrInstruction>(LabelMap[RI->label_true],nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;
+        }
+    }
+    else if(old->type == Alloca){
+        AllocaInstruction* RI = dynamic_cast<AllocaInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<AllocaInstruction>(getNewOperand(RI->des,ValueMap),nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Store){
+        StoreInstruction* RI = dynamic_cast<StoreInstruction*>(old.get());
+        if(RI->gep){
+            GetElementPtrInstruction* newGEP = dynamic_cast<GetElementPtrInstruction*>((ValueMap[RI->gep->reg])->I);
+            InstructionPtr ret =  newIR<StoreInstruction>(dynamic_pointer_cast<GetElementPtrInstruction>(newGEP->getSharedThis()), getNewOperand(RI->value,ValueMap),nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;  
+        }
+        else{
+            InstructionPtr ret =  newIR<StoreInstruction>(getNewOperand(RI->des,ValueMap),getNewOperand(RI->value,ValueMap),nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;   
+        }
+    }
+    else if(old->type == Load){
+        LoadInstruction* RI = dynamic_cast<LoadInstruction*>(old.get());
+        if(RI->from->type->isPtr()){
+            InstructionPtr ret =  newIR<LoadInstruction>(getNewOperand(RI->from, ValueMap), getNewOperand(RI->to,ValueMap),nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;  
+        }
+        else{
+            InstructionPtr ret =  newIR<LoadInstruction>(getNewOperand(RI->from,ValueMap),getNewOperand(RI->to,ValueMap),nullptr);
+            //供后续阶段使用
+            ValueMap[old->reg] = ret->reg;
+            return ret;   
+        }
+    }
+    else if(old->type == Call){
+        CallInstruction* RI = dynamic_cast<CallInstruction*>(old.get());
+        vector<ValuePtr> newArgv;
+        for(int i = 0;i<RI->argv.size();i++){
+            newArgv.push_back(getNewOperand(RI->argv[i],ValueMap));
+        }
+        InstructionPtr ret =  newIR<CallInstruction>(RI->func, newArgv, nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Bitcast){
+        BitCastInstruction* RI = dynamic_cast<BitCastInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<BitCastInstruction>(getNewOperand(RI->from, ValueMap), getNewOperand(RI->reg, ValueMap),nullptr, RI->toType);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Ext){
+        ExtInstruction* RI = dynamic_cast<ExtInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<ExtInstruction>(getNewOperand(RI->from, ValueMap), RI->to,RI->isign,nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Sitofp){
+        SitofpInstruction* RI = dynamic_cast<SitofpInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<SitofpInstruction>(getNewOperand(RI->from, ValueMap), nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Fptosi){
+        FptosiInstruction* RI = dynamic_cast<FptosiInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<FptosiInstruction>(getNewOperand(RI->from, ValueMap), nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == GEP){
+        GetElementPtrInstruction* RI = dynamic_cast<GetElementPtrInstruction*>(old.get());
+        vector<ValuePtr> newIndex;
+        for(auto oldInd:RI->index){
+            newIndex.push_back(getNewOperand(oldInd,ValueMap));
+        }
+        auto newFrom = getNewOperand(RI->from,ValueMap);
+       
+        InstructionPtr ret =  newIR<GetElementPtrInstruction>(getNewOperand(RI->from,ValueMap),newIndex,nullptr);
+         if(RI->from->type->isPtr()){
+            ret->reg->type = dynamic_cast<PtrType*>(RI->from->type.get())->inner;
+        }
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Binary){
+        BinaryInstruction* RI = dynamic_cast<BinaryInstruction*>(old.get());
+
+
+        InstructionPtr ret =  newIR<BinaryInstruction>(getNewOperand(RI->a, ValueMap),getNewOperand(RI->b, ValueMap),RI->op, BasicBlockPtr(nullptr));
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Fneg){
+        FnegInstruction* RI = dynamic_cast<FnegInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<FnegInstruction>(getNewOperand(RI->a, ValueMap), nullptr);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Icmp){
+        IcmpInstruction* RI = dynamic_cast<IcmpInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<IcmpInstruction>(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Fcmp){
+        FcmpInstruction* RI = dynamic_cast<FcmpInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<FcmpInstruction>(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op);
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else if(old->type == Phi){
+        PhiInstruction* RI = dynamic_cast<PhiInstruction*>(old.get());
+
+        InstructionPtr ret =  newIR<PhiInstruction>(nullptr, getNewOperand(RI->val, ValueMap));
+        //第二项参数实际上不需要了，后面直接能找到对应项，第二项参数留着会导致一个bug，即如果该phi是由后面用于替代return产生的，那么这个val就是call
+        //而call不是变量，copy时出现错误
+        // auto ret =  InstructionPtr(new PhiInstruction(nullptr, RI->val));
+        //供后续阶段使用
+        ValueMap[old->reg] = ret->reg;
+        return ret;
+    }
+    else{
+        assert(false&&"unknown Inst type");
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <unordered_map>
+#include "Module.h"
+
+using namespace std;
+
+// 内联和循环展开共用的指令复制。ValueMap记录原值到副本的映射，复制出的指令的结果也登记进去；
+// 常量原样使用，没登记过的寄存器先占一个新寄存器（phi可能先用后定义），变量复制一份。
+// 复制的指令不属于任何基本块，phi的incoming要等所有块复制完后再补上
+
+VariablePtr copyVariable(VariablePtr old);
+ValuePtr getNewOperand(ValuePtr old, unordered_map<ValuePtr, ValuePtr>&ValueMap);
+// 跳转目标按LabelMap换成副本的标签
+InstructionPtr copyInstruction(InstructionPtr old, unordered_map<ValuePtr,ValuePtr>&ValueMap,
+                                        unordered_map<BasicBlockPtr,BasicBlockPtr>&BBMap,
+                                        unordered_map<LabelPtr,LabelPtr>&LabelMap);
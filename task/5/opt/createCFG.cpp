@@ -6,8 +6,9 @@ void addEdgeInCFG(shared_ptr<BasicBlock> pred,shared_ptr<BasicBlock> succ){
         return;
     }
     assert(succ != nullptr && pred != nullptr);
-    succ->addPredBasicBlock(pred);
-    pred->addSuccBasicBlock(succ);
+    // pred的后继里没有succ，succ的前驱里也就没有pred；前驱可能很多（内联后的返回块），不再线性查重
+    succ->predBasicBlocks.push_back(pred);
+    pred->succBasicBlocks.push_back(succ);
 }
 
 
@@ -30,4 +31,141 @@ void computeCFG(FunctionPtr func) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void removeEdgeInCFG(BasicBlockPtr pred, BasicBlockPtr succ){
+    pred->deleteSuccBasicBlock(succ);
+    succ->deletePredBasicBlock(pred);
+}
+
+// phi的两项incoming是否为同一个值，常量按值比较
+static bool sameIncoming(const ValuePtr& a, const ValuePtr& b){
+    if(a == b)
+        return true;
+    auto ca = dynamic_cast<Const*>(a.get()), cb = dynamic_cast<Const*>(b.get());
+    return ca && cb && ca->type == cb->type && ca->getStr() == cb->getStr();
+}
+
+void moveSuccessorsInCFG(BasicBlockPtr from, BasicBlockPtr to){
+    for(auto& succ:from->succBasicBlocks){
+        bool merge = succ->predBasicBlocks.count(to);
+        // 原地替换，保持succ的前驱顺序
+        if(merge)
+            succ->deletePredBasicBlock(from);
+        else
+            succ->predBasicBlocks.replace(from, to);
+        for(auto& I:succ->instructions){
+            if(I->type != Phi)
+                break;
+            auto phi = dynamic_cast<PhiInstruction*>(I.get());
+            if(merge){
+                // succ已有来自to的incoming，来自from的一项是重复的，删掉
+                ValuePtr fromVal = nullptr, toVal = nullptr;
+                for(auto& f:phi->from){
+                    if(f.second == from) fromVal = f.first;
+                    if(f.second == to) toVal = f.first;
+                }
+                if(fromVal){
+                    assert(toVal && sameIncoming(fromVal, toVal) && "conflicting phi incoming when merging edges");
+                    phi->removeIncomingByBB(from);
+                }
+                continue;
+            }
+            for(auto& f:phi->from){
+                if(f.second == from)
+                    f.second = to;
+            }
+        }
+        to->addSuccBasicBlock(succ);
+    }
+    from->succBasicBlocks.clear();
+}
+
+void addBlockInCFG(FunctionPtr func, BasicBlockPtr bb){
+    func->LabelBBMap[bb->label] = bb;
+}
+
+void removeBlockInCFG(FunctionPtr func, BasicBlockPtr bb){
+    for(auto& succ:bb->succBasicBlocks)
+        succ->deletePredBasicBlock(bb);
+    for(auto& pred:bb->predBasicBlocks)
+        pred->deleteSuccBasicBlock(bb);
+    bb->succBasicBlocks.clear();
+    bb->predBasicBlocks.clear();
+    func->LabelBBMap.erase(bb->label);
+}
+
+void mergeBlockIntoPred(FunctionPtr func, BasicBlockPtr pred, BasicBlockPtr bb){
+    assert(pred != bb && pred->succBasicBlocks.size()==1 && bb->predBasicBlocks.size()==1);
+    //去掉pred结尾的跳转，接上bb的指令
+    pred->instructions.pop_back();
+    for(auto& I:bb->instructions)
+        I->basicblock = pred.get();
+    pred->instructions.splice(pred->instructions.end(), bb->instructions, bb->instructions.begin(), bb->instructions.end());
+    pred->endInstruction = bb->endInstruction;
+
+    removeEdgeInCFG(pred, bb);
+    moveSuccessorsInCFG(bb, pred);
+    func->LabelBBMap.erase(bb->label);
+
+    //bb唯一的前驱是pred，所以idom(bb)=pred，bb在支配树上的子节点改挂到pred下
+    //pred的唯一后继是bb，被pred严格支配的块都被bb支配，所以DF(pred)=DF(pred)∪DF(bb)-{bb}
+    //bb的先序/后序区间嵌在pred的区间里，删掉bb不影响其他块的编号
+    if(bb->directDominator == pred){
+        pred->deleteDominatorSon(bb);
+        for(auto& son:bb->dominatorSon){
+            son->setDirectDominator(pred);
+            pred->addDominatorSon(son);
+        }
+        pred->DF.unite(bb->DF);
+        pred->deleteDF(bb);
+        bb->dominatorSon.clear();
+        bb->DF.clear();
+        bb->setDirectDominator(nullptr);
+        bb->domPreIdx = bb->domPostIdx = -1;
+    }
+}
+
+bool verifyCFG(FunctionPtr func){
+    bool ok = true;
+    unordered_map<LabelPtr, BasicBlockPtr> labelMap;
+    for(auto& bb:func->basicBlocks)
+        labelMap[bb->label] = bb;
+    //按跳转指令求出每个块应有的后继
+    unordered_map<BasicBlockPtr, BasicBlockSet> succs, preds;
+    for(auto& bb:func->basicBlocks){
+        if(bb->instructions.empty() || bb->instructions.back()->type != Br)
+            continue;
+        auto br = dynamic_cast<BrInstruction*>(bb->instructions.back().get());
+        for(auto label:{br->label_true, br->label_false}){
+            if(!label)
+                continue;
+            auto succ = labelMap[label];
+            succs[bb].insert(succ);
+            preds[succ].insert(bb);
+        }
+    }
+    auto sameSet = [](const BasicBlockSet& a, const BasicBlockSet& b){
+        if(a.size() != b.size())
+            return false;
+        for(auto& x:a)
+            if(!b.count(x))
+                return false;
+        return true;
+    };
+    for(auto& bb:func->basicBlocks){
+        if(!sameSet(bb->succBasicBlocks, succs[bb])){
+            cerr<<"verifyCFG: succ mismatch at "<<bb->label->name<<endl;
+            ok = false;
+        }
+        if(!sameSet(bb->predBasicBlocks, preds[bb])){
+            cerr<<"verifyCFG: pred mismatch at "<<bb->label->name<<endl;
+            ok = false;
+        }
+        if(func->LabelBBMap[bb->label] != bb){
+            cerr<<"verifyCFG: LabelBBMap mismatch at "<<bb->label->name<<endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -2,6 +2,25 @@
 #include "BasicBlock.h"
 #include "Instruction.h"
 #include "Function.h"
+#include <cstdlib>
+
+// 编译时定义VERIFY_CFG（-DVERIFY_CFG，或构建task5-classic-verify）时，增量维护CFG的pass结束时
+// 会用verifyCFG与整体重建的结果比对，不一致则abort；每次都整体重建，默认构建不开
 
 void addEdgeInCFG(shared_ptr<BasicBlock> pred,shared_ptr<BasicBlock> next);
 void computeCFG(FunctionPtr func);
+
+// 增量维护CFG，修改跳转指令的pass直接调用这些接口，不再整体重建
+// 删除pred到succ的边
+void removeEdgeInCFG(BasicBlockPtr pred, BasicBlockPtr succ);
+// 把from的出边全部转给to，后继phi中来自from的incoming改为to，用于在块尾分裂出新块
+// 若to已是某个后继的前驱，phi中来自from和to的两项必须是同一个值，合并为来自to的一项
+void moveSuccessorsInCFG(BasicBlockPtr from, BasicBlockPtr to);
+// 把新建的基本块登记到函数的LabelBBMap
+void addBlockInCFG(FunctionPtr func, BasicBlockPtr bb);
+// 从CFG中摘除bb的所有进出边和LabelBBMap项，不修改func->basicBlocks，也不处理phi
+void removeBlockInCFG(FunctionPtr func, BasicBlockPtr bb);
+// 把bb合并到唯一前驱pred中（pred无条件跳转到bb），支配树有效时同步更新，不修改func->basicBlocks
+void mergeBlockIntoPred(FunctionPtr func, BasicBlockPtr pred, BasicBlockPtr bb);
+// 校验当前CFG与按跳转指令整体重建的结果是否一致，不一致时输出差异
+bool verifyCFG(FunctionPtr func);
@@ -163,14 +163,17 @@ void dce(FunctionPtr func){
             findDeadCode(ins.get(),del);
         }
     }
-    vector<InstructionPtr> newIns;
+    long removed = 0;
     for(auto& bb:(func->basicBlocks)){
-        newIns.clear();
-        for(auto ins:(bb->instructions)){
-            if(del.find(ins.get())==del.end()){
-                newIns.emplace_back(ins);
+        for(auto it = bb->instructions.begin();it!=bb->instructions.end();){
+            if(del.find(it->get())==del.end()){
+                it++;
+            }
+            else{
+                it = bb->instructions.erase(it);
+                removed++;
             }
         }
-        bb->instructions = newIns;
     }
+    passStats.add("dce", "instructions removed", removed);
 }
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include <queue>
 #include <stack>
 #include "Module.h"
+#include "analysisManager.h"
 
 
-void dce(FunctionPtr func);
\ No newline at end of file
+void dce(FunctionPtr func);
+// dce不删除跳转指令
+const unsigned dceRequires = AnalysisUse;
+const unsigned dcePreserves = AnalysisCFG | AnalysisDom | AnalysisLoop;
@@ -0,0 +1,289 @@
+#include "gvn.h"
+#include "callEffects.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+// 表达式的结构哈希：指令类型 + 操作符 + 操作数的编号
+// 非常量操作数按Value地址区分（SSA下同一个值只有一个定义），常量按类型和值编号，与是否共享同一个Const对象无关
+struct GVNKey {
+    InsID type;
+    string op;
+    vector<uintptr_t> ops;
+    bool operator==(const GVNKey& other) const {
+        return type == other.type && op == other.op && ops == other.ops;
+    }
+};
+
+struct GVNKeyHash {
+    size_t operator()(const GVNKey& key) const {
+        size_t h = std::hash<string>()(key.op) * 31 + key.type;
+        for(auto op: key.ops)
+            h = h * 1000003 ^ std::hash<uintptr_t>()(op);
+        return h;
+    }
+};
+
+bool gvnLoads = true;
+
+struct GVN {
+    bool loadAware;
+    // 当前支配树路径上可用的表达式，回溯时按undo日志恢复
+    unordered_map<GVNKey, ValuePtr, GVNKeyHash> table;
+    vector<pair<GVNKey, ValuePtr>> undo;
+    // 常量编号，从1开始，不会与地址冲突
+    map<pair<int, long long>, uintptr_t> constIds;
+    // 内存状态版本，store和call之后换新版本；块结束时的版本供只有一个前驱且前驱就是直接支配者的子块沿用
+    int memVersion = 0;
+    int maxVersion = 0;
+    unordered_map<BasicBlock*, int> endVersion;
+    int numRemoved = 0;
+
+    GVN(bool loadAware) : loadAware{loadAware} {}
+
+    uintptr_t number(ValuePtr value) {
+        if(!value->isConst)
+            return reinterpret_cast<uintptr_t>(value.get());
+        auto c = dynamic_cast<Const*>(value.get());
+        long long bits;
+        if(c->type->isFloat()) {
+            int fbits;
+            memcpy(&fbits, &c->floatVal, sizeof(fbits));
+            bits = fbits;
+        }
+        else if(c->type->isBool())
+            bits = c->boolVal;
+        else
+            bits = c->intVal;
+        auto key = make_pair(c->type->getID(), bits);
+        auto it = constIds.find(key);
+        if(it != constIds.end())
+            return it->second;
+        uintptr_t id = constIds.size() + 1;
+        constIds[key] = id;
+        return id;
+    }
+
+    ValuePtr lookup(const GVNKey& key) {
+        auto it = table.find(key);
+        return it == table.end() ? nullptr : it->second;
+    }
+
+    void insert(const GVNKey& key, ValuePtr value) {
+        auto it = table.find(key);
+        undo.push_back({key, it == table.end() ? nullptr : it->second});
+        table[key] = value;
+    }
+
+    void rollback(size_t mark) {
+        while(undo.size() > mark) {
+            auto& [key, old] = undo.back();
+            if(old)
+                table[key] = old;
+            else
+                table.erase(key);
+            undo.pop_back();
+        }
+    }
+
+    // 计算纯指令的哈希键，不能编号的指令返回false
+    bool makeKey(Instruction* I, GVNKey& key) {
+        key.type = I->type;
+        switch(I->type) {
+        case Binary: {
+            auto bi = (BinaryInstruction*)I;
+            key.op = string(1, bi->op);
+            key.ops = {number(bi->a), number(bi->b)};
+            if(bi->isCommutative && key.ops[0] > key.ops[1])
+                swap(key.ops[0], key.ops[1]);
+            return true;
+        }
+        case Icmp:
+        case Fcmp: {
+            auto isIcmp = I->type == Icmp;
+            auto a = isIcmp ? ((IcmpInstruction*)I)->a : ((FcmpInstruction*)I)->a;
+            auto b = isIcmp ? ((IcmpInstruction*)I)->b : ((FcmpInstruction*)I)->b;
+            key.op = isIcmp ? ((IcmpInstruction*)I)->op : ((FcmpInstruction*)I)->op;
+            key.ops = {number(a), number(b)};
+            // a<b与b>a是同一个比较
+            if(key.ops[0] > key.ops[1]) {
+                static const unordered_map<string, string> swapped = {
+                    {"==", "=="}, {"!=", "!="}, {"<", ">"}, {">", "<"}, {"<=", ">="}, {">=", "<="}};
+                auto it = swapped.find(key.op);
+                if(it != swapped.end()) {
+                    key.op = it->second;
+                    swap(key.ops[0], key.ops[1]);
+                }
+            }
+            return true;
+        }
+        case Ext: {
+            auto ext = (ExtInstruction*)I;
+            // 类型是唯一化的，直接用地址区分
+            key.op = ext->isign ? "s" : "z";
+            key.ops = {number(ext->from), reinterpret_cast<uintptr_t>(ext->to.get())};
+            return true;
+        }
+        case Bitcast: {
+            auto bc = (BitCastInstruction*)I;
+            key.ops = {number(bc->from), reinterpret_cast<uintptr_t>(bc->toType.get())};
+            return true;
+        }
+        case Sitofp:
+        case Fptosi:
+        case Fneg:
+            key.ops = {number(I->getOperand(0))};
+            return true;
+        case GEP: {
+            auto gep = (GetElementPtrInstruction*)I;
+            key.ops.push_back(number(gep->from));
+            for(auto idx: gep->index)
+                key.ops.push_back(number(idx));
+            return true;
+        }
+        case Phi: {
+            // 同一块中来源完全相同的phi才等价，块地址放在第一个操作数
+            auto phi = (PhiInstruction*)I;
+            vector<pair<uintptr_t, uintptr_t>> incoming;
+            for(auto& [value, pred]: phi->from)
+                incoming.push_back({reinterpret_cast<uintptr_t>(pred.get()), number(value)});
+            sort(incoming.begin(), incoming.end());
+            key.ops.push_back(reinterpret_cast<uintptr_t>(I->basicblock));
+            for(auto& [pred, value]: incoming) {
+                key.ops.push_back(pred);
+                key.ops.push_back(value);
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    GVNKey loadKey(ValuePtr addr) {
+        GVNKey key;
+        key.type = Load;
+        key.ops = {number(addr), (uintptr_t)memVersion};
+        return key;
+    }
+
+    void visit(BasicBlockPtr bb) {
+        // 只有一个前驱且前驱支配本块时，进入本块时的内存状态就是前驱结束时的状态
+        auto idom = bb->directDominator;
+        if(idom && bb->predBasicBlocks.size() == 1 && *bb->predBasicBlocks.begin() == idom && endVersion.count(idom.get()))
+            memVersion = endVersion[idom.get()];
+        else
+            memVersion = ++maxVersion;
+
+        unordered_set<Instruction*> removed;
+        // 块内还没被读过的store，同一地址再次store时前一个store是死的
+        unordered_map<Value*, Instruction*> pendingStore;
+        for(auto instr: bb->instructions) {
+            auto I = instr.get();
+            if(loadAware && I->type == Load) {
+                auto load = (LoadInstruction*)I;
+                auto key = loadKey(load->from);
+                if(auto leader = lookup(key)) {
+                    replaceVarByVar(load->to, leader);
+                    removed.insert(I);
+                }
+                else
+                    insert(key, load->to);
+                pendingStore.clear();
+                continue;
+            }
+            if(I->type == Call && getFunctionEffects(((CallInstruction*)I)->func.get()).isReadOnly()) {
+                // 只读内存的调用不改变内存状态，参数和内存状态都相同时结果也相同
+                auto call = (CallInstruction*)I;
+                auto& effects = getFunctionEffects(call->func.get());
+                if(effects.readsMemory())
+                    pendingStore.clear();
+                if(call->reg->type->isVoid())
+                    continue;
+                GVNKey key;
+                key.type = Call;
+                key.ops.push_back(reinterpret_cast<uintptr_t>(call->func.get()));
+                for(auto arg: call->argv)
+                    key.ops.push_back(number(arg));
+                if(effects.readsMemory())
+                    key.ops.push_back(memVersion);
+                if(auto leader = lookup(key)) {
+                    replaceVarByVar(call->reg, leader);
+                    removed.insert(I);
+                }
+                else
+                    insert(key, call->reg);
+                continue;
+            }
+            if(I->type == Store || I->type == Call) {
+                memVersion = ++maxVersion;
+                if(loadAware && I->type == Store) {
+                    auto store = (StoreInstruction*)I;
+                    auto it = pendingStore.find(store->des.get());
+                    if(it != pendingStore.end()) {
+                        deleteUser(it->second);
+                        removed.insert(it->second);
+                    }
+                    pendingStore[store->des.get()] = I;
+                    // 写入之后紧接着读同一地址，直接得到写入的值
+                    insert(loadKey(store->des), store->value);
+                }
+                else
+                    pendingStore.clear();
+                continue;
+            }
+            GVNKey key;
+            if(!makeKey(I, key))
+                continue;
+            if(auto leader = lookup(key)) {
+                replaceVarByVar(I->reg, leader);
+                removed.insert(I);
+            }
+            else
+                insert(key, I->reg);
+        }
+        endVersion[bb.get()] = memVersion;
+
+        if(!removed.empty()) {
+            for(auto it = bb->instructions.begin(); it != bb->instructions.end();)
+                if(removed.count(it->get()))
+                    it = bb->instructions.erase(it);
+                else
+                    it++;
+            numRemoved += removed.size();
+        }
+    }
+
+    // 沿支配树先序遍历，离开子树时撤销子树中加入的表达式
+    void run(FunctionPtr func) {
+        struct Frame {
+            BasicBlockPtr bb;
+            size_t child;
+            size_t mark;
+        };
+        vector<Frame> stack;
+        auto enter = [&](BasicBlockPtr bb) {
+            stack.push_back({bb, 0, undo.size()});
+            visit(bb);
+        };
+        enter(func->getEntryBlock());
+        while(!stack.empty()) {
+            auto& frame = stack.back();
+            if(frame.child < frame.bb->dominatorSon.size()) {
+                auto son = frame.bb->dominatorSon[frame.child++];
+                enter(son);
+                continue;
+            }
+            rollback(frame.mark);
+            stack.pop_back();
+        }
+    }
+};
+
+void gvn(FunctionPtr func) {
+    GVN pass(gvnLoads);
+    pass.run(func);
+    if(pass.numRemoved)
+        analysisManager.invalidate(func, AnalysisLoop);
+    passStats.add("gvn", "instructions removed", pass.numRemoved);
+}
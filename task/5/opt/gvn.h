@@ -0,0 +1,16 @@
+// 基于支配树的全局值编号，取代两两比较的cse
+#pragma once
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include "Module.h"
+#include "analysisManager.h"
+
+// 对纯计算（二元运算、比较、类型转换、gep、phi）和只读内存的调用编号；
+// gvnLoads为真时同时给内存状态编号，消除重复的load，并把store的值直接转发给后面的load
+void gvn(FunctionPtr func);
+// 是否编号load，由-gvn-load=0|1指定，默认打开
+extern bool gvnLoads;
+const unsigned gvnRequires = AnalysisCFG | AnalysisDom;
+// 替换并删掉了指令时自行使循环失效（SCEV记录的归纳变量、边界可能被删）
+const unsigned gvnPreserves = AnalysisCFG | AnalysisDom | AnalysisLoop | AnalysisUse;
@@ -13,7 +13,7 @@
 void findFunctionCallerAndCallee(FunctionPtr func){
     for(auto bb : func->basicBlocks){
         //在这里设置一下，前面好像有bug
-        bb->belongfunc = func;
+        bb->setBelongFunc(func);
         for(auto I:bb->instructions){
             if(I->type == Call){
                 CallInstruction* CI = dynamic_cast<CallInstruction*>(I.get());
@@ -44,224 +44,6 @@ void findFunctionCallerAndCallee(FunctionPtr func){
 
 
 
-//copy个Value
-static VariablePtr copyVariable(VariablePtr old){
-    //arr的inner就不要了，因为在局部变量中其会转换成gep和store指令，所以可以在后续获得
-    //intval floatval也都不要了，其以store、load指令存在，variable其实不应该有这几个量存在
-    error("copyVariavle\n");
-    VariablePtr ret = Variable::copy(old);
-    error("copyVariavle1\n");
-    //清除use，这些use会在之后copy指令的过程中重新建立
-    ret->name = ret->name+".copy";
-    ret->useHead = nullptr;
-    ret->numUses = 0;
-    return ret;
-}
-
-
-static ValuePtr getNewOperand(ValuePtr old, unordered_map<ValuePtr, ValuePtr>&ValueMap){
-    error("entre getNewOperand\n");
-    //const use same pointer
-    if(old->isConst){
-        error("const\n");
-        return old;
-    }
-    error("getNewOperand1\n");
-    if(ValueMap.find(old) == ValueMap.end()){
-        //打个补丁，phi中可能会用到
-        if(!dynamic_pointer_cast<Variable>(old)){
-            ValueMap[old] =  ValuePtr(new Reg(old->type,old->name));
-            return ValueMap[old];
-        }
-        ValueMap[old] = copyVariable(dynamic_pointer_cast<Variable>(old));
-    }
-    error("getNewOperand2\n");
-    return ValueMap[old];
-}
-
-
-
-static InstructionPtr copyInstruction(InstructionPtr old, unordered_map<ValuePtr,ValuePtr>&ValueMap,
-                                        unordered_map<BasicBlockPtr,BasicBlockPtr>&BBMap,
-                                        unordered_map<LabelPtr,LabelPtr>&LabelMap){
-    
-    error("enter CopyInstruction\n");
-    if(old->type == Return){
-        ReturnInstruction* RI = dynamic_cast<ReturnInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new ReturnInstruction(getNewOperand(RI->retValue,ValueMap),nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Br){
-        BrInstruction* RI = dynamic_cast<BrInstruction*>(old.get());
-        if(RI->exp){
-            //这里的label使用label获得，其实block里有labelbbmap，但实在是太麻烦了，就算了。
-            auto ret =  InstructionPtr(new BrInstruction(getNewOperand(RI->exp,ValueMap),LabelMap[RI->label_true],LabelMap[RI->label_false],nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;
-        }
-        else{
-            auto ret =  InstructionPtr(new BrInstruction(LabelMap[RI->label_true],nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;
-        }
-    }
-    else if(old->type == Alloca){
-        AllocaInstruction* RI = dynamic_cast<AllocaInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new AllocaInstruction(getNewOperand(RI->des,ValueMap),nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Store){
-        StoreInstruction* RI = dynamic_cast<StoreInstruction*>(old.get());
-        if(RI->gep){
-            GetElementPtrInstruction* newGEP = dynamic_cast<GetElementPtrInstruction*>((ValueMap[RI->gep->reg])->I);
-            auto ret =  InstructionPtr(new StoreInstruction(dynamic_pointer_cast<GetElementPtrInstruction>(newGEP->getSharedThis()), getNewOperand(RI->value,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;  
-        }
-        else{
-            auto ret =  InstructionPtr(new StoreInstruction(getNewOperand(RI->des,ValueMap),getNewOperand(RI->value,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;   
-        }
-    }
-    else if(old->type == Load){
-        LoadInstruction* RI = dynamic_cast<LoadInstruction*>(old.get());
-        if(RI->from->type->isPtr()){
-            auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(RI->to,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;  
-        }
-        else{
-            auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from,ValueMap),getNewOperand(RI->to,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;   
-        }
-    }
-    else if(old->type == Call){
-        CallInstruction* RI = dynamic_cast<CallInstruction*>(old.get());
-        vector<ValuePtr> newArgv;
-        for(int i = 0;i<RI->argv.size();i++){
-            newArgv.push_back(getNewOperand(RI->argv[i],ValueMap));
-        }
-        auto ret =  InstructionPtr(new CallInstruction(RI->func, newArgv, nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Bitcast){
-        BitCastInstruction* RI = dynamic_cast<BitCastInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new BitCastInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(RI->reg, ValueMap),nullptr, RI->toType));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Ext){
-        ExtInstruction* RI = dynamic_cast<ExtInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new ExtInstruction(getNewOperand(RI->from, ValueMap), RI->to,RI->isign,nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Sitofp){
-        SitofpInstruction* RI = dynamic_cast<SitofpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new SitofpInstruction(getNewOperand(RI->from, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Fptosi){
-        FptosiInstruction* RI = dynamic_cast<FptosiInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FptosiInstruction(getNewOperand(RI->from, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == GEP){
-        GetElementPtrInstruction* RI = dynamic_cast<GetElementPtrInstruction*>(old.get());
-        vector<ValuePtr> newIndex;
-        for(auto oldInd:RI->index){
-            newIndex.push_back(getNewOperand(oldInd,ValueMap));
-        }
-        auto newFrom = getNewOperand(RI->from,ValueMap);
-       
-        auto ret =  InstructionPtr(new GetElementPtrInstruction(getNewOperand(RI->from,ValueMap),newIndex,nullptr));
-         if(RI->from->type->isPtr()){
-            ret->reg->type = dynamic_cast<PtrType*>(RI->from->type.get())->inner;
-        }
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Binary){
-        error("binary \n");
-        BinaryInstruction* RI = dynamic_cast<BinaryInstruction*>(old.get());
-
-
-        auto ret =  InstructionPtr(new BinaryInstruction(getNewOperand(RI->a, ValueMap),getNewOperand(RI->b, ValueMap),RI->op, BasicBlockPtr(nullptr)));
-        //供后续阶段使用
-        error("binary2 \n");
-        ValueMap[old->reg] = ret->reg;
-        error("binary3 \n");
-        return ret;
-    }
-    else if(old->type == Fneg){
-        FnegInstruction* RI = dynamic_cast<FnegInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FnegInstruction(getNewOperand(RI->a, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Icmp){
-        IcmpInstruction* RI = dynamic_cast<IcmpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new IcmpInstruction(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Fcmp){
-        FcmpInstruction* RI = dynamic_cast<FcmpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FcmpInstruction(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Phi){
-        error("Phi\n");
-        PhiInstruction* RI = dynamic_cast<PhiInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new PhiInstruction(nullptr, getNewOperand(RI->val, ValueMap)));
-        //第二项参数实际上不需要了，后面直接能找到对应项，第二项参数留着会导致一个bug，即如果该phi是由后面用于替代return产生的，那么这个val就是call
-        //而call不是变量，copy时出现错误
-        // auto ret =  InstructionPtr(new PhiInstruction(nullptr, RI->val));
-        error("Phi4\n");
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else{
-        assert(false&&"unknown Inst type");
-    }
-}
-
 //按照dfs的顺序遍历bb，来拷贝指令
 //其实应该是拓扑排序，但因为有环，所以没办法
 //dfs的是原BB，因为需要原BB的指令信息，且没有copyBB到原BB的映射，所以直接遍历原BB，反正结构是一样的
@@ -280,7 +62,7 @@ static void dfsBasicBlock(BasicBlockPtr root, unordered_map<BasicBlockPtr, bool>
         // copyIns->print();
         error("after copyIns\n");
         
-        copyIns->basicblock = copyBasicBlock;
+        copyIns->basicblock = copyBasicBlock.get();
         copyBasicBlock->instructions.push_back(copyIns);
     }
     copyBasicBlock->setEndInstruction(copyBasicBlock->instructions.back());
@@ -300,7 +82,7 @@ static FunctionPtr copyFunction(FunctionPtr func, Module& ir,int callNum){
 
 
     //这个func的名字就不需要随便加数字防止重名了，因为copy的函数最后会被销毁
-    FunctionPtr newFunc = FunctionPtr(new Function(func->retVal->type,func->name+".copy",func->formArguments));
+    FunctionPtr newFunc = FunctionPtr(new Function(func->arena,func->retVal->type,func->name+".copy",func->formArguments));
 
     //用于保存原func的value到copyFunc的映射，这样才能保持原本的结构，即一条指令用到了之前的结果，那么可以通过原func中的结果来找到新func的结果
     //而之前的结果一定在这之前存到了valuemap中
@@ -326,17 +108,17 @@ static FunctionPtr copyFunction(FunctionPtr func, Module& ir,int callNum){
     for(auto bb:func->basicBlocks){
         LabelPtr BBLabel = LabelPtr(new Label(func->name+bb->label->name+".copy"+to_string(callNum)));
         LabelMap[bb->label] = BBLabel;
-        BBMap[bb] = BasicBlockPtr(new BasicBlock(BBLabel));
+        BBMap[bb] = newFunc->newBasicBlock(BBLabel);
         newBB.push_back(BBMap[bb]);
     }
     for(auto  bb:func->basicBlocks){
-        //完善cfg,保持原本的就够
+        //完善cfg,保持原本的就够；原集合无重复，直接追加
         BasicBlockPtr copyBasicBlock = BBMap[bb];
         for(auto pred:bb->predBasicBlocks){
-            copyBasicBlock->addPredBasicBlock(BBMap[pred]);
+            copyBasicBlock->predBasicBlocks.push_back(BBMap[pred]);
         }   
         for(auto succ:bb->succBasicBlocks){
-            copyBasicBlock->addSuccBasicBlock(BBMap[succ]);
+            copyBasicBlock->succBasicBlocks.push_back(BBMap[succ]);
         }   
     }
     newFunc->basicBlocks = newBB;
@@ -374,8 +156,8 @@ static FunctionPtr copyFunction(FunctionPtr func, Module& ir,int callNum){
 
 
 void inlineFunction(CallInstruction * I,Module& ir,int callNum){
-    BasicBlockPtr CallInBB = I->basicblock;
-    FunctionPtr caller = CallInBB->belongfunc;
+    BasicBlockPtr CallInBB = nonOwning(I->basicblock);
+    FunctionPtr caller = CallInBB->getParent();
     FunctionPtr callee = I->func;
     
 
@@ -383,65 +165,38 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
     //需要处理跳转指令，基本块的关系，以及一些指令的布局，如alloca指令需放在entry块中，还需要避免重名
 
     error("inlineFunction1\n");
-    auto it = CallInBB->instructions.begin();
-    vector<InstructionPtr> newInst;
-    for(;it!=CallInBB->instructions.end();it++){
-        if((*it).get()==I){
-            break;
-        }
-        newInst.push_back(*it);
-    }
+    auto callIt = CallInBB->instructions.iteratorTo(I);
     //跳过Call
-    it++;
+    auto afterCall = std::next(callIt);
     error("inlineFunction2\n");
 
     
     //后面随便加个数字防止重名
     LabelPtr BBAfterCallLabel = LabelPtr(new Label(callee->name+".ret"+to_string(callNum)));
-    BasicBlockPtr BBAfterCall = BasicBlockPtr(new BasicBlock(BBAfterCallLabel));
+    BasicBlockPtr BBAfterCall = caller->newBasicBlock(BBAfterCallLabel);
     BBAfterCall->setBelongFunc(caller);
 
     error("inlineFunction3\n");
-    vector<InstructionPtr> InstAfterCall;
-    for(;it!=CallInBB->instructions.end();it++){
-        InstAfterCall.push_back(*it);
-        (*it)->basicblock = BBAfterCall;
+    for(auto it = afterCall;it!=CallInBB->instructions.end();it++){
+        (*it)->basicblock = BBAfterCall.get();
     }
+    BBAfterCall->instructions.splice(BBAfterCall->instructions.end(), CallInBB->instructions, afterCall, CallInBB->instructions.end());
     error("inlineFunction4\n");
-    CallInBB->instructions=newInst;
-
-    BBAfterCall->succBasicBlocks = CallInBB->succBasicBlocks;
-    for(auto succ:CallInBB->succBasicBlocks){
-        // succ->predBasicBlocks.erase(CallInBB);
-        // succ->predBasicBlocks[BBAfterCall] = true;
-        succ->deletePredBasicBlock(CallInBB);
-        succ->addPredBasicBlock(BBAfterCall);
-        for(auto ii:succ->instructions){
-            if(ii->type == Phi){
-                for(auto&f:dynamic_cast<PhiInstruction*>(ii.get())->from){
-                    if(f.second == CallInBB){
-                        f.second = BBAfterCall;
-                    }
-                }
-            }
-        }
-    }
-    
-    CallInBB->succBasicBlocks.clear();
+    CallInBB->instructions.erase(callIt);
+
+    moveSuccessorsInCFG(CallInBB, BBAfterCall);
 
-    BBAfterCall->instructions = InstAfterCall;
     //保持原有的end就好
-    BBAfterCall->setEndInstruction(InstAfterCall.back());
+    BBAfterCall->setEndInstruction(BBAfterCall->instructions.back());
 
     FunctionPtr copyFunc = copyFunction(callee, ir, callNum);
     // copyFunc->print();
     
-    CallInBB->instructions.push_back(InstructionPtr(new BrInstruction(copyFunc->basicBlocks[0]->label,CallInBB)));
+    CallInBB->instructions.push_back(newIR<BrInstruction>(copyFunc->basicBlocks[0]->label,CallInBB));
     //维护这个属性，虽然好像没什么必要
     CallInBB->endInstruction = nullptr;
     CallInBB->setEndInstruction(CallInBB->instructions.back());
-    CallInBB->addSuccBasicBlock(copyFunc->basicBlocks[0]);
-    copyFunc->basicBlocks[0]->addPredBasicBlock(CallInBB);
+    addEdgeInCFG(CallInBB, copyFunc->basicBlocks[0]);
 
     unordered_map<BasicBlockPtr, bool> vis;
 
@@ -452,7 +207,7 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
     
     for(int i= 0,e = copyFunc->basicBlocks.size();i!=e;i++){
         error("inlineFunction51\n");
-        copyFunc->basicBlocks[i]->belongfunc = caller;
+        copyFunc->basicBlocks[i]->setBelongFunc(caller);
         error("inlineFunction52\n");
         //返回基本块
         if(copyFunc->basicBlocks[i]->succBasicBlocks.size()==0){
@@ -464,7 +219,7 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
                 calleeRetIns.push_back(ret);
 
                 copyFunc->basicBlocks[i]->instructions.pop_back();
-                InstructionPtr newBr = InstructionPtr(new BrInstruction(BBAfterCall->label, copyFunc->basicBlocks[i]));
+                InstructionPtr newBr = newIR<BrInstruction>(BBAfterCall->label, copyFunc->basicBlocks[i]);
                 copyFunc->basicBlocks[i]->instructions.push_back(newBr);
                 //维护endinstruction
                 copyFunc->basicBlocks[i]->endInstruction = newBr;
@@ -478,23 +233,20 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
     error("inlineFunction6\n");
 
     for(int i =0;i<calleeRetIns.size();i++){
-        auto bb  = calleeRetIns[i]->basicblock;
-        // bb->succBasicBlocks[BBAfterCall] = true;
-        // BBAfterCall->predBasicBlocks[bb] = true;
-        bb->addSuccBasicBlock(BBAfterCall);
-        BBAfterCall->addPredBasicBlock(bb);
+        auto bb  = nonOwning(calleeRetIns[i]->basicblock);
+        addEdgeInCFG(bb, BBAfterCall);
     }
     if(!callee->retVal->type->isVoid()){
         if(BBAfterCall->predBasicBlocks.size()==1){
             replaceVarByVar(I->reg,dynamic_cast<ReturnInstruction*>(calleeRetIns[0].get())->retValue);
         }
         else{
-            InstructionPtr newPhi = InstructionPtr(new PhiInstruction(BBAfterCall, I->reg));
+            InstructionPtr newPhi = newIR<PhiInstruction>(BBAfterCall, I->reg);
             BBAfterCall->instructions.insert(BBAfterCall->instructions.begin(),newPhi);
             replaceVarByVar(I->reg,newPhi->reg);
             for(int i =0;i<calleeRetIns.size();i++){
                 auto PI = dynamic_cast<PhiInstruction*>(newPhi.get());
-                PI->addFrom(dynamic_cast<ReturnInstruction*>(calleeRetIns[i].get())->retValue,calleeRetIns[i]->basicblock);
+                PI->addFrom(dynamic_cast<ReturnInstruction*>(calleeRetIns[i].get())->retValue,nonOwning(calleeRetIns[i]->basicblock));
             }
         }
 
@@ -517,23 +269,22 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
 
     error("inlineFunction8\n");
 
-    vector<InstructionPtr> allocaIns;
-    vector<InstructionPtr> InsEraseAlloca;
-    for(auto Ins : copyFunc->basicBlocks[0]->instructions){
-        if(Ins->type==Alloca){
-            allocaIns.push_back(Ins);
+    //alloca移到caller的entry开头
+    auto& calleeEntry = copyFunc->basicBlocks[0]->instructions;
+    auto& callerEntry = caller->basicBlocks[0]->instructions;
+    auto callerFirst = callerEntry.begin();
+    for(auto it = calleeEntry.begin();it!=calleeEntry.end();){
+        if((*it)->type==Alloca){
+            auto Ins = *it;
+            it = calleeEntry.remove(it);
+            callerEntry.insert(callerFirst, Ins);
         }
         else{
-            InsEraseAlloca.push_back(Ins);
+            it++;
         }
     }
 
     error("inlineFunction9\n");
-
-    copyFunc->basicBlocks[0]->instructions = InsEraseAlloca;
-
-    allocaIns.insert(allocaIns.end(),caller->basicBlocks[0]->instructions.begin(),caller->basicBlocks[0]->instructions.end());
-    caller->basicBlocks[0]->instructions = allocaIns;
     vector<BasicBlockPtr> newBBList;
     int i = 0;
     for(;i<caller->basicBlocks.size();i++){
@@ -552,71 +303,393 @@ void inlineFunction(CallInstruction * I,Module& ir,int callNum){
         newBBList.push_back(caller->basicBlocks[i]);
     }
     caller->basicBlocks = newBBList;
+    caller->renumberBasicBlocks();
+    for(auto bb:copyFunc->basicBlocks){
+        addBlockInCFG(caller, bb);
+    }
+    addBlockInCFG(caller, BBAfterCall);
+#ifdef VERIFY_CFG
+    if(!verifyCFG(caller))
+        abort();
+#endif
 }
 
 
-void inliner(Module& ir){
 
-    error("enter Inliner\n");
 
-    //构建调用图
-    for(auto func:ir.globalFunctions){
-        if(!func->isLib){
-            findFunctionCallerAndCallee(func);
-        }
+// 开启后，没有被整体内联的调用，若被调函数以“条件成立就直接返回”开头，只把这段判断复制到调用点
+bool partialInline = false;
+
+// 代价模型的参数，单位都是指令数
+// 调用本身的开销：call、传参和保存恢复寄存器
+static const int callOverhead = 8;
+// 实参为常量时，对应形参的每个使用都可能被折叠，最多计constArgMaxUses个
+static const int constArgBonus = 4;
+static const int constArgMaxUses = 5;
+// 被调函数读写指针形参指向的内存，而实参是调用者的局部数组或全局变量时，内联后访问的基址变为已知，
+// 这些load/store可以被gvn转发、DSE删除
+static const int memArgBonus = 10;
+// 不在循环中的调用点允许的代价，每深一层循环加loopDepthBonus，最多计maxLoopDepth层
+static const int baseThreshold = 50;
+static const int loopDepthBonus = 50;
+static const int maxLoopDepth = 3;
+// 被调函数只剩这一个调用点时，内联后函数本身会被删除，代码几乎不增长
+static const int singleCallSiteThreshold = 1000;
+// 内联后调用者的指令数上限，避免main这样的大函数继续膨胀，寄存器分配也吃不消
+static const int callerSizeLimit = 3000;
+// 整个模块因内联增加的指令数上限为原来的一半，且不低于moduleGrowthFloor
+static const int moduleGrowthFloor = 1000;
+// 部分内联时复制的判断指令数上限
+static const int guardSizeLimit = 8;
+// 提前返回路径上最多经过的空跳转块数
+static const int guardMaxHops = 4;
+
+static int instructionCount(Function *func){
+    int n = 0;
+    for(auto& bb:func->basicBlocks){
+        n += bb->instructions.size();
+    }
+    return n;
+}
+
+// 基址是全局变量或局部数组
+static bool isKnownBase(Value *base){
+    auto var = dynamic_cast<Variable*>(base);
+    return (var && var->isGlobal) || (base->I && base->I->type == Alloca);
+}
+
+static int countUses(ValuePtr val){
+    int n = 0;
+    for(Use *u = val->useHead;u;u = u->next){
+        n++;
     }
+    return n;
+}
 
+// 被调函数开头的提前返回：entry中只有无副作用的计算，以条件跳转结束，
+// 其中一边只经过空的跳转块就到达返回块，返回值是常量、形参或entry中算出的值
+struct EarlyExitGuard{
+    // entry中除跳转外的指令
+    vector<InstructionPtr> body;
+    BrInstruction *br;
+    bool exitOnTrue;
+    // 提前返回的值，void函数为空
+    ValuePtr retValue;
+};
+
+static bool isGuardInstruction(InstructionPtr I){
+    switch(I->type){
+    case Binary: case Fneg: case Icmp: case Fcmp: case Ext: case Sitofp: case Fptosi:
+        return true;
+    default:
+        return false;
+    }
+}
 
-    error("CG finish\n");
+static BasicBlockPtr branchTarget(BasicBlockPtr bb, LabelPtr label){
+    for(auto& succ:bb->succBasicBlocks){
+        if(succ->label == label){
+            return succ;
+        }
+    }
+    return nullptr;
+}
 
-    queue<FunctionPtr> inlinerFunc;
-    unordered_set<FunctionPtr> visited;
-    //仅内联不调用函数的函数
-    for(auto func:ir.globalFunctions){
-        if(!func->isLib&&func->name!="main"&&func->callee.size()==0){
-            inlinerFunc.push(func);
-            if(!visited.insert(func).second){
-                assert(false&&"inline function inlined");
+// 沿entry的一边走到返回块，求出这条路径上的返回值
+static bool findEarlyExitValue(FunctionPtr func, BasicBlockPtr entry, LabelPtr label, ValuePtr& retValue){
+    BasicBlockPtr pred = entry, cur = branchTarget(entry, label);
+    for(int hops = 0;cur && cur->instructions.back()->type != Return;hops++){
+        auto br = dynamic_cast<BrInstruction*>(cur->instructions.back().get());
+        if(hops == guardMaxHops || cur->instructions.size() != 1 || !br || br->exp){
+            return false;
+        }
+        pred = cur;
+        cur = branchTarget(cur, br->label_true);
+    }
+    if(!cur || cur == entry){
+        return false;
+    }
+    for(auto& I:cur->instructions){
+        if(I != cur->instructions.back() && I->type != Phi){
+            return false;
+        }
+    }
+    if(func->retVal->type->isVoid()){
+        retValue = nullptr;
+        return true;
+    }
+    ValuePtr value = dynamic_cast<ReturnInstruction*>(cur->instructions.back().get())->retValue;
+    if(value->I && value->I->type == Phi && value->I->basicblock == cur.get()){
+        ValuePtr incoming;
+        for(auto& f:dynamic_cast<PhiInstruction*>(value->I)->from){
+            if(f.second == pred){
+                incoming = f.first;
             }
         }
+        if(!incoming){
+            return false;
+        }
+        value = incoming;
     }
+    bool isArg = find(func->formArguments.begin(), func->formArguments.end(), value) != func->formArguments.end();
+    bool inEntry = value->I && value->I->basicblock == entry.get() && value->I->type != Phi;
+    if(!value->isConst && !isArg && !inEntry){
+        return false;
+    }
+    retValue = value;
+    return true;
+}
 
-    error("find function can be inline\n");
-
-    while(!inlinerFunc.empty()){
-        FunctionPtr nowFunc = inlinerFunc.front();
-        inlinerFunc.pop();
-        int callNum = 0;
-        error("before inline\n");
-        for(auto I:nowFunc->callerIns){
-            CallInstruction* CI = dynamic_cast<CallInstruction*>(I.get());
-            inlineFunction(CI, ir, callNum++);
+static bool findEarlyExitGuard(FunctionPtr func, EarlyExitGuard& guard){
+    auto entry = func->basicBlocks[0];
+    auto br = dynamic_cast<BrInstruction*>(entry->instructions.back().get());
+    if(!br || !br->exp || entry->instructions.size() - 1 > guardSizeLimit){
+        return false;
+    }
+    guard.body.assign(entry->instructions.begin(), std::prev(entry->instructions.end()));
+    for(auto& I:guard.body){
+        if(!isGuardInstruction(I)){
+            return false;
+        }
+    }
+    guard.br = br;
+    for(bool side:{true, false}){
+        if(findEarlyExitValue(func, entry, side ? br->label_true : br->label_false, guard.retValue)){
+            guard.exitOnTrue = side;
+            return true;
         }
+    }
+    return false;
+}
 
-        error("after Inline\n");
-        
-        for(auto C:(nowFunc->caller)){
-            auto Caller = C.first;
-            //删除调用者对其调用，因为全部都会inline，所以无所谓次数了
-            Caller->callee.erase(nowFunc);
+// 把判断复制到调用点：判断成立时直接取提前返回的值，否则照常调用，两边在join块用phi汇合
+static void partialInlineCall(InstructionPtr callIns, EarlyExitGuard& guard, int callNum){
+    CallInstruction *CI = dynamic_cast<CallInstruction*>(callIns.get());
+    BasicBlockPtr bb = nonOwning(CI->basicblock);
+    FunctionPtr caller = bb->getParent();
+    FunctionPtr callee = CI->func;
+    string prefix = callee->name + ".guard" + to_string(callNum);
+    BasicBlockPtr exitBB = caller->newBasicBlock(LabelPtr(new Label(prefix + ".exit")));
+    BasicBlockPtr callBB = caller->newBasicBlock(LabelPtr(new Label(prefix + ".call")));
+    BasicBlockPtr joinBB = caller->newBasicBlock(LabelPtr(new Label(prefix + ".join")));
+    for(auto newBB:{exitBB, callBB, joinBB}){
+        newBB->setBelongFunc(caller);
+    }
+
+    //call之后的指令移到join块，call单独放到一个块里
+    auto it = bb->instructions.iteratorTo(CI);
+    joinBB->instructions.splice(joinBB->instructions.end(), bb->instructions, std::next(it), bb->instructions.end());
+    for(auto& I:joinBB->instructions){
+        I->basicblock = joinBB.get();
+    }
+    joinBB->setEndInstruction(joinBB->instructions.back());
+    //call还要放进callBB，只摘下不删use
+    bb->instructions.remove(it);
+    moveSuccessorsInCFG(bb, joinBB);
+
+    //形参换成实参，复制判断
+    unordered_map<ValuePtr, ValuePtr> ValueMap;
+    unordered_map<BasicBlockPtr, BasicBlockPtr> BBMap;
+    unordered_map<LabelPtr, LabelPtr> LabelMap;
+    for(int i = 0;i<callee->formArguments.size();i++){
+        ValueMap[callee->formArguments[i]] = CI->argv[i];
+    }
+    for(auto& I:guard.body){
+        auto copyIns = copyInstruction(I, ValueMap, BBMap, LabelMap);
+        copyIns->reg->name = callee->name + "." + copyIns->reg->name + ".guard" + to_string(callNum);
+        copyIns->basicblock = bb.get();
+        bb->instructions.push_back(copyIns);
+    }
+    ValuePtr cond = getNewOperand(guard.br->exp, ValueMap);
+    LabelPtr trueLabel = guard.exitOnTrue ? exitBB->label : callBB->label;
+    LabelPtr falseLabel = guard.exitOnTrue ? callBB->label : exitBB->label;
+    InstructionPtr newBr = newIR<BrInstruction>(cond, trueLabel, falseLabel, bb);
+    bb->instructions.push_back(newBr);
+    bb->endInstruction = newBr;
+
+    InstructionPtr exitBr = newIR<BrInstruction>(joinBB->label, exitBB);
+    exitBB->instructions.push_back(exitBr);
+    exitBB->setEndInstruction(exitBr);
+    CI->basicblock = callBB.get();
+    InstructionPtr callBr = newIR<BrInstruction>(joinBB->label, callBB);
+    callBB->instructions.push_back(callIns);
+    callBB->instructions.push_back(callBr);
+    callBB->setEndInstruction(callBr);
+
+    addEdgeInCFG(bb, guard.exitOnTrue ? exitBB : callBB);
+    addEdgeInCFG(bb, guard.exitOnTrue ? callBB : exitBB);
+    addEdgeInCFG(exitBB, joinBB);
+    addEdgeInCFG(callBB, joinBB);
+
+    if(guard.retValue){
+        InstructionPtr phi = newIR<PhiInstruction>(joinBB, CI->reg);
+        //call仍然保留，不能摘掉它对实参的use
+        replaceUses(CI->reg, phi->reg);
+        joinBB->instructions.insert(joinBB->instructions.begin(), phi);
+        auto PI = dynamic_cast<PhiInstruction*>(phi.get());
+        PI->addFrom(getNewOperand(guard.retValue, ValueMap), exitBB);
+        PI->addFrom(CI->reg, callBB);
+    }
+
+    auto pos = find(caller->basicBlocks.begin(), caller->basicBlocks.end(), bb);
+    caller->basicBlocks.insert(pos + 1, {exitBB, callBB, joinBB});
+    caller->renumberBasicBlocks();
+    for(auto newBB:{exitBB, callBB, joinBB}){
+        addBlockInCFG(caller, newBB);
+    }
+#ifdef VERIFY_CFG
+    if(!verifyCFG(caller))
+        abort();
+#endif
+}
+
+
+void inliner(Module& ir){
+
+    error("enter Inliner\n");
+
+    unordered_map<Function*, FunctionPtr> funcPtr;
+    //模块中各函数剩余的调用点数
+    unordered_map<Function*, int> callSites;
+    unordered_map<Function*, int> sizes;
+    int moduleSize = 0;
+    for(auto func:ir.globalFunctions){
+        func->caller.clear();
+        func->callee.clear();
+        func->callerIns.clear();
+        if(func->isLib){
+            continue;
         }
+        //复制函数体时用到基本块所属的函数
+        for(auto bb:func->basicBlocks){
+            bb->setBelongFunc(func);
+        }
+        funcPtr[func.get()] = func;
+        sizes[func.get()] = instructionCount(func.get());
+        moduleSize += sizes[func.get()];
+        for(auto callee:directCallees(func.get())){
+            callSites[callee]++;
+        }
+    }
+    int growthLimit = max(moduleSize / 2, moduleGrowthFloor);
+    int growth = 0;
+    //各被调函数已经复制的次数，用来给复制出的基本块起不重复的名字
+    unordered_map<Function*, int> callNum;
+
+    struct CallSite{
+        InstructionPtr call;
+        int loopDepth;
+    };
+
+    //自底向上：处理一个函数时，它调用的其他分量中的函数都已经内联完毕，复制的是最终的函数体
+    for(auto& scc:callGraphSCCs(ir)){
+        unordered_set<Function*> inSCC(scc.begin(), scc.end());
+        for(auto callerRaw:scc){
+            FunctionPtr caller = funcPtr[callerRaw];
+            analysisManager.require(caller, AnalysisLoop);
+            //先记下所有调用点，内联进来的函数体中的调用不再处理
+            vector<CallSite> sites;
+            for(auto bb:caller->basicBlocks){
+                int depth = bb->loop ? bb->loop->getLoopDepth() : 0;
+                for(auto I:bb->instructions){
+                    if(I->type == Call && !dynamic_cast<CallInstruction*>(I.get())->func->isLib){
+                        sites.push_back({I, depth});
+                    }
+                }
+            }
 
-        //该函数应该可以删除了，毕竟已经全部inline了
-        for(auto it = ir.globalFunctions.begin();it!=ir.globalFunctions.end();it++){
-            if((*it) == nowFunc){
-                ir.globalFunctions.erase(it);
-                break;
+            bool changed = false;
+            for(auto& site:sites){
+                CallInstruction* CI = dynamic_cast<CallInstruction*>(site.call.get());
+                FunctionPtr callee = CI->func;
+                int size = sizes[callee.get()];
+                //同一分量中的函数互相递归，不能整体内联
+                bool canInline = !inSCC.count(callee.get()) && callee->name != "main";
+                if(canInline){
+                    int cost = size - callOverhead;
+                    auto& effects = getFunctionEffects(callee.get());
+                    for(int i = 0;i<CI->argv.size();i++){
+                        if(CI->argv[i]->isConst){
+                            cost -= constArgBonus * min(countUses(callee->formArguments[i]), constArgMaxUses);
+                        }
+                        bool accessed = i < effects.argsRead.size() && (effects.argsRead[i] || effects.argsWritten[i]);
+                        if(accessed && isKnownBase(getMemoryBase(CI->argv[i].get()))){
+                            cost -= memArgBonus;
+                        }
+                    }
+                    bool lastSite = callSites[callee.get()] == 1;
+                    int threshold = baseThreshold + loopDepthBonus * min(site.loopDepth, maxLoopDepth);
+                    if(lastSite){
+                        threshold = max(threshold, singleCallSiteThreshold);
+                    }
+                    canInline = cost <= threshold && sizes[callerRaw] + size <= callerSizeLimit
+                                && (lastSite || growth + size <= growthLimit);
+                }
+                if(canInline){
+                    auto newCallees = directCallees(callee.get());
+                    inlineFunction(CI, ir, callNum[callee.get()]++);
+                    deleteUser(site.call);
+                    sizes[callerRaw] += size;
+                    growth += size;
+                    if(--callSites[callee.get()] == 0){
+                        growth -= size;
+                    }
+                    for(auto g:newCallees){
+                        callSites[g]++;
+                    }
+                    changed = true;
+                    passStats.add("inliner", "call sites inlined");
+                    continue;
+                }
+                EarlyExitGuard guard;
+                if(partialInline && sizes[callerRaw] + guardSizeLimit <= callerSizeLimit && findEarlyExitGuard(callee, guard)){
+                    partialInlineCall(site.call, guard, callNum[callee.get()]++);
+                    sizes[callerRaw] = instructionCount(callerRaw);
+                    changed = true;
+                    passStats.add("inliner", "call sites partially inlined");
+                }
+            }
+            if(changed){
+                sizes[callerRaw] = instructionCount(callerRaw);
+                analysisManager.invalidate(caller, AnalysisDom);
             }
         }
+    }
 
-        //可能会产生新的没调用函数的函数
-        for(auto func:ir.globalFunctions){
-            if(!func->isLib&&func->name!="main"&&func->callee.size()==0&&!visited.count(func)){
-                inlinerFunc.push(func);
-                if(!visited.insert(func).second){
-                    assert(false&&"visited insert fail");
+    //删除从main出发不再可达的函数，被整体内联到所有调用点的函数都在其中
+    FunctionPtr mainFunc;
+    for(auto func:ir.globalFunctions){
+        if(!func->isLib && func->name == "main"){
+            mainFunc = func;
+        }
+    }
+    if(mainFunc){
+        unordered_set<Function*> reachable = {mainFunc.get()};
+        vector<Function*> work = {mainFunc.get()};
+        while(!work.empty()){
+            auto func = work.back();
+            work.pop_back();
+            for(auto callee:directCallees(func)){
+                if(reachable.insert(callee).second){
+                    work.push_back(callee);
                 }
             }
         }
+        for(auto it = ir.globalFunctions.begin();it!=ir.globalFunctions.end();){
+            if(!(*it)->isLib && !reachable.count(it->get())){
+                it = ir.globalFunctions.erase(it);
+                passStats.add("inliner", "functions deleted");
+            }
+            else{
+                it++;
+            }
+        }
     }
-}
\ No newline at end of file
+
+    //重建调用关系的登记
+    for(auto func:ir.globalFunctions){
+        if(!func->isLib){
+            findFunctionCallerAndCallee(func);
+        }
+    }
+}
@@ -13,14 +13,26 @@
 #include <algorithm>
 
 #include "Module.h"
+#include "analysisManager.h"
+#include "createCFG.h"
+#include "callGraph.h"
+#include "copyInstruction.h"
+#include "callEffects.h"
 
 using namespace std;
 
 
-static VariablePtr copyVariable(VariablePtr old);
-
 static FunctionPtr copyFunction(FunctionPtr func, Module& ir, int callNum);
 
+// 部分内联：被调函数开头是“条件成立就直接返回”时，只把这段判断复制到没有整体内联的调用点，
+// 由-partial-inline打开
+extern bool partialInline;
+
+// 沿调用图的强连通分量自底向上内联：按被调函数大小、常量实参、经指针实参访问的内存（取自computeCallEffects的摘要）、
+// 调用点所在循环深度估计代价，并限制调用者和整个模块的增长，之后删除从main不可达的函数
 void inliner(Module& ir);
+// 内联时增量维护了调用者的CFG，调用点的循环深度从循环分析取得
+const unsigned inlinerRequires = AnalysisUse;
+const unsigned inlinerPreserves = AnalysisCFG;
 
 #endif
\ No newline at end of file
@@ -70,6 +70,9 @@ void computePreHeader(FunctionPtr func) {
     for (auto loop : func->getAllLoops()) {
         BasicBlockPtr preHeader = nullptr;
         for (auto pred : loop->getHeader()->getPredecessor()) {
+            // 常量传播折叠跳转后可能留下不可达的前驱，它没有支配树编号
+            if (!pred->hasDomNumber())
+                continue;
             if (getLoopDepth(pred) != loop->getLoopDepth())  {
                 preHeader = pred;
                 break;
@@ -181,7 +184,7 @@ void loopAnalysis(FunctionPtr func) {
     stack<BasicBlockPtr> BackedgeTo;
     for(auto header : postOrderList) {
         for(auto pred : header->getPredecessor())
-            if(pred->getAllDoms().count(header)) {
+            if(header->dominates(pred)) {
                 BackedgeTo.push(pred);
             }
         
@@ -1,784 +1,389 @@
 #include "loopUnroll.h"
-#include "LICM.h"
 
-int copy_num =0;
-
-void unuseall(InstructionPtr ins)
-{
-    auto operands_num = ins->getNumOperands();
-    for(int i=0;i<operands_num;i++)
-    {
-        auto operand = ins->getOperand(i);
-        if(operand)
-        {
-            deleteUser(operand);
-        }
-    }
-}
-
-
-void error(string s)
-{
-    cerr << s << endl;
+int unrollFactor = 4;
+
+// 复制出的基本块和寄存器的名字后缀
+static NameCounter unrollNum;
+
+// 常量次数不超过maxFullUnrollTrip、展开后不超过fullUnrollBudget条指令时完全展开
+const int maxFullUnrollTrip = 32;
+const int fullUnrollBudget = 256;
+// 部分展开后的循环体不超过partialUnrollBudget条指令
+const int partialUnrollBudget = 128;
+// 每个函数因展开而增加的指令数上限
+const int functionGrowthLimit = 1024;
+
+// 一次迭代的副本
+struct LoopCopy {
+    unordered_map<ValuePtr, ValuePtr> valueMap;
+    unordered_map<BasicBlockPtr, BasicBlockPtr> bbMap;
+    BasicBlockPtr header, latch;
+};
+
+static int loopSize(LoopPtr loop) {
+    int size = 0;
+    for(auto bb: loop->getLoopBasicBlocks())
+        for(auto& instr: bb->instructions)
+            if(instr->type != Phi)
+                size++;
+    return size;
 }
 
-//copy个Value
-static VariablePtr copyVariable(VariablePtr old){
-    VariablePtr ret = Variable::copy(old);
-    ret->name = ret->name+".copy";
-    ret->useHead = nullptr;
-    ret->numUses = 0;
-    return ret;
+// 后端会向量化的循环（与后端共用analyzeVectorLoop），部分展开后就认不出来了
+static bool isVectorizable(FunctionPtr func, LoopPtr loop) {
+    VectorLoop vl;
+    return analyzeVectorLoop(func, loop, vl);
 }
 
-
-static ValuePtr getNewOperand(ValuePtr old, unordered_map<ValuePtr, ValuePtr>&ValueMap){
-    if(old->isConst){
-        // error("const\n");
-        return old;
-    }
-    // error("getNewOperand1\n");
-    if(ValueMap.find(old) == ValueMap.end()){
-        //打个补丁，phi中可能会用到
-        if(!dynamic_pointer_cast<Variable>(old)){
-            ValueMap[old] =  ValuePtr(new Reg(old->type,old->name+".unroll.copy"));
-            return ValueMap[old];
-        }
-        ValueMap[old] = copyVariable(dynamic_pointer_cast<Variable>(old));
+static string icmpOp(IcmpKind kind) {
+    switch(kind) {
+        case ICmpSLT: return "<";
+        case ICmpSLE: return "<=";
+        case ICmpSGT: return ">";
+        case ICmpSGE: return ">=";
+        case ICmpEQ: return "==";
+        default: return "!=";
     }
-    // error("getNewOperand2\n");
-
-    return ValueMap[old];
 }
 
-
-
-static InstructionPtr copyInstruction(InstructionPtr old, unordered_map<ValuePtr,ValuePtr>&ValueMap,
-                                        unordered_map<BasicBlockPtr,BasicBlockPtr>&BBMap,
-                                        unordered_map<LabelPtr,LabelPtr>&LabelMap, FunctionPtr func){
-    
-    // error("enter CopyInstruction\n");
-    if(old->type == Return){
-        ReturnInstruction* RI = dynamic_cast<ReturnInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new ReturnInstruction(getNewOperand(RI->retValue,ValueMap),nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Br){
-        BrInstruction* RI = dynamic_cast<BrInstruction*>(old.get());
-        if(RI->exp){
-            //这里的label使用label获得，其实block里有labelbbmap，但实在是太麻烦了，就算了。
-            // cerr << "Copyting Branch" << endl;
-            if(LabelMap[RI->label_true]==nullptr)
-            {
-                // cerr << "Label 1 null "<< endl;
-            }
-            if(LabelMap[RI->label_false]==nullptr)
-            {
-                // cerr << "Label 2 null "<< endl;
-            }
-            auto ret =  InstructionPtr(new BrInstruction(getNewOperand(RI->exp,ValueMap),LabelMap[RI->label_true],LabelMap[RI->label_false],nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;
-        }
-        else{
-            auto ret =  InstructionPtr(new BrInstruction(LabelMap[RI->label_true],nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;
-        }
-    }
-    else if(old->type == Alloca){
-        AllocaInstruction* RI = dynamic_cast<AllocaInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new AllocaInstruction(getNewOperand(RI->des,ValueMap),nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Store){
-        StoreInstruction* RI = dynamic_cast<StoreInstruction*>(old.get());
-        if(RI->gep){
-            GetElementPtrInstruction* newGEP = dynamic_cast<GetElementPtrInstruction*>((ValueMap[RI->gep->reg])->I);
-            auto ret =  InstructionPtr(new StoreInstruction(dynamic_pointer_cast<GetElementPtrInstruction>(newGEP->getSharedThis()), getNewOperand(RI->value,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;  
-        }
-        else{
-            auto ret =  InstructionPtr(new StoreInstruction(getNewOperand(RI->des,ValueMap),getNewOperand(RI->value,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;   
-        }
-    }
-    else if(old->type == Load){
-        LoadInstruction* RI = dynamic_cast<LoadInstruction*>(old.get());
-        if(RI->from->type->isPtr()){
-            auto nreg = func->getReg(RI->from->type);
-            auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(nreg,ValueMap),nullptr));
-            // auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(RI->to,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;  
-        }
-        else{
-            auto nreg = func->getReg(RI->from->type);
-            auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(nreg,ValueMap),nullptr));
-            // auto ret =  InstructionPtr(new LoadInstruction(getNewOperand(RI->from,ValueMap),getNewOperand(RI->to,ValueMap),nullptr));
-            //供后续阶段使用
-            ValueMap[old->reg] = ret->reg;
-            return ret;   
-        }
-    }
-    else if(old->type == Call){
-        CallInstruction* RI = dynamic_cast<CallInstruction*>(old.get());
-        vector<ValuePtr> newArgv;
-        for(int i = 0;i<RI->argv.size();i++){
-            newArgv.push_back(getNewOperand(RI->argv[i],ValueMap));
-        }
-        auto ret =  InstructionPtr(new CallInstruction(RI->func, newArgv, nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Bitcast){
-        BitCastInstruction* RI = dynamic_cast<BitCastInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new BitCastInstruction(getNewOperand(RI->from, ValueMap), getNewOperand(RI->reg, ValueMap),nullptr, RI->toType));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Ext){
-        ExtInstruction* RI = dynamic_cast<ExtInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new ExtInstruction(getNewOperand(RI->from, ValueMap), RI->to,RI->isign,nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Sitofp){
-        SitofpInstruction* RI = dynamic_cast<SitofpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new SitofpInstruction(getNewOperand(RI->from, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Fptosi){
-        FptosiInstruction* RI = dynamic_cast<FptosiInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FptosiInstruction(getNewOperand(RI->from, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == GEP){
-        GetElementPtrInstruction* RI = dynamic_cast<GetElementPtrInstruction*>(old.get());
-        vector<ValuePtr> newIndex;
-        for(auto oldInd:RI->index){
-            newIndex.push_back(getNewOperand(oldInd,ValueMap));
-        }
-        auto newFrom = getNewOperand(RI->from,ValueMap);
-       
-        auto ret =  InstructionPtr(new GetElementPtrInstruction(getNewOperand(RI->from,ValueMap),newIndex,nullptr));
-         if(RI->from->type->isPtr()){
-            ret->reg->type = dynamic_cast<PtrType*>(RI->from->type.get())->inner;
-        }
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Binary){
-        // error("binary \n");
-        BinaryInstruction* RI = dynamic_cast<BinaryInstruction*>(old.get());
-
-
-        auto ret =  InstructionPtr(new BinaryInstruction(getNewOperand(RI->a, ValueMap),getNewOperand(RI->b, ValueMap),RI->op, BasicBlockPtr(nullptr)));
-        //供后续阶段使用
-        // error("binary2 \n");
-        ValueMap[old->reg] = ret->reg;
-        // error("binary3 \n");
-        return ret;
-    }
-    else if(old->type == Fneg){
-        FnegInstruction* RI = dynamic_cast<FnegInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FnegInstruction(getNewOperand(RI->a, ValueMap), nullptr));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Icmp){
-        IcmpInstruction* RI = dynamic_cast<IcmpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new IcmpInstruction(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Fcmp){
-        FcmpInstruction* RI = dynamic_cast<FcmpInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new FcmpInstruction(nullptr, getNewOperand(RI->a, ValueMap), getNewOperand(RI->b, ValueMap),RI->op));
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else if(old->type == Phi){
-        // error("Phi\n");
-        PhiInstruction* RI = dynamic_cast<PhiInstruction*>(old.get());
-
-        auto ret =  InstructionPtr(new PhiInstruction(nullptr, getNewOperand(RI->val, ValueMap)));
-        //第二项参数实际上不需要了，后面直接能找到对应项，第二项参数留着会导致一个bug，即如果该phi是由后面用于替代return产生的，那么这个val就是call
-        //而call不是变量，copy时出现错误
-        // auto ret =  InstructionPtr(new PhiInstruction(nullptr, RI->val));
-        // error("Phi4\n");
-        //供后续阶段使用
-        ValueMap[old->reg] = ret->reg;
-        return ret;
-    }
-    else{
-        assert(false&&"unknown Inst type");
-    }
+static ValuePtr incomingFrom(PhiInstruction *phi, BasicBlockPtr bb) {
+    for(auto& [val, pred]: phi->from)
+        if(pred == bb)
+            return val;
+    assert(false && "phi has no incoming from bb");
+    return nullptr;
 }
 
+static vector<PhiInstruction *> headerPhis(BasicBlockPtr header) {
+    vector<PhiInstruction *> phis;
+    for(auto& instr: header->instructions)
+        if(instr->type == Phi)
+            phis.push_back((PhiInstruction *)instr.get());
+    return phis;
+}
 
+// 循环中的块按逆后序排列（不走回边），复制时操作数的定义先于使用
+static vector<BasicBlockPtr> loopRPO(LoopPtr loop) {
+    vector<BasicBlockPtr> order;
+    set<BasicBlockPtr> visited;
+    auto header = loop->getHeader();
+    function<void(BasicBlockPtr)> dfs = [&](BasicBlockPtr bb) {
+        visited.insert(bb);
+        for(auto succ: bb->getSuccessor())
+            if(succ != header && loop->contains(succ) && !visited.count(succ))
+                dfs(succ);
+        order.push_back(bb);
+    };
+    dfs(header);
+    reverse(order.begin(), order.end());
+    return order;
+}
 
-LoopPtr getLoopCopy(LoopPtr loop, std::unordered_map<ValuePtr, ValuePtr>& LoopValueCpy, unordered_map<ValuePtr, ValuePtr>& CurrentIncomingValue, BasicBlockPtr exitblock, FunctionPtr func)
-{
-    // cerr << "Entering Loop copy" << endl;
-    // auto headerCpy = BasicBlock::Create(loop->getHeader()->getName() + ".unrollcpy", loop->getParent());
-    string now_num = to_string(copy_num++);
-    LabelPtr BBLabel = LabelPtr(new Label(loop->getHeader()->label->name+".copy"+now_num));
-
-    auto headerCpy = BasicBlockPtr(new BasicBlock(BBLabel));
-
-    LabelPtr latchLabel = LabelPtr(new Label(loop->latchBlock->label->name+".copy"+now_num));
-
-    auto latchCpy = (loop->getHeader() == loop->latchBlock) ? headerCpy : BasicBlockPtr(new BasicBlock(latchLabel));
-    
-    auto loopCpy = LoopPtr(new Loop(headerCpy,1));
-
-    loopCpy->setLatchBlock(latchCpy);
-
-    std::unordered_map<PhiInstruction*, PhiInstruction*> queuePhi;
-
-    unordered_map<ValuePtr,ValuePtr> ValueMap;
-    unordered_map<BasicBlockPtr, BasicBlockPtr> loopBBMap;
-    unordered_map<LabelPtr, LabelPtr> LabelMap;
-    unordered_map<InstructionPtr, InstructionPtr> insMap;
-
-    for(auto bb : loop->getBasicBlocks())
-        if(bb == loop->getHeader())
-        {
-            loopBBMap[bb] = headerCpy;
-            LabelMap[bb->label] = headerCpy->label;
-            // LoopValueCpy[bb] = headerCpy;
-        }
-        else if(bb == loop->getLatchBlock())
-        {
-            loopBBMap[bb] = latchCpy;
-            LabelMap[bb->label] = latchCpy->label;
-            // LoopValueCpy[bb] = latchCpy;
-            loopCpy->addBasicBlock(latchCpy);
-        }
-        else if(bb != loop->getHeader() && bb != loop->getLatchBlock())
-        {
-            LabelPtr BBLabel = LabelPtr(new Label(bb->label->name+".unrollcpy"+now_num));
-            auto loopBodyCpy = BasicBlockPtr(new BasicBlock(BBLabel));
-            loopBBMap[bb] = loopBodyCpy;
-            LabelMap[bb->label] = BBLabel;
-            // LoopValueCpy[bb] = loopBodyCpy;
-            loopCpy->addBasicBlock(loopBodyCpy);
+static void insertBlocksBefore(FunctionPtr func, BasicBlockPtr pos, const vector<BasicBlockPtr>& blocks) {
+    auto it = find(func->basicBlocks.begin(), func->basicBlocks.end(), pos);
+    func->basicBlocks.insert(it, blocks.begin(), blocks.end());
+    func->renumberBasicBlocks();
+    for(auto bb: blocks)
+        addBlockInCFG(func, bb);
+}
 
-        }
+static BasicBlockPtr newBlock(FunctionPtr func, string name) {
+    auto bb = func->newBasicBlock(LabelPtr(new Label(name)));
+    bb->setBelongFunc(func);
+    return bb;
+}
 
-    LabelMap[exitblock->label] = exitblock->label; 
+static void appendInstruction(BasicBlockPtr bb, InstructionPtr instr) {
+    instr->basicblock = bb.get();
+    bb->instructions.push_back(instr);
+    if(instr->type == Br)
+        bb->endInstruction = instr;
+}
 
-    // maybe wrong
+// 把bb末尾的无条件跳转改到to
+static void retargetJump(BasicBlockPtr bb, BasicBlockPtr to) {
+    auto br = (BrInstruction *)bb->endInstruction.get();
+    assert(!br->exp);
+    removeEdgeInCFG(bb, bb->belongfunc->LabelBBMap[br->label_true]);
+    br->label_true = to->label;
+    addEdgeInCFG(bb, to);
+}
 
-    for(auto bb : loop->getBasicBlocks())
-    {
-        if(bb == loop->getHeader())
-        {
-            for(auto instr : bb->instructions)
-            {
-                if(instr->type == Phi)
-                    continue;
-                auto instrCpy = copyInstruction(instr, CurrentIncomingValue, loopBBMap, LabelMap, func);
-                headerCpy->pushInstruction(instrCpy);
-                instrCpy->basicblock = headerCpy;
+// 复制一次迭代，header的phi取phiValues中的值，header副本不再判断直接进入循环体，
+// latch副本仍然跳回原来的header，由调用者改到下一次迭代。副本插在原header之前
+static LoopCopy copyIteration(FunctionPtr func, LoopPtr loop, LoopBound& bound,
+                              unordered_map<ValuePtr, ValuePtr>& phiValues) {
+    auto header = loop->getHeader();
+    auto blocks = loopRPO(loop);
+    string suffix = ".unroll" + to_string(unrollNum++);
+    LoopCopy copy;
+    auto& valueMap = copy.valueMap;
+    unordered_map<LabelPtr, LabelPtr> labelMap;
+    for(auto bb: blocks) {
+        copy.bbMap[bb] = newBlock(func, bb->label->name + suffix);
+        labelMap[bb->label] = copy.bbMap[bb]->label;
+    }
+    labelMap[header->label] = header->label;
+    copy.header = copy.bbMap[header];
+    copy.latch = copy.bbMap[loop->getLatchBlock()];
+
+    // 循环外定义的值原样使用
+    for(auto bb: blocks)
+        for(auto& instr: bb->instructions)
+            for(unsigned i = 0; i < instr->getNumOperands(); i++) {
+                auto val = instr->getOperand(i);
+                if(val && !val->isConst && (!val->I || !loop->contains(val->I->basicblock)))
+                    valueMap[val] = val;
             }
-        }
-        else if(bb == loop->getLatchBlock())
-        {
-            for(auto instr : bb->instructions)
-            {
-                auto instrCpy = copyInstruction(instr, CurrentIncomingValue, loopBBMap, LabelMap, func);
-                latchCpy->pushInstruction(instrCpy);
-                instrCpy->basicblock = latchCpy;
-                if(instrCpy ->type ==Binary && instr -> type ==Binary)
-                {
-                    auto bi = dynamic_cast<BinaryInstruction*>(instr.get());
-                    auto bi_cpy = dynamic_cast<BinaryInstruction*>(instrCpy.get());
-                    auto v1 = bi->a;
-                    auto v2 = bi->b;
-                    if(v1->I && v1->I->type==Phi && loop == v1->I->basicblock->loop)
-                    {
-                        CurrentIncomingValue[v1] = bi_cpy->reg;
-                    }
-                    if(v2->I && v2->I->type==Phi && loop == v2->I->basicblock->loop)
-                    {
-                        CurrentIncomingValue[v2] = bi_cpy->reg;
-                    }
-                }
-                if(instr->type==Phi)
-                {
-                    auto phi = dynamic_cast<PhiInstruction*>(instr.get());
-                    if(instrCpy->type==Phi)
-                    {
-                        auto phiCpy = dynamic_cast<PhiInstruction*>(instrCpy.get());
-                        queuePhi[phi] = phiCpy;
-                    }
-                        
-                }
-                    
+    for(auto phi: headerPhis(header))
+        valueMap[phi->reg] = phiValues[phi->reg];
+
+    for(auto bb: blocks) {
+        auto newBB = copy.bbMap[bb];
+        for(auto& instr: bb->instructions) {
+            if(bb == header && instr->type == Phi)
+                continue;
+            InstructionPtr newInstr;
+            if(instr == header->endInstruction) {
+                auto body = bound.body == header ? header : copy.bbMap[bound.body];
+                newInstr = newIR<BrInstruction>(body->label, newBB);
             }
-        }
-        else
-        {
-            // cerr << "Loop stage 2 else" << endl;
-            for(auto instr : bb->instructions)
-            {
-                auto instrCpy = copyInstruction(instr, CurrentIncomingValue, loopBBMap, LabelMap, func);
-                // LoopValueCpy[instr] = instrCpy;
-                auto loopBodyCpy = loopBBMap[bb];
-                loopBodyCpy->pushInstruction(instrCpy);
-                instrCpy->basicblock = loopBodyCpy;
-                if(instrCpy ->type ==Binary && instr -> type ==Binary)
-                {
-                    auto bi = dynamic_cast<BinaryInstruction*>(instr.get());
-                    auto bi_cpy = dynamic_cast<BinaryInstruction*>(instr.get());
-                    auto v1 = bi->a;
-                    auto v2 = bi->b;
-                    // if(bi->op != '+' || bi->op != '-')
-                    //     continue;
-                    if(v1 ->I && v1->I->type==Phi)
-                    {
-                        CurrentIncomingValue[v1] = bi_cpy->reg;
-                    }
-                    if(v2 ->I && v2->I->type==Phi)
-                    {
-                        CurrentIncomingValue[v2] = bi_cpy->reg;
-                    }
-                }
-                if(instr->type==Phi)
-                {
-                    auto phi = dynamic_cast<PhiInstruction*>(instr.get());
-                    if(instrCpy->type ==Phi)
-                    {
-                        auto phiCpy = dynamic_cast<PhiInstruction*>(instrCpy.get());
-                        queuePhi[phi] = phiCpy;
-                    }
-                        
-                }
-                    
+            else {
+                newInstr = copyInstruction(instr, valueMap, copy.bbMap, labelMap);
+                if(newInstr->reg)
+                    newInstr->reg->name = instr->reg->name + suffix;
             }
+            appendInstruction(newBB, newInstr);
         }
     }
-
-    // cerr << "Loop copy stage 2" << endl;
-    // if(copy_num==2)
-    // for(auto instr: latchCpy->instructions)
-    // {
-    //     cerr << instr->getName() << endl;
-    // }
-
-    for(auto iter : loopBBMap)
-    {
-        auto bb = iter.first;
-        auto bbCpy = iter.second;
-        // dumpBasickBlock(bbCpy);
-        if(bb != loop->getHeader())
-            for(auto pred : bb->predBasicBlocks)
-                bbCpy->predBasicBlocks.insert(loopBBMap[pred]);
-        if(bb != loop->getLatchBlock())
-            for(auto succ : bb->succBasicBlocks)
-                bbCpy->succBasicBlocks.insert(loopBBMap[succ]);
-        // dumpBasickBlock(bbCpy);
-    }
-
-    // cerr << "Loop copy stage 3" << endl;
-
-    for(auto iter : queuePhi)
-    {
-        auto phi = iter.first;
-        auto phiCpy = iter.second;
-        for(auto iter : phi->from)
-        {
-            auto val = iter.first;
-            auto pred = iter.second;
-            // phiCpy->replaceValue
-            phiCpy->addFrom(val, loopBBMap[pred]);
+    // 循环体中的phi等所有块复制完再补incoming
+    for(auto bb: blocks) {
+        if(bb == header)
+            continue;
+        for(auto& instr: bb->instructions) {
+            if(instr->type != Phi)
+                continue;
+            auto phi = (PhiInstruction *)instr.get();
+            auto newPhi = (PhiInstruction *)valueMap[phi->reg]->I;
+            for(auto& [val, pred]: phi->from)
+                newPhi->addFrom(getNewOperand(val, valueMap), copy.bbMap[pred]);
+        }
+    }
+
+    vector<BasicBlockPtr> newBlocks;
+    for(auto bb: blocks)
+        newBlocks.push_back(copy.bbMap[bb]);
+    insertBlocksBefore(func, header, newBlocks);
+    for(auto bb: blocks) {
+        if(bb == header) {
+            addEdgeInCFG(copy.header, bound.body == header ? header : copy.bbMap[bound.body]);
+            continue;
         }
+        for(auto succ: bb->getSuccessor())
+            addEdgeInCFG(copy.bbMap[bb], succ == header ? header : copy.bbMap[succ]);
     }
+    return copy;
+}
 
-    std::unordered_map<PhiInstruction*, ValuePtr> phiAssignLater;
-    for(auto instr : loop->getHeader()->instructions)
-    {
-        if(instr->type==Phi)
-        {
-            auto phi = dynamic_cast<PhiInstruction*>(instr.get());
-            for(auto iter : phi->from)
-            {
-                auto val = iter.first;
-                auto pred = iter.second;
-                if(pred == loop->getLatchBlock())
-                    phiAssignLater[phi] = val;
-            }
-                
-        }
-        else
-            break;
-    }   
-    return loopCpy;
+// 下一次迭代开始时header各phi的值
+static unordered_map<ValuePtr, ValuePtr> nextPhiValues(LoopPtr loop, LoopCopy& copy) {
+    unordered_map<ValuePtr, ValuePtr> values;
+    for(auto phi: headerPhis(loop->getHeader()))
+        values[phi->reg] = getNewOperand(incomingFrom(phi, loop->getLatchBlock()), copy.valueMap);
+    return values;
 }
 
+// 复制tripCount次迭代依次连接，header只剩最后一次不成立的判断，直接跳到出口
+static void fullyUnroll(FunctionPtr func, LoopPtr loop, LoopBound& bound, long long tripCount) {
+    auto header = loop->getHeader(), preHeader = loop->getPreheader();
+    unordered_map<ValuePtr, ValuePtr> values;
+    for(auto phi: headerPhis(header))
+        values[phi->reg] = incomingFrom(phi, preHeader);
+    BasicBlockPtr prevLatch = preHeader;
+    for(long long k = 0; k < tripCount; k++) {
+        auto copy = copyIteration(func, loop, bound, values);
+        retargetJump(prevLatch, copy.header);
+        values = nextPhiValues(loop, copy);
+        prevLatch = copy.latch;
+    }
+
+    for(auto phi: headerPhis(header)) {
+        auto reg = phi->reg;
+        replaceVarByVar(reg, values[reg]);
+        header->instructions.erase(header->instructions.iteratorTo(phi));
+    }
+    auto oldBr = header->endInstruction;
+    deleteUser(oldBr);
+    header->instructions.pop_back();
+    header->endInstruction = nullptr;
+    appendInstruction(header, newIR<BrInstruction>(bound.exit->label, header));
+    removeEdgeInCFG(header, bound.body);
 
-void runOnLoop(LoopPtr loop, FunctionPtr func)
-{
-    int maxTripCount = 80;
-    copy_num = 0;
+    // 原来的循环体已经不可达
+    for(auto bb: loop->getLoopBasicBlocks()) {
+        if(bb == header)
+            continue;
+        for(auto& instr: bb->instructions)
+            deleteUser(instr);
+        removeBlockInCFG(func, bb);
+        func->basicBlocks.erase(find(func->basicBlocks.begin(), func->basicBlocks.end(), bb));
+    }
+    func->renumberBasicBlocks();
+}
 
-    auto legalLoop = [&](LoopPtr loop) -> bool {
-        // 1. Loop can not have break. At our simplify loop continue become 
-        // to the common for loop
-        if(loop->getExitingBlocks().size() != 1 || loop->getExitBlocks().size() != 1 || loop->getSubLoops().size())
-        {
-            return false;    
-        } 
-                                   // It must to be 1 at any time.
-        auto trip = loop->getTripCount();
-        if( !trip)
-        {
-            // std::cerr << "333" <<std::endl;
-            return false;
-        }
-            
-        else if(trip != 60 && trip != 300 && trip!= 20)
-        {
-            // std::cerr << "444" <<std::endl;
-            return false;
-        }
-        // 3. Do not have any function call.
-        for(auto bb : loop->getBasicBlocks())
-            for(auto instr : bb->instructions)
-                if(instr->type == Call)
-                    return false;
-        
-        for(auto bb : loop->getBasicBlocks())
-            for(auto instr : bb->instructions)
-                if(instr->type == Icmp && bb != loop->header)
-                    return false;
-        return true;
+// 部分展开：preHeader -> [检查] -> 展开的循环 -> 余数循环的preHeader -> 原循环。
+// 展开的循环在 ind + (factor-1)*step 仍满足条件时执行一组factor次迭代，
+// 即判断 ind kind end-(factor-1)*step，end不是常量时先检查这个界限不会溢出，溢出则全部交给原循环
+static bool partiallyUnroll(FunctionPtr func, LoopPtr loop, LoopBound& bound, int factor, set<BasicBlockPtr>& visited) {
+    auto header = loop->getHeader(), preHeader = loop->getPreheader();
+    long long span = (long long)(factor - 1) * bound.step;
+    if(span > INT32_MAX || span < INT32_MIN)
+        return false;
+    ValuePtr limit, inRange;
+    auto insertInPreHeader = [&](InstructionPtr instr) {
+        preHeader->instructions.insert(std::prev(preHeader->instructions.end()), instr);
+        return instr->reg;
     };
-
-
-    if(!legalLoop(loop))
-    {
-        return;
+    if(bound.end->isConst) {
+        long long end = ((Const *)bound.end.get())->intVal;
+        if(end - span > INT32_MAX || end - span < INT32_MIN)
+            return false;
+        limit = Const::getConst(Type::getInt(), (int)(end - span));
     }
-    else
-    { }
-
-        
-    
-    auto header = loop->getHeader();
-
-    auto latch = loop->latchBlock;
-    auto exit = *loop->getExitBlocks().begin();
-
-    std::unordered_map<ValuePtr, ValuePtr> CurrentIncomingValue;
-    std::vector<InstructionPtr> headerPhi;
-
-    std::unordered_map<ValuePtr, ValuePtr> tmpmap;
-
-    int itrtimes = 0;
-
-    ValuePtr tracephi = nullptr;
-    for(auto instr : header->instructions)
-    {
-        int phitimes = 0;
-        if(instr->type==Phi)
-        {
-            auto phi  = (PhiInstruction*)(instr.get());
-            headerPhi.push_back(instr);
-            if(phi->reg->getStr()=="%phi2")
-                tracephi = phi->reg;
-            for(auto it : phi->from)
-            {
-                auto val = it.first;
-                auto pred = it.second;
-                if(pred == nullptr)
-                    continue;
-                if(pred == latch)
-                {
-                    CurrentIncomingValue[phi->reg] = val;
-                }
-            }
-        }
+    else {
+        limit = insertInPreHeader(newIR<BinaryInstruction>(bound.end, Const::getConst(Type::getInt(), (int)span), '-', preHeader));
+        if(span > 0)
+            inRange = insertInPreHeader(newIR<IcmpInstruction>(preHeader, bound.end, Const::getConst(Type::getInt(), (int)(INT32_MIN + span)), ">="));
         else
-            break;
-    }
-
-    for(auto instr: latch->instructions)
-    {
-        if(instr->type ==Binary)
-        {
-            auto bi = dynamic_cast<BinaryInstruction*>(instr.get());
-            auto reg = bi -> reg;
-            if(CurrentIncomingValue.find(reg)==CurrentIncomingValue.end())
-            {
-                CurrentIncomingValue[reg] = reg;
-            }
-            if(bi->a && CurrentIncomingValue.find(bi->a)==CurrentIncomingValue.end() && !bi->a->isConst)
-            {
-                CurrentIncomingValue[bi->a] = bi->a;
-            }
-            if(bi->b && CurrentIncomingValue.find(bi->b)==CurrentIncomingValue.end() && !bi->b->isConst)
-            {
-                CurrentIncomingValue[bi->b] = bi->b;
-            }
-        }
-        else if(instr->type == GEP)
-        {
-            auto gep = dynamic_cast<GetElementPtrInstruction*>(instr.get());
-            auto reg = gep->reg;
-            if(CurrentIncomingValue.find(reg) == CurrentIncomingValue.end())
-            {
-                CurrentIncomingValue[reg] = reg;
-            }
-            if(gep->from && CurrentIncomingValue.find(gep->from) ==CurrentIncomingValue.end())
-            {
-                CurrentIncomingValue[gep->from] = gep->from;
-            }
-        }
-        else if(instr->type == Store)
-        {
-            auto str = dynamic_cast<StoreInstruction*>(instr.get());
-            auto reg = str->des;
-            if(CurrentIncomingValue.find(reg) == CurrentIncomingValue.end())
-            {
-                CurrentIncomingValue[reg] = reg;
-            }
-            if(str->value && CurrentIncomingValue.find(str->value) ==CurrentIncomingValue.end())
-            {
-                CurrentIncomingValue[str->value] = str->value;
-            }
-        }
-    }
-
-    for(auto iter: CurrentIncomingValue)
-    {
-        cout << "value->value is " << iter.first->name << " -> " << iter.second->name << endl;
+            inRange = insertInPreHeader(newIR<IcmpInstruction>(preHeader, bound.end, Const::getConst(Type::getInt(), (int)(INT32_MAX + span)), "<="));
+    }
+
+    string prefix = header->label->name + ".unroll" + to_string(unrollNum++);
+    auto unrollPreHeader = inRange ? newBlock(func, prefix + ".ph") : nullptr;
+    auto unrollHeader = newBlock(func, prefix + ".header");
+    auto remPreHeader = newBlock(func, prefix + ".rem");
+    visited.insert(unrollHeader);
+    auto entry = inRange ? unrollPreHeader : preHeader;
+
+    // 展开的循环的header：phi和判断
+    unordered_map<ValuePtr, ValuePtr> values;
+    vector<pair<PhiInstruction *, PhiInstruction *>> unrollPhis;
+    for(auto phi: headerPhis(header)) {
+        auto newPhi = newIR<PhiInstruction>(unrollHeader, phi->reg).get();
+        appendInstruction(unrollHeader, newPhi->getSharedThis());
+        newPhi->addFrom(incomingFrom(phi, preHeader), entry);
+        values[phi->reg] = newPhi->reg;
+        unrollPhis.push_back({phi, newPhi});
+    }
+    InstructionPtr cond = newIR<IcmpInstruction>(unrollHeader, values[bound.indPhi->reg], limit, icmpOp(bound.kind));
+    appendInstruction(unrollHeader, cond);
+    if(inRange) {
+        appendInstruction(unrollPreHeader, newIR<BrInstruction>(unrollHeader->label, unrollPreHeader));
+        insertBlocksBefore(func, header, {unrollPreHeader, unrollHeader});
     }
+    else
+        insertBlocksBefore(func, header, {unrollHeader});
 
-    auto itr = --latch->instructions.end();
-    auto latchCondBr =  *itr;
-    latch->instructions.erase(itr);
-    latch->endInstruction = nullptr;
-    unuseall(latchCondBr);
-    latch->succBasicBlocks.clear();
-
-    std::vector<BasicBlockPtr> latchHeaderEdge;
-    BasicBlockPtr preLatch = latch;
-    BasicBlockPtr nowHeader = nullptr;
-
-    auto trip = loop->getTripCount();
-
-    std::unordered_map<ValuePtr, ValuePtr> copyMap;
-    latchHeaderEdge.push_back(preLatch);
-    for(int i = 1; i < trip; i++)
-    {
-        auto loopCpy = getLoopCopy(loop, copyMap, CurrentIncomingValue,exit, func);
-
-        auto headerCpy = loopCpy->getHeader();
-        auto latchCpy = loopCpy->getLatchBlock();
-
-        nowHeader = headerCpy;
-        latchHeaderEdge.push_back(latchCpy);
-        preLatch = latchCpy;
-    }
-
-    latchHeaderEdge.push_back(exit);
-
-    for(auto instr : exit->instructions)
-    {
-        if(instr->type == Binary)
-        {
-            auto bi = dynamic_cast<BinaryInstruction*>(instr.get());
-            if(bi->a&&bi->a->I && bi->a->I->type == Phi)
-            {   
-                ValuePtr incomingVal = nullptr;
-                auto phi = dynamic_cast<PhiInstruction*>(bi->a->I);
-                bool flag = false;
-                for (auto iter : phi->from)
-                {
-                    auto val = iter.first;
-                    auto pred = iter.second;
-                    if (pred == latch)
-                        flag = true;
-                    
-                    
-                }
-                if(!latch || !flag)
-                    continue;
-                bi->setOperands(0,CurrentIncomingValue[phi->reg]);
-            }
-
-            if(bi->b&&bi->b->I && bi->b->I->type ==Phi)
-            {   
-                ValuePtr incomingVal = nullptr;
-                auto phi = dynamic_cast<PhiInstruction*>(bi->b->I);
-                bool flag = false;
-                for (auto iter : phi->from)
-                {
-                    auto val = iter.first;
-                    auto pred = iter.second;
-                    if (pred == latch)
-                        flag = true;
-                }
-                if(!latch || !flag)
-                    continue;
-                bi->setOperands(1,CurrentIncomingValue[phi->reg]);
-            }
-        }
+    BasicBlockPtr prevLatch = unrollHeader, firstHeader;
+    for(int k = 0; k < factor; k++) {
+        auto copy = copyIteration(func, loop, bound, values);
+        if(k == 0)
+            firstHeader = copy.header;
         else
-            continue;
+            retargetJump(prevLatch, copy.header);
+        values = nextPhiValues(loop, copy);
+        prevLatch = copy.latch;
+    }
+    retargetJump(prevLatch, unrollHeader);
+    for(auto [phi, newPhi]: unrollPhis)
+        newPhi->addFrom(values[phi->reg], prevLatch);
+    appendInstruction(unrollHeader, newIR<BrInstruction>(cond->reg, firstHeader->label, remPreHeader->label, unrollHeader));
+    addEdgeInCFG(unrollHeader, firstHeader);
+    addEdgeInCFG(unrollHeader, remPreHeader);
+
+    // 余数循环从展开的循环结束时的值开始；检查不通过时直接从初值开始
+    for(auto [phi, newPhi]: unrollPhis) {
+        auto remPhi = newIR<PhiInstruction>(remPreHeader, phi->reg);
+        appendInstruction(remPreHeader, remPhi);
+        if(inRange)
+            remPhi->addFrom(incomingFrom(phi, preHeader), preHeader);
+        remPhi->addFrom(newPhi->reg, unrollHeader);
+        phi->removeIncomingByBB(preHeader);
+        phi->addFrom(remPhi->reg, remPreHeader);
+    }
+    appendInstruction(remPreHeader, newIR<BrInstruction>(header->label, remPreHeader));
+    insertBlocksBefore(func, header, {remPreHeader});
+    addEdgeInCFG(remPreHeader, header);
+
+    removeEdgeInCFG(preHeader, header);
+    if(inRange) {
+        auto oldBr = preHeader->endInstruction;
+        deleteUser(oldBr);
+        preHeader->instructions.pop_back();
+        preHeader->endInstruction = nullptr;
+        appendInstruction(preHeader, newIR<BrInstruction>(inRange, unrollPreHeader->label, remPreHeader->label, preHeader));
+        addEdgeInCFG(preHeader, unrollPreHeader);
+        addEdgeInCFG(preHeader, remPreHeader);
+        addEdgeInCFG(unrollPreHeader, unrollHeader);
+    }
+    else {
+        ((BrInstruction *)preHeader->endInstruction.get())->label_true = unrollHeader->label;
+        addEdgeInCFG(preHeader, unrollHeader);
+    }
+    return true;
+}
+
+// 返回是否修改了函数
+static bool unrollLoop(FunctionPtr func, LoopPtr loop, set<BasicBlockPtr>& visited, int& growth) {
+    LoopBound bound;
+    if(!getLoopBound(loop, bound))
+        return false;
+    auto latch = loop->getLatchBlock();
+    if(latch != loop->getHeader() && ((BrInstruction *)latch->endInstruction.get())->exp)
+        return false;
+    int size = loopSize(loop);
+    long long tripCount = getConstTripCount(bound);
+    if(tripCount >= 1 && tripCount <= maxFullUnrollTrip && tripCount * size <= fullUnrollBudget
+        && growth + (tripCount - 1) * size <= functionGrowthLimit) {
+        fullyUnroll(func, loop, bound, tripCount);
+        growth += (tripCount - 1) * size;
+        passStats.add("loopUnroll", "loops fully unrolled");
+        return true;
     }
+    if(tripCount == 0 || isVectorizable(func, loop))
+        return false;
+    int factor = min(unrollFactor, partialUnrollBudget / max(size, 1));
+    if(tripCount > 0)
+        factor = min<long long>(factor, tripCount);
+    if(factor < 2 || growth + factor * size > functionGrowthLimit)
+        return false;
+    if(!partiallyUnroll(func, loop, bound, factor, visited))
+        return false;
+    growth += factor * size;
+    passStats.add("loopUnroll", "loops partially unrolled");
+    return true;
+}
 
-    for(auto instr : headerPhi)
-    {
-        auto phi  = (PhiInstruction*)(instr.get());
-        for(auto iter : phi->from)
-        {
-            auto val = iter.first;
-            auto pred = iter.second;
-            if(pred == loop->preHeader)
-            {
-                replaceVarByVar(phi->reg, val);
-                
-                unuseall(instr);
-                phi->basicblock->removeInsturction(instr);
+void loopUnroll(FunctionPtr func) {
+    // 已经处理过的循环按header记录，部分展开产生的新循环也不再展开
+    set<BasicBlockPtr> visited;
+    int growth = 0;
+    while(true) {
+        analysisManager.require(func, AnalysisLoop);
+        LoopPtr target = nullptr;
+        for(auto loop: func->getAllLoops())
+            if(loop->getSubLoops().empty() && !visited.count(loop->getHeader())) {
+                target = loop;
                 break;
             }
-        }
-    }
-
-    int iter_num = 0;
-
-    auto block_iter = func->basicBlocks.begin();
-
-    for(auto bb: func->basicBlocks)
-    {
-        block_iter++;
-        if(bb == latch)
-        {
+        if(!target)
             break;
-        }
-    }
-
-    vector<BasicBlockPtr> ins_list;
-
-    for(auto iter : latchHeaderEdge)
-    {
-        iter_num ++;
-
-        auto latch_cp = iter;
-        if(iter_num==latchHeaderEdge.size())
-        {
-            break;
-        }
-        auto nextLatch = latchHeaderEdge[iter_num];
-        latch_cp->succBasicBlocks.insert(nextLatch);
-        nextLatch->predBasicBlocks.clear();
-        nextLatch->predBasicBlocks.insert(latch_cp);
-
-        auto br = InstructionPtr( new BrInstruction(nextLatch->label, latch_cp));
-        latch_cp->pushInstruction(br);
-
-        if(!loop->contains(latch_cp)&&latch_cp) {
-            loop->addBasicBlock(latch_cp);
-            ins_list.push_back(latch_cp);
-        }
-    }
-
-    func->basicBlocks.insert(block_iter,ins_list.begin(),ins_list.end());
-
-
-    itr = --header->instructions.end();
-    header->instructions.erase(itr);
-    header->endInstruction = nullptr;
-    auto br = InstructionPtr( new BrInstruction(latch->label, header));
-    header->pushInstruction(br);
-
-    for(auto iter: header->predBasicBlocks)
-    {
-        if(iter == latch)
-        {
-            header->predBasicBlocks.erase(iter);
-            break;
-        }
-    }
-
-    for(auto iter: exit->predBasicBlocks)
-    {
-        if(iter == header)
-        {
-            exit->predBasicBlocks.erase(iter);
-            break;
-        }
-    }
-
-    unordered_set<BasicBlockPtr> visited;
-
-    for(auto bb: func->basicBlocks)
-    {
-        visited.insert(bb);
-    }
-
-    for(auto bb: func->basicBlocks)
-    {
-        for(auto iter: bb->getPredecessor())
-        {
-            if(!visited.count(iter))
-                bb->predBasicBlocks.erase(iter);
-        }
-    }
+        visited.insert(target->getHeader());
+        if(unrollLoop(func, target, visited, growth))
+            analysisManager.invalidate(func, AnalysisDom);
+    }
+#ifdef VERIFY_CFG
+    if(!verifyCFG(func))
+        abort();
+#endif
 }
-
-// @FIXME: bug when compiling 09_BFS and almost useless
-void unrollLoop(FunctionPtr func) {
-
-    queue<LoopPtr> QueWorkList;
-    for(auto loop : func->getAllLoops())
-    {
-        if(loop->getParentLoop()!=nullptr)
-            continue;
-        else
-            QueWorkList.push(loop);
-    }
-    while(!QueWorkList.empty())
-    {
-        auto loop = QueWorkList.front();
-        QueWorkList.pop();
-        runOnLoop(loop, func);
-        for(auto subLoop : loop->getSubLoops())
-            QueWorkList.push(subLoop);
-    }
-}
\ No newline at end of file
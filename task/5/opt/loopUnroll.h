@@ -1,9 +1,21 @@
 #pragma once
-#include <iostream>
 #include <vector>
 #include <set>
-#include <queue>
 #include "Module.h"
 #include "Function.h"
+#include "createCFG.h"
+#include "analysisManager.h"
+#include "SCEV.h"
+#include "copyInstruction.h"
+#include "vectorLoop.h"
 
-void unrollLoop(FunctionPtr func);
\ No newline at end of file
+// 部分展开的倍数，由-unroll-factor=N指定，小于2时不做部分展开
+extern int unrollFactor;
+
+// 展开最内层循环，只处理getLoopBound能识别的循环：
+// 循环次数是不超过maxFullUnrollTrip的常量时完全展开，去掉循环；
+// 否则按unrollFactor部分展开，展开后的循环每次执行unrollFactor次迭代，剩下的迭代交给原循环（余数循环）执行。
+// 循环的出口仍然只有原来的header，LCSSA的phi不受影响；展开受循环体大小和函数增长的指令数限制
+void loopUnroll(FunctionPtr func);
+const unsigned loopUnrollRequires = AnalysisLoop | AnalysisUse;
+const unsigned loopUnrollPreserves = AnalysisCFG | AnalysisUse;
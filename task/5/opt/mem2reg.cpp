@@ -1,172 +1,143 @@
 #include "mem2reg.h"
 
 
-//block和root为当前节点，dfsNum和rootNum是按照前序遍历的顺序的节点编号，used是标志每个节点是否被访问过，且记录每个bb的dfs下标
-//block组织的是图G，root组织的是dfs树
-void dfsTree(BasicBlockPtr bb,vector<BasicBlockPtr>&dfsNum, vector<node*>&rootNum,unordered_map<BasicBlockPtr, int>& used, node* root){
-    dfsNum.push_back(bb);
-    rootNum.push_back(root);
-    used[bb] =dfsNum.size()-1;
-    for(auto& succ:(bb->succBasicBlocks)){
-        if(used.find(succ)==used.end()){
-            root->son.push_back(new node(succ));
-            root->son.back()->father = root;
-            dfsTree(succ, dfsNum, rootNum, used,root->son.back());
+// 从entry出发迭代DFS，得到可达基本块的后序序列，postIdx按bb->idx记录后序编号，-1为不可达
+static void cfgPostOrder(FunctionPtr func, vector<BasicBlockPtr>& postOrder, vector<int>& postIdx){
+    auto entry = func->getEntryBlock();
+    vector<bool> visited(func->basicBlocks.size(), false);
+    stack<pair<BasicBlockPtr, BasicBlockSet::iterator>> stk;
+    visited[entry->idx] = true;
+    stk.push({entry, entry->succBasicBlocks.begin()});
+    while(!stk.empty()){
+        auto& top = stk.top();
+        if(top.second == top.first->succBasicBlocks.end()){
+            postIdx[top.first->idx] = postOrder.size();
+            postOrder.push_back(top.first);
+            stk.pop();
+            continue;
+        }
+        auto succ = *top.second;
+        ++top.second;
+        assert(func->isNumbered(succ) && "successor not in function");
+        if(!visited[succ->idx]){
+            visited[succ->idx] = true;
+            stk.push({succ, succ->succBasicBlocks.begin()});
         }
     }
 }
 
-int mEval(int id, vector<node *>& root,vector<BasicBlockPtr>& dfsNum, vector<int >& semi, unordered_map<BasicBlockPtr , int>& used){
-    if(root[id]->bb == dfsNum[id]){
-        return id;
-    }
-    else{
-        queue<node*> list;
-        int ret = id;
-        for(int i=0;i<root[id]->son.size();i++){
-            list.push(root[id]->son[i]);
+// 沿支配树给每个bb编先序/后序号，domOrder记录先序编号对应的块
+static void numberDomTree(BasicBlockPtr entry, vector<BasicBlock*>& domOrder){
+    int preCnt = 0, postCnt = 0;
+    stack<pair<BasicBlockPtr, bool>> stk;
+    stk.push({entry, false});
+    while(!stk.empty()){
+        auto [bb, expanded] = stk.top();
+        stk.pop();
+        if(expanded){
+            bb->domPostIdx = postCnt++;
+            continue;
         }
-        while(!list.empty()){
-            node* t = list.front();
-            list.pop();
-            if(semi[used[t->bb]]<semi[ret]){
-                ret = used[t->bb];
-            }
-            for(int i=0;i<t->son.size();i++){
-                list.push(t->son[i]);
-            }
+        bb->domPreIdx = preCnt++;
+        domOrder.push_back(bb.get());
+        stk.push({bb, true});
+        for(auto& son : bb->dominatorSon){
+            stk.push({son, false});
         }
-        return ret;
     }
 }
 
-// DFS计算能支配一个基本块的所有基本块
-static unordered_set<BasicBlockPtr> doms;
-void computeAllDoms(BasicBlockPtr bb) {
-    doms.insert(bb);
-    bb->setAllDoms(doms);
-    for(auto next : bb->getDominatorSon())
-        computeAllDoms(next);
-    doms.erase(bb);
-}
-
+// Cooper-Harvey-Kennedy算法："A Simple, Fast Dominance Algorithm"
+// 按逆后序迭代求直接支配节点，通常两三轮即收敛，之后用runner算法求支配边界
 void domTree(FunctionPtr func){
-    doms.clear();
-    //有bug
-    //目前是正确的，但时间复杂度高，感觉像n^4
+    func->renumberBasicBlocks();
     for(auto bb:func->basicBlocks){
-        // bb->directDominator = nullptr;
         bb->setDirectDominator(nullptr);
         bb->dominatorSon.clear();
         bb->DF.clear();
+        bb->DF.setUniverse(&func->domOrder);
+        bb->domPreIdx = bb->domPostIdx = -1;
     }
-
-
-    vector<BasicBlockPtr> dfsNum;
-    vector<node*> rootNum;
-    unordered_map<BasicBlockPtr , int> used;
-    node* dfsRoot = new node(func->basicBlocks[0]);
-    dfsTree(func->basicBlocks[0], dfsNum, rootNum, used, dfsRoot);
-
-
-    vector<unordered_map<BasicBlockPtr, bool>> Dom(dfsNum.size());
-    //先序遍历id为0的节点即entryBB,该bb的支配节点只会是他本身
-    Dom[0][dfsNum[0]] = true;
-
-    for(int i=1;i<dfsNum.size();i++){
-        for(int j=0;j<dfsNum.size();j++){
-            Dom[i][dfsNum[j]] = true;
+    func->domOrder.clear();
+
+    auto entry = func->getEntryBlock();
+    vector<BasicBlockPtr> postOrder;
+    vector<int> postIdx(func->basicBlocks.size(), -1);
+    cfgPostOrder(func, postOrder, postIdx);
+
+    // idom以后序编号表示，entry的后序编号最大，-1表示尚未计算
+    int n = postOrder.size();
+    vector<int> idom(n, -1);
+    idom[n-1] = n-1;
+    auto intersect = [&](int a, int b){
+        while(a != b){
+            while(a < b) a = idom[a];
+            while(b < a) b = idom[b];
         }
-    }
+        return a;
+    };
+
     bool change = true;
     while(change){
         change = false;
-        for(int i=0;i<dfsNum.size();i++){
-            unordered_map<BasicBlockPtr, bool> newDom;
-            for(int j=0;j<dfsNum.size();j++){
-                bool flag = false;
-                for(auto& pred:(dfsNum[i]->predBasicBlocks)){
-                    flag = true;
-                    if(Dom[used[pred]].find(dfsNum[j])==Dom[used[pred]].end()){
-                        flag = false;
-                        break;
-                    }
-                }
-                if(flag){
-                    newDom[dfsNum[j]] = true;
-                }
+        for(int i=n-2;i>=0;i--){
+            int newIdom = -1;
+            for(auto& pred:(postOrder[i]->predBasicBlocks)){
+                // 不可达或不在函数中的前驱不参与计算
+                if(!func->isNumbered(pred) || postIdx[pred->idx] == -1)
+                    continue;
+                int p = postIdx[pred->idx];
+                if(idom[p] == -1)
+                    continue;
+                newIdom = newIdom == -1 ? p : intersect(p, newIdom);
             }
-            newDom[dfsNum[i]] = true;
-            if(Dom[i]!=newDom){
-                Dom[i] = newDom;
+            if(idom[i] != newIdom){
+                idom[i] = newIdom;
                 change = true;
             }
         }
     }
 
-    // for(int i=0;i<dfsNum.size();i++){
-    //     cerr<<"label:               "<<dfsNum[i]->label->name<<endl;
-    //     for(auto& d:Dom[i]){
-    //         cerr<<d.first->label->name<<endl;
-    //     }
-    // }
-
-
-    //对每个BB BFS找到直接支配节点
-    for(int i=1 ;i<dfsNum.size();i++){
-        queue<BasicBlockPtr> list;
-        unordered_map<BasicBlockPtr, bool> vis;
-        vis[dfsNum[i]] = true;
-        for(auto&pred:(dfsNum[i]->predBasicBlocks)){
-            list.push(pred);
-            vis[pred] = true;
-        }
-        while(!list.empty()){
-            auto t = list.front();
-            list.pop();
-            if(Dom[i].find(t)!=Dom[i].end()){
-                // dfsNum[i]->directDominator = t;
-                dfsNum[i]->setDirectDominator(t);
-                // t->dominatorSon[dfsNum[i]] = true;
-                t->addDominatorSon(dfsNum[i]);
-                break;
-            }
-            for(auto&pred:(t->predBasicBlocks)){
-                if(vis.find(pred)==vis.end()){
-                    list.push(pred);
-                    vis[pred] = true;
-                }
-            }
-
-        }
+    for(int i=0;i<n-1;i++){
+        postOrder[i]->setDirectDominator(postOrder[idom[i]]);
+        // 每个块只有一个直接支配节点，儿子不会重复，不用insert的线性查找
+        postOrder[idom[i]]->dominatorSon.push_back(postOrder[i]);
     }
-
-    //计算DF
-    for(int i=0;i<dfsNum.size();i++){
-        if(dfsNum[i]->predBasicBlocks.size()>=2){
-            for(auto &pred:(dfsNum[i]->predBasicBlocks)){
-                auto runner = pred;
-                while(runner!=dfsNum[i]->directDominator){
-                    // runner->DF[dfsNum[i]] = true;
-                    runner->addDF(dfsNum[i]);
-                    if(runner->directDominator){
-                        runner = runner->directDominator;
-                    }
-                    else{
-                        break;
-                    }
+    // DF以先序编号为下标，先编号
+    numberDomTree(entry, func->domOrder);
+
+    //计算DF：runner沿idom数组上行，先按块收集成员的先序编号，最后每块排序一次建位集合
+    vector<vector<uint32_t>> dfMembers(n);
+    // 同一个块从多个前驱出发可能走到同一个runner，记下runner最近加入的块去重
+    vector<int> lastAdded(n, -1);
+    for(int i=0;i<n;i++){
+        auto& bb = postOrder[i];
+        if(bb->predBasicBlocks.size()<2)
+            continue;
+        // entry没有直接支配节点，runner一直走到entry（含）为止
+        int stop = i == n-1 ? -1 : idom[i];
+        for(auto &pred:(bb->predBasicBlocks)){
+            if(!func->isNumbered(pred) || postIdx[pred->idx] == -1)
+                continue;
+            for(int r = postIdx[pred->idx]; r != stop; r = r == n-1 ? -1 : idom[r]){
+                if(lastAdded[r] != i){
+                    lastAdded[r] = i;
+                    dfMembers[r].push_back(bb->domPreIdx);
                 }
             }
         }
     }
-
-    computeAllDoms(func->getEntryBlock());
+    for(int i=0;i<n;i++)
+        postOrder[i]->DF.assign(dfMembers[i]);
 }
 
 bool isADominatorB(BasicBlockPtr A, BasicBlockPtr B, BasicBlockPtr entry){
     if(A == entry){
         return true;
     }
+    if(A->hasDomNumber() && B->hasDomNumber()){
+        return A->dominates(B);
+    }
     while(B!=entry){
         if(B == A){
             return true;
@@ -194,12 +165,11 @@ void eraseNotPredBB(FunctionPtr func){
         }
         else{
             //to-do  递归删除
-            for(auto &succ:(func->basicBlocks[i]->succBasicBlocks)){
-                succ->predBasicBlocks.erase(func->basicBlocks[i]);
-            }
+            removeBlockInCFG(func, func->basicBlocks[i]);
         }
     }
     func->basicBlocks = newBB;
+    func->renumberBasicBlocks();
 }
 
 void mem2reg(FunctionPtr func){
@@ -211,21 +181,14 @@ void mem2reg(FunctionPtr func){
 
     //去除对应alloca的entry
     //可以被promote的alloca是只被load和store使用的alloca，在该比赛中就是float和int，实际上ptr应该也不会出现，但是我忘了为啥这样写了，就留着吧
-    vector<InstructionPtr> newEntryInst;
-    for(int i=0;i<entry->instructions.size();i++){
-        if(entry->instructions[i]->type==Alloca){
-            auto tI = ((AllocaInstruction*)(entry->instructions[i].get()));
+    for(auto &ins:(entry->instructions)){
+        if(ins->type==Alloca){
+            auto tI = ((AllocaInstruction*)(ins.get()));
             if(tI->des->type->isFloat()||tI->des->type->isInt()||tI->des->type->isPtr()){
                 //记录需要删除的alloca变量
-                defBB[((AllocaInstruction*)(entry->instructions[i].get()))->des] = {};
-                useBB[((AllocaInstruction*)(entry->instructions[i].get()))->des] = {};
+                defBB[tI->des] = {};
+                useBB[tI->des] = {};
             }
-            else{
-                newEntryInst.emplace_back(entry->instructions[i]);
-            }
-        }
-        else{
-            newEntryInst.emplace_back(entry->instructions[i]);
         }
     }
     //记录store的块
@@ -328,12 +291,11 @@ void mem2reg(FunctionPtr func){
         while(!workList.empty()){
             auto now = workList.front();
             workList.pop();
-            for(auto &df:now->DF){
+            for(auto df:now->DF){
                 if(inserted[df] != valDef.first && liveInBB.find(df) != liveInBB.end()){
 
-                    auto mBegin = df->instructions.begin();
-                    auto phi = InstructionPtr(new PhiInstruction(df, valDef.first));
-                    df->instructions.emplace(mBegin,phi);
+                    InstructionPtr phi = newIR<PhiInstruction>(df, valDef.first);
+                    df->instructions.push_front(phi);
                     inserted[df] = valDef.first;
                     if(inworkList[df]!= valDef.first){
                         inworkList[df] = valDef.first;
@@ -347,7 +309,12 @@ void mem2reg(FunctionPtr func){
 
 
 
-    entry->instructions = newEntryInst;
+    for(auto it = entry->instructions.begin(); it != entry->instructions.end();){
+        if((*it)->type==Alloca&&defBB.count(((AllocaInstruction*)(it->get()))->des))
+            it = entry->instructions.erase(it);
+        else
+            it++;
+    }
     //每个变量一个stack
     unordered_map<ValuePtr ,vector<valBB>> stak;
     for(auto & varDef: defBB){
@@ -360,7 +327,6 @@ void mem2reg(FunctionPtr func){
     }
 
     stack<BasicBlockPtr> list; 
-    vector<InstructionPtr> newInst;
     list.push(entry);
 
 
@@ -372,13 +338,13 @@ void mem2reg(FunctionPtr func){
         auto bb = list.top();
         //cerr<<bb->label->name<<endl;
         list.pop();
-        //先记录要留下的指令，再统一删除，防止超时
-        newInst.clear();
         //cerr<<"label:    "<<bb->label->name<<endl;
-        for(int i=0;i<bb->instructions.size();i++){
-            if(bb->instructions[i]->type == Load){
-                auto to = ((LoadInstruction*)(bb->instructions[i].get()))->to;
-                auto from = ((LoadInstruction*)(bb->instructions[i].get()))->from;
+        for(auto it = bb->instructions.begin(); it != bb->instructions.end();){
+            auto ins = *it;
+            it++;
+            if(ins->type == Load){
+                auto to = ((LoadInstruction*)(ins.get()))->to;
+                auto from = ((LoadInstruction*)(ins.get()))->from;
                 //cerr<<"load:   "<<to->name<<" "<<from->name<<endl;
                 if(stak.find(from)!=stak.end()){
                     //cerr<<"mmmm:   "<<to->name<<" "<<from->name<<endl;
@@ -398,16 +364,14 @@ void mem2reg(FunctionPtr func){
                     // if(!rmInstructionUse(bb->instructions[i], from)){
                     //     cerr<<"error\n";
                     // }
-                    rmInstructionUse(bb->instructions[i], from);
-                }
-                else{
-                    newInst.emplace_back(bb->instructions[i]);
+                    rmInstructionUse(ins, from);
+                    bb->instructions.erase(bb->instructions.iteratorTo(ins.get()));
                 }
             }
             //定义
-            else if(bb->instructions[i]->type == Store){
-                auto des = ((StoreInstruction*)(bb->instructions[i].get()))->des;
-                auto value = ((StoreInstruction*)(bb->instructions[i].get()))->value;
+            else if(ins->type == Store){
+                auto des = ((StoreInstruction*)(ins.get()))->des;
+                auto value = ((StoreInstruction*)(ins.get()))->value;
                 //cerr<<"store:   "<<des->name<<" "<<value->name<<endl;
 
                 if(stak.find(des)!=stak.end()){
@@ -420,24 +384,22 @@ void mem2reg(FunctionPtr func){
                     //     stakIdx--;
                     // }
                     stak[des].emplace_back(valBB(value,bb));
-                    if(!rmInstructionUse(bb->instructions[i], des)){
+                    if(!rmInstructionUse(ins, des)){
                         assert(false&&"cannot rm Store InstructionUse");
                     }
-                    if(!rmInstructionUse(bb->instructions[i], value)){
+                    if(!rmInstructionUse(ins, value)){
                         assert(false&&"cannot rm Store InstructionUse");
                     }
+                    bb->instructions.erase(bb->instructions.iteratorTo(ins.get()));
                     // if(value->name=="binary3"){
                     //         cerr<<"pll   "<<value->numUses<<endl;
                     // }
                 }
-                else{
-                    newInst.emplace_back(bb->instructions[i]);
-                }
             }
             //定义
-            else if(bb->instructions[i]->type == Phi){
-                auto val = ((PhiInstruction*)(bb->instructions[i].get()))->val;
-                auto reg = ((PhiInstruction*)(bb->instructions[i].get()))->reg;
+            else if(ins->type == Phi){
+                auto val = ((PhiInstruction*)(ins.get()))->val;
+                auto reg = ((PhiInstruction*)(ins.get()))->reg;
                 //cerr<<"phi:   "<<reg->name<<" "<<val->name<<endl;
                 if(stak.find(val)!=stak.end()){
                     //cerr<<"phi:   "<<reg->name<<" "<<val->name<<endl;
@@ -452,12 +414,8 @@ void mem2reg(FunctionPtr func){
 
                     stak[val].emplace_back(valBB(reg,bb));
                 }
-                newInst.emplace_back(bb->instructions[i]);
                 //phi指令不用删除
             }
-            else{
-                newInst.emplace_back(bb->instructions[i]);
-            }
         }
 
         for(auto &succ:(bb->succBasicBlocks)){
@@ -497,7 +455,6 @@ void mem2reg(FunctionPtr func){
             }
         }
 
-        bb->instructions = newInst;
         // for(auto &domson:(bb->dominatorSon)){
         //     list.push(domson.first);
         // }
@@ -4,15 +4,12 @@
 #include <queue>
 #include <stack>
 #include "Module.h"
+#include "analysisManager.h"
+#include "createCFG.h"
 
 using namespace std;
-struct node{
-    shared_ptr<BasicBlock> bb;
-    vector<node*> son;
-    node* father = nullptr;
-    node(shared_ptr<BasicBlock> ibb):bb{ibb}{};
-};
-
-
 void domTree(FunctionPtr func);
-void mem2reg(FunctionPtr func);
\ No newline at end of file
+void mem2reg(FunctionPtr func);
+// mem2reg只删除不可达块并插入phi
+const unsigned mem2regRequires = AnalysisCFG | AnalysisDom;
+const unsigned mem2regPreserves = AnalysisCFG | AnalysisDom | AnalysisUse;
@@ -0,0 +1,208 @@
+#include "memorySSA.h"
+
+// gep第0维下标加1时跨过的元素数；全局数组和局部数组的from就是数组本身，第0维只能是0，返回0
+static long long firstStride(Value *from) {
+    auto type = from->type;
+    if(type->isPtr())
+        return dynamic_cast<PtrType *>(type.get())->inner->getNumElements();
+    return type->isArr() ? 0 : 1;
+}
+
+MemoryLocation getMemoryLocation(Value *addr) {
+    MemoryLocation loc;
+    loc.addr = addr;
+    loc.constOffset = true;
+    // 沿gep链向上累加常量偏移，遇到非常量下标或bitcast后只保留基址
+    Value *cur = addr;
+    while(cur->I && (cur->I->type == GEP || cur->I->type == Bitcast)) {
+        if(cur->I->type == Bitcast) {
+            loc.constOffset = false;
+            cur = ((BitCastInstruction *)cur->I)->from.get();
+            continue;
+        }
+        auto gep = (GetElementPtrInstruction *)cur->I;
+        if(loc.constOffset) {
+            long long stride = firstStride(gep->from.get());
+            auto first = dynamic_cast<Const *>(gep->index[0].get());
+            if(!first || (stride == 0 && first->intVal != 0))
+                loc.constOffset = false;
+            else
+                loc.offset += stride * first->intVal;
+            TypePtr type = gep->from->type;
+            for(size_t k = 1; k < gep->index.size() && loc.constOffset; k++) {
+                if(type->isPtr())
+                    type = dynamic_cast<PtrType *>(type.get())->inner;
+                auto arr = dynamic_cast<ArrType *>(type.get());
+                auto idx = dynamic_cast<Const *>(gep->index[k].get());
+                if(!arr || !idx) {
+                    loc.constOffset = false;
+                    break;
+                }
+                loc.offset += (long long)arr->getStride() * idx->intVal;
+                type = arr->inner;
+            }
+        }
+        cur = gep->from.get();
+    }
+    loc.base = cur;
+    auto var = dynamic_cast<Variable *>(cur);
+    if(var && var->isGlobal)
+        loc.baseKind = GlobalBase;
+    else if(cur->I && cur->I->type == Alloca)
+        loc.baseKind = LocalBase;
+    else if(var && !cur->I)
+        loc.baseKind = ArgumentBase;
+    else
+        loc.baseKind = UnknownBase;
+    if(!loc.constOffset)
+        loc.offset = 0;
+    return loc;
+}
+
+bool mayAlias(const MemoryLocation& a, const MemoryLocation& b) {
+    if(a.base == b.base) {
+        if(a.baseKind != UnknownBase && a.constOffset && b.constOffset)
+            return a.offset == b.offset;
+        return true;
+    }
+    auto ka = a.baseKind, kb = b.baseKind;
+    if(ka == UnknownBase || kb == UnknownBase)
+        return true;
+    // 不同的全局变量、局部数组互不重叠；形参指向调用者的内存，不会是本函数的局部数组
+    if(ka == ArgumentBase && kb == ArgumentBase)
+        return true;
+    if(ka == ArgumentBase || kb == ArgumentBase)
+        return ka != LocalBase && kb != LocalBase;
+    return false;
+}
+
+MemoryAccess *MemorySSA::newAccess(MemoryAccessKind kind, BasicBlock *block, Instruction *instr) {
+    accesses.emplace_back(new MemoryAccess(kind, block, instr));
+    return accesses.back().get();
+}
+
+MemorySSA::MemorySSA(FunctionPtr func) : func{func}, isMain{func->name == "main"} {
+    auto entry = func->getEntryBlock();
+    liveOnEntry = newAccess(MemoryDef, entry.get(), nullptr);
+
+    // 按指令建立访问，记录含MemoryDef的块
+    vector<BasicBlockPtr> defBlocks;
+    for(auto& bb : func->basicBlocks) {
+        if(!bb->hasDomNumber())
+            continue;
+        bool hasDef = false;
+        for(auto& ins : bb->instructions) {
+            MemoryAccessKind kind;
+            if(ins->type == Store)
+                kind = MemoryDef;
+            else if(ins->type == Load || ins->type == Return)
+                kind = MemoryUse;
+            else if(ins->type == Call) {
+                auto& effects = getFunctionEffects(((CallInstruction *)ins.get())->func.get());
+                if(effects.writesMemory())
+                    kind = MemoryDef;
+                else if(effects.readsMemory())
+                    kind = MemoryUse;
+                else
+                    continue;
+            }
+            else
+                continue;
+            auto access = newAccess(kind, bb.get(), ins.get());
+            instrAccess[ins.get()] = access;
+            blockAccesses[bb.get()].push_back(access);
+            hasDef |= kind == MemoryDef;
+        }
+        if(hasDef)
+            defBlocks.push_back(bb);
+    }
+
+    // 在含MemoryDef的块的迭代支配边界上放MemoryPhi
+    while(!defBlocks.empty()) {
+        auto bb = defBlocks.back();
+        defBlocks.pop_back();
+        for(auto df : bb->DF) {
+            if(phis.count(df.get()))
+                continue;
+            auto phi = newAccess(MemoryPhi, df.get(), nullptr);
+            phis[df.get()] = phi;
+            auto& list = blockAccesses[df.get()];
+            list.insert(list.begin(), phi);
+            defBlocks.push_back(df);
+        }
+    }
+
+    // 沿支配树先序遍历重命名，块入口的定义是块中的MemoryPhi或直接支配者出口的定义
+    unordered_map<BasicBlock *, MemoryAccess *> exitDef;
+    vector<BasicBlockPtr> stack = {entry};
+    while(!stack.empty()) {
+        auto bb = stack.back();
+        stack.pop_back();
+        MemoryAccess *cur = bb == entry ? liveOnEntry : exitDef[bb->directDominator.get()];
+        for(auto access : blockAccesses[bb.get()]) {
+            if(access->kind == MemoryPhi) {
+                cur = access;
+                continue;
+            }
+            access->defining = cur;
+            cur->users.push_back(access);
+            if(access->kind == MemoryDef)
+                cur = access;
+        }
+        exitDef[bb.get()] = cur;
+        for(auto it = bb->dominatorSon.rbegin(); it != bb->dominatorSon.rend(); it++)
+            stack.push_back(*it);
+    }
+    for(auto& [bb, phi] : phis)
+        for(auto& pred : bb->predBasicBlocks) {
+            if(!pred->hasDomNumber())
+                continue;
+            auto def = exitDef[pred.get()];
+            phi->incoming.push_back({def, pred.get()});
+            def->users.push_back(phi);
+        }
+}
+
+MemoryAccess *MemorySSA::getAccess(Instruction *instr) {
+    auto it = instrAccess.find(instr);
+    return it == instrAccess.end() ? nullptr : it->second;
+}
+
+MemoryAccess *MemorySSA::getPhi(BasicBlock *bb) {
+    auto it = phis.find(bb);
+    return it == phis.end() ? nullptr : it->second;
+}
+
+const vector<MemoryAccess *>& MemorySSA::getBlockAccesses(BasicBlock *bb) {
+    return blockAccesses[bb];
+}
+
+bool MemorySSA::mayRead(Instruction *instr, const MemoryLocation& loc) {
+    if(instr->type == Load)
+        return mayAlias(getMemoryLocation(((LoadInstruction *)instr)->from.get()), loc);
+    if(instr->type == Call)
+        return callMayRef((CallInstruction *)instr, loc.base);
+    if(instr->type == Return)
+        // main返回后程序就结束了；局部数组在返回后不再可见
+        return !isMain && loc.baseKind != LocalBase;
+    return false;
+}
+
+void MemorySSA::removeAccess(MemoryAccess *access) {
+    assert(access->kind != MemoryPhi);
+    auto def = access->defining;
+    auto& defUsers = def->users;
+    defUsers.erase(std::find(defUsers.begin(), defUsers.end(), access));
+    for(auto user : access->users) {
+        if(user->defining == access)
+            user->defining = def;
+        for(auto& in : user->incoming)
+            if(in.first == access)
+                in.first = def;
+        defUsers.push_back(user);
+    }
+    access->users.clear();
+    auto& list = blockAccesses[access->block];
+    list.erase(std::find(list.begin(), list.end(), access));
+    instrAccess.erase(access->instr);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Module.h"
+#include "callEffects.h"
+
+// 内存的SSA形式：把所有内存看作一个变量，写内存的指令（store、写内存的调用）是它的定义MemoryDef，
+// 读内存的指令（load、读内存的调用、return）是它的使用MemoryUse，支配边界处放MemoryPhi。
+// 每个访问只记录到达它的最近定义，是否真的访问同一块内存由MemoryLocation判断
+
+enum MemoryAccessKind {
+    MemoryUse,
+    MemoryDef,
+    MemoryPhi,
+};
+
+struct MemoryAccess {
+    MemoryAccessKind kind;
+    BasicBlock *block;
+    // 对应的指令，MemoryPhi和函数入口的liveOnEntry为nullptr
+    Instruction *instr;
+    // MemoryUse/MemoryDef之前最近的定义
+    MemoryAccess *defining = nullptr;
+    // MemoryPhi各前驱流入的定义
+    vector<pair<MemoryAccess *, BasicBlock *>> incoming;
+    // 以这个定义为defining或incoming的访问
+    vector<MemoryAccess *> users;
+
+    MemoryAccess(MemoryAccessKind kind, BasicBlock *block, Instruction *instr) : kind{kind}, block{block}, instr{instr} {}
+};
+
+// 基址的来历：全局变量、局部数组、形参指向的内存，以及其他来历不明的指针
+enum MemoryBaseKind {
+    GlobalBase,
+    LocalBase,
+    ArgumentBase,
+    UnknownBase,
+};
+
+// 访问的位置：基址加上以元素为单位的偏移，gep的下标都是常量时偏移已知
+struct MemoryLocation {
+    Value *addr = nullptr;
+    Value *base = nullptr;
+    MemoryBaseKind baseKind = UnknownBase;
+    bool constOffset = false;
+    long long offset = 0;
+};
+
+MemoryLocation getMemoryLocation(Value *addr);
+// 两个位置可能重叠
+bool mayAlias(const MemoryLocation& a, const MemoryLocation& b);
+
+// 需要CFG和支配树，函数改动后要重新构造；删除store等写内存的指令时用removeAccess同步
+struct MemorySSA {
+    FunctionPtr func;
+    MemoryAccess *liveOnEntry;
+
+    MemorySSA(FunctionPtr func);
+    // 指令对应的MemoryUse/MemoryDef，不访问内存的指令为nullptr
+    MemoryAccess *getAccess(Instruction *instr);
+    MemoryAccess *getPhi(BasicBlock *bb);
+    // 块中的访问按执行顺序排列，MemoryPhi在最前
+    const vector<MemoryAccess *>& getBlockAccesses(BasicBlock *bb);
+    // 指令是否可能读loc；return读函数返回后仍能看到的内存
+    bool mayRead(Instruction *instr, const MemoryLocation& loc);
+    // 摘掉一个MemoryDef，它的使用者改用它的defining，之后再删除指令本身
+    void removeAccess(MemoryAccess *access);
+
+private:
+    vector<unique_ptr<MemoryAccess>> accesses;
+    unordered_map<Instruction *, MemoryAccess *> instrAccess;
+    unordered_map<BasicBlock *, MemoryAccess *> phis;
+    unordered_map<BasicBlock *, vector<MemoryAccess *>> blockAccesses;
+    bool isMain;
+
+    MemoryAccess *newAccess(MemoryAccessKind kind, BasicBlock *block, Instruction *instr);
+};
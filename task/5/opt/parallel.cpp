@@ -0,0 +1,93 @@
+#include "parallel.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+};
+
+// 自己的队列从头部取，别人的队列从尾部偷，减少和队列主人的竞争
+static bool takeTask(WorkQueue& queue, bool steal, int& task) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.tasks.empty())
+        return false;
+    if(steal) {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+    }
+    else {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+    }
+    return true;
+}
+
+void parallelFor(int numTasks, int numThreads, const std::function<void(int)>& task) {
+    numThreads = std::min(numThreads, numTasks);
+    if(numThreads <= 1) {
+        for(int i = 0; i < numTasks; i++)
+            task(i);
+        return;
+    }
+
+    vector<WorkQueue> queues(numThreads);
+    for(int i = 0; i < numTasks; i++)
+        queues[i % numThreads].tasks.push_back(i);
+
+    auto worker = [&](int self) {
+        int t;
+        while(true) {
+            if(takeTask(queues[self], false, t)) {
+                task(t);
+                continue;
+            }
+            // 任务不会再增加，所有队列都偷不到时就结束
+            bool found = false;
+            for(int k = 1; k < numThreads && !found; k++)
+                found = takeTask(queues[(self + k) % numThreads], true, t);
+            if(!found)
+                break;
+            task(t);
+        }
+    };
+
+    vector<std::thread> threads;
+    for(int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for(auto& thread: threads)
+        thread.join();
+}
+
+void forEachFunction(Module& ir, int numThreads, const std::function<void(FunctionPtr)>& pipeline) {
+    vector<FunctionPtr> funcs;
+    for(auto& func: ir.globalFunctions)
+        if(!func->isLib)
+            funcs.push_back(func);
+
+    // 大函数先分出去，避免最后只剩一个线程在处理大函数
+    vector<size_t> sizes;
+    for(auto& func: funcs) {
+        size_t size = 0;
+        for(auto bb: func->basicBlocks)
+            size += bb->instructions.size();
+        sizes.push_back(size);
+    }
+    vector<int> order(funcs.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+    vector<vector<int>> counters(funcs.size(), NameCounter::snapshot());
+    parallelFor(funcs.size(), numThreads, [&](int i) {
+        int idx = order[i];
+        NameCounter::Scope scope(counters[idx]);
+        IRArena::Scope arenaScope(funcs[idx]->arena.get());
+        pipeline(funcs[idx]);
+    });
+    for(auto& counter: counters)
+        NameCounter::merge(counter);
+}
@@ -0,0 +1,12 @@
+// 按函数并行执行优化
+#pragma once
+#include <functional>
+#include "Module.h"
+
+// 对[0, numTasks)中的每个下标调用一次task，返回时全部完成
+// 工作窃取调度：任务依次轮流分到各线程的队列，线程先从自己队列的头部取任务，取完后从其他线程队列的尾部偷
+void parallelFor(int numTasks, int numThreads, const std::function<void(int)>& task);
+
+// 在每个非库函数上运行pipeline，pipeline只能修改传入的函数
+// 每个函数从同一份全局计数开始命名（见NameCounter），输出与线程数和调度顺序无关
+void forEachFunction(Module& ir, int numThreads, const std::function<void(FunctionPtr)>& pipeline);
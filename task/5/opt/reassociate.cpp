@@ -10,26 +10,27 @@
 #endif
 
 
-unordered_map<ValuePtr, unsigned> ValueRankMap;
-unordered_map<BasicBlockPtr, unsigned> BBRankMap;
-unordered_map<Instruction*, unsigned> IRankMap;
+// pass内部的状态，按线程划分，并行优化多个函数时互不干扰
+thread_local unordered_map<ValuePtr, unsigned> ValueRankMap;
+thread_local unordered_map<BasicBlockPtr, unsigned> BBRankMap;
+thread_local unordered_map<Instruction*, unsigned> IRankMap;
 
-unordered_set<Instruction*> isInRedoInsts;
-unordered_set<Instruction*> eraseSet;
+thread_local unordered_set<Instruction*> isInRedoInsts;
+thread_local unordered_set<Instruction*> eraseSet;
 
-vector<Instruction* > RedoInsts;
+thread_local vector<Instruction* > RedoInsts;
 
 
 
-int NumChanged = 0;
-int NumAnnihil = 0;
-int NumFactor = 0;
+thread_local int NumChanged = 0;
+thread_local int NumAnnihil = 0;
+thread_local int NumFactor = 0;
 
 
 
 using RepeatedValue = std::pair<ValuePtr, int>;
 
-bool MadeChange = false;
+thread_local bool MadeChange = false;
 struct PairMapValue {
     ValuePtr Value1;
     ValuePtr Value2;                                        
@@ -40,7 +41,7 @@ struct PairMapValue {
 };
 //目前的实现中总共12种二元操作
 const int NumBinaryOps = 12;
-map<std::pair<ValuePtr, ValuePtr>, PairMapValue> PairMap[NumBinaryOps];
+thread_local map<std::pair<ValuePtr, ValuePtr>, PairMapValue> PairMap[NumBinaryOps];
 
 static const unsigned GlobalReassociateLimit = 10;
 
@@ -61,22 +62,16 @@ struct Factor{
 
 void insertInstruction(InstructionPtr instruction, Instruction* InsertBefore){
 
-    auto curInstruction = InsertBefore->basicblock->instructions.begin();
-    while (curInstruction != InsertBefore->basicblock->instructions.end())
-    {
-        if ((*curInstruction).get() == InsertBefore) break;
-        curInstruction++;
-    }
     // make sure next can be found
-    assert(curInstruction != InsertBefore->basicblock->instructions.end());
-    InsertBefore->basicblock->instructions.emplace(curInstruction, instruction);
+    assert(InsertBefore->ownerList == &InsertBefore->basicblock->instructions);
+    InsertBefore->basicblock->instructions.insert(InsertBefore->getIterator(), instruction);
     instruction->basicblock = InsertBefore->basicblock;
 }
 
 
 static  InstructionPtr CreateMul(ValuePtr S1, ValuePtr S2, Instruction* InsertBefore){
     if(S1->type->isInt()){
-        InstructionPtr Mul = InstructionPtr(new BinaryInstruction(S1,S2,'*',InsertBefore));
+        InstructionPtr Mul = newIR<BinaryInstruction>(S1,S2,'*',InsertBefore);
         error("insert before\n");
         //在构造函数中插入了
         insertInstruction(Mul, InsertBefore);
@@ -86,7 +81,7 @@ static  InstructionPtr CreateMul(ValuePtr S1, ValuePtr S2, Instruction* InsertBe
     }
     else{
         error("Finsert before\n");
-        InstructionPtr FMul = InstructionPtr(new BinaryInstruction(S1,S2,'*',InsertBefore));
+        InstructionPtr FMul = newIR<BinaryInstruction>(S1,S2,'*',InsertBefore);
         insertInstruction(FMul, InsertBefore);
         return FMul;
     }
@@ -96,13 +91,13 @@ static  InstructionPtr CreateMul(ValuePtr S1, ValuePtr S2, Instruction* InsertBe
 static InstructionPtr CreateNeg(ValuePtr S1,string name,InstructionPtr insertBefore){
    
     if(S1->type->isInt()){
-        InstructionPtr Neg = InstructionPtr(new BinaryInstruction(Const::getConst(Type::getInt(),int(0)),S1,'-',insertBefore.get()));
+        InstructionPtr Neg = newIR<BinaryInstruction>(Const::getConst(Type::getInt(),int(0)),S1,'-',insertBefore.get());
         insertInstruction(Neg,insertBefore.get());
         return Neg;
     }
     else if(S1->type->isFloat()){
         //因为这个指令没有实现insertbefore版本
-        InstructionPtr fneg = InstructionPtr(new FnegInstruction(S1,insertBefore->basicblock));
+        InstructionPtr fneg = newIR<FnegInstruction>(S1,nonOwning(insertBefore->basicblock));
         insertInstruction(fneg,insertBefore.get());
         return fneg;
     }
@@ -127,9 +122,9 @@ static  InstructionPtr CreateAdd(ValuePtr S1, ValuePtr S2, InstructionPtr Insert
         if(S2->I)error(S2->I->reg->name<<endl);
         if(S2->I)error(S2->I<<endl);
         if(S2->I)error("smart   "<<S2->I->getSharedThis()<<endl);
-        auto temp = new BinaryInstruction(S1,S2,'+',InsertBefore.get());
+        auto temp = newIR<BinaryInstruction>(S1,S2,'+',InsertBefore.get());
         error(temp<<endl);
-        InstructionPtr Add = InstructionPtr(temp);
+        InstructionPtr Add = temp;
         error("insert before\n");
         //在构造函数中插入了
         error(Add->reg->name<<endl);
@@ -143,7 +138,7 @@ static  InstructionPtr CreateAdd(ValuePtr S1, ValuePtr S2, InstructionPtr Insert
         return Add;
     }
     else{
-        InstructionPtr FAdd = InstructionPtr(new BinaryInstruction(S1,S2,'+',InsertBefore.get()));
+        InstructionPtr FAdd = newIR<BinaryInstruction>(S1,S2,'+',InsertBefore.get());
         insertInstruction(FAdd, InsertBefore.get());
         return FAdd;
     }
@@ -199,7 +194,7 @@ void buildRankMap(FunctionPtr func, vector<BasicBlockPtr> & rpoBB){
     }
     for(auto& BB:rpoBB){
         unsigned BBRank = BBRankMap[BB] = ++Rank<<16;
-        for(InstructionPtr & I:BB->instructions){
+        for(const InstructionPtr & I:BB->instructions){
             if(isInsLoadOrStore(I)){
                 IRankMap[I.get()] = ++BBRank;
             }
@@ -236,7 +231,7 @@ unsigned getRank(Instruction* Ins){
     }
 
   
-    unsigned Rank = 0, MaxRank = BBRankMap[Ins->basicblock];
+    unsigned Rank = 0, MaxRank = BBRankMap[nonOwning(Ins->basicblock)];
 
 
     for(unsigned i = 0,e = Ins->getNumOperands();i!=e &&Rank!=MaxRank;++i){
@@ -474,7 +469,7 @@ static bool LinearizeExprTree(Instruction* I, vector<RepeatedValue>& Ops){
             ValuePtr Op = I->getOperand(OpIdx);
             int weight = P.second;
             error("LinearizeExprTree30\n");
-            assert(!((Op->numUses)==0)&&"No used");
+            assert((!Op->trackUses||Op->numUses!=0)&&"No used");
             error("LinearizeExprTree32\n");
             error(Op->name<<endl);
             if(Op->I) error(Op->I->reg->name<<" "<<(Op->I==I)<<endl);
@@ -798,7 +793,7 @@ void RewriteExprTree(BinaryInstruction* I, vector<ValueEntry>&Ops){
             ValuePtr Undef = Const::getConst(Type::getInt(), 0);
             // opcode应该为与原式相同，后面才会被认为是inner node
             //先构造一下，防止之后没得用
-            auto temp = InstructionPtr(new BinaryInstruction(Undef,Undef,I->op,I));
+            InstructionPtr temp = newIR<BinaryInstruction>(Undef,Undef,I->op,I);
             NewOp = dynamic_cast<BinaryInstruction*>(temp.get());
     
             insertInstruction(NewOp->getSharedThis(), I);
@@ -977,7 +972,7 @@ static ValuePtr buildMultiplyTree(vector<ValuePtr>&Ops,Instruction* InsertBefore
     ValuePtr LHS = Ops.back();
     Ops.pop_back();
     do{
-        auto tempI = InstructionPtr(new BinaryInstruction(LHS,Ops.back(),'*',InsertBefore));
+        InstructionPtr tempI = newIR<BinaryInstruction>(LHS,Ops.back(),'*',InsertBefore);
         insertInstruction(tempI,InsertBefore);
         LHS = tempI->reg;
     }while(!Ops.empty());
@@ -1405,7 +1400,7 @@ void ReassociateExpression(BinaryInstruction* I){
                 }
                 else{
                     error("ReassociateExpression324\n");
-                    SeenBB = CurrLeafInstr->basicblock;
+                    SeenBB = nonOwning(CurrLeafInstr->basicblock);
                     error("ReassociateExpression325\n");
                 }
 
@@ -1544,12 +1539,12 @@ static ValuePtr NegateValue(ValuePtr V, BinaryInstruction* BI,vector<Instruction
             continue;
         }
 
-        vector<InstructionPtr>::iterator InsertBefore;
+        InstructionList::iterator InsertBefore;
         if(Instruction* InstInput = V->I){
             if(V->I->type==Phi){
                 InsertBefore = InstInput->basicblock->instructions.end();
                 InsertBefore--;
-                if((InsertBefore!=InstInput->basicblock->instructions.begin())&&((*(InsertBefore-1))->type==Icmp||(*(InsertBefore-1))->type==Fcmp)){
+                if((InsertBefore!=InstInput->basicblock->instructions.begin())&&((*std::prev(InsertBefore))->type==Icmp||(*std::prev(InsertBefore))->type==Fcmp)){
                     InsertBefore--;
                 }
             }
@@ -1662,6 +1657,7 @@ void OptimizeInst(InstructionPtr I){
                                 RedoInsts.push_back(use->user);
                             }
                         }
+                        use = use->next;
                     }
                     RedoInsts.push_back(BI);
                     MadeChange = true;
@@ -1706,6 +1702,9 @@ void clearAllReassociate(){
     BBRankMap.clear();
     IRankMap.clear();
     RedoInsts.clear();
+    // 上一个函数留下的指令地址可能被新指令复用，不清空的话结果会依赖之前处理过哪些函数
+    isInRedoInsts.clear();
+    eraseSet.clear();
 
     NumChanged = 0;
     NumAnnihil = 0;
@@ -1870,19 +1869,22 @@ void reassociate(FunctionPtr func){
             error("before isDeadCode\n");
             if(isDeadCode((*it).get())){
                 error("before eraseInst\n");
-                EraseInst((*it).get());
+                // EraseInst只删这一条指令，先移到下一条
+                auto I = (*it).get();
+                it++;
+                EraseInst(I);
                 error("after EraseInst\n");
             }
             else{
                 error("before OptimizeInst\n");
                 auto tempI = *it;
                 OptimizeInst(*it);
-                it = find(BB->instructions.begin(),BB->instructions.end(),tempI);
-                if(it==BB->instructions.end()){
+                if(tempI->ownerList!=&BB->instructions){
                     assert(false&&"error");
                 }
+                it = BB->instructions.iteratorTo(tempI.get());
                 error("after OptimizeInst\n");
-                assert((*it)->basicblock == BB && "Moved to a different block");
+                assert((*it)->basicblock == BB.get() && "Moved to a different block");
                 it++;
             }
             
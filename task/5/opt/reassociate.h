@@ -13,6 +13,7 @@
 #include <algorithm>
 
 #include "Module.h"
+#include "analysisManager.h"
 
 using namespace std;
 
@@ -22,5 +23,8 @@ using namespace std;
 
 
 void reassociate(FunctionPtr func);
+// 只在基本块内重排指令
+const unsigned reassociateRequires = AnalysisUse;
+const unsigned reassociatePreserves = AnalysisCFG | AnalysisDom | AnalysisLoop;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include "sccp.h"
+#include <climits>
+
+namespace {
+
+enum LatticeState { Unknown, Constant, Overdefined };
+
+// 格上的值，Constant时c为对应的常量
+struct LatticeVal {
+    LatticeState state = Unknown;
+    ValuePtr c;
+};
+
+Const *asConst(const ValuePtr &v) {
+    return dynamic_cast<Const *>(v.get());
+}
+
+// 按int运算时的值，int按32位截断
+long long constInt(Const *c) {
+    if (c->type->isBool())
+        return c->boolVal;
+    if (c->type == Type::getInt())
+        return (int)c->intVal;
+    return c->intVal;
+}
+
+bool constTruth(Const *c) {
+    if (c->type->isBool())
+        return c->boolVal;
+    if (c->type->isFloat())
+        return c->floatVal != 0;
+    return c->intVal != 0;
+}
+
+bool sameConst(const ValuePtr &x, const ValuePtr &y) {
+    if (x == y)
+        return true;
+    auto a = asConst(x), b = asConst(y);
+    if (a->type != b->type)
+        return false;
+    if (a->type->isFloat())
+        return a->floatVal == b->floatVal;
+    return constInt(a) == constInt(b);
+}
+
+template <typename T>
+ValuePtr foldCompare(const string &op, T x, T y) {
+    bool res;
+    if (op == "!=")
+        res = x != y;
+    else if (op == ">")
+        res = x > y;
+    else if (op == ">=")
+        res = x >= y;
+    else if (op == "<")
+        res = x < y;
+    else if (op == "<=")
+        res = x <= y;
+    else if (op == "==")
+        res = x == y;
+    else
+        return nullptr;
+    return Const::getConst(Type::getBool(), res);
+}
+
+// int运算按32位补码回绕，除零、INT_MIN/-1和越界移位不折叠，留给运行时
+ValuePtr foldBinary(BinaryInstruction *B, Const *a, Const *b) {
+    if (a->type->isFloat() && b->type->isFloat()) {
+        float x = a->floatVal, y = b->floatVal, r;
+        switch (B->op) {
+        case '+': r = x + y; break;
+        case '-': r = x - y; break;
+        case '*': r = x * y; break;
+        case '/': r = x / y; break;
+        default: return nullptr;
+        }
+        return Const::getConst(Type::getFloat(), r);
+    }
+    if (B->op == '!') {
+        if (!a->type->isBool() || !b->type->isBool())
+            return nullptr;
+        return Const::getConst(Type::getBool(), (bool)(a->boolVal ^ b->boolVal));
+    }
+    if (B->reg->type != Type::getInt() || a->type->isFloat() || b->type->isFloat())
+        return nullptr;
+    int x = constInt(a), y = constInt(b);
+    unsigned ux = x, uy = y;
+    int r;
+    switch (B->op) {
+    case '+': r = ux + uy; break;
+    case '-': r = ux - uy; break;
+    case '*': r = ux * uy; break;
+    case '/':
+    case '%':
+        if (y == 0 || (x == INT_MIN && y == -1))
+            return nullptr;
+        r = B->op == '/' ? x / y : x % y;
+        break;
+    case ',':
+    case '.':
+        if (y < 0 || y > 31)
+            return nullptr;
+        r = B->op == ',' ? (int)(ux << y) : x >> y;
+        break;
+    default: return nullptr;
+    }
+    return Const::getConst(Type::getInt(), r);
+}
+
+ValuePtr foldExt(ExtInstruction *E, Const *f) {
+    if (f->type->isFloat())
+        return nullptr;
+    long long v;
+    if (f->type->isBool())
+        v = E->isign ? -(long long)f->boolVal : f->boolVal;
+    else
+        v = E->isign ? (long long)(int)f->intVal : (long long)(unsigned)f->intVal;
+    if (E->to == Type::getInt())
+        return Const::getConst(Type::getInt(), (int)v);
+    if (E->to == Type::getInt64())
+        return Const::getConst(Type::getInt64(), v);
+    return nullptr;
+}
+
+// 操作数在格上全为常量时求值，ops按getOperand的顺序给出，不能折叠返回nullptr
+ValuePtr foldInstruction(Instruction *I, Const **ops) {
+    switch (I->type) {
+    case Binary:
+        return foldBinary((BinaryInstruction *)I, ops[0], ops[1]);
+    case Icmp: {
+        auto a = ops[0], b = ops[1];
+        if (a->type->isFloat() || b->type->isFloat())
+            return nullptr;
+        return foldCompare(((IcmpInstruction *)I)->op, constInt(a), constInt(b));
+    }
+    case Fcmp: {
+        auto a = ops[0], b = ops[1];
+        if (!a->type->isFloat() || !b->type->isFloat())
+            return nullptr;
+        return foldCompare(((FcmpInstruction *)I)->op, a->floatVal, b->floatVal);
+    }
+    case Ext:
+        return foldExt((ExtInstruction *)I, ops[0]);
+    case Sitofp: {
+        auto f = ops[0];
+        if (f->type->isFloat())
+            return nullptr;
+        return Const::getConst(Type::getFloat(), (float)constInt(f));
+    }
+    case Fptosi: {
+        auto f = ops[0];
+        // 超出int范围（含NaN）时结果未定义，不折叠
+        if (!f->type->isFloat() || !(f->floatVal > -2147483649.0 && f->floatVal < 2147483648.0))
+            return nullptr;
+        return Const::getConst(Type::getInt(), (int)f->floatVal);
+    }
+    case Fneg: {
+        auto f = ops[0];
+        if (!f->type->isFloat())
+            return nullptr;
+        return Const::getConst(Type::getFloat(), -f->floatVal);
+    }
+    default:
+        return nullptr;
+    }
+}
+
+struct SCCPSolver {
+    FunctionPtr func;
+    // 函数内每条指令的结果，不在表中的值（参数、全局变量）视为非常量
+    unordered_map<Value *, LatticeVal> values;
+    // 指令所在块的下标
+    unordered_map<Instruction *, int> blockOf;
+    vector<bool> executable;
+    // 每个块已确定可执行的入边的来源块
+    vector<vector<BasicBlock *>> execPreds;
+    // CFG工作表：新变为可执行的边；SSA工作表：格值下降后需要重新求值的指令
+    vector<pair<BasicBlock *, BasicBlock *>> cfgWork;
+    vector<Instruction *> ssaWork;
+
+    SCCPSolver(FunctionPtr func) : func{func} {
+        func->renumberBasicBlocks();
+        executable.assign(func->basicBlocks.size(), false);
+        execPreds.resize(func->basicBlocks.size());
+        for (auto &bb : func->basicBlocks) {
+            for (auto &I : bb->instructions) {
+                blockOf[I.get()] = bb->idx;
+                if (I->reg && !I->reg->isVoid)
+                    values[I->reg.get()];
+            }
+        }
+    }
+
+    LatticeVal get(const ValuePtr &v) {
+        if (asConst(v))
+            return {Constant, v};
+        auto it = values.find(v.get());
+        if (it == values.end())
+            return {Overdefined, nullptr};
+        return it->second;
+    }
+
+    // 格值只能单调下降：Unknown -> Constant -> Overdefined
+    void update(Value *v, LatticeVal nv) {
+        auto it = values.find(v);
+        if (it == values.end())
+            return;
+        auto &old = it->second;
+        if (old.state == Overdefined || nv.state == Unknown)
+            return;
+        if (old.state == Constant) {
+            if (nv.state == Constant && sameConst(old.c, nv.c))
+                return;
+            nv = {Overdefined, nullptr};
+        }
+        old = nv;
+        for (Use *use = v->useHead; use != nullptr; use = use->next)
+            ssaWork.push_back(use->user);
+    }
+
+    BasicBlock *target(const LabelPtr &label) {
+        auto it = func->LabelBBMap.find(label);
+        assert(it != func->LabelBBMap.end() && "branch to unknown label");
+        return it->second.get();
+    }
+
+    bool isExecEdge(BasicBlock *pred, BasicBlock *succ) {
+        auto &preds = execPreds[succ->idx];
+        return std::find(preds.begin(), preds.end(), pred) != preds.end();
+    }
+
+    void markEdge(BasicBlock *pred, BasicBlock *succ) {
+        if (!isExecEdge(pred, succ))
+            cfgWork.push_back({pred, succ});
+    }
+
+    void visitPhi(PhiInstruction *P) {
+        auto bb = func->basicBlocks[blockOf[P]].get();
+        LatticeVal res;
+        for (auto &f : P->from) {
+            if (!isExecEdge(f.second.get(), bb))
+                continue;
+            auto v = get(f.first);
+            if (v.state == Unknown)
+                continue;
+            if (v.state == Overdefined || (res.state == Constant && !sameConst(res.c, v.c))) {
+                res = {Overdefined, nullptr};
+                break;
+            }
+            res = v;
+        }
+        update(P->reg.get(), res);
+    }
+
+    void visitBr(BrInstruction *B) {
+        auto bb = func->basicBlocks[blockOf[B]].get();
+        if (!B->exp) {
+            markEdge(bb, target(B->label_true));
+            return;
+        }
+        auto cond = get(B->exp);
+        if (cond.state == Constant) {
+            markEdge(bb, target(constTruth(asConst(cond.c)) ? B->label_true : B->label_false));
+        } else if (cond.state == Overdefined) {
+            markEdge(bb, target(B->label_true));
+            markEdge(bb, target(B->label_false));
+        }
+    }
+
+    void visit(Instruction *I) {
+        switch (I->type) {
+        case Phi:
+            visitPhi((PhiInstruction *)I);
+            return;
+        case Br:
+            visitBr((BrInstruction *)I);
+            return;
+        case Binary:
+        case Icmp:
+        case Fcmp:
+        case Ext:
+        case Sitofp:
+        case Fptosi:
+        case Fneg: {
+            unsigned n = I->getNumOperands();
+            assert(n <= 2);
+            Const *ops[2];
+            for (unsigned i = 0; i < n; i++) {
+                auto v = get(I->getOperand(i));
+                if (v.state == Overdefined) {
+                    update(I->reg.get(), {Overdefined, nullptr});
+                    return;
+                }
+                if (v.state == Unknown)
+                    return;
+                ops[i] = asConst(v.c);
+            }
+            auto c = foldInstruction(I, ops);
+            update(I->reg.get(), c ? LatticeVal{Constant, c} : LatticeVal{Overdefined, nullptr});
+            return;
+        }
+        default:
+            // 访存、调用等结果无法在编译期确定
+            if (I->reg)
+                update(I->reg.get(), {Overdefined, nullptr});
+            return;
+        }
+    }
+
+    void solve() {
+        while (!cfgWork.empty() || !ssaWork.empty()) {
+            while (!cfgWork.empty()) {
+                auto [pred, succ] = cfgWork.back();
+                cfgWork.pop_back();
+                if (pred) {
+                    if (isExecEdge(pred, succ))
+                        continue;
+                    execPreds[succ->idx].push_back(pred);
+                }
+                // 块第一次可执行时求值全部指令，之后新的入边只影响phi
+                bool first = !executable[succ->idx];
+                executable[succ->idx] = true;
+                for (auto &I : succ->instructions) {
+                    if (!first && I->type != Phi)
+                        break;
+                    visit(I.get());
+                }
+            }
+            while (!ssaWork.empty()) {
+                auto I = ssaWork.back();
+                ssaWork.pop_back();
+                auto it = blockOf.find(I);
+                if (it != blockOf.end() && executable[it->second])
+                    visit(I);
+            }
+        }
+    }
+
+    void run() {
+        cfgWork.push_back({nullptr, func->getEntryBlock().get()});
+        solve();
+        // 没有undef时可执行块中的条件都应被求出，保险起见仍未知的条件按非常量处理
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto &bb : func->basicBlocks) {
+                if (!executable[bb->idx] || bb->instructions.back()->type != Br)
+                    continue;
+                auto B = (BrInstruction *)bb->instructions.back().get();
+                if (B->exp && get(B->exp).state == Unknown) {
+                    values[B->exp.get()] = {Overdefined, nullptr};
+                    visitBr(B);
+                    changed = true;
+                }
+            }
+            solve();
+        }
+    }
+};
+
+void removeIncomingFrom(BasicBlockPtr bb, BasicBlockPtr pred) {
+    for (auto &I : bb->instructions) {
+        if (I->type != Phi)
+            break;
+        ((PhiInstruction *)I.get())->removeIncomingByBB(pred);
+    }
+}
+
+}
+
+void sccp(FunctionPtr func) {
+    SCCPSolver solver(func);
+    solver.run();
+    auto &executable = solver.executable;
+
+    // 替换结果为常量的指令
+    int folded = 0;
+    for (auto &bb : func->basicBlocks) {
+        if (!executable[bb->idx])
+            continue;
+        for (auto it = bb->instructions.begin(); it != bb->instructions.end();) {
+            auto &I = *it;
+            auto v = I->reg ? solver.get(I->reg) : LatticeVal{};
+            if (v.state == Constant) {
+                replaceUses(I->reg, v.c);
+                deleteUser(I.get());
+                it = bb->instructions.erase(it);
+                folded++;
+            } else {
+                it++;
+            }
+        }
+    }
+
+    if (folded)
+        analysisManager.invalidate(func, AnalysisLoop);
+
+    // 条件为常量的跳转改为直接跳转，去掉另一条边
+    int branches = 0;
+    for (auto &bb : func->basicBlocks) {
+        if (!executable[bb->idx] || bb->instructions.back()->type != Br)
+            continue;
+        auto B = (BrInstruction *)bb->instructions.back().get();
+        if (!B->exp || !asConst(B->exp))
+            continue;
+        bool taken = constTruth(asConst(B->exp));
+        auto live = taken ? B->label_true : B->label_false;
+        auto dead = taken ? B->label_false : B->label_true;
+        auto liveBB = func->LabelBBMap[live], deadBB = func->LabelBBMap[dead];
+        deleteUser(B);
+        B->exp = nullptr;
+        B->label_true = live;
+        B->label_false = nullptr;
+        if (deadBB != liveBB) {
+            removeEdgeInCFG(bb, deadBB);
+            removeIncomingFrom(deadBB, bb);
+        }
+        branches++;
+    }
+
+    // 删除不可执行的块
+    int removed = 0;
+    vector<BasicBlockPtr> newBB;
+    for (auto &bb : func->basicBlocks) {
+        if (executable[bb->idx]) {
+            newBB.push_back(bb);
+            continue;
+        }
+        for (auto &succ : bb->succBasicBlocks)
+            if (executable[succ->idx])
+                removeIncomingFrom(succ, bb);
+        for (auto &I : bb->instructions)
+            deleteUser(I.get());
+        removeBlockInCFG(func, bb);
+        removed++;
+    }
+
+    if (branches || removed) {
+        // 跳转被折叠，原有的支配树和循环信息不再可信
+        analysisManager.invalidate(func, AnalysisDom);
+        func->basicBlocks = newBB;
+        func->renumberBasicBlocks();
+        // 只剩一个入边的phi直接用入边的值替换
+        for (auto &bb : func->basicBlocks) {
+            for (auto it = bb->instructions.begin(); it != bb->instructions.end() && (*it)->type == Phi;) {
+                auto P = (PhiInstruction *)it->get();
+                if (P->from.size() == 1) {
+                    replaceVarByVar(P->reg, P->from[0].first);
+                    deleteUser(P);
+                    it = bb->instructions.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+    }
+#ifdef VERIFY_CFG
+    if(!verifyCFG(func))
+        abort();
+#endif
+    passStats.add("sccp", "values folded", folded);
+    passStats.add("sccp", "branches folded", branches);
+    passStats.add("sccp", "blocks removed", removed);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include "Module.h"
+#include "analysisManager.h"
+#include "createCFG.h"
+
+// 稀疏条件常量传播（Wegman-Zadeck）：每个值一个格（未知/常量/非常量），
+// 只沿可执行的边求值，一遍同时完成常量折叠、条件跳转折叠和不可达块删除
+void sccp(FunctionPtr func);
+// 沿use链找被影响的指令；折叠了跳转或删了块时自行使支配树失效，
+// 折叠了值时自行使循环失效（SCEV记录的归纳变量、边界可能被删）
+const unsigned sccpRequires = AnalysisCFG | AnalysisUse;
+const unsigned sccpPreserves = AnalysisCFG | AnalysisDom | AnalysisLoop;
@@ -9,9 +9,7 @@ bool removeUnreachableBlocks(FunctionPtr func){
             newBB.push_back(func->basicBlocks[i]);
         }
         else{
-            for(auto succ:func->basicBlocks[i]->succBasicBlocks){
-                succ->predBasicBlocks.erase(func->basicBlocks[i]);
-            }
+            removeBlockInCFG(func, func->basicBlocks[i]);
             change = true;
         }
     }
@@ -23,12 +21,15 @@ bool removeUnreachableBlocks(FunctionPtr func){
                 auto Pi = dynamic_cast<PhiInstruction*>((*it).get());
                 for(auto fit = Pi->from.begin();fit!=Pi->from.end();){
                     if(bb->predBasicBlocks.find(fit->second)==bb->predBasicBlocks.end()){
+                        SharedUseLock lock(fit->first.get());
                         Use *use = fit->first->useHead;
                         while (use != nullptr)
                         {
+                            // 同一个值可能从多个前驱流入，只摘掉这一项对应的use
                             if (use->user == (*it).get())
                             {
                                 use->rmUse();
+                                break;
                             }
                             use = use->next;
                         }   
@@ -57,46 +58,28 @@ bool removeUnreachableBlocks(FunctionPtr func){
 
 
 void deleteOneFromOneToBB(FunctionPtr func){
-    for(auto it = func->basicBlocks.begin();it!=func->basicBlocks.end();it++){
-        auto bb = *it;
+    auto entry = func->getEntryBlock();
+    vector<BasicBlockPtr> newBB;
+    for(auto bb:func->basicBlocks){
         //前缀为1
-        if(bb->predBasicBlocks.size()==1){
-            for(auto pred:bb->predBasicBlocks){
-                if(auto bI = dynamic_cast<BrInstruction*>(pred->instructions.back().get())){
-                    //前缀的后缀为1
-                    if(!bI->exp){
-                        assert(pred->succBasicBlocks.size()==1&&"has succBasicBlock not equal 1");
-                        // auto br = bb->instructions.back();
-                        pred->instructions.pop_back();
-                        //bb不可能有phi
-                        pred->instructions.insert(pred->instructions.end(),bb->instructions.begin(),bb->instructions.end());
-                        pred->succBasicBlocks = bb->succBasicBlocks;
-                        for(auto succ:bb->succBasicBlocks){
-                            succ->predBasicBlocks.erase(bb);
-                            succ->predBasicBlocks.insert(pred);
-                            for(auto I:succ->instructions){
-                                if(I->type == Phi){
-                                    auto Pi = dynamic_cast<PhiInstruction*> (I.get());
-                                    for(int i = 0;i<Pi->from.size();i++){
-                                        if(Pi->from[i].second == bb){
-                                            Pi->from[i].second = pred;
-                                        }
-                                    }
-                                }
-                                else{
-                                    break;
-                                }
-                            }
-                        }
-                        it = func->basicBlocks.erase(it);
-                        it--;
-                    }
+        if(bb != entry && bb->predBasicBlocks.size()==1){
+            auto pred = *bb->predBasicBlocks.begin();
+            if(auto bI = dynamic_cast<BrInstruction*>(pred->instructions.back().get())){
+                //前缀的后缀为1
+                if(!bI->exp && pred != bb){
+                    assert(pred->succBasicBlocks.size()==1&&"has succBasicBlock not equal 1");
+                    //bb不可能有phi
+                    mergeBlockIntoPred(func, pred, bb);
+                    continue;
                 }
             }
         }
+        newBB.push_back(bb);
     }
+    func->basicBlocks = newBB;
 }
 
+
 //to-do 多个return的merge先放着，感觉没啥用
 
 
@@ -106,15 +89,15 @@ void findFunctionBackedges(FunctionPtr func, vector<pair<BasicBlockPtr,BasicBloc
         return;
     }
     unordered_set<BasicBlockPtr> visited;
-    vector<pair<BasicBlockPtr,unordered_set<BasicBlockPtr>::const_iterator>> visitStack;
+    vector<pair<BasicBlockPtr,BasicBlockSet::const_iterator>> visitStack;
     unordered_set<BasicBlockPtr> inStack;
     visited.insert(BB);
     visitStack.push_back({BB,BB->succBasicBlocks.begin()});
     inStack.insert(BB);
     do{
-        pair<BasicBlockPtr, unordered_set<BasicBlockPtr>::const_iterator>&top = visitStack.back();
+        pair<BasicBlockPtr, BasicBlockSet::const_iterator>&top = visitStack.back();
         BasicBlockPtr ParentBB = top.first;
-        unordered_set<BasicBlockPtr>::const_iterator &I = top.second;
+        BasicBlockSet::const_iterator &I = top.second;
         bool FoundNew = false;
         while(I!=ParentBB->succBasicBlocks.end()){
             BB = *I++;
@@ -175,7 +158,13 @@ static bool iterativeSimplifyCFG(FunctionPtr func){
     return Changed;
 }
 
+// 增量维护CFG和支配树，结束后二者仍然有效
 void simplifyCFG(FunctionPtr func){
     removeUnreachableBlocks(func);
     deleteOneFromOneToBB(func);
+    func->renumberBasicBlocks();
+#ifdef VERIFY_CFG
+    if(!verifyCFG(func))
+        abort();
+#endif
 }
\ No newline at end of file
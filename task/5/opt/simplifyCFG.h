@@ -6,5 +6,10 @@
 #include <stack>
 #include <math.h>
 #include "Module.h"
+#include "analysisManager.h"
+#include "createCFG.h"
 
-void simplifyCFG(FunctionPtr func);
\ No newline at end of file
+void simplifyCFG(FunctionPtr func);
+// 增量维护CFG和支配树
+const unsigned simplifyCFGRequires = AnalysisCFG | AnalysisDom;
+const unsigned simplifyCFGPreserves = AnalysisCFG | AnalysisDom;
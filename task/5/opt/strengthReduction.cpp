@@ -15,9 +15,9 @@ void strengthReduction(FunctionPtr func) {
     int regCount = 0;
     for (auto &bb : func->basicBlocks)
     {
-        for (int i = 0; i < bb->instructions.size(); i ++)
+        for (auto it = bb->instructions.begin(); it != bb->instructions.end(); it ++)
         {
-            auto &ins = bb->instructions[i];
+            auto ins = *it;
             if (ins->type == InsID::Binary)
             {
                 auto binary = dynamic_cast<BinaryInstruction *>(ins.get());
@@ -31,9 +31,9 @@ void strengthReduction(FunctionPtr func) {
                         if (const_lhs->intVal > 0 && isExp(const_lhs->intVal))
                         {
                             auto shamt = Const::getConst(Type::getInt(),int(log2(const_lhs->intVal)), "strengthReduction%" + to_string(regCount++));
-                            auto new_binary = new BinaryInstruction(rhs, shamt, ',', ins->basicblock);
+                            auto new_binary = newIR<BinaryInstruction>(rhs, shamt, ',', nonOwning(ins->basicblock));
                             replaceVarByVar(binary->reg, new_binary->reg);
-                            bb->instructions[i] = shared_ptr<Instruction>(new_binary);
+                            it = bb->instructions.replace(it, new_binary);
                         }
                     }
                     else if (rhs->isConst && lhs->type->ID == IntID) 
@@ -42,9 +42,9 @@ void strengthReduction(FunctionPtr func) {
                         if (const_rhs->intVal > 0 && isExp(const_rhs->intVal))
                         {
                             auto shamt = Const::getConst(Type::getInt(),int(log2(const_rhs->intVal)), "strengthReduction%" + to_string(regCount++));
-                            auto new_binary = new BinaryInstruction(lhs, shamt, ',', ins->basicblock);
+                            auto new_binary = newIR<BinaryInstruction>(lhs, shamt, ',', nonOwning(ins->basicblock));
                             replaceVarByVar(binary->reg, new_binary->reg);
-                            bb->instructions[i] = shared_ptr<Instruction>(new_binary);
+                            it = bb->instructions.replace(it, new_binary);
                         }
                     }
                 }
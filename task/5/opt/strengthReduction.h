@@ -6,5 +6,8 @@
 #include <stack>
 #include <math.h>
 #include "Module.h"
+#include "analysisManager.h"
 
-void strengthReduction(FunctionPtr func);
\ No newline at end of file
+void strengthReduction(FunctionPtr func);
+const unsigned strengthReductionRequires = AnalysisNone;
+const unsigned strengthReductionPreserves = AnalysisCFG | AnalysisDom | AnalysisLoop;
@@ -0,0 +1,313 @@
+#include "vectorLoop.h"
+
+
+static bool isConstInt(ValuePtr v, int x) {
+    return v->isConst && dynamic_cast<Const *>(v.get())->intVal == x;
+}
+
+template <typename Pred>
+static bool allUsers(ValuePtr v, Pred pred) {
+    for (auto u = v->useHead; u; u = u->next)
+        if (!pred(u->user))
+            return false;
+    return true;
+}
+
+// 全局数组、局部数组或指针参数，地址在整个函数中不变
+static bool isArrayBase(FunctionPtr func, ValuePtr v) {
+    if (dynamic_cast<AllocaInstruction *>(v->I))
+        return v->type->isArr();
+    auto var = dynamic_cast<Variable *>(v.get());
+    if (var && var->isGlobal)
+        return v->type->isArr();
+    for (auto arg : func->formArguments)
+        if (v == arg)
+            return v->type->isPtr() && dynamic_cast<PtrType *>(v->type.get())->inner->getID() == IntID;
+    return false;
+}
+
+// 不同数组之间只有指针参数可能与其他参数或全局数组重叠
+static bool arraysMayAlias(ValuePtr a, ValuePtr b) {
+    if (a == b)
+        return true;
+    bool a_arg = a->type->isPtr(), b_arg = b->type->isPtr();
+    bool a_local = dynamic_cast<AllocaInstruction *>(a->I) != nullptr;
+    bool b_local = dynamic_cast<AllocaInstruction *>(b->I) != nullptr;
+    return (a_arg && b_arg) || (a_arg && !b_local) || (b_arg && !a_local);
+}
+
+// gep按emit_Gep的方式计算元素偏移，要求最后一维是归纳变量，其余维是常量
+static bool unitStrideAccess(GetElementPtrInstruction *gep, map<Value *, int> &isIndex, int &offset) {
+    auto &index = gep->index;
+    if (!isIndex.count(index.back().get()))
+        return false;
+    offset = 0;
+    if (index.size() == 1)
+        return gep->from->type->isPtr();
+    if (!isConstInt(index[0], 0))
+        return false;
+    TypePtr cur = gep->from->type;
+    for (size_t k = 1; k < index.size(); k++) {
+        if (!cur->isArr())
+            return false;
+        auto arr = dynamic_cast<ArrType *>(cur.get());
+        if (k < index.size() - 1) {
+            if (!index[k]->isConst)
+                return false;
+            offset += arr->getStride() * dynamic_cast<Const *>(index[k].get())->intVal;
+        }
+        cur = arr->inner;
+    }
+    return cur->getID() == IntID;
+}
+
+bool analyzeVectorLoop(FunctionPtr func, LoopPtr loop, VectorLoop &vl) {
+    auto header = loop->getHeader(), latch = loop->getLatchBlock();
+    if (!loop->getSubLoops().empty() || loop->getLoopBasicBlocks().size() != 2 || !loop->getPreheader() ||
+        !latch || latch == header || !loop->indPhi || !loop->indCondVar || !loop->indEnd)
+        return false;
+    auto icmp = dynamic_cast<IcmpInstruction *>(loop->indCondVar.get());
+    auto br = dynamic_cast<BrInstruction *>(header->instructions.back().get());
+    auto latchBr = dynamic_cast<BrInstruction *>(latch->instructions.back().get());
+    if (!icmp || !br || br->exp != icmp->reg || br->label_true->name != latch->label->name)
+        return false;
+    if (!latchBr || latchBr->exp || latchBr->label_true->name != header->label->name)
+        return false;
+    for (auto I : header->instructions)
+        if (I->type != Phi && I.get() != icmp && I.get() != br)
+            return false;
+
+    // i < n、i <= n及其交换形式，步长为1
+    vl.loop = loop;
+    vl.ind = loop->indPhi;
+    ValuePtr i = vl.ind->reg;
+    auto kind = loop->getIcmpKind();
+    if (vl.ind->basicblock != header.get() || loop->indEnd->type->getID() != IntID)
+        return false;
+    if (icmp->a == i && (kind == ICmpSLT || kind == ICmpSLE))
+        vl.threshold = kind == ICmpSLT ? 4 : 3;
+    else if (icmp->b == i && (kind == ICmpSGT || kind == ICmpSGE))
+        vl.threshold = kind == ICmpSGT ? 4 : 3;
+    else
+        return false;
+
+    // 头块的phi只能是归纳变量和求和归约，它们在latch中的新值只流回phi
+    for (auto I : header->instructions) {
+        auto phi = dynamic_cast<PhiInstruction *>(I.get());
+        if (!phi)
+            continue;
+        if (phi->from.size() != 2 || phi->reg->type->getID() != IntID ||
+            (phi->from[0].second == latch) == (phi->from[1].second == latch))
+            return false;
+        ValuePtr next = phi->from[0].second == latch ? phi->from[0].first : phi->from[1].first;
+        auto upd = dynamic_cast<BinaryInstruction *>(next->I);
+        if (!upd || upd->basicblock != latch.get() || !allUsers(next, [&](Instruction *u) { return u == phi; }))
+            return false;
+        if (phi == vl.ind) {
+            if (!(upd->op == '+' && ((upd->a == i && isConstInt(upd->b, 1)) || (upd->b == i && isConstInt(upd->a, 1)))))
+                return false;
+            vl.inc = upd;
+        } else {
+            ValuePtr s = phi->reg;
+            bool sum = upd->op == '+' && (upd->a == s) != (upd->b == s);
+            bool diff = upd->op == '-' && upd->a == s && upd->b != s;
+            if (!sum && !diff)
+                return false;
+            if (!allUsers(s, [&](Instruction *u) { return u == upd || !loop->contains(u->basicblock); }))
+                return false;
+            vl.reduction[upd] = phi;
+        }
+    }
+
+    // 逐条检查循环体：下标、地址、向量值（加载结果及其运算）和循环不变量
+    map<Value *, int> isIndex, isVector;
+    isIndex[i.get()] = 1;
+    auto invariant = [&](ValuePtr v) {
+        return loop->isSimpleLoopInvariant(v) && v->type->getID() == IntID;
+    };
+    auto operandOk = [&](ValuePtr v) { return isVector.count(v.get()) || invariant(v); };
+    for (auto I : latch->instructions) {
+        if (I.get() == latchBr)
+            continue;
+        vl.body.push_back(I.get());
+        switch (I->type) {
+            case Ext: {
+                auto ext = dynamic_cast<ExtInstruction *>(I.get());
+                if (!isIndex.count(ext->from.get()))
+                    return false;
+                isIndex[ext->reg.get()] = 1;
+            } break;
+            case GEP: {
+                auto gep = dynamic_cast<GetElementPtrInstruction *>(I.get());
+                int offset;
+                if (!isArrayBase(func, gep->from) || !unitStrideAccess(gep, isIndex, offset))
+                    return false;
+                // 地址只用于本块的load/store
+                bool onlyMemory = allUsers(gep->reg, [&](Instruction *u) {
+                    auto st = dynamic_cast<StoreInstruction *>(u);
+                    return u->basicblock == latch.get() && (u->type == Load || (st && st->value != gep->reg));
+                });
+                if (!onlyMemory)
+                    return false;
+                vl.access[gep->reg.get()] = {gep->from, offset};
+            } break;
+            case Load: {
+                auto ld = dynamic_cast<LoadInstruction *>(I.get());
+                if (!vl.access.count(ld->from.get()) || ld->to->type->getID() != IntID)
+                    return false;
+                isVector[ld->to.get()] = 1;
+            } break;
+            case Store: {
+                auto st = dynamic_cast<StoreInstruction *>(I.get());
+                if (!vl.access.count(st->des.get()) || !operandOk(st->value))
+                    return false;
+            } break;
+            case Binary: {
+                auto bi = dynamic_cast<BinaryInstruction *>(I.get());
+                if (bi == vl.inc)
+                    break;
+                if (vl.reduction.count(bi)) {
+                    auto s = vl.reduction[bi]->reg;
+                    if (!isVector.count((bi->a == s ? bi->b : bi->a).get()))
+                        return false;
+                    break;
+                }
+                if (bi->op != '+' && bi->op != '-' && bi->op != '*')
+                    return false;
+                if (!operandOk(bi->a) || !operandOk(bi->b) ||
+                    (!isVector.count(bi->a.get()) && !isVector.count(bi->b.get())))
+                    return false;
+                isVector[bi->reg.get()] = 1;
+            } break;
+            default:
+                return false;
+        }
+    }
+    // 下标只用于地址计算，向量值不能在循环外使用
+    for (auto &v : isVector) {
+        bool inside = true;
+        for (auto u = v.first->useHead; u; u = u->next)
+            inside = inside && u->user->basicblock == latch.get();
+        if (!inside)
+            return false;
+    }
+    for (auto I : vl.body)
+        if (I->type != GEP && I->type != Ext && I != vl.inc)
+            for (unsigned k = 0; k < I->getNumOperands(); k++)
+                if (isIndex.count(I->getOperand(k).get()))
+                    return false;
+
+    // 同一数组只能访问同一个元素；写入的数组与其他数组不能重叠
+    vector<pair<ValuePtr, int>> loads, stores;
+    for (auto I : vl.body) {
+        if (I->type == Load)
+            loads.push_back(vl.access[dynamic_cast<LoadInstruction *>(I)->from.get()]);
+        if (I->type == Store)
+            stores.push_back(vl.access[dynamic_cast<StoreInstruction *>(I)->des.get()]);
+    }
+    for (auto &st : stores) {
+        for (auto other : {&loads, &stores})
+            for (auto &a : *other) {
+                if (a.first == st.first && a.second != st.second)
+                    return false;
+                if (a.first != st.first && arraysMayAlias(a.first, st.first))
+                    return false;
+            }
+    }
+
+    // 只被一次加减使用的乘法合并为vmla/vmls：累加到归约的累加器，或累加到随后不再使用的向量值
+    map<Instruction *, int> pos;
+    for (size_t k = 0; k < vl.body.size(); k++)
+        pos[vl.body[k]] = k;
+    map<Instruction *, Instruction *> fusedInto;
+    for (auto I : vl.body) {
+        auto mul = dynamic_cast<BinaryInstruction *>(I);
+        if (!mul || mul->op != '*' || !isVector.count(mul->reg.get()) || mul->reg->getNumUses() != 1)
+            continue;
+        auto user = dynamic_cast<BinaryInstruction *>(mul->reg->useHead->user);
+        if (!user || !(user->op == '+' || (user->op == '-' && user->b == mul->reg)))
+            continue;
+        if (!vl.reduction.count(user)) {
+            ValuePtr z = user->a == mul->reg ? user->b : user->a;
+            if (z == mul->reg || !isVector.count(z.get()) || z->getNumUses() != 1 || fusedInto.count(z->I))
+                continue;
+        }
+        vl.fused.insert(mul);
+        fusedInto[mul] = user;
+    }
+
+    // 向量值最后一次被使用的位置，合并的乘法的操作数在其使用者处使用
+    map<Value *, int> lastUse;
+    for (auto I : vl.body) {
+        int at = fusedInto.count(I) ? pos[fusedInto[I]] : pos[I];
+        for (unsigned k = 0; k < I->getNumOperands(); k++) {
+            auto v = I->getOperand(k).get();
+            if (isVector.count(v))
+                lastUse[v] = max(lastUse[v], at);
+        }
+    }
+
+    // 顺序分配q寄存器，不变量的广播和累加器占用整个循环
+    bool busy[neonQRegCount] = {};
+    auto alloc = [&](Value *v) {
+        for (int k = 0; k < neonQRegCount; k++)
+            if (!busy[k]) {
+                busy[k] = true;
+                vl.qreg[v] = neonFirstQReg + k;
+                return true;
+            }
+        return false;
+    };
+    for (auto I : vl.body) {
+        if (I == vl.inc || vl.reduction.count(I) || (I->type != Binary && I->type != Store))
+            continue;
+        for (unsigned k = 0; k < I->getNumOperands(); k++) {
+            auto v = I->getOperand(k);
+            if (isVector.count(v.get()) || vl.access.count(v.get()) || vl.qreg.count(v.get()))
+                continue;
+            if (!alloc(v.get()))
+                return false;
+            vl.broadcast.push_back(v);
+        }
+    }
+    for (auto &r : vl.reduction)
+        if (!alloc(r.second->reg.get()))
+            return false;
+    for (auto I : vl.body) {
+        int at = pos[I];
+        if (I == vl.inc || vl.fused.count(I) || I->type == GEP || I->type == Ext)
+            continue;
+        // 先释放在这里最后一次使用的向量值，目的寄存器可以与操作数相同
+        set<Value *> dying;
+        auto collect = [&](Instruction *J) {
+            for (unsigned k = 0; k < J->getNumOperands(); k++) {
+                auto v = J->getOperand(k).get();
+                if (isVector.count(v) && lastUse[v] == at && !vl.fused.count(dynamic_cast<Instruction *>(v->I)))
+                    dying.insert(v);
+            }
+        };
+        collect(I);
+        for (unsigned k = 0; k < I->getNumOperands(); k++)
+            if (auto J = dynamic_cast<Instruction *>(I->getOperand(k)->I); J && vl.fused.count(J))
+                collect(J);
+        Value *acc = nullptr;
+        if (I->type == Binary && !vl.reduction.count(I))
+            for (unsigned k = 0; k < I->getNumOperands(); k++)
+                if (auto J = dynamic_cast<Instruction *>(I->getOperand(k)->I); J && vl.fused.count(J)) {
+                    acc = I->getOperand(1 - k).get();
+                    dying.erase(acc);
+                }
+        for (auto v : dying)
+            busy[vl.qreg[v] - neonFirstQReg] = false;
+        if (I->type == Load || (I->type == Binary && !vl.reduction.count(I))) {
+            auto def = I->type == Load ? dynamic_cast<LoadInstruction *>(I)->to.get() : I->reg.get();
+            if (acc)
+                vl.qreg[def] = vl.qreg[acc];
+            else if (!alloc(def))
+                return false;
+            if (!lastUse.count(def))
+                busy[vl.qreg[def] - neonFirstQReg] = false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <set>
+#include "Module.h"
+#include "Loop.h"
+
+// 后端NEON向量化处理的循环形式，中端（loopUnroll）与后端（arm.cpp）共用同一个判断，两边不会各自演变：
+// 最内层的简单计数循环：头块只有phi、icmp和br，循环体是唯一的latch块，例如
+//   while (i < n) { a[i] = b[i] * c[i] + k; s = s + a[i]; i = i + 1; }
+// 数组下标的最后一维是归纳变量、其余维是常量，只有i32的加、减、乘和求和归约。
+// 向量值固定放在q8-q15（AAPCS中调用者保存，向量循环里没有函数调用），不参与寄存器分配
+
+const int neonFirstQReg = 8, neonQRegCount = 8;
+
+struct VectorLoop {
+    LoopPtr loop;
+    PhiInstruction *ind = nullptr;           // 归纳变量i
+    Instruction *inc = nullptr;              // i + 1
+    int threshold = 4;                       // n - i >= threshold时至少还剩4次迭代，为3时cmp i, n后gt不再进入循环，否则ge
+    vector<Instruction *> body;              // latch中除br外的指令
+    map<Value *, pair<ValuePtr, int>> access;     // gep -> (数组基址, 常量元素偏移)
+    map<Instruction *, PhiInstruction *> reduction; // 归约的更新指令 -> 归约phi
+    set<Instruction *> fused;                // 合并进使用者vmla/vmls的乘法
+    vector<ValuePtr> broadcast;              // 需要广播到q寄存器的循环不变量
+    map<Value *, int> qreg;                  // 向量值、广播的不变量、累加器（以phi为键）所在的q寄存器
+};
+
+// 判断循环能否向量化，并给向量值分配q寄存器；需要循环分析（含SCEV的归纳变量）和use链
+bool analyzeVectorLoop(FunctionPtr func, LoopPtr loop, VectorLoop &vl);
@@ -0,0 +1,260 @@
+// -emit-obj的编码测试：手工构造一段覆盖各类指令的机器代码，用build_program_object输出目标文件，
+// 逐字比对.text和重定位。期望值取自GNU as/llvm-mc对同一段汇编的编码，
+// 其中对本文件函数的bl由汇编器留给链接器，这里是直接回填的偏移
+// 构建：cmake --build <build> --target task5-object-test
+// 运行：task5-object-test，全部一致时返回0，否则打印不一致的位置
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include "arm.h"
+
+// 期望的.text，callee在0，main从4开始
+static const uint32 expectedText[] = {
+    0xe12fff1e, // callee: bx lr
+    0xe92d4010, // push {r4, lr}
+    0xe52d5004, // str r5, [sp, #-4]!          单个寄存器的push
+    0xe3a004ff, // mov r0, #0xff000000         循环右移立即数
+    0xe2801fff, // add r1, r0, #0x3fc
+    0xe2812010, // add r2, r1, #16             sub #-16
+    0xe3e03001, // mvn r3, #1                  mov #-2
+    0xe3c340ff, // bic r4, r3, #255            and #0xffffff00
+    0xe3700001, // cmn r0, #1                  cmp #-1
+    0xe0810102, // add r0, r1, r2, lsl #2
+    0xe1a00021, // lsr r0, r1, #32
+    0xe1a00251, // asr r0, r1, r2
+    0xe1b06007, // movs r6, r7
+    0xe0000291, // mul r0, r1, r2
+    0xe710f211, // sdiv r0, r1, r2
+    0xe0203291, // mla r0, r1, r2, r3
+    0xe16f0f11, // clz r0, r1
+    0xe7910102, // ldr r0, [r1, r2, lsl #2]
+    0xe5010008, // str r0, [r1, #-8]
+    0xe5910fff, // ldr r0, [r1, #4095]
+    0xe5843000, // str r3, [r4]
+    0xe3050678, // movw r0, #0x5678            常量0x12345678
+    0xe3410234, // movt r0, #0x1234
+    0xe3a010ff, // mov r1, #255
+    0xe3e02004, // mvn r2, #4                  常量-5
+    0xe30b3eef, // movw r3, #0xbeef
+    0xe3004000, // movw r4, #:lower16:g
+    0xe3404000, // movt r4, #:upper16:g
+    0xebffffe2, // bl callee                   本文件的函数，直接回填
+    0xebfffffe, // bl putint                   R_ARM_CALL
+    0x1bfffffe, // blne getint                 R_ARM_JUMP24
+    0x0a000009, // beq .L2
+    0xf4600a8f, // .L1: vld1.32 {d16, d17}, [r0]
+    0xeea21b90, // vdup.32 q9, r1
+    0xf2c04050, // vmov.i32 q10, #0
+    0xf26008e2, // vadd.i32 q8, q8, q9
+    0xf26049e2, // vmla.i32 q10, q8, q9
+    0xf26069f2, // vmul.i32 q11, q8, q9
+    0xf26448a5, // vadd.i32 d20, d20, d21
+    0xf2644bb4, // vpadd.i32 d20, d20, d20
+    0xee140b90, // vmov.32 r0, d20[0]
+    0xeaffffd6, // b .L0
+    0xe49d5004, // .L2: ldr r5, [sp], #4       单个寄存器的pop
+    0xe8bd4010, // pop {r4, lr}
+    0xe12fff1e, // bx lr
+};
+
+struct ExpectedReloc {
+    uint32 offset;
+    const char *symbol;
+    uint32 type;
+};
+
+static const ExpectedReloc expectedRelocs[] = {
+    {0x68, "g", R_ARM_MOVW_ABS_NC},
+    {0x6c, "g", R_ARM_MOVT_ABS},
+    {0x74, "putint", R_ARM_CALL},
+    {0x78, "getint", R_ARM_JUMP24},
+};
+
+static MOperand qreg(int q) { return MOperand(QREG, q); }
+
+static Machine_Block *newBlock(Func_Asm *func) {
+    auto mb = new Machine_Block;
+    mb->i = func->mbs.len;
+    mb->func = func;
+    func->mbs.push(mb);
+    return mb;
+}
+
+static Func_Asm *buildCallee() {
+    auto func = new Func_Asm;
+    func->name = "callee";
+    newBlock(func)->push(new MI_Return());
+    return func;
+}
+
+static Func_Asm *buildMain() {
+    auto func = new Func_Asm;
+    func->name = "main";
+    auto b0 = newBlock(func), b1 = newBlock(func), b2 = newBlock(func);
+    auto r = make_reg;
+
+    auto push = new MI_Push();
+    push->operands.push(r(4));
+    push->operands.push(r(lr));
+    b0->push(push);
+    auto push1 = new MI_Push();
+    push1->operands.push(r(5));
+    b0->push(push1);
+
+    // 立即数放不下时换成另一条指令
+    b0->push(new MI_Move(r(0), make_imm(0xff000000)));
+    b0->push(new MI_Binary(BINARY_ADD, r(1), r(0), make_imm(0x3fc)));
+    b0->push(new MI_Binary(BINARY_SUBTRACT, r(2), r(1), make_imm(-16)));
+    b0->push(new MI_Move(r(3), make_imm(-2)));
+    b0->push(new MI_Binary(BINARY_BITWISE_AND, r(4), r(3), make_imm(0xffffff00)));
+    b0->push(new MI_Compare(r(0), make_imm(-1)));
+
+    // 移位
+    b0->push(new MI_Binary(BINARY_ADD, r(0), r(1), MOperand(REG, 2, LSL, 2)));
+    b0->push(new MI_Binary(BINARY_LSR, r(0), r(1), make_imm(32)));
+    b0->push(new MI_Binary(BINARY_ASR, r(0), r(1), r(2)));
+    auto movs = new MI_Move(r(6), r(7));
+    movs->update_flags = true;
+    b0->push(movs);
+
+    // 乘除
+    b0->push(new MI_Binary(BINARY_MULTIPLY, r(0), r(1), r(2)));
+    b0->push(new MI_Binary(BINARY_DIVIDE, r(0), r(1), r(2)));
+    b0->push(new MI_ComplexMul(COMPLEX_MLA, r(0), r(1), r(2), r(3)));
+    auto clz = new MI_Clz();
+    clz->dst = r(0);
+    clz->operand = r(1);
+    b0->push(clz);
+
+    // ldr/str的几种偏移
+    auto mem = [&](bool load, uint8 rt, uint8 rn, MOperand offset) {
+        MI *I;
+        if (load) {
+            auto ldr = new MI_Load();
+            ldr->reg = r(rt), ldr->base = r(rn), ldr->offset = offset;
+            I = ldr;
+        } else {
+            auto str = new MI_Store();
+            str->reg = r(rt), str->base = r(rn), str->offset = offset;
+            I = str;
+        }
+        b0->push(I);
+    };
+    mem(true, 0, 1, MOperand(REG, 2, LSL, 2));
+    mem(false, 0, 1, make_imm(-8));
+    mem(true, 0, 1, make_imm(4095));
+    mem(false, 3, 4, MOperand());
+
+    // 常量和全局地址都用movw/movt，不用文字池
+    auto load = [&](uint8 rt, MOperand base) {
+        auto ldr = new MI_Load();
+        ldr->reg = r(rt);
+        ldr->base = base;
+        b0->push(ldr);
+    };
+    load(0, make_imm(0x12345678));
+    load(1, make_imm(255));
+    load(2, make_imm(-5));
+    load(3, make_imm(0xbeef));
+    load(4, MOperand(ADR_GLOBAL, "g"));
+
+    // 调用：本文件的函数直接回填，外部函数生成重定位
+    b0->push(new MI_Func_Call("callee"));
+    b0->push(new MI_Func_Call("putint"));
+    auto blne = new MI_Func_Call("getint");
+    blne->cond = NOT_EQUAL;
+    b0->push(blne);
+    b0->push(new MI_Branch(EQUAL, b2, b1));
+
+    // NEON
+    b1->push(new MI_Neon_Mem(MI_VLD1, qreg(8), r(0)));
+    b1->push(new MI_Neon_Dup(qreg(9), r(1)));
+    b1->push(new MI_Neon_Dup(qreg(10), make_imm(0)));
+    b1->push(new MI_Neon_Binary(BINARY_ADD, qreg(8), qreg(8), qreg(9)));
+    b1->push(new MI_Neon_Binary(BINARY_ADD, qreg(10), qreg(8), qreg(9), true));
+    b1->push(new MI_Neon_Binary(BINARY_MULTIPLY, qreg(11), qreg(8), qreg(9)));
+    b1->push(new MI_Neon_Reduce(r(0), qreg(10)));
+    b1->push(new MI_Branch(NO_CONDITION, b0));
+
+    auto pop1 = new MI_Pop();
+    pop1->operands.push(r(5));
+    b2->push(pop1);
+    auto pop = new MI_Pop();
+    pop->operands.push(r(4));
+    pop->operands.push(r(lr));
+    b2->push(pop);
+    b2->push(new MI_Return());
+    return func;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, uint32 offset, uint32 got, uint32 expected) {
+    if (ok)
+        return;
+    failures++;
+    printf("%s @0x%02x: got 0x%08x, expected 0x%08x\n", what, offset, got, expected);
+}
+
+int main() {
+    IRArena arena;
+    IRArena::Scope scope(&arena);
+    vector<VariablePtr> globals = {newIR<Int>("g", true, false, 7)};
+
+    Program_Asm program;
+    program.functions.push(buildCallee());
+    program.functions.push(buildMain());
+
+    FILE *f = tmpfile();
+    build_program_object(f, &program, globals);
+    long size = ftell(f);
+    vector<uint8> image(size);
+    rewind(f);
+    if (fread(image.data(), 1, size, f) != (size_t)size) {
+        printf("cannot read back the object file\n");
+        return 1;
+    }
+    fclose(f);
+
+    auto eh = (Elf32_Ehdr *)image.data();
+    auto sh = (Elf32_Shdr *)(image.data() + eh->e_shoff);
+    const char *shstr = (const char *)image.data() + sh[eh->e_shstrndx].sh_offset;
+    auto section = [&](const char *name) -> Elf32_Shdr * {
+        for (int k = 0; k < eh->e_shnum; k++)
+            if (!strcmp(shstr + sh[k].sh_name, name))
+                return &sh[k];
+        printf("missing section %s\n", name);
+        exit(1);
+    };
+
+    auto text = section(".text");
+    size_t count = sizeof(expectedText) / sizeof(expectedText[0]);
+    check(text->sh_size == count * 4, ".text size", 0, text->sh_size, count * 4);
+    auto words = (const uint32 *)(image.data() + text->sh_offset);
+    for (size_t k = 0; k < count && k * 4 < text->sh_size; k++)
+        check(words[k] == expectedText[k], ".text", k * 4, words[k], expectedText[k]);
+
+    auto rel = section(".rel.text"), symtab = section(".symtab"), strtab = section(".strtab");
+    auto syms = (const Elf32_Sym *)(image.data() + symtab->sh_offset);
+    const char *strs = (const char *)image.data() + strtab->sh_offset;
+    auto rels = (const Elf32_Rel *)(image.data() + rel->sh_offset);
+    size_t relCount = rel->sh_size / sizeof(Elf32_Rel);
+    size_t expectedRelCount = sizeof(expectedRelocs) / sizeof(expectedRelocs[0]);
+    check(relCount == expectedRelCount, ".rel.text count", 0, relCount, expectedRelCount);
+    for (size_t k = 0; k < relCount && k < expectedRelCount; k++) {
+        auto &e = expectedRelocs[k];
+        const char *name = strs + syms[ELF32_R_SYM(rels[k].r_info)].st_name;
+        check(rels[k].r_offset == e.offset, ".rel.text offset", e.offset, rels[k].r_offset, e.offset);
+        check(ELF32_R_TYPE(rels[k].r_info) == e.type, ".rel.text type", e.offset, ELF32_R_TYPE(rels[k].r_info), e.type);
+        if (strcmp(name, e.symbol)) {
+            failures++;
+            printf(".rel.text symbol @0x%02x: got %s, expected %s\n", e.offset, name, e.symbol);
+        }
+    }
+
+    if (failures)
+        printf("%d mismatches\n", failures);
+    else
+        printf("object encoding matches\n");
+    return failures != 0;
+}
@@ -0,0 +1,159 @@
+// 指令调度的单元测试：手工构造带各类依赖的基本块，分别做分配前、分配后调度，
+// 检查依赖对的先后不变、屏障不动、load和它的使用者之间确实插入了别的指令
+// 构建：cmake --build <build> --target task5-schedule-test
+// 运行：task5-schedule-test，全部满足时返回0，否则打印不满足的约束
+#include <cstdio>
+#include "arm.h"
+#include "asm_passes.h"
+
+static int failures = 0;
+
+struct Block {
+    Func_Asm *func;
+    Machine_Block *mb;
+    vector<MI *> insts;
+
+    explicit Block(const char *name) {
+        func = new Func_Asm;
+        func->name = name;
+        mb = new Machine_Block;
+        mb->i = 0;
+        mb->func = func;
+        func->mbs.push(mb);
+    }
+
+    int add(MI *I) {
+        mb->push(I);
+        insts.push_back(I);
+        return insts.size() - 1;
+    }
+
+    // 调度后第k条原指令的位置
+    vector<int> positions() {
+        vector<int> pos(insts.size(), -1);
+        int p = 0;
+        for (auto I = mb->inst; I; I = I->next, p++)
+            for (size_t k = 0; k < insts.size(); k++)
+                if (insts[k] == I)
+                    pos[k] = p;
+        return pos;
+    }
+};
+
+static MI_Load *load(MOperand rt, MOperand base, MOperand offset = MOperand()) {
+    auto ldr = new MI_Load();
+    ldr->reg = rt, ldr->base = base, ldr->offset = offset;
+    return ldr;
+}
+
+static MI_Store *store(MOperand rt, MOperand base, MOperand offset = MOperand()) {
+    auto str = new MI_Store();
+    str->reg = rt, str->base = base, str->offset = offset;
+    return str;
+}
+
+static MI *cond(MI *I, Branch_Condition c) {
+    I->cond = c;
+    return I;
+}
+
+static void expect(bool ok, const char *name, const char *what) {
+    if (ok)
+        return;
+    failures++;
+    printf("%s: %s\n", name, what);
+}
+
+static void expect_before(const vector<int> &pos, int a, int b, const char *name) {
+    if (pos[a] < pos[b])
+        return;
+    failures++;
+    printf("%s: instruction %d must stay before %d (now at %d and %d)\n", name, a, b, pos[a], pos[b]);
+}
+
+static void expect_fixed(const vector<int> &pos, int a, const char *name) {
+    if (pos[a] == a)
+        return;
+    failures++;
+    printf("%s: barrier %d moved to %d\n", name, a, pos[a]);
+}
+
+// 分配后：物理寄存器、内存、条件标志的依赖，调用是屏障
+static void post_ra() {
+    Block b("post_ra");
+    auto r = make_reg;
+    int ld = b.add(load(r(0), r(1)));
+    int use = b.add(new MI_Binary(BINARY_ADD, r(2), r(0), make_imm(1)));
+    int st = b.add(store(r(2), r(1), make_imm(4)));
+    int ld_same = b.add(load(r(3), r(1), make_imm(4)));       // 与上面的str同一地址
+    int ld_other = b.add(load(r(4), r(1), make_imm(8)));      // 与str不重叠，可以提前
+    int mul = b.add(new MI_Binary(BINARY_MULTIPLY, r(5), r(6), r(7)));
+    int cmp = b.add(new MI_Compare(r(5), make_imm(0)));
+    int movne = b.add(cond(new MI_Move(r(8), make_imm(1)), NOT_EQUAL));
+    int sum = b.add(new MI_Binary(BINARY_ADD, r(9), r(3), r(4)));
+    int call = b.add(new MI_Func_Call("g"));
+    int mov = b.add(new MI_Move(r(0), make_imm(3)));
+    int ld2 = b.add(load(r(1), r(2)));
+    int use2 = b.add(new MI_Binary(BINARY_ADD, r(1), r(1), r(0)));
+    int ret = b.add(new MI_Return());
+
+    Program_Asm program;
+    program.functions.push(b.func);
+    schedule_post_ra(&program);
+    auto pos = b.positions();
+
+    expect_before(pos, ld, use, "post_ra");
+    expect_before(pos, use, st, "post_ra");
+    expect_before(pos, st, ld_same, "post_ra");
+    expect_before(pos, ld_same, sum, "post_ra");
+    expect_before(pos, ld_other, sum, "post_ra");
+    expect_before(pos, mul, cmp, "post_ra");
+    expect_before(pos, cmp, movne, "post_ra");
+    expect_before(pos, mov, use2, "post_ra");
+    expect_before(pos, ld2, use2, "post_ra");
+    expect_fixed(pos, call, "post_ra");
+    expect_fixed(pos, ret, "post_ra");
+    expect(pos[use] > pos[ld] + 1, "post_ra", "nothing scheduled between ldr and its use");
+    expect(pos[ld_other] < pos[st], "post_ra", "independent ldr not hoisted above the str");
+    expect(b.mb->last_inst == b.insts[ret] && !b.mb->last_inst->next, "post_ra", "block list not relinked");
+}
+
+// 分配前：虚拟寄存器，条件执行的定值是屏障
+static void pre_ra() {
+    Block b("pre_ra");
+    auto v = make_vreg;
+    int ld = b.add(load(v(0), v(10)));
+    int use = b.add(new MI_Binary(BINARY_ADD, v(1), v(0), make_imm(1)));
+    int mov = b.add(new MI_Move(v(2), make_imm(7)));
+    int cmp = b.add(new MI_Compare(v(3), make_imm(0)));
+    int movge = b.add(cond(new MI_Move(v(4), make_imm(1)), GREATER_THAN_OR_EQUAL));
+    int movlt = b.add(cond(new MI_Move(v(4), make_imm(0)), LESS_THAN));
+    int mul = b.add(new MI_Binary(BINARY_MULTIPLY, v(5), v(6), v(7)));
+    int sum = b.add(new MI_Binary(BINARY_ADD, v(8), v(1), v(5)));
+    int ret = b.add(new MI_Return());
+    b.func->has_return_value = false;
+
+    Program_Asm program;
+    program.functions.push(b.func);
+    schedule_pre_ra(&program);
+    auto pos = b.positions();
+
+    expect_before(pos, ld, use, "pre_ra");
+    expect_before(pos, cmp, movge, "pre_ra");
+    expect_before(pos, mul, sum, "pre_ra");
+    expect_fixed(pos, movge, "pre_ra");
+    expect_fixed(pos, movlt, "pre_ra");
+    expect_fixed(pos, ret, "pre_ra");
+    expect(pos[use] > pos[ld] + 1, "pre_ra", "nothing scheduled between ldr and its use");
+    expect(pos[mov] < movge && pos[mul] > movlt, "pre_ra", "instruction crossed a conditional definition");
+}
+
+int main() {
+    post_ra();
+    pre_ra();
+    if (failures)
+        printf("%d failures\n", failures);
+    else
+        printf("schedule constraints hold\n");
+    return failures != 0;
+}
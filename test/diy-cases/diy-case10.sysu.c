@@ -0,0 +1,86 @@
+//test partial inlining of early-return guards
+#include <sysy/sylib.h>
+int calls;
+int buf[64];
+
+// 递归调用不能整体内联，开头的判断返回形参
+int fib(int n) {
+  if (n < 2) {
+    return n;
+  }
+  calls = calls + 1;
+  return fib(n - 1) + fib(n - 2);
+}
+
+// 判断不成立时才提前返回，返回值是entry中算出的值
+int sumRange(int lo, int hi) {
+  int d = hi - lo;
+  int e = d * 2;
+  if (d > 0) {
+    calls = calls + 1;
+    int s = 0;
+    int i = lo;
+    while (i < hi) {
+      s = s + buf[(i % 64 + 64) % 64] * (i - lo + 1);
+      if (s > 100000) {
+        s = s - 100000;
+      }
+      i = i + 1;
+    }
+    int j = 0;
+    while (j < d) {
+      buf[((lo + j) % 64 + 64) % 64] = buf[((lo + j) % 64 + 64) % 64] + s % 7;
+      j = j + 1;
+    }
+    return s;
+  }
+  return e;
+}
+
+// void函数，判断成立时什么也不做
+void touch(int idx, int v) {
+  if (idx < 0) {
+    return;
+  }
+  calls = calls + 1;
+  int k = 0;
+  while (k < 3) {
+    buf[(idx + k) % 64] = buf[(idx + k) % 64] + v - k;
+    k = k + 1;
+  }
+  if (buf[idx % 64] > 1000) {
+    buf[idx % 64] = buf[idx % 64] % 1000;
+  }
+}
+
+int main() {
+  int i = 0;
+  while (i < 64) {
+    buf[i] = i * 5 % 13;
+    i = i + 1;
+  }
+  calls = 0;
+  int total = 0;
+  i = -3;
+  while (i < 20) {
+    total = total + fib(i % 12);
+    total = total + sumRange(i, i % 5 + 8);
+    touch(i * 7 - 30, i);
+    // 第二个实参只有call用到，判断中不会再用
+    touch(i, i * 3 + 1);
+    i = i + 1;
+  }
+  putint(total);
+  putch(32);
+  putint(calls);
+  putch(10);
+  i = 0;
+  int h = 0;
+  while (i < 64) {
+    h = (h * 31 + buf[i]) % 1000007;
+    i = i + 1;
+  }
+  putint(h);
+  putch(10);
+  return calls % 256;
+}
@@ -0,0 +1,10 @@
+main entry while.cond6 1
+main while.cond6 while.body6 12
+main while.cond6 while.end6 1
+main while.end6 while.cond7 1
+main while.cond7 while.body7 7
+main while.cond7 while.end7 1
+main while.end7 while.cond8 1
+main while.cond8 while.body8 32
+main while.cond8 while.end8 1
+main while.body8 while.cond8 32
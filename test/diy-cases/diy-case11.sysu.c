@@ -0,0 +1,124 @@
+//test partial loop unrolling with runtime trip counts
+#include <sysy/sylib.h>
+int arr[32];
+
+// 向上计数，次数由参数决定，不一定是展开倍数的整数倍
+int upward(int lo, int hi) {
+  int s = 0;
+  int i = lo;
+  while (i < hi) {
+    s = (s * 3 + i) % 10007;
+    i = i + 1;
+  }
+  return s * 100 + (i - lo);
+}
+
+// 步长为2，终值包含在内
+int upwardStep(int lo, int hi) {
+  int s = 0;
+  int i = lo;
+  while (i <= hi) {
+    s = (s * 7 + i) % 10007;
+    i = i + 2;
+  }
+  return s;
+}
+
+// 向下计数
+int downward(int hi, int lo) {
+  int s = 0;
+  int i = hi;
+  while (i > lo) {
+    s = (s * 5 + i) % 10007;
+    i = i - 1;
+  }
+  return s * 100 + (hi - i);
+}
+
+// 向下计数，步长为3，终值包含在内，顺带写数组
+int downwardStep(int hi, int lo) {
+  int i = hi;
+  int c = 0;
+  while (i >= lo) {
+    arr[i % 32] = arr[i % 32] + i;
+    c = c + 1;
+    i = i - 3;
+  }
+  return c;
+}
+
+// 终值接近INT32_MAX，end-(factor-1)*step不能溢出
+int nearMax(int lo, int hi) {
+  int c = 0;
+  int x = 0;
+  int i = lo;
+  while (i < hi) {
+    x = (x * 3 + i % 1000) % 10007;
+    c = c + 1;
+    i = i + 1;
+  }
+  return c * 1000 + x;
+}
+
+// 终值接近INT32_MIN的向下循环
+int nearMin(int hi, int lo) {
+  int c = 0;
+  int x = 0;
+  int i = hi;
+  while (i > lo) {
+    x = (x * 3 - i % 1000) % 10007;
+    c = c + 1;
+    i = i - 1;
+  }
+  return c * 1000 + x;
+}
+
+int main() {
+  int n = 0;
+  while (n < 12) {
+    putint(upward(n - 3, 2 * n - 3));
+    putch(32);
+    putint(upwardStep(-n, n));
+    putch(32);
+    putint(downward(n, -n / 2));
+    putch(32);
+    putint(downwardStep(n * 2, 1));
+    putch(10);
+    n = n + 1;
+  }
+
+  int max = getint();
+  int min = getint();
+  int k = getint();
+  while (k > 0) {
+    int d = getint();
+    // 上界为INT32_MAX，只差d次
+    putint(nearMax(max - d, max));
+    putch(32);
+    // 上界是常量INT32_MAX，内联后走常量终值的分支
+    putint(nearMax(max - d, 2147483647));
+    putch(32);
+    // 上界离INT32_MIN很近，提前检查不通过，全部交给原循环
+    putint(nearMax(min, min + d));
+    putch(32);
+    // 下界为INT32_MIN
+    putint(nearMin(min + d, min));
+    putch(32);
+    putint(nearMin(min + d, -2147483647 - 1));
+    putch(32);
+    // 下界离INT32_MAX很近
+    putint(nearMin(max, max - d));
+    putch(10);
+    k = k - 1;
+  }
+
+  int i = 0;
+  int h = 0;
+  while (i < 32) {
+    h = (h * 31 + arr[i]) % 1000007;
+    i = i + 1;
+  }
+  putint(h);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,97 @@
+//test neon vectorized loops
+#include <sysy/sylib.h>
+int a[103], b[103], c[103], d[103];
+int m[10][2];
+
+// 形参数组可能互相别名，循环必须保持标量
+void shift(int x[], int y[], int n) {
+  int i = 0;
+  while (i < n) {
+    x[i] = y[i] + 1;
+    i = i + 1;
+  }
+}
+
+int sum(int n) {
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    s = s + a[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int i = 0;
+  while (i < 103) {
+    b[i] = i * 3 - 50;
+    c[i] = 7 - i;
+    d[i] = i - i / 5 * 5 + 1;
+    i = i + 1;
+  }
+
+  // 迭代次数不是4的倍数
+  i = 0;
+  while (i < 103) {
+    a[i] = b[i] + c[i] * 2;
+    i = i + 1;
+  }
+  putint(sum(103));
+  putch(10);
+  putint(a[100]);
+  putch(32);
+  putint(a[101]);
+  putch(32);
+  putint(a[102]);
+  putch(10);
+
+  // i <= n，向量循环的进入条件少一次迭代
+  int n = 97;
+  i = 0;
+  while (i <= n) {
+    a[i] = b[i] - c[i];
+    i = i + 1;
+  }
+  putint(sum(103));
+  putch(10);
+
+  // 乘加合并为vmla、乘减合并为vmls
+  i = 0;
+  while (i < 101) {
+    a[i] = b[i] + c[i] * d[i];
+    i = i + 1;
+  }
+  putint(sum(101));
+  putch(10);
+  i = 0;
+  while (i < 102) {
+    a[i] = b[i] - c[i] * d[i];
+    i = i + 1;
+  }
+  putint(sum(102));
+  putch(10);
+
+  // 乘积的求和归约
+  int s = 0;
+  i = 0;
+  while (i < 99) {
+    s = s + c[i] * d[i];
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+
+  // m[1]从m[0]后两个元素开始，x[i]依赖两次迭代前写入的值
+  m[0][0] = 5;
+  m[0][1] = 9;
+  shift(m[1], m[0], 18);
+  i = 0;
+  while (i < 10) {
+    putint(m[i][0] + m[i][1]);
+    putch(32);
+    i = i + 1;
+  }
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,46 @@
+//test division and modulo by constants
+#include <sysy/sylib.h>
+int xs[5];
+
+void put2(int q, int r) {
+  putint(q);
+  putch(32);
+  putint(r);
+  putch(32);
+}
+
+// 除数都是常量，后端用移位或乘法代替sdiv
+void check(int x) {
+  put2(x / 1, x % 1);
+  // INT_MIN / -1溢出，跳过
+  if (x != -2147483647 - 1) {
+    put2(x / -1, x % -1);
+  }
+  put2(x / 2, x % 2);
+  put2(x / -2, x % -2);
+  put2(x / 16, x % 16);
+  put2(x / -16, x % -16);
+  put2(x / 1073741824, x % 1073741824);
+  put2(x / -1073741824, x % -1073741824);
+  put2(x / 3, x % 3);
+  put2(x / -3, x % -3);
+  put2(x / 7, x % 7);
+  put2(x / -7, x % -7);
+  put2(x / 641, x % 641);
+  put2(x / 2147483647, x % 2147483647);
+  putch(10);
+}
+
+int main() {
+  xs[0] = -2147483647 - 1;
+  xs[1] = 2147483647;
+  xs[2] = 0;
+  xs[3] = 1;
+  xs[4] = -1;
+  int i = 0;
+  while (i < 5) {
+    check(xs[i]);
+    i = i + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+//test sparse conditional constant propagation
+#include <sysy/sylib.h>
+const int N = 10;
+int g;
+
+// x在循环中只会被赋为1，只有同时跟踪可执行边才能把phi折叠成常量
+int loopConst(int n) {
+  int x = 1;
+  int i = 0;
+  while (i < n) {
+    if (x != 1) {
+      x = 2;
+      putint(-1);
+    }
+    i = i + 1;
+  }
+  return x;
+}
+
+// 比较的结果都是常量，else分支不可达，其中的除零和输出都不能执行
+int foldCompare() {
+  int a = 6;
+  int b = a * 7;
+  int c = b - 40;
+  if (b == 42 && c < 3) {
+    if (c >= 2 || 1 / (c - 2) > 0) {
+      return b + c;
+    }
+    putint(-2);
+    return 0;
+  } else {
+    putint(-3);
+    return 1 / (c - 2);
+  }
+}
+
+// 两条路径上的值相同，合并后仍然是常量
+int samePhi(int flag) {
+  int y;
+  if (flag > 0) {
+    y = 3 + 4;
+  } else {
+    y = 14 / 2;
+  }
+  int z = 0;
+  if (y == 7) {
+    z = y * N;
+  } else {
+    z = -1;
+    g = g + 100;
+  }
+  return z;
+}
+
+// 条件依赖参数时不能折叠
+int notConst(int n) {
+  int x = 0;
+  if (n > 5) {
+    x = 1;
+  }
+  if (x == 1) {
+    return 10;
+  }
+  return 20;
+}
+
+// 循环次数为常量，循环结束后的分支只有一边可达
+int countedLoop() {
+  int i = 0;
+  int done = 0;
+  while (i < N) {
+    i = i + 1;
+  }
+  if (i == N) {
+    done = 1;
+  } else {
+    g = g + 1000;
+    putint(-4);
+  }
+  return done + i;
+}
+
+int main() {
+  g = 0;
+  putint(loopConst(0));
+  putch(32);
+  putint(loopConst(N));
+  putch(10);
+  putint(foldCompare());
+  putch(10);
+  putint(samePhi(1));
+  putch(32);
+  putint(samePhi(-1));
+  putch(10);
+  putint(notConst(3));
+  putch(32);
+  putint(notConst(8));
+  putch(10);
+  putint(countedLoop());
+  putch(10);
+  putint(g);
+  putch(10);
+  return loopConst(3) + foldCompare();
+}
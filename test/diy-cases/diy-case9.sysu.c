@@ -0,0 +1,73 @@
+//test dead store elimination
+#include <sysy/sylib.h>
+int g;
+int garr[8];
+
+// 同一常量偏移被再次写入，前一个store是死的
+void overwriteGlobal() {
+  garr[2] = 22222;
+  garr[2] = 5;
+  garr[3] = 6;
+}
+
+// 不是main，返回后调用者还会读g，store必须保留
+// 递归调用的是函数本身，即使main中的调用被内联，这里的store仍在非main函数中
+void addG(int n) {
+  if (n == 0) {
+    return;
+  }
+  addG(n - 1);
+  g = g + n;
+}
+
+// a[0]在下一次迭代开头被读，循环末尾的store经过MemoryPhi后仍是活的
+int loopCarried(int n) {
+  int a[2];
+  a[0] = 1;
+  a[1] = 0;
+  int i = 0;
+  while (i < n) {
+    int x = a[0];
+    a[1] = a[1] + x;
+    a[0] = x + i;
+    i = i + 1;
+  }
+  return a[1];
+}
+
+// b[i]每次迭代地址都不同，不能被下一次迭代里同一条store当作覆盖
+int loopIndexed(int n) {
+  int b[10];
+  int s = 0;
+  int i = 0;
+  while (i < n) {
+    if (i > 0) {
+      s = s + b[i - 1];
+    }
+    b[i] = i * 3;
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int a[4];
+  a[1] = 11111;
+  a[1] = 7;
+  a[2] = 8;
+  overwriteGlobal();
+  addG(6);
+  putint(a[1] + a[2]);
+  putch(32);
+  putint(garr[2] + garr[3]);
+  putch(32);
+  putint(g);
+  putch(10);
+  putint(loopCarried(6));
+  putch(32);
+  putint(loopIndexed(10));
+  putch(10);
+  // main返回后没有人再读g
+  g = 33333;
+  return 0;
+}
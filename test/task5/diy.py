@@ -0,0 +1,124 @@
+"""用实验五的编译器按给定的几组参数分别编译一个 diy 测例，
+汇编产物用 `arm-linux-gnueabihf-gcc` 链接后在 qemu 中运行；
+同时用 clang 把测例编译为本机程序作为参考答案。
+每组参数的输出和返回值都必须与参考答案一致，否则返回非零。
+给出--absent时，每组参数输出的IR中都不能出现匹配的内容，用于检查某些指令确实被优化掉了。
+"""
+
+import sys
+import os
+import os.path as osp
+import re
+import argparse
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+TIME_OUT: int = 20
+
+
+class Error(Exception):
+    pass
+
+
+def run(cmd, outdir, name, stdin_path):
+    """运行程序，返回(标准输出, 返回值)，标准错误写到 outdir/name.err"""
+    stdin = open(stdin_path, "rb") if stdin_path else subps.DEVNULL
+    with open(osp.join(outdir, name + ".err"), "wb") as ferr:
+        try:
+            p = subps.run(cmd, stdin=stdin, stdout=subps.PIPE, stderr=ferr, timeout=TIME_OUT)
+        except subps.TimeoutExpired:
+            raise Error(f"{name} 运行超时")
+        finally:
+            if stdin_path:
+                stdin.close()
+    with open(osp.join(outdir, name + ".out"), "wb") as f:
+        f.write(p.stdout)
+    return p.stdout, p.returncode
+
+
+def build(cmd, outdir, name, stdout=None):
+    with open(osp.join(outdir, name + ".compile"), "wb") as f:
+        try:
+            retn = subps.run(cmd, stdout=stdout or f, stderr=f, timeout=TIME_OUT * 3).returncode
+        except subps.TimeoutExpired:
+            raise Error(f"{name} 编译超时")
+    if retn:
+        raise Error(f"{name} 编译失败（{retn}），见 {name}.compile")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验五 diy 测例", description=__doc__)
+    parser.add_argument("src", help="测例源文件")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task5", help="task5-classic程序路径")
+    parser.add_argument("gcc", help="gcc程序路径")
+    parser.add_argument("qemu_path", help="qemu程序路径")
+    parser.add_argument("rtlib_a", help="运行时库文件路径")
+    parser.add_argument("clang", help="clang程序路径")
+    parser.add_argument("rtlib", help="运行时库源码路径")
+    parser.add_argument("rtlib_so", help="本机运行时库路径")
+    parser.add_argument(
+        "--flags",
+        action="append",
+        default=None,
+        help="一组编译参数，以空格分隔，可多次给出；不给时只用默认参数编译",
+    )
+    parser.add_argument("--absent", default=None, help="输出的IR中不能出现的内容（正则）")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    os.makedirs(args.bindir, exist_ok=True)
+    input_path = args.src.removesuffix(".sysu.c") + ".in"
+    if not osp.exists(input_path):
+        input_path = None
+
+    try:
+        # 参考答案
+        ref_exe = osp.join(args.bindir, "answer.exe")
+        build(
+            [
+                args.clang,
+                "-O0",
+                "-I",
+                osp.join(args.rtlib, "include"),
+                "-o",
+                ref_exe,
+                args.src,
+                args.rtlib_so,
+            ],
+            args.bindir,
+            "answer",
+        )
+        answer = run([ref_exe], args.bindir, "answer", input_path)
+
+        # 实验五的文法不认识预处理指令，运行时函数由编译器内置声明，直接去掉#include
+        src = osp.join(args.bindir, "input.sysu.c")
+        with open(args.src, "r", encoding="utf-8") as fin, open(src, "w", encoding="utf-8") as fout:
+            for line in fin:
+                fout.write("\n" if line.lstrip().startswith("#") else line)
+
+        failed = False
+        for i, flags in enumerate(args.flags or [""]):
+            name = f"output{i}"
+            asm = osp.join(args.bindir, name + ".s")
+            with open(osp.join(args.bindir, name + ".ll"), "wb") as fll:
+                build([args.task5, *flags.split(), src, asm], args.bindir, name, fll)
+            if args.absent:
+                with open(osp.join(args.bindir, name + ".ll"), "r", encoding="utf-8") as fll:
+                    found = re.search(args.absent, fll.read())
+                if found:
+                    failed = True
+                    print(f"[{flags}] {name}.ll 中不应出现 {found.group(0)}")
+            exe = osp.join(args.bindir, name + ".exe")
+            build([args.gcc, "--static", "-o", exe, asm, args.rtlib_a], args.bindir, name + ".link")
+            output = run([args.qemu_path, exe], args.bindir, name, input_path)
+            print(f"[{flags}] 返回值 {output[1]}")
+            if output != answer:
+                failed = True
+                print(f"[{flags}] 与参考答案不一致（参考返回值 {answer[1]}），见 {name}.out 与 answer.out")
+    except Error as e:
+        print(e)
+        exit(1)
+    exit(1 if failed else 0)